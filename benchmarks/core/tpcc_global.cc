@@ -12,6 +12,7 @@ uint32_t g_max_items              = MAX_ITEMS;
 uint32_t g_cust_per_dist          = MAX_CUST_PER_DIST;
 uint32_t g_max_txn_retry          = MAX_TXN_RETRY;
 bool     g_use_upserts            = false;
+bool     g_prefetch               = false;
 uint32_t g_total_num_transactions = TOTAL_NUM_TRANSACTIONS;
 
 /**********************************************/
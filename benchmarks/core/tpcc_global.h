@@ -33,6 +33,7 @@ extern uint32_t g_max_items;
 extern uint32_t g_cust_per_dist;
 extern uint32_t g_max_txn_retry;
 extern bool     g_use_upserts;
+extern bool     g_prefetch;
 extern uint32_t g_total_num_transactions;
 
 uint64_t
@@ -119,14 +119,15 @@ TPCCWorkload::init(utils::Properties              &props,
    printf(
       "Initializing TPCCWorkload; num_wh = %d, g_max_items = %d, "
       "g_cust_per_dist = %d, g_max_txn_retry = %d, g_abort_penalty_us = %d, "
-      "g_total_num_transactions = %d, g_use_upsert = %d\n",
+      "g_total_num_transactions = %d, g_use_upsert = %d, g_prefetch = %d\n",
       g_num_wh,
       g_max_items,
       g_cust_per_dist,
       g_max_txn_retry,
       g_abort_penalty_us,
       g_total_num_transactions,
-      g_use_upserts);
+      g_use_upserts,
+      g_prefetch);
    _db = db;
    // load all tables in the database
    tpcc_buffer = new drand48_data[g_num_wh];
@@ -171,6 +172,7 @@ TPCCWorkload::configure_parameters(utils::Properties &props)
       "total_num_transactions", std::to_string(TOTAL_NUM_TRANSACTIONS)));
    g_use_upserts =
       props.GetProperty("use_upserts", std::to_string(false)) == "true";
+   g_prefetch = props.GetProperty("prefetch", std::to_string(false)) == "true";
 }
 
 void *
@@ -695,6 +697,23 @@ TPCCWorkload::run_new_order(TPCCTransaction *txn)
    // printf("NEW_ORDER on warehouse: %lu, district: %lu, client: %lu\n",
    // txn->w_id, txn->d_id, txn->c_id);
 
+   if (g_prefetch) {
+      // Read the rows the transaction looks up from disk all at once
+      TPCCKey  keys[3 + 2 * MAX_OL_PER_ORDER];
+      uint32_t num_keys = 0;
+      keys[num_keys++]  = wKey(txn->w_id);
+      keys[num_keys++]  = dKey(txn->d_id, txn->w_id);
+      keys[num_keys++]  = cKey(txn->c_id, txn->d_id, txn->w_id);
+      for (uint32_t ol_number = 0; ol_number < txn->ol_cnt; ol_number++) {
+         keys[num_keys++] = iKey(txn->items[ol_number].ol_i_id);
+         if (!g_use_upserts) {
+            keys[num_keys++] = sKey(txn->items[ol_number].ol_i_id,
+                                    txn->items[ol_number].ol_supply_w_id);
+         }
+      }
+      _db->Prefetch(keys, sizeof(TPCCKey), num_keys);
+   }
+
    ycsbc::Transaction *t = NULL;
    _db->Begin(&t);
 
@@ -76,16 +76,82 @@ TransactionalSplinterDB::TransactionalSplinterDB(
    splinterdb_cfg.num_normal_bg_threads =
       props.GetIntProperty("splinterdb.num_normal_bg_threads");
 
+   transaction_protocol protocol = transaction_protocol_from_name(
+      props.GetProperty("splinterdb.txn_protocol").c_str());
+   if (protocol == TRANSACTION_PROTOCOL_INVALID) {
+      throw utils::Exception("Unknown transaction protocol: "
+                             + props.GetProperty("splinterdb.txn_protocol"));
+   }
+
+   transactional_splinterdb_config txn_splinterdb_cfg;
+   transactional_splinterdb_config_init(
+      &txn_splinterdb_cfg, &splinterdb_cfg, protocol);
+   // 0 keeps the default of the protocol
+   txn_splinterdb_cfg.isol_level = (transaction_isolation_level)
+      props.GetIntProperty("splinterdb.isolation_level");
+   txn_splinterdb_cfg.tscache_log_slots =
+      props.GetIntProperty("splinterdb.tscache_log_slots");
+   txn_splinterdb_cfg.sketch_rows =
+      props.GetIntProperty("splinterdb.sketch_rows");
+   txn_splinterdb_cfg.sketch_cols =
+      props.GetIntProperty("splinterdb.sketch_cols");
+   const string contention_policy =
+      props.GetProperty("splinterdb.contention_policy");
+   txn_splinterdb_cfg.contention_policy =
+      transaction_contention_policy_from_name(contention_policy.c_str());
+   if (txn_splinterdb_cfg.contention_policy == TRANSACTION_CONTENTION_INVALID)
+   {
+      throw utils::Exception("Unknown contention policy: " + contention_policy);
+   }
+   txn_splinterdb_cfg.contention_min_wait_ns =
+      props.GetIntProperty("splinterdb.contention_min_wait_ns");
+   txn_splinterdb_cfg.contention_max_wait_ns =
+      props.GetIntProperty("splinterdb.contention_max_wait_ns");
+   const string read_wait_policy =
+      props.GetProperty("splinterdb.read_wait_policy");
+   if (!read_wait_policy.empty()) {
+      txn_splinterdb_cfg.read_wait_policy =
+         transaction_read_wait_policy_from_name(read_wait_policy.c_str());
+      if (txn_splinterdb_cfg.read_wait_policy == TRANSACTION_READ_WAIT_INVALID)
+      {
+         throw utils::Exception("Unknown read wait policy: "
+                                + read_wait_policy);
+      }
+   }
+   txn_splinterdb_cfg.read_wait_spins =
+      props.GetIntProperty("splinterdb.read_wait_spins");
+   txn_splinterdb_cfg.read_wait_no_spin =
+      props.GetIntProperty("splinterdb.read_wait_no_spin");
+   const string timestamp_source =
+      props.GetProperty("splinterdb.timestamp_source");
+   if (!timestamp_source.empty()) {
+      txn_splinterdb_cfg.timestamp_source =
+         transaction_timestamp_source_from_name(timestamp_source.c_str());
+      if (txn_splinterdb_cfg.timestamp_source == TRANSACTION_TIMESTAMP_INVALID)
+      {
+         throw utils::Exception("Unknown timestamp source: "
+                                + timestamp_source);
+      }
+   }
+
+   txn_splinterdb_cfg.hot_key_sample_interval =
+      props.GetIntProperty("splinterdb.hot_key_sample_interval");
+   txn_splinterdb_cfg.phase_stats =
+      props.GetIntProperty("splinterdb.phase_stats");
+   txn_splinterdb_cfg.commutative_updates =
+      props.GetIntProperty("splinterdb.commutative_updates");
+   txn_splinterdb_cfg.hot_lock_threshold =
+      props.GetIntProperty("splinterdb.hot_lock_threshold");
+   txn_splinterdb_cfg.compact_timestamps =
+      props.GetIntProperty("splinterdb.compact_timestamps");
+
    if (preloaded) {
-      assert(!transactional_splinterdb_open(&splinterdb_cfg, &spl));
+      assert(!transactional_splinterdb_open_with_config(&txn_splinterdb_cfg,
+                                                        &spl));
    } else {
-      assert(!transactional_splinterdb_create(&splinterdb_cfg, &spl));
+      assert(!transactional_splinterdb_create_with_config(&txn_splinterdb_cfg,
+                                                          &spl));
    }
-
-   transactional_splinterdb_set_isolation_level(
-      spl,
-      (transaction_isolation_level)props.GetIntProperty(
-         "splinterdb.isolation_level"));
 }
 
 TransactionalSplinterDB::TransactionalSplinterDB(utils::Properties &props,
@@ -157,10 +223,38 @@ TransactionalSplinterDB::Scan(Transaction            *txn,
                               const vector<string>   *fields,
                               vector<vector<KVPair>> &result)
 {
-   assert(txn != NULL);
    assert(fields == NULL);
 
-   return DB::kErrorNotSupport;
+   slice key_slice = slice_create(key.size(), key.c_str());
+
+   if (txn == NULL) {
+      splinterdb_iterator *itor;
+      assert(!splinterdb_iterator_init(
+         transactional_splinterdb_get_db(spl), &itor, key_slice));
+      for (int i = 0; i < len && splinterdb_iterator_valid(itor); i++) {
+         slice key, val;
+         splinterdb_iterator_get_current(itor, &key, &val);
+         splinterdb_iterator_next(itor);
+      }
+      assert(!splinterdb_iterator_status(itor));
+      splinterdb_iterator_deinit(itor);
+      return DB::kOK;
+   }
+
+   transaction *txn_handle = &((SplinterDBTransaction *)txn)->handle;
+   transactional_splinterdb_iterator *itor;
+   assert(!transactional_splinterdb_iterator_init(
+      spl, txn_handle, &itor, key_slice));
+   for (int i = 0; i < len && transactional_splinterdb_iterator_valid(itor);
+        i++) {
+      slice key, val;
+      transactional_splinterdb_iterator_get_current(itor, &key, &val);
+      transactional_splinterdb_iterator_next(itor);
+   }
+   assert(!transactional_splinterdb_iterator_status(itor));
+   transactional_splinterdb_iterator_deinit(itor);
+
+   return DB::kOK;
 }
 
 int
@@ -355,9 +449,24 @@ TransactionalSplinterDB::Store(void    *key,
    return DB::kOK;
 }
 
+void
+TransactionalSplinterDB::Prefetch(const void *keys,
+                                  uint32_t    key_size,
+                                  uint32_t    num_keys)
+{
+   std::vector<slice> key_slices(num_keys);
+   for (uint32_t i = 0; i < num_keys; i++) {
+      key_slices[i] =
+         slice_create(key_size, (const char *)keys + (uint64_t)i * key_size);
+   }
+   splinterdb_prefetch(
+      transactional_splinterdb_get_db(spl), num_keys, key_slices.data());
+}
+
 ///
-/// Print splinterdb stats.
-/// It requires to set the config "use_stats" to 1.
+/// Print splinterdb stats, how long transactions waited for locks, why they
+/// aborted, and how long their phases took if "splinterdb.phase_stats" is 1.
+/// The splinterdb stats require to set the config "use_stats" to 1.
 ///
 void
 TransactionalSplinterDB::PrintDBStats() const
@@ -366,6 +475,16 @@ TransactionalSplinterDB::PrintDBStats() const
    splinterdb_stats_print_insertion(db);
    splinterdb_stats_print_lookup(db);
    splinterdb_stats_reset(db);
+   transaction_contention_stats contention;
+   transactional_splinterdb_contention_stats(spl, &contention);
+   cout << "Lock waits: " << contention.lock_waits << " ("
+        << contention.wait_ns << " ns), read waits: " << contention.read_waits
+        << " (" << contention.read_wait_ns << " ns)\n";
+   transactional_splinterdb_reset_contention_stats(spl);
+   transactional_splinterdb_print_abort_stats(spl);
+   transactional_splinterdb_reset_abort_stats(spl);
+   transactional_splinterdb_print_phase_stats(spl);
+   transactional_splinterdb_reset_phase_stats(spl);
 }
 
 int
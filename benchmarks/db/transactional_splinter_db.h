@@ -120,6 +120,13 @@ public:
           void        *value,
           uint32_t     value_size);
 
+   ///
+   /// Brings num_keys keys, of key_size bytes each and stored back to back
+   /// at keys, into the cache all at once, before a transaction reads them.
+   ///
+   void
+   Prefetch(const void *keys, uint32_t key_size, uint32_t num_keys);
+
    virtual void
    PrintDBStats() const;
 
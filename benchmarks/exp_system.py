@@ -10,12 +10,16 @@ available_systems = [
     'baseline-parallel',
     'silo-memory',
     'tictoc-memory',
+    'tictoc-memory-compact',
     'tictoc-counter',
     'tictoc-sketch',
     'sto-sketch',
     'sto-counter',
     'sto-memory',
     '2pl-no-wait',
+    '2pl-wait-die',
+    '2pl-wound-wait',
+    '2pl-detect',
 ]
 
 system_dir_map = {
@@ -24,22 +28,44 @@ system_dir_map = {
 }
 
 system_sed_map = {
-    'baseline-parallel': ["sed -i 's/\/\/ #define PARALLEL_VALIDATION/#define PARALLEL_VALIDATION/g' src/transaction_private.h"],
-    'silo-memory': ["sed -i 's/#define EXPERIMENTAL_MODE_SILO_MEMORY [ ]*0/#define EXPERIMENTAL_MODE_SILO_MEMORY 1/g' src/experimental_mode.h"],
-    'tictoc-disk': ["sed -i 's/#define EXPERIMENTAL_MODE_TICTOC_DISK [ ]*0/#define EXPERIMENTAL_MODE_TICTOC_DISK 1/g' src/experimental_mode.h"],
-    'tictoc-memory': ["sed -i 's/#define EXPERIMENTAL_MODE_TICTOC_MEMORY [ ]*0/#define EXPERIMENTAL_MODE_TICTOC_MEMORY 1/g' src/experimental_mode.h"],
-    'tictoc-counter': ["sed -i 's/#define EXPERIMENTAL_MODE_TICTOC_COUNTER [ ]*0/#define EXPERIMENTAL_MODE_TICTOC_COUNTER 1/g' src/experimental_mode.h"],
-    'tictoc-sketch': ["sed -i 's/#define EXPERIMENTAL_MODE_TICTOC_SKETCH [ ]*0/#define EXPERIMENTAL_MODE_TICTOC_SKETCH 1/g' src/experimental_mode.h"],
-    'sto-disk': ["sed -i 's/#define EXPERIMENTAL_MODE_STO_DISK [ ]*0/#define EXPERIMENTAL_MODE_STO_DISK 1/g' src/experimental_mode.h"],
-    'sto-memory': ["sed -i 's/#define EXPERIMENTAL_MODE_STO_MEMORY [ ]*0/#define EXPERIMENTAL_MODE_STO_MEMORY 1/g' src/experimental_mode.h"],
-    'sto-sketch': ["sed -i 's/#define EXPERIMENTAL_MODE_STO_SKETCH [ ]*0/#define EXPERIMENTAL_MODE_STO_SKETCH 1/g' src/experimental_mode.h"],
-    'sto-counter': ["sed -i 's/#define EXPERIMENTAL_MODE_STO_COUNTER [ ]*0/#define EXPERIMENTAL_MODE_STO_COUNTER 1/g' src/experimental_mode.h"],
-    '2pl-no-wait': ["sed -i 's/#define EXPERIMENTAL_MODE_2PL_NO_WAIT [ ]*0/#define EXPERIMENTAL_MODE_2PL_NO_WAIT 1/g' src/experimental_mode.h"],
-    '2pl-wait-die': ["sed -i 's/#define EXPERIMENTAL_MODE_2PL_WAIT_DIE [ ]*0/#define EXPERIMENTAL_MODE_2PL_WAIT_DIE 1/g' src/experimental_mode.h"],
-    '2pl-wound-wait': ["sed -i 's/#define EXPERIMENTAL_MODE_2PL_WOUND_WAIT [ ]*0/#define EXPERIMENTAL_MODE_2PL_WOUND_WAIT 1/g' src/experimental_mode.h"]
+    'baseline-parallel': ["sed -i 's/\/\/ #define PARALLEL_VALIDATION/#define PARALLEL_VALIDATION/g' src/transaction_private.h"]
+}
+
+# Systems that only differ in the concurrency control protocol share the same
+# build and pick the protocol at runtime.
+txn_protocols = [
+    'tictoc-disk',
+    'tictoc-memory',
+    'tictoc-counter',
+    'tictoc-sketch',
+    'sto-disk',
+    'sto-memory',
+    'sto-counter',
+    'sto-sketch',
+    '2pl-no-wait',
+    '2pl-wait-die',
+    '2pl-wound-wait',
+    '2pl-detect',
+    'silo-memory',
+    'mvcc',
+]
+
+# Variants of a protocol that only differ in its runtime options
+txn_protocol_variants = {
+    'tictoc-memory-compact': ('tictoc-memory',
+                              '-p splinterdb.compact_timestamps 1'),
 }
 
 class ExpSystem:
+    @staticmethod
+    def props(sys):
+        if sys in txn_protocols:
+            return f'-p splinterdb.txn_protocol {sys}'
+        if sys in txn_protocol_variants:
+            protocol, options = txn_protocol_variants[sys]
+            return f'-p splinterdb.txn_protocol {protocol} {options}'
+        return ''
+
     @staticmethod
     def build(sys):
 
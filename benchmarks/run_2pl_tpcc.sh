@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Compares deadlock detection with the deadlock prevention policies of 2PL
+
+result_dir=tpcc_2pl_results
+
+! test -d $result_dir && mkdir -p $result_dir
+
+for sys in 2pl-no-wait 2pl-wait-die 2pl-wound-wait 2pl-detect
+do
+    for wl in tpcc-wh4 tpcc-wh8 tpcc-wh16 tpcc-wh32
+    do
+	python3 run_tpcc.py -s $sys -w $wl -r 60 -f
+	cp $sys-$wl $sys-$wl.csv $result_dir
+    done
+done
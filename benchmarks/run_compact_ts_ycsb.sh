@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Compares the compact timestamps of TicToc memory with the wide ones
+
+result_dir=ycsb_compact_ts_results
+
+! test -d $result_dir && mkdir -p $result_dir
+
+for sys in tictoc-memory tictoc-memory-compact
+do
+    for wl in read_intensive write_intensive read_intensive_medium write_intensive_medium
+    do
+	python3 run_ycsb.py -s $sys -w $wl -r 60 -c 6144 -f
+	cp $sys-$wl $sys-$wl.csv $result_dir
+    done
+done
@@ -88,31 +88,25 @@ if not os.path.exists(results_path):
 results_path = os.path.join(results_path, f"{label}")
 os.mkdir(results_path)
 
-os.chdir(splinterdb_path)
-run_cmd("git checkout src/experimental_mode.h")
-run_cmd("sed -i 's/#define EXPERIMENTAL_MODE_TICTOC_SKETCH [ ]*0/#define EXPERIMENTAL_MODE_TICTOC_SKETCH 1/g' src/experimental_mode.h")
-# run_cmd("sed -i 's/#define EXPERIMENTAL_MODE_STO_SKETCH [ ]*0/#define EXPERIMENTAL_MODE_STO_SKETCH 1/g' src/experimental_mode.h")
+txn_protocol = "tictoc-sketch"
+# txn_protocol = "sto-sketch"
 
 os.environ['CC'] = "clang"
 os.environ['LD'] = "clang"
 
+os.chdir(splinterdb_path)
+run_cmd("sudo -E make clean")
+run_cmd("sudo -E make install")
+
+os.chdir(ycsb_path)
+run_cmd("make clean")
+run_cmd("make")
+
 max_size = 8 * 1024 * 1024
 rowsxcols = max_size // (128 // 8)
 for rows in [1, 2]:
     cols = rowsxcols // rows
     while (rows == 1 and cols == 1) or (rows == 2 and cols >= 1):
-        os.chdir(splinterdb_path)
-        # run_cmd(f"sed -i 's/txn_splinterdb_cfg->sktch_config.rows = [0-9]\+;/txn_splinterdb_cfg->sktch_config.rows = {rows};/' src/transaction_impl/transaction_sto.h")
-        # run_cmd(f"sed -i 's/txn_splinterdb_cfg->sktch_config.cols = [0-9]\+;/txn_splinterdb_cfg->sktch_config.cols = {cols};/' src/transaction_impl/transaction_sto.h")
-        run_cmd(f"sed -i 's/txn_splinterdb_cfg->sktch_config.rows = [0-9]\+;/txn_splinterdb_cfg->sktch_config.rows = {rows};/' src/transaction_impl/transaction_tictoc_sketch.h")
-        run_cmd(f"sed -i 's/txn_splinterdb_cfg->sktch_config.cols = [0-9]\+;/txn_splinterdb_cfg->sktch_config.cols = {cols};/' src/transaction_impl/transaction_tictoc_sketch.h")
-        run_cmd("sudo -E make clean")
-        run_cmd("sudo -E make install")
-
-        os.chdir(ycsb_path)
-        run_cmd("make clean")
-        run_cmd("make")
-
         output_path = os.path.join(results_path, f"rows_{rows}_cols_{cols}")
         run_cmd(f"LD_PRELOAD=/usr/lib/x86_64-linux-gnu/libjemalloc.so ./ycsbc \
                 -db transactional_splinterdb \
@@ -123,6 +117,9 @@ for rows in [1, 2]:
                 -W workloads/read_intensive.spec \
                 -p splinterdb.filename /dev/md0 \
                 -p splinterdb.cache_size_mb 6144 \
+                -p splinterdb.txn_protocol {txn_protocol} \
+                -p splinterdb.sketch_rows {rows} \
+                -p splinterdb.sketch_cols {cols} \
                 > {output_path} 2>&1")
 
         cols = cols // 2
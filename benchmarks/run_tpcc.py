@@ -254,7 +254,8 @@ def main(argc, argv):
             -p splinterdb.filename {dev_name} \
             -p splinterdb.cache_size_mb {cache_size_mb} \
             -p splinterdb.num_normal_bg_threads {num_normal_bg_threads} \
-            -p splinterdb.num_memtable_bg_threads {num_memtable_bg_threads}'
+            -p splinterdb.num_memtable_bg_threads {num_memtable_bg_threads} \
+            {ExpSystem.props(system)}'
         cmds.append(cmd)
 
     for i in range(0, num_repeats):
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+
+# Measures the cost of a single operation as transactions get larger. Each
+# run uses one client thread, so there are no conflicts and the per-operation
+# time is dominated by the read/write set bookkeeping of the protocol.
+
+import os
+import sys
+import time
+import getopt
+import subprocess
+
+def print_help():
+    print("\t-h,--help: Print this help message", file=sys.stderr)
+    print("\t-p,--parse [results path]: Parse the results in the given directory", file=sys.stderr)
+    print("\t-l,--label [results label]: Specify a label for the experiment", file=sys.stderr)
+    print("\t-s,--system [txn protocol]: Choose the protocol to run (default: tictoc-memory)", file=sys.stderr)
+    exit(1)
+
+try:
+    opts, args = getopt.getopt(sys.argv[1:], "hp:l:s:", ["help", "parse=", "label=", "system="])
+except getopt.GetoptError as err:
+    print_help()
+
+def parse_result(results_path):
+    results = []
+    for file in os.listdir(results_path):
+        if not file.startswith("ops_"):
+            continue
+        f = open(f"{results_path}/{file}", "r")
+        lines = f.readlines()
+        f.close()
+
+        run_data = False
+
+        for line in lines:
+            if run_data:
+                fields = line.split()
+                run_tputs = fields[-1]
+                run_data = False
+
+            if line.startswith("# Transaction throughput (KTPS)"):
+                run_data = True
+
+        ops = int(file.split("_")[1])
+        # KTPS * ops per transaction = thousands of operations per second
+        op_us = 1000.0 / (float(run_tputs) * ops)
+
+        results.append((str(ops), run_tputs, f"{op_us:.3f}"))
+
+    results.sort(key=lambda x: int(x[0]))
+
+    output = open(f"{results_path}/results.csv", "w")
+    print("ops_per_txn\trun_tputs\tus_per_op", file=output)
+    for result in results:
+        print("\t".join(result), file=output)
+    output.close()
+
+
+label = time.time()
+txn_protocol = "tictoc-memory"
+
+for o, a in opts:
+    if o in ('-h', '--help'):
+        print_help()
+    if o in ('-p', '--parse'):
+        parse_result(a)
+        exit(0)
+    if o in ('-l', '--label'):
+        label = a
+    if o in ('-s', '--system'):
+        txn_protocol = a
+
+
+def run_cmd(cmd):
+    subprocess.call(cmd, shell=True)
+
+ycsb_path = os.getcwd()
+splinterdb_path = os.path.abspath("../splinterdb")
+
+results_path = os.path.join(ycsb_path, "txn_size_exp")
+if not os.path.exists(results_path):
+    os.mkdir(results_path)
+
+results_path = os.path.join(results_path, f"{txn_protocol}_{label}")
+os.mkdir(results_path)
+
+os.environ['CC'] = "clang"
+os.environ['LD'] = "clang"
+
+os.chdir(splinterdb_path)
+run_cmd("sudo -E make clean")
+run_cmd("sudo -E make install")
+
+os.chdir(ycsb_path)
+run_cmd("make clean")
+run_cmd("make")
+
+for ops in [1, 4, 16, 64, 256, 1024, 4096]:
+    output_path = os.path.join(results_path, f"ops_{ops}")
+    run_cmd(f"LD_PRELOAD=/usr/lib/x86_64-linux-gnu/libjemalloc.so ./ycsbc \
+            -db transactional_splinterdb \
+            -threads 1 \
+            -client txn \
+            -benchmark_seconds 30 \
+            -L workloads/large_txn.spec \
+            -W workloads/large_txn.spec \
+            -w opspertransaction {ops} \
+            -p splinterdb.filename /dev/md0 \
+            -p splinterdb.cache_size_mb 6144 \
+            -p splinterdb.txn_protocol {txn_protocol} \
+            > {output_path} 2>&1")
+
+parse_result(results_path)
@@ -278,7 +278,8 @@ def main(argc, argv):
             -p splinterdb.filename {dev_name} \
             -p splinterdb.cache_size_mb {cache_size_mb} \
             -p splinterdb.num_normal_bg_threads {num_normal_bg_threads} \
-            -p splinterdb.num_memtable_bg_threads {num_memtable_bg_threads}'
+            -p splinterdb.num_memtable_bg_threads {num_memtable_bg_threads} \
+            {ExpSystem.props(system)}'
         cmds.append(cmd)
 
     for i in range(0, num_repeats):
@@ -299,7 +300,7 @@ def main(argc, argv):
                 'echo 1 | sudo tee /proc/sys/vm/drop_caches > /dev/null')
 
             # run load phase
-            run_shell_command(f'LD_PRELOAD=/usr/lib/x86_64-linux-gnu/libjemalloc.so ./ycsbc -db {db} -threads {max_num_threads} -L {spec_file} -p splinterdb.filename {dev_name} -p splinterdb.cache_size_mb {cache_size_mb}', shell=True)
+            run_shell_command(f'LD_PRELOAD=/usr/lib/x86_64-linux-gnu/libjemalloc.so ./ycsbc -db {db} -threads {max_num_threads} -L {spec_file} -p splinterdb.filename {dev_name} -p splinterdb.cache_size_mb {cache_size_mb} {ExpSystem.props(system)}', shell=True)
 
             out, _ = run_shell_command(cmd, shell=True)
             if out:
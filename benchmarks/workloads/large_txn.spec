@@ -0,0 +1,15 @@
+recordcount=10000000
+workload=com.yahoo.ycsb.workloads.CoreWorkload
+fieldcount=1
+fieldlength=100
+readallfields=true
+requestdistribution=uniform
+readproportion=0.5
+updateproportion=0.5
+scanproportion=0
+insertproportion=0
+readmodifywriteproportion=0
+opspertransaction=16
+maxtxncount=100000
+maxtxnretry=5
+mintxnabortpaneltyus=2000
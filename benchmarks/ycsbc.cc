@@ -70,8 +70,40 @@ std::map<string, string> default_props = {
    {"splinterdb.num_memtable_bg_threads", "0"},
    {"splinterdb.num_normal_bg_threads", "0"},
 
-   // Transaction isolation level isn't used for now
-   {"splinterdb.isolation_level", "1"},
+   // 0 keeps the default of the protocol. 2 (snapshot) always runs mvcc.
+   {"splinterdb.isolation_level", "0"},
+
+   // See transaction_protocol_name() for the available protocols
+   {"splinterdb.txn_protocol", "tictoc-memory"},
+   // These use the protocol's defaults
+   {"splinterdb.tscache_log_slots", "0"},
+   {"splinterdb.sketch_rows", "0"},
+   {"splinterdb.sketch_cols", "0"},
+   // See transaction_contention_policy_name() for the available policies.
+   // A wait of 0 uses the default of the contention manager.
+   {"splinterdb.contention_policy", "fixed"},
+   {"splinterdb.contention_min_wait_ns", "0"},
+   {"splinterdb.contention_max_wait_ns", "0"},
+   // What a read does when its tuple is locked, see
+   // transaction_read_wait_policy_name(). Empty or 0 uses the default.
+   {"splinterdb.read_wait_policy", ""},
+   {"splinterdb.read_wait_spins", "0"},
+   // See transaction_timestamp_source_name() for the available sources.
+   // Empty uses the default of the protocol.
+   {"splinterdb.timestamp_source", ""},
+   // Counts the key of one in this many aborts. 0 uses the default.
+   {"splinterdb.hot_key_sample_interval", "0"},
+   // 1 times the phases of every transaction
+   {"splinterdb.phase_stats", "0"},
+   // 1 applies the writes of keys a transaction only updated without
+   // locking or validating them, e.g. the YTD amounts of TPC-C payments
+   // with use_upserts
+   {"splinterdb.commutative_updates", "0"},
+   // Conflicts of a key after which TicToc and Silo read it under a lock,
+   // 0 keeps every key optimistic
+   {"splinterdb.hot_lock_threshold", "0"},
+   // 1 keeps the timestamps of TicToc memory in one word per key
+   {"splinterdb.compact_timestamps", "0"},
 
    {"rocksdb.database_filename", "rocksdb.db"},
    //    {"rocksdb.isolation_level", "3"},
@@ -75,6 +75,14 @@ typedef struct {
    // log
    bool use_log;
 
+   // Group commit of the log. splinterdb_log_sync() writes out the log for
+   // every thread at once, after waiting up to log_sync_delay_ns for more
+   // writes to join it, or as soon as log_sync_batch writes are waiting.
+   // Larger values trade sync latency for fewer log writes. By default, a
+   // sync is never delayed.
+   uint64 log_sync_delay_ns;
+   uint64 log_sync_batch;
+
    // splinter
    uint64 memtable_capacity;
    uint64 fanout;
@@ -193,6 +201,52 @@ splinterdb_delete(const splinterdb *kvsb, slice key);
 int
 splinterdb_update(const splinterdb *kvsb, slice key, slice delta);
 
+// A write of a batch
+typedef struct {
+   message_type type;  // MESSAGE_TYPE_INSERT, _UPDATE or _DELETE
+   slice        key;
+   slice        value; // The value or the delta. Unused by a delete.
+} splinterdb_write;
+
+// Apply num_writes writes in order, as splinterdb_insert(), _update() and
+// _delete() would.
+//
+// The whole batch goes into the memtable under a single acquisition of its
+// insert lock, and into the log in one append, which is cheaper than writing
+// its keys one at a time.
+//
+// The batch is not atomic: lookups may see some of its writes before the
+// others. A key or value that is too large fails the batch before any of it
+// is applied, but if a write fails after that, for lack of memory or in the
+// merge of an update, the writes before it stay applied.
+int
+splinterdb_write_batch(const splinterdb       *kvsb,
+                       uint64                  num_writes,
+                       const splinterdb_write *writes);
+
+// Returns the log sequence number of the last write logged so far, which is
+// larger than that of every write logged before it. Returns 0 if the log is
+// off.
+uint64
+splinterdb_log_lsn(const splinterdb *kvsb);
+
+// Returns TRUE if every write logged up to lsn is on disk. It may write out
+// the log first, if a sync is due under log_sync_delay_ns and log_sync_batch,
+// but never waits for one. Returns FALSE if the log is off.
+bool
+splinterdb_log_is_durable(const splinterdb *kvsb, uint64 lsn);
+
+// Waits until every write logged up to lsn is on disk. Returns EINVAL if the
+// log is off.
+int
+splinterdb_log_sync(const splinterdb *kvsb, uint64 lsn);
+
+// Returns how many times the log has been written out to make writes
+// durable, so callers can see how well commits are grouped. Returns 0 if the
+// log is off.
+uint64
+splinterdb_log_num_syncs(const splinterdb *kvsb);
+
 // Lookups
 
 // Size of opaque data required to hold a lookup result
@@ -258,6 +312,15 @@ splinterdb_lookup(const splinterdb         *kvs,   // IN
                   splinterdb_lookup_result *result // IN/OUT
 );
 
+// Brings what lookups of the keys read into the cache, reading it from disk
+// for several keys at once, so that the next splinterdb_lookup() of each key
+// does not wait for the disk. The values looked up are thrown away.
+void
+splinterdb_prefetch(const splinterdb *kvs,      // IN
+                    uint64            num_keys, // IN
+                    const slice      *keys      // IN
+);
+
 
 /*
 Iterator API (range query)
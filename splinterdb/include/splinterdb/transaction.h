@@ -11,7 +11,322 @@
 
 typedef struct transactional_splinterdb transactional_splinterdb;
 
+typedef enum {
+   TRANSACTION_ISOLATION_LEVEL_INVALID = 0,
+   TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE,
+   TRANSACTION_ISOLATION_LEVEL_SNAPSHOT,
+   TRANSACTION_ISOLATION_LEVEL_REPEATABLE_READ,
+   TRANSACTION_ISOLATION_LEVEL_MAX_VALID
+} transaction_isolation_level;
+
+// Concurrency control protocols that can be chosen when a transactional
+// splinterdb is created or opened.
+typedef enum {
+   TRANSACTION_PROTOCOL_INVALID = 0,
+   TRANSACTION_PROTOCOL_TICTOC_DISK,
+   TRANSACTION_PROTOCOL_TICTOC_MEMORY,
+   TRANSACTION_PROTOCOL_TICTOC_COUNTER,
+   TRANSACTION_PROTOCOL_TICTOC_SKETCH,
+   TRANSACTION_PROTOCOL_STO_DISK,
+   TRANSACTION_PROTOCOL_STO_MEMORY,
+   TRANSACTION_PROTOCOL_STO_COUNTER,
+   TRANSACTION_PROTOCOL_STO_SKETCH,
+   TRANSACTION_PROTOCOL_2PL_NO_WAIT,
+   TRANSACTION_PROTOCOL_2PL_WAIT_DIE,
+   TRANSACTION_PROTOCOL_2PL_WOUND_WAIT,
+   // Lets transactions wait for locks, and aborts one of each cycle of waits
+   TRANSACTION_PROTOCOL_2PL_DETECT,
+   TRANSACTION_PROTOCOL_SILO_MEMORY,
+   // Keeps every version of a key, and provides snapshot isolation. Reads
+   // never wait, but a transaction still aborts if a key it reads was
+   // written so often that the versions of its snapshot were truncated. The
+   // empty key is reserved for its own use.
+   TRANSACTION_PROTOCOL_MVCC,
+   TRANSACTION_PROTOCOL_MAX_VALID
+} transaction_protocol;
+
+#define TRANSACTION_PROTOCOL_DEFAULT TRANSACTION_PROTOCOL_TICTOC_MEMORY
+
+// How long a transaction waits before retrying a lock that another one
+// holds. Waits are kept between the contention_min_wait_ns and
+// contention_max_wait_ns of the config.
+typedef enum {
+   TRANSACTION_CONTENTION_INVALID = 0,
+   // Always waits contention_min_wait_ns
+   TRANSACTION_CONTENTION_FIXED,
+   // Doubles the wait after every failed attempt, with random jitter
+   TRANSACTION_CONTENTION_BACKOFF,
+   // Waits longer the more of the recent transactions of the thread aborted
+   TRANSACTION_CONTENTION_ABORT_RATE,
+   // Like BACKOFF, but halves the wait for every time the transaction has
+   // aborted already, so that old transactions win over new ones
+   TRANSACTION_CONTENTION_AGE,
+   TRANSACTION_CONTENTION_MAX_VALID
+} transaction_contention_policy;
+
+#define TRANSACTION_CONTENTION_DEFAULT TRANSACTION_CONTENTION_FIXED
+
+// What a read does when the tuple it reads is locked by a commit that is
+// installing its writes, in the TicToc memory and sketch protocols
+typedef enum {
+   TRANSACTION_READ_WAIT_INVALID = 0,
+   // Spins until the commit is done
+   TRANSACTION_READ_WAIT_SPIN,
+   // Spins read_wait_spins times, then yields the CPU between attempts
+   TRANSACTION_READ_WAIT_YIELD,
+   // Spins read_wait_spins times, then aborts the transaction of the read
+   TRANSACTION_READ_WAIT_ABORT,
+   TRANSACTION_READ_WAIT_MAX_VALID
+} transaction_read_wait_policy;
+
+#define TRANSACTION_READ_WAIT_DEFAULT TRANSACTION_READ_WAIT_YIELD
+#define TRANSACTION_READ_WAIT_SPINS   (1024)
+
+// What the contention manager saw, for a thread or for all of them
+typedef struct transaction_contention_stats {
+   uint64 commits;
+   uint64 aborts;
+   // Times a transaction waited to retry a lock, or to run again after an
+   // abort in transactional_splinterdb_run()
+   uint64 lock_waits;
+   uint64 wait_ns; // Total time of those waits
+   // Reads that found their tuple locked, and how long they waited for it
+   uint64 read_waits;
+   uint64 read_wait_ns;
+} transaction_contention_stats;
+
+// Why a protocol aborted a transaction
+typedef enum {
+   // The protocol did not say
+   TRANSACTION_ABORT_UNKNOWN = 0,
+   // transactional_splinterdb_abort()
+   TRANSACTION_ABORT_USER,
+   // A key it read was overwritten before it committed
+   TRANSACTION_ABORT_READ_CHANGED,
+   // A key it read was locked by another commit when it was validated, or
+   // for too long when it was read
+   TRANSACTION_ABORT_READ_LOCKED,
+   // 2PL: a lock it needed was held by another transaction
+   TRANSACTION_ABORT_LOCK_BUSY,
+   // 2PL: an older transaction took a lock it held
+   TRANSACTION_ABORT_WOUNDED,
+   // 2PL: it was chosen to break a cycle of transactions waiting for locks
+   TRANSACTION_ABORT_DEADLOCK,
+   // STO: a younger transaction already read or wrote a key it accessed
+   TRANSACTION_ABORT_TOO_LATE,
+   // MVCC: a key it wrote was committed by another since its snapshot
+   TRANSACTION_ABORT_WRITE_CONFLICT,
+   // MVCC: the versions of its snapshot were truncated from a key it read
+   TRANSACTION_ABORT_SNAPSHOT_TOO_OLD,
+   // A range it scanned through an iterator changed
+   TRANSACTION_ABORT_PHANTOM,
+   TRANSACTION_ABORT_MAX_VALID
+} transaction_abort_reason;
+
+// Aborts by reason, for a thread or for all of them
+typedef struct transaction_abort_stats {
+   uint64 aborts[TRANSACTION_ABORT_MAX_VALID];
+} transaction_abort_stats;
+
+#define TRANSACTION_HOT_KEY_MAX_LENGTH (64)
+
+// A key that aborted transactions, as counted by the hot key profiler
+typedef struct transaction_hot_key {
+   uint64 conflicts; // Sampled aborts on the key, too many by at most error
+   uint64 error;
+   uint64 length; // Of the key, which is cut to fit in key
+   char   key[TRANSACTION_HOT_KEY_MAX_LENGTH];
+} transaction_hot_key;
+
+#define TRANSACTION_HOT_KEY_SAMPLE_INTERVAL (1)
+
+// Phases of a transaction, as timed by the phase histograms
+typedef enum {
+   // From begin to commit
+   TRANSACTION_PHASE_EXECUTION = 0,
+   // From commit until the writes are installed, or until the commit
+   // returns if the protocol installs none
+   TRANSACTION_PHASE_VALIDATION,
+   // Installing the writes of a commit
+   TRANSACTION_PHASE_WRITE,
+   // From begin to the abort, of transactions that abort
+   TRANSACTION_PHASE_ABORT,
+   TRANSACTION_PHASE_MAX_VALID
+} transaction_phase;
+
+// Histograms keep 2^TRANSACTION_HISTOGRAM_SUB_BITS buckets for every power
+// of 2, so a bucket is at most 1/2^TRANSACTION_HISTOGRAM_SUB_BITS as wide as
+// the values it holds. Values of 2^TRANSACTION_HISTOGRAM_MAX_BITS ns or more
+// all go into the last bucket.
+#define TRANSACTION_HISTOGRAM_SUB_BITS (3)
+#define TRANSACTION_HISTOGRAM_MAX_BITS (40)
+#define TRANSACTION_HISTOGRAM_BUCKETS                                          \
+   ((TRANSACTION_HISTOGRAM_MAX_BITS - TRANSACTION_HISTOGRAM_SUB_BITS + 1)      \
+    << TRANSACTION_HISTOGRAM_SUB_BITS)
+
+// Durations of a phase, in ns
+typedef struct transaction_histogram {
+   uint64 count;
+   uint64 sum_ns;
+   uint64 max_ns;
+   uint64 buckets[TRANSACTION_HISTOGRAM_BUCKETS];
+} transaction_histogram;
+
+// Where the protocols that order transactions by the time they began (STO
+// and 2PL) take the timestamps of begin from. Every source hands out unique
+// timestamps that grow on each thread. Only COUNTER and BATCHED give dense
+// timestamps, which TRANSACTION_PROTOCOL_STO_DISK needs to fit them on disk.
+typedef enum {
+   TRANSACTION_TIMESTAMP_INVALID = 0,
+   // One shared counter, incremented by every begin
+   TRANSACTION_TIMESTAMP_COUNTER,
+   // Ranges of the shared counter handed out to each thread. Threads that
+   // run few transactions lag behind until their range runs out.
+   TRANSACTION_TIMESTAMP_BATCHED,
+   // A logical clock per thread, tagged with the thread id. Threads catch up
+   // with a shared clock that each of them only moves now and then.
+   TRANSACTION_TIMESTAMP_TAGGED,
+   // The invariant TSC of the CPU, tagged with the thread id. Falls back to
+   // the monotonic clock of the OS when the CPU has none.
+   TRANSACTION_TIMESTAMP_TSC,
+   TRANSACTION_TIMESTAMP_MAX_VALID
+} transaction_timestamp_source;
+
+#define TRANSACTION_TIMESTAMP_DEFAULT TRANSACTION_TIMESTAMP_TAGGED
+
+// Configuration of a transactional splinterdb.
+//
+// Zero-initialized fields take the default of the chosen protocol, so
+// callers only need to fill in kvsb_cfg and, optionally, protocol.
+typedef struct transactional_splinterdb_config {
+   splinterdb_config    kvsb_cfg;
+   transaction_protocol protocol;
+
+   // TRANSACTION_ISOLATION_LEVEL_SNAPSHOT is only provided by
+   // TRANSACTION_PROTOCOL_MVCC, which it selects if protocol is left zeroed;
+   // asking for it with any other protocol fails.
+   transaction_isolation_level isol_level;
+
+   // Initial size of the timestamp cache (log2 of the number of slots) used
+   // by the in-memory protocols; the cache grows as keys are added
+   uint64 tscache_log_slots;
+
+   // Shape of the timestamp sketch used by the COUNTER/SKETCH protocols
+   uint64 sketch_rows;
+   uint64 sketch_cols;
+
+   // Contention manager, shared by all protocols
+   transaction_contention_policy contention_policy;
+   uint64                        contention_min_wait_ns;
+   uint64                        contention_max_wait_ns;
+   transaction_read_wait_policy  read_wait_policy;
+   uint64                        read_wait_spins;
+   // Yield or abort on the first locked read, whatever read_wait_spins says
+   bool                          read_wait_no_spin;
+
+   // Timestamps of begin. TRANSACTION_TIMESTAMP_DEFAULT, or BATCHED for
+   // TRANSACTION_PROTOCOL_STO_DISK, if left zeroed.
+   transaction_timestamp_source timestamp_source;
+
+   // Time the phases of every transaction from the start. See
+   // transactional_splinterdb_enable_phase_stats().
+   bool phase_stats;
+
+   // The hot key profiler counts the key of one in this many aborts.
+   // TRANSACTION_HOT_KEY_SAMPLE_INTERVAL if left zeroed.
+   uint64 hot_key_sample_interval;
+
+   // Make transactional_splinterdb_commit() wait until the writes of the
+   // transaction are on disk. Requires kvsb_cfg.use_log. Commits from
+   // concurrent threads share log writes, as tuned by kvsb_cfg.log_sync_*.
+   bool sync_commits;
+
+   // Escrow-style upserts: a key a transaction only updated, without reading
+   // or replacing it, is neither locked nor validated, so that updates of
+   // the same key from concurrent transactions never conflict. The merges of
+   // the application must commute, and transactions that read the key are
+   // not ordered against these updates: they may see a value with or
+   // without an update they are serialized after. Meant for aggregates,
+   // like the YTD amounts of TPC-C, whose readers can live with that.
+   bool commutative_updates;
+
+   // Adaptive locking in TicToc (memory, sketch, counter) and Silo: a key
+   // whose reads failed validation this many times recently is read under
+   // its lock, held until the transaction finishes, while the other keys
+   // stay optimistic. 0, the default, keeps every key optimistic.
+   uint64 hot_lock_threshold;
+
+   // Keep the timestamps and lock of each tuple in one 64-bit word, as in
+   // the TicToc paper, instead of two, so that they are swapped with 8-byte
+   // rather than 16-byte atomics. Reads may abort a little more often, when
+   // the read timestamp of a tuple gets far ahead of its write timestamp.
+   // Only TRANSACTION_PROTOCOL_TICTOC_MEMORY has it, the other protocols
+   // ignore it.
+   bool compact_timestamps;
+} transactional_splinterdb_config;
+
+// Fill txn_kvsb_cfg with a copy of kvsb_cfg and the defaults for protocol
+void
+transactional_splinterdb_config_init(
+   transactional_splinterdb_config *txn_kvsb_cfg,
+   const splinterdb_config         *kvsb_cfg,
+   transaction_protocol             protocol);
+
+// Returns the canonical name of a protocol (e.g. "tictoc-memory")
+const char *
+transaction_protocol_name(transaction_protocol protocol);
+
+// Parses a protocol name as returned by transaction_protocol_name().
+// Returns TRANSACTION_PROTOCOL_INVALID for unknown names.
+transaction_protocol
+transaction_protocol_from_name(const char *name);
+
+// Returns the canonical name of a contention policy (e.g. "backoff")
+const char *
+transaction_contention_policy_name(transaction_contention_policy policy);
+
+// Parses a contention policy name as returned by
+// transaction_contention_policy_name(). Returns
+// TRANSACTION_CONTENTION_INVALID for unknown names.
+transaction_contention_policy
+transaction_contention_policy_from_name(const char *name);
+
+// Returns the canonical name of a phase (e.g. "validation")
+const char *
+transaction_phase_name(transaction_phase phase);
+
+// Returns the smallest duration, in ns, that percentile % of the durations
+// in hist are at most, up to the width of its bucket. 0 if hist is empty.
+uint64
+transaction_histogram_percentile(const transaction_histogram *hist,
+                                 double                       percentile);
+
+// Returns the canonical name of an abort reason (e.g. "read-changed")
+const char *
+transaction_abort_reason_name(transaction_abort_reason reason);
+
+// Returns the canonical name of a read wait policy (e.g. "yield")
+const char *
+transaction_read_wait_policy_name(transaction_read_wait_policy policy);
+
+// Parses a read wait policy name as returned by
+// transaction_read_wait_policy_name(). Returns TRANSACTION_READ_WAIT_INVALID
+// for unknown names.
+transaction_read_wait_policy
+transaction_read_wait_policy_from_name(const char *name);
+
+// Returns the canonical name of a timestamp source (e.g. "tagged")
+const char *
+transaction_timestamp_source_name(transaction_timestamp_source source);
+
+// Parses a timestamp source name as returned by
+// transaction_timestamp_source_name(). Returns TRANSACTION_TIMESTAMP_INVALID
+// for unknown names.
+transaction_timestamp_source
+transaction_timestamp_source_from_name(const char *name);
+
 // Create a new SplinterDB instance, erasing any existing file or block device.
+// It uses TRANSACTION_PROTOCOL_DEFAULT.
 //
 // The library will allocate and own the memory for splinterdb
 // and will free it on splinterdb_close().
@@ -31,6 +346,20 @@ int
 transactional_splinterdb_open(const splinterdb_config   *kvsb_cfg,
                               transactional_splinterdb **txn_kvsb);
 
+// Same as transactional_splinterdb_create(), but also chooses the
+// concurrency control protocol and its parameters.
+int
+transactional_splinterdb_create_with_config(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb);
+
+// Same as transactional_splinterdb_open(), but also chooses the
+// concurrency control protocol and its parameters.
+int
+transactional_splinterdb_open_with_config(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb);
+
 // Close a splinterdb
 //
 // This will flush all data to disk and release all resources
@@ -61,31 +390,79 @@ transactional_splinterdb_register_thread(transactional_splinterdb *kvs);
 void
 transactional_splinterdb_deregister_thread(transactional_splinterdb *kvs);
 
-typedef struct rw_entry rw_entry;
-
-#define RW_SET_SIZE_LIMIT 64
+typedef struct rw_entry          rw_entry;
+typedef struct rw_index_slot     rw_index_slot;
+typedef struct transaction_arena transaction_arena;
+typedef struct transaction_scan  transaction_scan;
 
 typedef struct transaction {
-   rw_entry *rw_entries[RW_SET_SIZE_LIMIT];
-   uint64    num_rw_entries;
-   uint128   ts;
+   // Owns the memory of the read/write set. It is taken from a per-thread
+   // pool by transactional_splinterdb_begin() and given back by commit/abort.
+   transaction_arena *arena;
+   rw_entry         **rw_entries;
+   slice             *rw_keys; // rw_keys[i] is the key of rw_entries[i]
+   uint64             num_rw_entries;
+   uint64             max_rw_entries;
+   // Hash index over rw_keys, built once the read/write set gets large
+   rw_index_slot *rw_index;
+   uint64         rw_index_size;
+   // Ranges read through transactional_splinterdb_iterator, validated again
+   // at commit
+   transaction_scan *scans;
+   uint128           ts;
    // TODO: this should only be declared for WOUND_WAIT, move it in another data
    // struct
    bool wounded;
+   // Set by mvcc when an iterator of txn skipped a key whose versions of
+   // its snapshot were truncated away, which fails its commit
+   bool snapshot_too_old;
+   // When the phases of txn started, if phase statistics were enabled when
+   // it began. begin_ns is 0 otherwise.
+   uint64 begin_ns;
+   uint64 commit_ns;
+   uint64 write_ns;
 } transaction;
 
 int
 transactional_splinterdb_begin(transactional_splinterdb *txn_kvsb,
                                transaction              *txn);
 
+// Returns 0, TRANSACTION_ABORTED, or an errno from splinterdb if the writes
+// of txn failed to go in, in which case some of them may still be applied.
 int
 transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
                                 transaction              *txn);
 
+// Same as transactional_splinterdb_commit(), but never waits for the writes
+// of txn to reach the disk. On success, *ticket is set to a ticket for
+// transactional_splinterdb_is_durable() and _wait_durable().
+int
+transactional_splinterdb_commit_async(transactional_splinterdb *txn_kvsb,
+                                      transaction              *txn,
+                                      uint64                   *ticket);
+
+// Returns TRUE if the transaction that got ticket, and every transaction
+// committed before it, are on disk. Polling also writes out the log once
+// the group commit settings of kvsb_cfg say it is due.
+bool
+transactional_splinterdb_is_durable(transactional_splinterdb *txn_kvsb,
+                                    uint64                    ticket);
+
+// Waits until transactional_splinterdb_is_durable() would return TRUE.
+// Returns EINVAL if the log is off.
+int
+transactional_splinterdb_wait_durable(transactional_splinterdb *txn_kvsb,
+                                      uint64                    ticket);
+
 int
 transactional_splinterdb_abort(transactional_splinterdb *txn_kvsb,
                                transaction              *txn);
 
+// Returned by an operation or a commit when the protocol aborted txn over a
+// conflict. Operations can also fail with an errno from splinterdb. Either
+// way, txn is over and must not be committed or aborted.
+#define TRANSACTION_ABORTED (-1)
+
 int
 transactional_splinterdb_insert(transactional_splinterdb *txn_kvsb,
                                 transaction              *txn,
@@ -124,15 +501,202 @@ transactional_splinterdb_lookup_result_init(
 const splinterdb *
 transactional_splinterdb_get_db(transactional_splinterdb *txn_kvsb);
 
-typedef enum {
-   TRANSACTION_ISOLATION_LEVEL_INVALID = 0,
-   TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE,
-   TRANSACTION_ISOLATION_LEVEL_SNAPSHOT,
-   TRANSACTION_ISOLATION_LEVEL_REPEATABLE_READ,
-   TRANSACTION_ISOLATION_LEVEL_MAX_VALID
-} transaction_isolation_level;
+// The body of a transaction run by transactional_splinterdb_run(). It does
+// the reads and writes of the transaction on txn, which is already begun,
+// and must not commit or abort it.
+//
+// It returns 0 to have txn committed. When an operation fails, txn is
+// aborted already, and the body returns that error: TRANSACTION_ABORTED has
+// the transaction run again, any other error is returned to the caller of
+// transactional_splinterdb_run(). Any other non-zero return gives up too:
+// txn is aborted and the error is returned.
+typedef int (*transactional_splinterdb_body)(transactional_splinterdb *txn_kvsb,
+                                             transaction              *txn,
+                                             void                     *ctx);
+
+typedef struct transactional_splinterdb_run_options {
+   // Gives up after this many aborts. 0 retries until the body commits.
+   uint64 max_attempts;
+   // The keys the body reads or writes, if known up front, NULL otherwise.
+   // They are prefetched together with splinterdb_prefetch() before the
+   // first attempt, so that the body waits for one round of disk reads
+   // rather than one per key.
+   const slice *footprint;
+   uint64       footprint_size;
+} transactional_splinterdb_run_options;
+
+typedef struct transactional_splinterdb_run_stats {
+   uint64 attempts;  // 1 if the first attempt committed
+   uint64 wasted_ns; // Time spent in attempts that aborted, and between them
+} transactional_splinterdb_run_stats;
+
+// Runs body in a transaction until it commits, waiting as the contention
+// policy of the config says between attempts. Every attempt reuses the
+// buffers of the previous one. opts and stats may be NULL.
+//
+// Returns 0 once a commit succeeded, the error of the body if it gave up or
+// an operation failed with an error other than TRANSACTION_ABORTED, or the
+// error of the last attempt once opts->max_attempts ran out.
+int
+transactional_splinterdb_run(
+   transactional_splinterdb                   *txn_kvsb,
+   transactional_splinterdb_body               body,
+   void                                       *ctx,
+   const transactional_splinterdb_run_options *opts,
+   transactional_splinterdb_run_stats         *stats);
+
+// Fills stats with what the contention manager saw on the calling thread
+void
+transactional_splinterdb_thread_contention_stats(
+   transactional_splinterdb     *txn_kvsb,
+   transaction_contention_stats *stats);
+
+// Fills stats with what the contention manager saw on all threads
+void
+transactional_splinterdb_contention_stats(
+   transactional_splinterdb     *txn_kvsb,
+   transaction_contention_stats *stats);
+
+// Zeroes the statistics of every thread
+void
+transactional_splinterdb_reset_contention_stats(
+   transactional_splinterdb *txn_kvsb);
+
+// Fills stats with the reasons of the aborts on the calling thread
+void
+transactional_splinterdb_thread_abort_stats(transactional_splinterdb *txn_kvsb,
+                                            transaction_abort_stats  *stats);
+
+// Fills stats with the reasons of the aborts on all threads
+void
+transactional_splinterdb_abort_stats(transactional_splinterdb *txn_kvsb,
+                                     transaction_abort_stats  *stats);
+
+// Copies the max_keys keys that aborted the most transactions on all threads
+// into keys, most aborts first, and returns how many it copied. Each thread
+// only tracks its hottest keys, so keys that are hot on no thread in
+// particular can be missed.
+uint64
+transactional_splinterdb_hot_keys(transactional_splinterdb *txn_kvsb,
+                                  transaction_hot_key      *keys,
+                                  uint64                    max_keys);
+
+// Logs the abort reasons and the hottest keys of all threads
+void
+transactional_splinterdb_print_abort_stats(transactional_splinterdb *txn_kvsb);
+
+// Zeroes the abort reasons and forgets the hot keys of every thread
+void
+transactional_splinterdb_reset_abort_stats(transactional_splinterdb *txn_kvsb);
+
+// Starts or stops timing the phases of the transactions that begin from
+// now on. Timing costs a few reads of the clock per transaction.
+void
+transactional_splinterdb_enable_phase_stats(transactional_splinterdb *txn_kvsb,
+                                            bool                      enable);
+
+// Fills hist with the durations of phase on all threads
+void
+transactional_splinterdb_phase_histogram(transactional_splinterdb *txn_kvsb,
+                                         transaction_phase         phase,
+                                         transaction_histogram    *hist);
+
+// Logs the count, mean and percentiles of every phase on all threads
+void
+transactional_splinterdb_print_phase_stats(transactional_splinterdb *txn_kvsb);
+
+// Empties the phase histograms of every thread
+void
+transactional_splinterdb_reset_phase_stats(transactional_splinterdb *txn_kvsb);
 
 void
 transactional_splinterdb_set_isolation_level(
    transactional_splinterdb   *txn_kvsb,
    transaction_isolation_level isol_level);
+
+/*
+Transactional iterators
+
+A transactional iterator walks the committed contents of the database like a
+splinterdb_iterator, and remembers the keys and values it returns. When the
+transaction commits, the range it walked is scanned again, and the commit
+fails if any key was inserted into, deleted from, or changed within that range
+in the meantime. This protects the transaction against phantoms. Each key
+the iterator returns also counts as read by the transaction, as if it had been
+looked up, though a failed read only shows when the transaction commits.
+
+The range covered is from start_key up to the last key the iterator was
+positioned on, or up to the end of the database if the iterator ran past it.
+
+Writes of the transaction itself are not visible through its iterators.
+
+Iterators are allocated from the transaction, and must be deinitialized
+before the transaction commits or aborts.
+
+Sample application code:
+
+   transactional_splinterdb_iterator* it;
+   int rc = transactional_splinterdb_iterator_init(txn_kvsb, &txn, &it,
+                                                   start_key);
+   if (rc != 0) { ... handle error ... }
+
+   slice key, value;
+   for(; transactional_splinterdb_iterator_valid(it);
+         transactional_splinterdb_iterator_next(it)) {
+      transactional_splinterdb_iterator_get_current(it, &key, &value);
+      // read key and value...
+   }
+
+   rc = transactional_splinterdb_iterator_status(it);
+   transactional_splinterdb_iterator_deinit(it);
+
+   rc = transactional_splinterdb_commit(txn_kvsb, &txn);
+*/
+
+typedef struct transactional_splinterdb_iterator
+   transactional_splinterdb_iterator;
+
+// Initialize a new iterator of txn, starting at the given key
+//
+// If start_key is NULL_SLICE, the iterator will start before the minimum key
+int
+transactional_splinterdb_iterator_init(
+   transactional_splinterdb           *txn_kvsb, // IN
+   transaction                        *txn,      // IN
+   transactional_splinterdb_iterator **iter,     // OUT
+   slice                               start_key // IN
+);
+
+// Deinitialize an iterator
+void
+transactional_splinterdb_iterator_deinit(
+   transactional_splinterdb_iterator *iter);
+
+// Checks that the iterator status is OK (no errors) and that get_current()
+// will succeed. If false, there are two possibilities:
+// 1. Iterator has passed the final item. In this case, status() == 0
+// 2. Iterator has encountered an error. In this case, status() != 0
+bool
+transactional_splinterdb_iterator_valid(
+   transactional_splinterdb_iterator *iter);
+
+// Attempts to advance the iterator to the next item.
+void
+transactional_splinterdb_iterator_next(
+   transactional_splinterdb_iterator *iter);
+
+// Sets *key and *value to the locations of the current item
+// Callers must not modify that memory
+//
+// If valid() == false, then behavior is undefined.
+void
+transactional_splinterdb_iterator_get_current(
+   transactional_splinterdb_iterator *iter, // IN
+   slice                             *key,  // OUT
+   slice                             *value // OUT
+);
+
+// Returns an error encountered from iteration, or 0 if successful.
+int
+transactional_splinterdb_iterator_status(
+   const transactional_splinterdb_iterator *iter);
@@ -1630,6 +1630,33 @@ btree_grow_root(cache              *cc,   // IN
    return 0;
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * btree_insert_check --
+ *
+ *      Checks that btree_insert() takes the tuple: its key and message fit
+ *      in a leaf, and its message has a valid type.
+ *
+ *-----------------------------------------------------------------------------
+ */
+platform_status
+btree_insert_check(const btree_config *cfg, key tuple_key, message msg)
+{
+   if (MAX_INLINE_KEY_SIZE(btree_page_size(cfg)) < key_length(tuple_key)) {
+      return STATUS_BAD_PARAM;
+   }
+
+   if (MAX_INLINE_MESSAGE_SIZE(btree_page_size(cfg)) < message_length(msg)) {
+      return STATUS_BAD_PARAM;
+   }
+
+   if (message_is_invalid_user_type(msg)) {
+      return STATUS_BAD_PARAM;
+   }
+
+   return STATUS_OK;
+}
+
 /*
  *-----------------------------------------------------------------------------
  * btree_insert --
@@ -1654,16 +1681,9 @@ btree_insert(cache              *cc,         // IN
    leaf_incorporate_spec spec;
    uint64                leaf_wait = 1;
 
-   if (MAX_INLINE_KEY_SIZE(btree_page_size(cfg)) < key_length(tuple_key)) {
-      return STATUS_BAD_PARAM;
-   }
-
-   if (MAX_INLINE_MESSAGE_SIZE(btree_page_size(cfg)) < message_length(msg)) {
-      return STATUS_BAD_PARAM;
-   }
-
-   if (message_is_invalid_user_type(msg)) {
-      return STATUS_BAD_PARAM;
+   rc = btree_insert_check(cfg, tuple_key, msg);
+   if (!SUCCESS(rc)) {
+      return rc;
    }
 
    btree_node root_node;
@@ -200,6 +200,9 @@ typedef struct btree_async_ctxt {
    uint64            child_addr; // Child disk address
 } btree_async_ctxt;
 
+platform_status
+btree_insert_check(const btree_config *cfg, key tuple_key, message msg);
+
 platform_status
 btree_insert(cache              *cc,         // IN
              const btree_config *cfg,        // IN
@@ -0,0 +1,243 @@
+#include <immintrin.h>
+#include <string.h>
+
+#include "iceberg_precompute.h"
+#include "iceberg_simd.h"
+
+// The byte of lv1 metadata that holds the lock bit, set in broadcast_mask
+#define LOCK_BYTE 56
+
+/*
+ * Portable kernels, comparing 8 bytes of metadata at a time.
+ */
+#define BYTES_LOW7 0x7f7f7f7f7f7f7f7fULL
+#define BYTES_LOW1 0x0101010101010101ULL
+
+// Bit i is set if byte i of a equals byte i of b
+static inline uint8_t
+bytes_eq_mask(uint64_t a, uint64_t b)
+{
+   uint64_t x    = a ^ b;
+   uint64_t zero = ~(((x & BYTES_LOW7) + BYTES_LOW7) | x | BYTES_LOW7);
+   return (((zero >> 7) & BYTES_LOW1) * 0x0102040810204080ULL) >> 56;
+}
+
+static inline uint64_t
+load_word(const uint8_t *bytes)
+{
+   uint64_t word;
+   memcpy(&word, bytes, sizeof(word));
+   return word;
+}
+
+static uint64_t
+slot_mask_64_scalar(const uint8_t *md, uint8_t fprint)
+{
+   uint64_t bcast = BYTES_LOW1 * fprint;
+   uint64_t mask  = 0;
+   for (int i = 0; i < 8; i++) {
+      uint64_t word = load_word(md + 8 * i);
+      uint64_t fp   = bcast;
+      if (i == LOCK_BYTE / 8) {
+         word |= 1;
+         fp |= 1;
+      }
+      mask |= (uint64_t)bytes_eq_mask(word, fp) << (8 * i);
+   }
+   return mask;
+}
+
+static uint32_t
+slot_mask_32_scalar(const uint8_t *md, uint8_t fprint)
+{
+   uint64_t bcast = BYTES_LOW1 * fprint;
+   uint32_t mask  = 0;
+   for (int i = 0; i < 4; i++) {
+      mask |= (uint32_t)bytes_eq_mask(load_word(md + 8 * i), bcast) << (8 * i);
+   }
+   return mask;
+}
+
+static uint8_t
+word_select_scalar(uint64_t val, int rank)
+{
+   for (int i = 0; i < rank && val; i++) {
+      val &= val - 1;
+   }
+   return val ? __builtin_ctzll(val) : 64;
+}
+
+static const iceberg_simd_ops simd_scalar = {
+   .name         = "scalar",
+   .slot_mask_64 = slot_mask_64_scalar,
+   .slot_mask_32 = slot_mask_32_scalar,
+   .word_select  = word_select_scalar,
+};
+
+/*
+ * Kernels with BMI2, shared by the SIMD levels.
+ */
+__attribute__((target("bmi,bmi2"))) static uint8_t
+word_select_bmi2(uint64_t val, int rank)
+{
+   return _tzcnt_u64(_pdep_u64(one[rank], val));
+}
+
+/*
+ * SSE4.2, 16 bytes at a time.
+ */
+__attribute__((target("sse4.2"))) static inline uint32_t
+slot_mask_16_sse42(const uint8_t *md, const uint8_t *mask, __m128i bcast)
+{
+   __m128i m     = _mm_loadu_si128((const __m128i *)mask);
+   __m128i block = _mm_or_si128(_mm_loadu_si128((const __m128i *)md), m);
+   __m128i cmp   = _mm_cmpeq_epi8(_mm_or_si128(bcast, m), block);
+   return (uint32_t)_mm_movemask_epi8(cmp);
+}
+
+__attribute__((target("sse4.2"))) static uint64_t
+slot_mask_64_sse42(const uint8_t *md, uint8_t fprint)
+{
+   __m128i  bcast = _mm_set1_epi8(fprint);
+   uint64_t mask  = 0;
+   for (int i = 0; i < 4; i++) {
+      mask |= (uint64_t)slot_mask_16_sse42(
+                 md + 16 * i, broadcast_mask + 16 * i, bcast)
+              << (16 * i);
+   }
+   return mask;
+}
+
+__attribute__((target("sse4.2"))) static uint32_t
+slot_mask_32_sse42(const uint8_t *md, uint8_t fprint)
+{
+   __m128i bcast = _mm_set1_epi8(fprint);
+   __m128i lo    = _mm_loadu_si128((const __m128i *)md);
+   __m128i hi    = _mm_loadu_si128((const __m128i *)(md + 16));
+   return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bcast, lo))
+          | ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bcast, hi)) << 16);
+}
+
+static const iceberg_simd_ops simd_sse42 = {
+   .name         = "sse4.2",
+   .slot_mask_64 = slot_mask_64_sse42,
+   .slot_mask_32 = slot_mask_32_sse42,
+   .word_select  = word_select_bmi2,
+};
+
+/*
+ * AVX2, 32 bytes at a time.
+ */
+__attribute__((target("avx2"))) static uint64_t
+slot_mask_64_avx2(const uint8_t *md, uint8_t fprint)
+{
+   __m256i fp = _mm256_set1_epi8(fprint);
+
+   __m256i mask1 = _mm256_loadu_si256((const __m256i *)broadcast_mask);
+   __m256i md1   = _mm256_loadu_si256((const __m256i *)md);
+   __m256i cmp1  = _mm256_cmpeq_epi8(_mm256_or_si256(md1, mask1),
+                                    _mm256_or_si256(fp, mask1));
+
+   __m256i mask2 = _mm256_loadu_si256((const __m256i *)(broadcast_mask + 32));
+   __m256i md2   = _mm256_loadu_si256((const __m256i *)(md + 32));
+   __m256i cmp2  = _mm256_cmpeq_epi8(_mm256_or_si256(md2, mask2),
+                                    _mm256_or_si256(fp, mask2));
+
+   return ((uint64_t)(uint32_t)_mm256_movemask_epi8(cmp2) << 32)
+          | (uint32_t)_mm256_movemask_epi8(cmp1);
+}
+
+__attribute__((target("avx2"))) static uint32_t
+slot_mask_32_avx2(const uint8_t *md, uint8_t fprint)
+{
+   __m256i bcast = _mm256_set1_epi8(fprint);
+   __m256i block = _mm256_loadu_si256((const __m256i *)md);
+   return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bcast, block));
+}
+
+static const iceberg_simd_ops simd_avx2 = {
+   .name         = "avx2",
+   .slot_mask_64 = slot_mask_64_avx2,
+   .slot_mask_32 = slot_mask_32_avx2,
+   .word_select  = word_select_bmi2,
+};
+
+/*
+ * AVX-512, the 64 bytes of lv1 metadata at once.
+ */
+__attribute__((target("avx512f,avx512bw"))) static uint64_t
+slot_mask_64_avx512(const uint8_t *md, uint8_t fprint)
+{
+   __m512i mask  = _mm512_loadu_si512((const __m512i *)broadcast_mask);
+   __m512i bcast = _mm512_or_epi64(_mm512_set1_epi8(fprint), mask);
+   __m512i block = _mm512_loadu_si512((const __m512i *)md);
+   block         = _mm512_or_epi64(block, mask);
+   return _mm512_cmp_epi8_mask(bcast, block, _MM_CMPINT_EQ);
+}
+
+__attribute__((target("avx512bw,avx512vl"))) static uint32_t
+slot_mask_32_avx512(const uint8_t *md, uint8_t fprint)
+{
+   __m256i bcast = _mm256_set1_epi8(fprint);
+   __m256i block = _mm256_loadu_si256((const __m256i *)md);
+   return _mm256_cmp_epi8_mask(bcast, block, _MM_CMPINT_EQ);
+}
+
+static const iceberg_simd_ops simd_avx512 = {
+   .name         = "avx512",
+   .slot_mask_64 = slot_mask_64_avx512,
+   .slot_mask_32 = slot_mask_32_avx512,
+   .word_select  = word_select_bmi2,
+};
+
+static bool
+iceberg_simd_supported(iceberg_simd_level level)
+{
+   __builtin_cpu_init();
+   switch (level) {
+      case ICEBERG_SIMD_SCALAR:
+         return TRUE;
+      case ICEBERG_SIMD_SSE42:
+         return __builtin_cpu_supports("sse4.2")
+                && __builtin_cpu_supports("bmi2");
+      case ICEBERG_SIMD_AVX2:
+         return __builtin_cpu_supports("avx2")
+                && __builtin_cpu_supports("bmi2");
+      case ICEBERG_SIMD_AVX512:
+         return __builtin_cpu_supports("avx512f")
+                && __builtin_cpu_supports("avx512bw")
+                && __builtin_cpu_supports("avx512vl")
+                && __builtin_cpu_supports("bmi2");
+      default:
+         return FALSE;
+   }
+}
+
+const iceberg_simd_ops *
+iceberg_simd_ops_get(iceberg_simd_level level)
+{
+   static const iceberg_simd_ops *const ops[ICEBERG_SIMD_MAX_VALID] = {
+      [ICEBERG_SIMD_SCALAR] = &simd_scalar,
+      [ICEBERG_SIMD_SSE42]  = &simd_sse42,
+      [ICEBERG_SIMD_AVX2]   = &simd_avx2,
+      [ICEBERG_SIMD_AVX512] = &simd_avx512,
+   };
+   if (level >= ICEBERG_SIMD_MAX_VALID || !iceberg_simd_supported(level)) {
+      return NULL;
+   }
+   return ops[level];
+}
+
+const iceberg_simd_ops *
+iceberg_simd_ops_best(void)
+{
+   for (int level = ICEBERG_SIMD_MAX_VALID - 1; level > ICEBERG_SIMD_SCALAR;
+        level--)
+   {
+      const iceberg_simd_ops *ops = iceberg_simd_ops_get(level);
+      if (ops != NULL) {
+         return ops;
+      }
+   }
+   return &simd_scalar;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef __cplusplus
+#   define __restrict__
+extern "C" {
+#endif
+
+#include "platform.h"
+
+/*
+ * The kernels the iceberg table uses to scan the metadata of its blocks,
+ * built once per instruction set. A table picks the fastest set the cpu
+ * supports when it is created, so one binary runs on older cpus and still
+ * uses the newer instructions where they are there.
+ */
+typedef enum iceberg_simd_level {
+   ICEBERG_SIMD_SCALAR,
+   ICEBERG_SIMD_SSE42, // with BMI2
+   ICEBERG_SIMD_AVX2,  // with BMI2
+   ICEBERG_SIMD_AVX512,
+   ICEBERG_SIMD_MAX_VALID
+} iceberg_simd_level;
+
+typedef struct iceberg_simd_ops {
+   const char *name;
+
+   // Bit i is set if md[i] == fprint, for the 64 bytes of md. The lowest bit
+   // of md[56] is ignored: it is the lock bit of lv1 blocks.
+   uint64_t (*slot_mask_64)(const uint8_t *md, uint8_t fprint);
+
+   // Bit i is set if md[i] == fprint, for the first 32 bytes of md
+   uint32_t (*slot_mask_32)(const uint8_t *md, uint8_t fprint);
+
+   // Position of the set bit of val that has rank set bits below it, or 64
+   uint8_t (*word_select)(uint64_t val, int rank);
+} iceberg_simd_ops;
+
+// The kernels of level, or NULL if the cpu does not support them
+const iceberg_simd_ops *
+iceberg_simd_ops_get(iceberg_simd_level level);
+
+// The kernels of the highest level the cpu supports
+const iceberg_simd_ops *
+iceberg_simd_ops_best(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,12 +4,10 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <immintrin.h>
-#include <tmmintrin.h>
 #include <sys/mman.h>
 #include <sys/sysinfo.h>
 #include <math.h>
 
-#include "iceberg_precompute.h"
 #include "iceberg_table.h"
 
 #define likely(x)   __builtin_expect((x), 1)
@@ -18,6 +16,19 @@
 /* #define RESIZE_THRESHOLD 0.96 */
 #define RESIZE_THRESHOLD 0.85 // For YCSB*/
 
+// A resize splits the old blocks in chunks of 8
+#define RESIZE_CHUNK_BITS   3
+#define RESIZE_CHUNK_BLOCKS (1ULL << RESIZE_CHUNK_BITS)
+
+#define PC_THRESHOLD 64
+
+// Freed cells of short keys a thread keeps for reuse. They all have room for
+// ICEBERG_INLINE_KEY_SIZE bytes of key.
+#define CELL_CACHE_MAX 1024
+
+// Nodes of lv3 lists a thread allocates at once when it has none to reuse
+#define LV3_SLAB_NODES 64
+
 uint64_t seed[5] = {12351327692179052ll,
                     23246347347385899ll,
                     35236262354132235ll,
@@ -44,13 +55,6 @@ lv2_hash(slice key, uint8_t i)
       platform_hash64(slice_data(key), slice_length(key), seed[i + 1]));
 }
 
-static inline uint8_t
-word_select(uint64_t val, int rank)
-{
-   val = _pdep_u64(one[rank], val);
-   return _tzcnt_u64(val);
-}
-
 uint64_t
 lv1_balls(iceberg_table *table)
 {
@@ -149,8 +153,8 @@ need_resize(iceberg_table *table)
 {
    double lf = iceberg_load_factor_aprox(table);
    if (lf >= RESIZE_THRESHOLD)
-      return true;
-   return false;
+      return TRUE;
+   return FALSE;
 }
 #endif
 
@@ -161,7 +165,7 @@ get_index_offset(uint64_t  init_log,
                  uint64_t *boffset)
 {
    uint64_t shf = index >> init_log;
-   *bindex      = 64 - _lzcnt_u64(shf);
+   *bindex      = shf ? 64 - __builtin_clzll(shf) : 0;
    uint64_t adj = 1ULL << *bindex;
    adj          = adj >> 1;
    adj          = adj << init_log;
@@ -175,105 +179,48 @@ split_hash(uint64_t          hash,
            iceberg_metadata *metadata)
 {
    *fprint = hash & ((1 << FPRINT_BITS) - 1);
-   *index  = (hash >> FPRINT_BITS) & ((1 << metadata->block_bits) - 1);
+   *index  = (hash >> FPRINT_BITS) & ((1ULL << metadata->block_bits) - 1);
 }
 
 #define LOCK_MASK   1ULL
 #define UNLOCK_MASK ~1ULL
 
 static inline void
-lock_block(uint64_t *metadata)
+lock_block(iceberg_lv1_block_md *md)
 {
 #ifdef ENABLE_BLOCK_LOCKING
-   uint64_t *data = metadata + 7;
+   uint64_t *data = (uint64_t *)md->block_md + 7;
    while ((__sync_fetch_and_or(data, LOCK_MASK) & 1) != 0) {
       _mm_pause();
    }
+   __atomic_store_n(&md->version, md->version + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
 #endif
 }
 
 static inline void
-unlock_block(uint64_t *metadata)
+unlock_block(iceberg_lv1_block_md *md)
 {
 #ifdef ENABLE_BLOCK_LOCKING
-   uint64_t *data = metadata + 7;
-   *data          = *data & UNLOCK_MASK;
+   uint64_t *data = (uint64_t *)md->block_md + 7;
+   __atomic_store_n(&md->version, md->version + 1, __ATOMIC_RELEASE);
+   __atomic_store_n(data, *data & UNLOCK_MASK, __ATOMIC_RELEASE);
 #endif
 }
 
-static inline uint32_t
-slot_mask_32(uint8_t *metadata, uint8_t fprint)
-{
-   __m256i bcast = _mm256_set1_epi8(fprint);
-   __m256i block = _mm256_loadu_si256((const __m256i *)(metadata));
-#if defined __AVX512BW__ && defined __AVX512VL__
-   return _mm256_cmp_epi8_mask(bcast, block, _MM_CMPINT_EQ);
-#else
-   __m256i cmp = _mm256_cmpeq_epi8(bcast, block);
-   return _mm256_movemask_epi8(cmp);
-#endif
-}
-
-#if defined __AVX512F__ && defined __AVX512BW__
-static inline uint64_t
-slot_mask_64(uint8_t *metadata, uint8_t fprint)
-{
-   __m512i mask  = _mm512_loadu_si512((const __m512i *)(broadcast_mask));
-   __m512i bcast = _mm512_set1_epi8(fprint);
-   bcast         = _mm512_or_epi64(bcast, mask);
-   __m512i block = _mm512_loadu_si512((const __m512i *)(metadata));
-   block         = _mm512_or_epi64(block, mask);
-   return _mm512_cmp_epi8_mask(bcast, block, _MM_CMPINT_EQ);
-}
-#else  /* ! (defined __AVX512F__ && defined __AVX512BW__) */
-static inline uint32_t
-slot_mask_64_half(__m256i fprint, __m256i md, __m256i mask)
-{
-   __m256i masked_fp = _mm256_or_si256(fprint, mask);
-   __m256i masked_md = _mm256_or_si256(md, mask);
-   __m256i cmp = _mm256_cmpeq_epi8(masked_md, masked_fp);
-   return _mm256_movemask_epi8(cmp);
-}
-
-static inline uint64_t
-slot_mask_64(uint8_t *metadata, uint8_t fp)
-{
-   __m256i fprint = _mm256_set1_epi8(fp);
-
-   __m256i md1 = _mm256_loadu_si256((const __m256i *)(metadata));
-   __m256i mask1 = _mm256_loadu_si256((const __m256i *)(broadcast_mask));
-   uint64_t result1 = slot_mask_64_half(fprint, md1, mask1);
-
-   __m256i md2 = _mm256_loadu_si256((const __m256i *)(&metadata[32]));
-   __m256i mask2 = _mm256_loadu_si256((const __m256i *)(&broadcast_mask[32]));
-   uint64_t result2 = slot_mask_64_half(fprint, md2, mask2);
-
-   return ((uint64_t)result2 << 32) | result1;
-}
-#endif /* ! (defined __AVX512F__ && defined __AVX512BW__) */
-
-
-static inline void __attribute__((unused))
-atomic_write_128(slice key, ValueType val, uint64_t *slot)
-{
-   kv_pair t = {.key = key, .val = val};
-   __m128d a = _mm_load_pd((double *)&t);
-   _mm_store_pd((double *)slot, a);
-}
-
 static uint64_t
 iceberg_block_load(iceberg_table *table, uint64_t index, uint8_t level)
 {
    uint64_t bindex, boffset;
    get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
    if (level == 1) {
-      __mmask64 mask64 =
-         slot_mask_64(table->metadata.lv1_md[bindex][boffset].block_md, 0);
+      uint64_t mask64 = table->simd->slot_mask_64(
+         table->metadata.lv1_md[bindex][boffset].block_md, 0);
       return (1ULL << SLOT_BITS) - __builtin_popcountll(mask64);
    } else if (level == 2) {
-      __mmask32 mask32 =
-         slot_mask_32(table->metadata.lv2_md[bindex][boffset].block_md, 0)
-         & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
+      uint32_t mask32 = table->simd->slot_mask_32(
+                           table->metadata.lv2_md[bindex][boffset].block_md, 0)
+                        & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
       return (C_LV2 + MAX_LG_LG_N / D_CHOICES) - __builtin_popcountll(mask32);
    } else
       return table->metadata.lv3_sizes[bindex][boffset];
@@ -321,6 +268,7 @@ iceberg_init(iceberg_table     *table,
              const data_config *spl_data_config)
 {
    memset(table, 0, sizeof(*table));
+   table->simd = iceberg_simd_ops_best();
 
    uint64_t total_blocks = 1 << (log_slots - SLOT_BITS);
    uint64_t total_size_in_bytes =
@@ -368,10 +316,20 @@ iceberg_init(iceberg_table     *table,
    table->metadata.log_init_size       = log2(total_blocks);
    table->metadata.nblocks_parts[0]    = total_blocks;
 
-   uint32_t procs = get_nprocs();
-   pc_init(&table->metadata.lv1_balls, &table->metadata.lv1_ctr, procs, 1000);
-   pc_init(&table->metadata.lv2_balls, &table->metadata.lv2_ctr, procs, 1000);
-   pc_init(&table->metadata.lv3_balls, &table->metadata.lv3_ctr, procs, 1000);
+   // The counters are indexed by thread id. Keep their threshold low, the
+   // load factor that triggers a resize is computed from the global counts.
+   pc_init(&table->metadata.lv1_balls,
+           &table->metadata.lv1_ctr,
+           MAX_THREADS,
+           PC_THRESHOLD);
+   pc_init(&table->metadata.lv2_balls,
+           &table->metadata.lv2_ctr,
+           MAX_THREADS,
+           PC_THRESHOLD);
+   pc_init(&table->metadata.lv3_balls,
+           &table->metadata.lv3_ctr,
+           MAX_THREADS,
+           PC_THRESHOLD);
 
    size_t lv1_md_size = sizeof(iceberg_lv1_block_md) * total_blocks + 64;
    // table->metadata.lv1_md = (iceberg_lv1_block_md
@@ -415,37 +373,26 @@ iceberg_init(iceberg_table     *table,
    }
 
 #ifdef ENABLE_RESIZE
-   table->metadata.resize_cnt     = 0;
-   table->metadata.lv1_resize_ctr = total_blocks;
-   table->metadata.lv2_resize_ctr = total_blocks;
-   table->metadata.lv3_resize_ctr = total_blocks;
-
-   // create one marker for 8 blocks.
-   size_t resize_marker_size            = sizeof(uint8_t) * total_blocks / 8;
-   table->metadata.lv1_resize_marker[0] = (uint8_t *)mmap(
-      NULL, resize_marker_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (!table->metadata.lv1_resize_marker[0]) {
-      perror("level1 resize ctr malloc failed");
-      exit(1);
-   }
-   table->metadata.lv2_resize_marker[0] = (uint8_t *)mmap(
-      NULL, resize_marker_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (!table->metadata.lv2_resize_marker[0]) {
-      perror("level2 resize ctr malloc failed");
-      exit(1);
-   }
-   table->metadata.lv3_resize_marker[0] = (uint8_t *)mmap(
+   // A resize splits the blocks in chunks, which needs whole chunks
+   platform_assert(total_blocks >= RESIZE_CHUNK_BLOCKS,
+                   "iceberg needs at least %llu slots to resize\n",
+                   RESIZE_CHUNK_BLOCKS << SLOT_BITS);
+   table->metadata.resize_cnt         = 0;
+   table->metadata.resize_chunks_left = 0;
+
+   // create one marker per chunk of blocks.
+   size_t resize_marker_size =
+      sizeof(uint8_t) * (total_blocks >> RESIZE_CHUNK_BITS);
+   table->metadata.resize_marker[0] = (uint8_t *)mmap(
       NULL, resize_marker_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (!table->metadata.lv3_resize_marker[0]) {
-      perror("level3 resize ctr malloc failed");
+   if (table->metadata.resize_marker[0] == MAP_FAILED) {
+      perror("resize marker malloc failed");
       exit(1);
    }
-   memset(table->metadata.lv1_resize_marker[0], 1, resize_marker_size);
-   memset(table->metadata.lv2_resize_marker[0], 1, resize_marker_size);
-   memset(table->metadata.lv3_resize_marker[0], 1, resize_marker_size);
 
    table->metadata.marker_sizes[0] = resize_marker_size;
    table->metadata.lock            = 0;
+   rw_lock_init(&table->metadata.resize_rwlock);
 #endif
 
    for (uint64_t i = 0; i < total_blocks; ++i) {
@@ -458,7 +405,7 @@ iceberg_init(iceberg_table     *table,
          table->level2[0][i].slots[j].key      = NULL_SLICE;
          table->level2[0][i].slots[j].refcount = 0;
       }
-      table->level3[0]->head = NULL;
+      table->level3[0][i].head = NULL;
    }
 
    memset((char *)table->metadata.lv1_md[0], 0, lv1_md_size);
@@ -485,360 +432,550 @@ iceberg_init_with_sketch(iceberg_table     *table,
    return 0;
 }
 
-#ifdef ENABLE_RESIZE
 static inline bool
-is_lv1_resize_active(iceberg_table *table)
+is_inline_key(slice key)
 {
-   uint64_t half_mark = table->metadata.nblocks >> 1;
-   uint64_t lv1_ctr =
-      __atomic_load_n(&table->metadata.lv1_resize_ctr, __ATOMIC_SEQ_CST);
-   return lv1_ctr < half_mark;
+   return slice_length(key) <= ICEBERG_INLINE_KEY_SIZE;
 }
 
-static inline bool
-is_lv2_resize_active(iceberg_table *table)
+static inline kv_cell *
+kv_cell_create(iceberg_table *table,
+               slice          key,
+               ValueType      value,
+               threadid       thread_id)
+{
+   kv_cell *cell;
+#if ICEBERG_INLINE_KEY_SIZE
+   iceberg_cell_cache *cache = &table->cell_caches[thread_id];
+   if (is_inline_key(key) && cache->head != NULL) {
+      cell        = cache->head;
+      cache->head = cell->next_free;
+      cache->count--;
+   } else if (is_inline_key(key)) {
+      cell =
+         TYPED_FLEXIBLE_STRUCT_ZALLOC(0, cell, key, ICEBERG_INLINE_KEY_SIZE);
+   } else
+#endif
+   {
+      cell = TYPED_FLEXIBLE_STRUCT_ZALLOC(0, cell, key, slice_length(key));
+   }
+   cell->val = value;
+   memcpy(cell->key, slice_data(key), slice_length(key));
+   return cell;
+}
+
+static inline void
+kv_cell_destroy(iceberg_table *table,
+                ValueType     *val,
+                slice          key,
+                threadid       thread_id)
+{
+   kv_cell *cell = (kv_cell *)val;
+#if ICEBERG_INLINE_KEY_SIZE
+   iceberg_cell_cache *cache = &table->cell_caches[thread_id];
+   if (is_inline_key(key) && cache->count < CELL_CACHE_MAX) {
+      cell->next_free = cache->head;
+      cache->head     = cell;
+      cache->count++;
+      return;
+   }
+#endif
+   platform_free_from_heap(0, cell);
+}
+
+static inline void
+kv_pair_set(kv_pair *kv, slice key, ValueType *value, uint64_t refcount)
+{
+   kv->key      = key;
+   kv->val      = value;
+   kv->refcount = refcount;
+#if ICEBERG_INLINE_KEY_SIZE
+   if (is_inline_key(key)) {
+      memcpy(kv->inline_key, slice_data(key), slice_length(key));
+   }
+#endif
+}
+
+// The key of kv to compare with, from the slot itself if it is short
+static inline slice
+kv_pair_key(const kv_pair *kv)
 {
-   uint64_t half_mark = table->metadata.nblocks >> 1;
-   uint64_t lv2_ctr =
-      __atomic_load_n(&table->metadata.lv2_resize_ctr, __ATOMIC_SEQ_CST);
-   return lv2_ctr < half_mark;
+#if ICEBERG_INLINE_KEY_SIZE
+   if (is_inline_key(kv->key)) {
+      return slice_create(slice_length(kv->key), kv->inline_key);
+   }
+#endif
+   return kv->key;
 }
 
+/*
+ * Whether kv holds key. The table hashes the bytes of keys, so equal keys have
+ * the same length, and a short key is never compared with the cell of a long
+ * one.
+ */
 static inline bool
-is_lv3_resize_active(iceberg_table *table)
+kv_pair_key_equal(iceberg_table *table, const kv_pair *kv, slice key)
 {
-   uint64_t half_mark = table->metadata.nblocks >> 1;
-   uint64_t lv3_ctr =
-      __atomic_load_n(&table->metadata.lv3_resize_ctr, __ATOMIC_SEQ_CST);
-   return lv3_ctr < half_mark;
+   slice kv_key = kv_pair_key(kv);
+   if (slice_length(kv_key) != slice_length(key)) {
+      return FALSE;
+   }
+   return iceberg_key_compare(table->spl_data_config, kv_key, key) == 0;
 }
 
 static bool
+iceberg_insert_internal(iceberg_table *table,
+                        slice          key,
+                        ValueType     *value,
+                        uint64_t       refcount,
+                        uint8_t        fprint,
+                        uint64_t       bindex,
+                        uint64_t       boffset,
+                        threadid       thread_id);
+
+static inline bool
+iceberg_lv2_insert_internal(iceberg_table *table,
+                            slice          key,
+                            ValueType     *value,
+                            uint64_t       refcount,
+                            uint8_t        fprint,
+                            uint64_t       index,
+                            threadid       thread_id);
+
+#ifdef ENABLE_RESIZE
+/*
+ * A resize doubles the number of blocks of every level, and the keys of each
+ * old block b are then split between b and its new sibling, b + nblocks / 2.
+ * The old blocks are split in chunks of RESIZE_CHUNK_BLOCKS, lazily: before
+ * an operation touches a block, it splits the chunk of the block, or waits
+ * for the thread that is splitting it. The new sibling of a block only gets
+ * keys from that block, so a split never needs another chunk, and a key is
+ * always found where the current number of blocks puts it.
+ *
+ * Operations hold resize_rwlock shared, so that setting up a resize, which
+ * changes the number of blocks, waits for them. Slots move during a split,
+ * but the values stay in their cells.
+ */
+#   define RESIZE_CHUNK_PENDING 0
+#   define RESIZE_CHUNK_SPLITTING 1
+#   define RESIZE_CHUNK_SPLIT 2
+
+static inline bool
 is_resize_active(iceberg_table *table)
 {
-   return is_lv3_resize_active(table) || is_lv2_resize_active(table)
-          || is_lv1_resize_active(table);
+   return __atomic_load_n(&table->metadata.resize_chunks_left, __ATOMIC_ACQUIRE)
+          != 0;
 }
 
-static bool
-iceberg_setup_resize(iceberg_table *table)
+static inline uint8_t *
+iceberg_resize_marker(iceberg_table *table, uint64_t chunk_idx)
 {
-   // grab write lock
-   if (!lock(&table->metadata.lock, TRY_ONCE_LOCK))
-      return false;
+   uint64_t mindex, moffset;
+   get_index_offset(table->metadata.log_init_size - RESIZE_CHUNK_BITS,
+                    chunk_idx,
+                    &mindex,
+                    &moffset);
+   return &table->metadata.resize_marker[mindex][moffset];
+}
 
-   if (unlikely(!need_resize(table))) {
-      unlock(&table->metadata.lock);
-      return false;
+static void
+iceberg_nuke_key(iceberg_table *table,
+                 uint64_t       level,
+                 uint64_t       index,
+                 uint64_t       slot,
+                 threadid       thread_id)
+{
+   uint64_t bindex, boffset;
+   get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
+   iceberg_metadata *metadata = &table->metadata;
+
+   if (level == 1) {
+      iceberg_lv1_block *blocks                        = table->level1[bindex];
+      metadata->lv1_md[bindex][boffset].block_md[slot] = 0;
+      blocks[boffset].slots[slot].key                  = NULL_SLICE;
+      blocks[boffset].slots[slot].refcount             = 0;
+      pc_add(&metadata->lv1_balls, -1, thread_id);
+   } else if (level == 2) {
+      iceberg_lv2_block *blocks                        = table->level2[bindex];
+      metadata->lv2_md[bindex][boffset].block_md[slot] = 0;
+      blocks[boffset].slots[slot].key                  = NULL_SLICE;
+      blocks[boffset].slots[slot].refcount             = 0;
+      pc_add(&metadata->lv2_balls, -1, thread_id);
    }
-   if (is_resize_active(table)) {
-      // finish the current resize
-      iceberg_end(table);
-      unlock(&table->metadata.lock);
-      return false;
+}
+
+static void
+iceberg_lv1_split_block(iceberg_table *table, uint64_t bnum, threadid thread_id)
+{
+   uint64_t bindex, boffset;
+   get_index_offset(table->metadata.log_init_size, bnum, &bindex, &boffset);
+   iceberg_lv1_block *blocks = table->level1[bindex];
+
+   for (uint64_t j = 0; j < (1 << SLOT_BITS); ++j) {
+      kv_pair kv = blocks[boffset].slots[j];
+      if (slice_is_null(kv.key)) {
+         continue;
+      }
+      uint8_t  fprint;
+      uint64_t index;
+      split_hash(lv1_hash(kv.key), &fprint, &index, &table->metadata);
+      if (index == bnum) {
+         continue;
+      }
+
+      // The sibling has as many slots as the block, it cannot be full
+      uint64_t new_bindex, new_boffset;
+      get_index_offset(
+         table->metadata.log_init_size, index, &new_bindex, &new_boffset);
+      bool moved = iceberg_insert_internal(table,
+                                           kv.key,
+                                           kv.val,
+                                           kv.refcount,
+                                           fprint,
+                                           new_bindex,
+                                           new_boffset,
+                                           thread_id);
+      platform_assert(moved, "Failed insert during resize lv1\n");
+      iceberg_nuke_key(table, 1, bnum, j, thread_id);
    }
+}
 
-   printf("Setting up resize\n");
-   iceberg_print_state(table);
+static void
+iceberg_lv2_split_block(iceberg_table *table, uint64_t bnum, threadid thread_id)
+{
+   uint64_t bindex, boffset;
+   get_index_offset(table->metadata.log_init_size, bnum, &bindex, &boffset);
+   iceberg_lv2_block *blocks = table->level2[bindex];
+   uint64_t           mask   = ~(1ULL << (table->metadata.block_bits - 1));
 
-#   if defined(HUGE_TLB)
-   int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB;
-#   else
-   int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
-#   endif
+   for (uint64_t j = 0; j < C_LV2 + MAX_LG_LG_N / D_CHOICES; ++j) {
+      kv_pair kv = blocks[boffset].slots[j];
+      if (slice_is_null(kv.key)) {
+         continue;
+      }
 
-   // compute new sizes
-   uint64_t cur_blocks = table->metadata.nblocks;
-   uint64_t resize_cnt = table->metadata.resize_cnt + 1;
+      // The fingerprint tells which choice put the key here, and lookups
+      // of the other choices would not match it even in this block.
+      uint8_t  fprint    = table->metadata.lv2_md[bindex][boffset].block_md[j];
+      bool     stays     = FALSE;
+      uint64_t new_index = bnum;
+      for (int i = 0; i < D_CHOICES; ++i) {
+         uint8_t  l2fprint;
+         uint64_t l2index;
+         split_hash(lv2_hash(kv.key, i), &l2fprint, &l2index, &table->metadata);
+         if (l2fprint != fprint || (l2index & mask) != bnum) {
+            continue;
+         }
+         if (l2index == bnum) {
+            stays = TRUE;
+            break;
+         }
+         new_index = l2index;
+      }
+      if (stays) {
+         continue;
+      }
+      platform_assert(new_index != bnum);
 
-   // Allocate new table and metadata
-   // alloc level1
-   size_t level1_size        = sizeof(iceberg_lv1_block) * cur_blocks;
-   table->level1[resize_cnt] = (iceberg_lv1_block *)mmap(
-      NULL, level1_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->level1[resize_cnt] == (void *)-1) {
-      perror("level1 resize failed");
-      exit(1);
+      bool moved = iceberg_lv2_insert_internal(
+         table, kv.key, kv.val, kv.refcount, fprint, new_index, thread_id);
+      platform_assert(moved, "Failed insert during resize lv2\n");
+      iceberg_nuke_key(table, 2, bnum, j, thread_id);
    }
+}
 
-   // alloc level2
-   size_t level2_size        = sizeof(iceberg_lv2_block) * cur_blocks;
-   table->level2[resize_cnt] = (iceberg_lv2_block *)mmap(
-      NULL, level2_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->level2[resize_cnt] == (void *)-1) {
-      perror("level2 resize failed");
-      exit(1);
+static void
+iceberg_lv3_split_block(iceberg_table *table, uint64_t bnum)
+{
+   iceberg_metadata *metadata = &table->metadata;
+   uint64_t          sibling  = bnum + (metadata->nblocks >> 1);
+   uint64_t          bindex, boffset, new_bindex, new_boffset;
+   get_index_offset(metadata->log_init_size, bnum, &bindex, &boffset);
+   get_index_offset(
+      metadata->log_init_size, sibling, &new_bindex, &new_boffset);
+
+   if (likely(!metadata->lv3_sizes[bindex][boffset])) {
+      return;
    }
 
-   // alloc level3
-   size_t level3_size        = sizeof(iceberg_lv3_list) * cur_blocks;
-   table->level3[resize_cnt] = (iceberg_lv3_list *)mmap(
-      NULL, level3_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->level3[resize_cnt] == (void *)-1) {
-      perror("level3 resize failed");
-      exit(1);
+   // Lookups of other keys may walk the list, so move its nodes under the
+   // locks of both lists. Nodes are relinked, not copied.
+   while (__sync_lock_test_and_set(metadata->lv3_locks[bindex] + boffset, 1))
+      ;
+   while (__sync_lock_test_and_set(
+      metadata->lv3_locks[new_bindex] + new_boffset, 1))
+      ;
+
+   iceberg_lv3_list  *list     = &table->level3[bindex][boffset];
+   iceberg_lv3_list  *new_list = &table->level3[new_bindex][new_boffset];
+   iceberg_lv3_node **link     = &list->head;
+   while (*link != NULL) {
+      iceberg_lv3_node *node = *link;
+      uint8_t           fprint;
+      uint64_t          index;
+      split_hash(lv1_hash(node->kv.key), &fprint, &index, metadata);
+      if (index == bnum) {
+         link = &node->next_node;
+         continue;
+      }
+      *link           = node->next_node;
+      node->next_node = new_list->head;
+      new_list->head  = node;
+      metadata->lv3_sizes[bindex][boffset]--;
+      metadata->lv3_sizes[new_bindex][new_boffset]++;
    }
 
-   // alloc level1 metadata
-   size_t lv1_md_size = sizeof(iceberg_lv1_block_md) * cur_blocks + 64;
-   table->metadata.lv1_md[resize_cnt] = (iceberg_lv1_block_md *)mmap(
-      NULL, lv1_md_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv1_md[resize_cnt] == (void *)-1) {
-      perror("lv1_md resize failed");
-      exit(1);
+   metadata->lv3_locks[new_bindex][new_boffset] = 0;
+   metadata->lv3_locks[bindex][boffset]         = 0;
+}
+
+static void
+iceberg_split_chunk(iceberg_table *table,
+                    uint64_t       chunk_idx,
+                    threadid       thread_id)
+{
+   uint64_t first = chunk_idx << RESIZE_CHUNK_BITS;
+   for (uint64_t bnum = first; bnum < first + RESIZE_CHUNK_BLOCKS; ++bnum) {
+      iceberg_lv1_split_block(table, bnum, thread_id);
+      iceberg_lv2_split_block(table, bnum, thread_id);
+      iceberg_lv3_split_block(table, bnum);
    }
+}
 
-   // alloc level2 metadata
-   size_t lv2_md_size = sizeof(iceberg_lv2_block_md) * cur_blocks + 32;
-   table->metadata.lv2_md[resize_cnt] = (iceberg_lv2_block_md *)mmap(
-      NULL, lv2_md_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv2_md[resize_cnt] == (void *)-1) {
-      perror("lv2_md resize failed");
-      exit(1);
+/*
+ * Makes sure the block index of the current resize has been split from its
+ * old block, splitting the chunk of that block if nobody has started to.
+ */
+static void
+iceberg_resize_fix_block(iceberg_table *table,
+                         uint64_t       index,
+                         threadid       thread_id)
+{
+   uint64_t half      = table->metadata.nblocks >> 1;
+   uint64_t chunk_idx = (index & (half - 1)) >> RESIZE_CHUNK_BITS;
+   uint8_t *marker    = iceberg_resize_marker(table, chunk_idx);
+
+   uint8_t state = __atomic_load_n(marker, __ATOMIC_ACQUIRE);
+   if (likely(state == RESIZE_CHUNK_SPLIT)) {
+      return;
    }
+   if (state == RESIZE_CHUNK_PENDING
+       && __atomic_compare_exchange_n(marker,
+                                      &state,
+                                      RESIZE_CHUNK_SPLITTING,
+                                      FALSE,
+                                      __ATOMIC_ACQUIRE,
+                                      __ATOMIC_ACQUIRE))
+   {
+      iceberg_split_chunk(table, chunk_idx, thread_id);
+      __atomic_store_n(marker, RESIZE_CHUNK_SPLIT, __ATOMIC_RELEASE);
+      __atomic_fetch_sub(
+         &table->metadata.resize_chunks_left, 1, __ATOMIC_ACQ_REL);
+      return;
+   }
+   while (__atomic_load_n(marker, __ATOMIC_ACQUIRE) != RESIZE_CHUNK_SPLIT) {
+      _mm_pause();
+   }
+}
 
-   // alloc level3 metadata (sizes, locks)
-   size_t lv3_sizes_size                 = sizeof(uint64_t) * cur_blocks;
-   table->metadata.lv3_sizes[resize_cnt] = (uint64_t *)mmap(
-      NULL, lv3_sizes_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv3_sizes[resize_cnt] == (void *)-1) {
-      perror("lv3_sizes resize failed");
-      exit(1);
+// Splits the blocks of every level key may be in
+static inline void
+iceberg_resize_fix_key(iceberg_table *table, slice key, threadid thread_id)
+{
+   if (likely(!is_resize_active(table))) {
+      return;
    }
 
-   size_t lv3_locks_size                 = sizeof(uint8_t) * cur_blocks;
-   table->metadata.lv3_locks[resize_cnt] = (uint8_t *)mmap(
-      NULL, lv3_locks_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv3_locks[resize_cnt] == (void *)-1) {
-      perror("lv3_locks remap failed");
-      exit(1);
+   uint8_t  fprint;
+   uint64_t index;
+   split_hash(lv1_hash(key), &fprint, &index, &table->metadata);
+   iceberg_resize_fix_block(table, index, thread_id);
+   for (uint8_t i = 0; i < D_CHOICES; ++i) {
+      split_hash(lv2_hash(key, i), &fprint, &index, &table->metadata);
+      iceberg_resize_fix_block(table, index, thread_id);
    }
-   memset(
-      table->metadata.lv3_locks[resize_cnt], 0, cur_blocks * sizeof(uint8_t));
+}
 
-   // alloc resize markers
-   // resize_marker_size
-   size_t resize_marker_size = sizeof(uint8_t) * cur_blocks / 8;
-   table->metadata.lv1_resize_marker[resize_cnt] = (uint8_t *)mmap(
-      NULL, resize_marker_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv1_resize_marker[resize_cnt] == (void *)-1) {
-      perror("level1 resize failed");
-      exit(1);
+// finish splitting the chunks that are left during the last resize.
+void
+iceberg_end(iceberg_table *table)
+{
+   uint64_t nchunks = table->metadata.nblocks >> 1 >> RESIZE_CHUNK_BITS;
+   for (uint64_t chunk_idx = 0; chunk_idx < nchunks; ++chunk_idx) {
+      iceberg_resize_fix_block(table, chunk_idx << RESIZE_CHUNK_BITS, 0);
    }
+}
 
-   table->metadata.lv2_resize_marker[resize_cnt] = (uint8_t *)mmap(
-      NULL, resize_marker_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv2_resize_marker[resize_cnt] == (void *)-1) {
-      perror("level1 resize failed");
+static inline void *
+iceberg_resize_mmap(size_t size, const char *what)
+{
+#   if defined(HUGE_TLB)
+   int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB;
+#   else
+   int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
+#   endif
+
+   void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
+   if (ptr == MAP_FAILED) {
+      perror(what);
       exit(1);
    }
+   return ptr;
+}
 
-   table->metadata.lv3_resize_marker[resize_cnt] = (uint8_t *)mmap(
-      NULL, resize_marker_size, PROT_READ | PROT_WRITE, mmap_flags, 0, 0);
-   if (table->metadata.lv3_resize_marker[resize_cnt] == (void *)-1) {
-      perror("level1 resize failed");
-      exit(1);
+static void
+iceberg_setup_resize(iceberg_table *table)
+{
+   iceberg_metadata *metadata = &table->metadata;
+
+   if (!lock(&metadata->lock, TRY_ONCE_LOCK))
+      return;
+
+   if (unlikely(!need_resize(table))) {
+      unlock(&metadata->lock);
+      return;
+   }
+   if (is_resize_active(table)) {
+      // finish the current resize, the next operation starts a new one
+      iceberg_end(table);
+      unlock(&metadata->lock);
+      return;
+   }
+   if (metadata->resize_cnt + 1 == MAX_RESIZES) {
+      unlock(&metadata->lock);
+      return;
    }
 
-   table->metadata.marker_sizes[resize_cnt] = resize_marker_size;
-   // resetting the resize markers.
-   for (uint64_t i = 0; i <= resize_cnt; ++i) {
-      memset(table->metadata.lv1_resize_marker[i],
-             0,
-             table->metadata.marker_sizes[i]);
-      memset(table->metadata.lv2_resize_marker[i],
-             0,
-             table->metadata.marker_sizes[i]);
-      memset(table->metadata.lv3_resize_marker[i],
-             0,
-             table->metadata.marker_sizes[i]);
+   // The new blocks are allocated before operations are stopped
+   uint64_t cur_blocks = metadata->nblocks;
+   uint64_t resize_cnt = metadata->resize_cnt + 1;
+
+   iceberg_lv1_block *level1 = iceberg_resize_mmap(
+      sizeof(iceberg_lv1_block) * cur_blocks, "level1 resize failed");
+   iceberg_lv2_block *level2 = iceberg_resize_mmap(
+      sizeof(iceberg_lv2_block) * cur_blocks, "level2 resize failed");
+   iceberg_lv3_list *level3 = iceberg_resize_mmap(
+      sizeof(iceberg_lv3_list) * cur_blocks, "level3 resize failed");
+   iceberg_lv1_block_md *lv1_md = iceberg_resize_mmap(
+      sizeof(iceberg_lv1_block_md) * cur_blocks + 64, "lv1_md resize failed");
+   iceberg_lv2_block_md *lv2_md = iceberg_resize_mmap(
+      sizeof(iceberg_lv2_block_md) * cur_blocks + 32, "lv2_md resize failed");
+   uint64_t *lv3_sizes = iceberg_resize_mmap(sizeof(uint64_t) * cur_blocks,
+                                             "lv3_sizes resize failed");
+   uint8_t  *lv3_locks = iceberg_resize_mmap(sizeof(uint8_t) * cur_blocks,
+                                            "lv3_locks resize failed");
+   size_t    resize_marker_size =
+      sizeof(uint8_t) * (cur_blocks >> RESIZE_CHUNK_BITS);
+   uint8_t *resize_marker =
+      iceberg_resize_mmap(resize_marker_size, "resize marker resize failed");
+
+   write_lock(&metadata->resize_rwlock, WAIT_FOR_LOCK);
+
+   table->level1[resize_cnt]             = level1;
+   table->level2[resize_cnt]             = level2;
+   table->level3[resize_cnt]             = level3;
+   metadata->lv1_md[resize_cnt]          = lv1_md;
+   metadata->lv2_md[resize_cnt]          = lv2_md;
+   metadata->lv3_sizes[resize_cnt]       = lv3_sizes;
+   metadata->lv3_locks[resize_cnt]       = lv3_locks;
+   metadata->resize_marker[resize_cnt]   = resize_marker;
+   metadata->marker_sizes[resize_cnt]    = resize_marker_size;
+
+   // every chunk of the old blocks is pending again.
+   for (uint64_t i = 0; i < resize_cnt; ++i) {
+      memset(metadata->resize_marker[i],
+             RESIZE_CHUNK_PENDING,
+             metadata->marker_sizes[i]);
    }
 
-   uint64_t total_blocks = table->metadata.nblocks * 2;
-   uint64_t total_size_in_bytes =
+   uint64_t total_blocks = cur_blocks * 2;
+   metadata->total_size_in_bytes =
       (sizeof(iceberg_lv1_block) + sizeof(iceberg_lv2_block)
        + sizeof(iceberg_lv1_block_md) + sizeof(iceberg_lv2_block_md))
       * total_blocks;
+   metadata->resize_cnt = resize_cnt;
+   metadata->nslots *= 2;
+   metadata->nblocks = total_blocks;
+   metadata->block_bits += 1;
+   metadata->nblocks_parts[resize_cnt] = total_blocks;
+   __atomic_store_n(&metadata->resize_chunks_left,
+                    cur_blocks >> RESIZE_CHUNK_BITS,
+                    __ATOMIC_RELEASE);
+
+   write_unlock(&metadata->resize_rwlock);
+   unlock(&metadata->lock);
+}
+#endif
 
-   // increment resize cnt
-   table->metadata.resize_cnt += 1;
-
-   // update metadata
-   table->metadata.total_size_in_bytes = total_size_in_bytes;
-   table->metadata.nslots *= 2;
-   table->metadata.nblocks = total_blocks;
-   table->metadata.block_bits += 1;
-   table->metadata.nblocks_parts[resize_cnt] = total_blocks;
-
-   // reset the block ctr
-   table->metadata.lv1_resize_ctr = 0;
-   table->metadata.lv2_resize_ctr = 0;
-   table->metadata.lv3_resize_ctr = 0;
-
-   /*printf("Setting up finished\n");*/
-   unlock(&table->metadata.lock);
-   return true;
+/*
+ * Every operation on the table starts with iceberg_enter() and ends with
+ * iceberg_exit(). In between, the blocks key may be in stay where they are.
+ */
+static inline void
+iceberg_enter(iceberg_table *table, slice key, threadid thread_id)
+{
+#ifdef ENABLE_RESIZE
+   if (unlikely(need_resize(table))) {
+      iceberg_setup_resize(table);
+   }
+   read_lock(&table->metadata.resize_rwlock, WAIT_FOR_LOCK, thread_id);
+   iceberg_resize_fix_key(table, key, thread_id);
+#endif
 }
 
-static bool
-iceberg_lv1_move_block(iceberg_table *table, uint64_t bnum, threadid thread_id);
-static bool
-iceberg_lv2_move_block(iceberg_table *table, uint64_t bnum, threadid thread_id);
-static bool
-iceberg_lv3_move_block(iceberg_table *table, uint64_t bnum, threadid thread_id);
+static inline void
+iceberg_exit(iceberg_table *table, threadid thread_id)
+{
+#ifdef ENABLE_RESIZE
+   read_unlock(&table->metadata.resize_rwlock, thread_id);
+#endif
+}
 
-// finish moving blocks that are left during the last resize.
-void
-iceberg_end(iceberg_table *table)
+/*
+ * Slabs are never freed: a node that leaves its list goes to the cache of the
+ * thread that removed it, and lv3 keeps the memory of its largest overflow.
+ */
+static inline iceberg_lv3_node *
+iceberg_lv3_node_create(iceberg_table *table, threadid thread_id)
 {
-   if (is_lv1_resize_active(table)) {
-      for (uint64_t j = 0; j < table->metadata.nblocks / 8; ++j) {
-         uint64_t chunk_idx = j;
-         uint64_t mindex, moffset;
-         get_index_offset(
-            table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-         // if fixing is needed set the marker
-         if (!__sync_lock_test_and_set(
-                &table->metadata.lv1_resize_marker[mindex][moffset], 1))
-         {
-            for (uint8_t i = 0; i < 8; ++i) {
-               uint64_t idx = chunk_idx * 8 + i;
-               iceberg_lv1_move_block(table, idx, 0);
-            }
-            // set the marker for the dest block
-            uint64_t dest_chunk_idx =
-               chunk_idx + table->metadata.nblocks / 8 / 2;
-            uint64_t mindex, moffset;
-            get_index_offset(table->metadata.log_init_size - 3,
-                             dest_chunk_idx,
-                             &mindex,
-                             &moffset);
-            __sync_lock_test_and_set(
-               &table->metadata.lv1_resize_marker[mindex][moffset], 1);
-         }
+   iceberg_lv3_node_cache *cache = &table->lv3_node_caches[thread_id];
+   if (unlikely(cache->head == NULL)) {
+      iceberg_lv3_node *slab = TYPED_ARRAY_MALLOC(0, slab, LV3_SLAB_NODES);
+      platform_assert(slab != NULL);
+      for (uint64_t i = 0; i < LV3_SLAB_NODES - 1; i++) {
+         slab[i].next_node = &slab[i + 1];
       }
+      slab[LV3_SLAB_NODES - 1].next_node = NULL;
+      cache->head                        = slab;
+      cache->count                       = LV3_SLAB_NODES;
+      cache->slabs++;
    }
-   if (is_lv2_resize_active(table)) {
-      for (uint64_t j = 0; j < table->metadata.nblocks / 8; ++j) {
-         uint64_t chunk_idx = j;
-         uint64_t mindex, moffset;
-         get_index_offset(
-            table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-         // if fixing is needed set the marker
-         if (!__sync_lock_test_and_set(
-                &table->metadata.lv2_resize_marker[mindex][moffset], 1))
-         {
-            for (uint8_t i = 0; i < 8; ++i) {
-               uint64_t idx = chunk_idx * 8 + i;
-               iceberg_lv2_move_block(table, idx, 0);
-            }
-            // set the marker for the dest block
-            uint64_t dest_chunk_idx =
-               chunk_idx + table->metadata.nblocks / 8 / 2;
-            uint64_t mindex, moffset;
-            get_index_offset(table->metadata.log_init_size - 3,
-                             dest_chunk_idx,
-                             &mindex,
-                             &moffset);
-            __sync_lock_test_and_set(
-               &table->metadata.lv2_resize_marker[mindex][moffset], 1);
-         }
-      }
-   }
-   if (is_lv3_resize_active(table)) {
-      for (uint64_t j = 0; j < table->metadata.nblocks / 8; ++j) {
-         uint64_t chunk_idx = j;
-         uint64_t mindex, moffset;
-         get_index_offset(
-            table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-         // if fixing is needed set the marker
-         if (!__sync_lock_test_and_set(
-                &table->metadata.lv3_resize_marker[mindex][moffset], 1))
-         {
-            for (uint8_t i = 0; i < 8; ++i) {
-               uint64_t idx = chunk_idx * 8 + i;
-               iceberg_lv3_move_block(table, idx, 0);
-            }
-            // set the marker for the dest block
-            uint64_t dest_chunk_idx =
-               chunk_idx + table->metadata.nblocks / 8 / 2;
-            uint64_t mindex, moffset;
-            get_index_offset(table->metadata.log_init_size - 3,
-                             dest_chunk_idx,
-                             &mindex,
-                             &moffset);
-            __sync_lock_test_and_set(
-               &table->metadata.lv3_resize_marker[mindex][moffset], 1);
-         }
-      }
-   }
-
-   /*printf("Final resize done.\n");*/
-   /*printf("Final resize done. Table load: %ld\n",
-    * iceberg_table_load(table));*/
+   iceberg_lv3_node *node = cache->head;
+   cache->head            = node->next_node;
+   cache->count--;
+   return node;
 }
-#endif
 
 static inline bool
 iceberg_lv3_insert(iceberg_table *table,
                    slice          key,
-                   ValueType      value,
+                   ValueType     *value,
                    uint64_t       refcount,
                    uint64_t       lv3_index,
                    threadid       thread_id)
 {
-
-#ifdef ENABLE_RESIZE
-   if (unlikely(lv3_index < (table->metadata.nblocks >> 1)
-                && is_lv3_resize_active(table)))
-   {
-      uint64_t chunk_idx = lv3_index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      // if fixing is needed set the marker
-      if (!__sync_lock_test_and_set(
-             &table->metadata.lv3_resize_marker[mindex][moffset], 1))
-      {
-         for (uint8_t i = 0; i < 8; ++i) {
-            uint64_t idx = chunk_idx * 8 + i;
-            /*printf("LV3 Before: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 3));*/
-            iceberg_lv3_move_block(table, idx, thread_id);
-            /*printf("LV3 After: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 3));*/
-         }
-         // set the marker for the dest block
-         uint64_t dest_chunk_idx = chunk_idx + table->metadata.nblocks / 8 / 2;
-         uint64_t mindex, moffset;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         __sync_lock_test_and_set(
-            &table->metadata.lv3_resize_marker[mindex][moffset], 1);
-      }
-   }
-#endif
-
    uint64_t bindex, boffset;
    get_index_offset(
       table->metadata.log_init_size, lv3_index, &bindex, &boffset);
    iceberg_metadata *metadata = &table->metadata;
    iceberg_lv3_list *lists    = table->level3[bindex];
 
+   iceberg_lv3_node *new_node = iceberg_lv3_node_create(table, thread_id);
+   kv_pair_set(&new_node->kv, key, value, refcount);
+
    while (__sync_lock_test_and_set(metadata->lv3_locks[bindex] + boffset, 1))
       ;
 
-   // iceberg_lv3_node *new_node =
-   //    (iceberg_lv3_node *)malloc(sizeof(iceberg_lv3_node));
-   iceberg_lv3_node *new_node;
-   posix_memalign((void **)&new_node, 64, sizeof(iceberg_lv3_node));
-
-   new_node->kv.key      = key;
-   new_node->kv.val      = value;
-   new_node->kv.refcount = refcount;
-
    // printf("tid %d %p %s %s insert refcount: %d\n", thread_id, (void *)table,
    // __func__, key, value.refcount);
 
@@ -849,13 +986,13 @@ iceberg_lv3_insert(iceberg_table *table,
    pc_add(&metadata->lv3_balls, 1, thread_id);
    metadata->lv3_locks[bindex][boffset] = 0;
 
-   return true;
+   return TRUE;
 }
 
 static inline bool
 iceberg_lv2_insert_internal(iceberg_table *table,
                             slice          key,
-                            ValueType      value,
+                            ValueType     *value,
                             uint64_t       refcount,
                             uint8_t        fprint,
                             uint64_t       index,
@@ -868,26 +1005,24 @@ iceberg_lv2_insert_internal(iceberg_table *table,
    iceberg_lv2_block *blocks   = table->level2[bindex];
 
 start:;
-   __mmask32 md_mask =
-      slot_mask_32(metadata->lv2_md[bindex][boffset].block_md, 0)
+   uint32_t md_mask =
+      table->simd->slot_mask_32(metadata->lv2_md[bindex][boffset].block_md, 0)
       & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
    uint8_t popct = __builtin_popcountll(md_mask);
 
    if (unlikely(!popct))
-      return false;
+      return FALSE;
 
    uint8_t start = 0;
    /*for(uint8_t i = start; i < start + popct; ++i) {*/
 
-   uint8_t slot = word_select(md_mask, start);
+   uint8_t slot = table->simd->word_select(md_mask, start);
 
    if (__sync_bool_compare_and_swap(
           metadata->lv2_md[bindex][boffset].block_md + slot, 0, 1))
    {
       pc_add(&metadata->lv2_balls, 1, thread_id);
-      blocks[boffset].slots[slot].key      = key;
-      blocks[boffset].slots[slot].val      = value;
-      blocks[boffset].slots[slot].refcount = refcount;
+      kv_pair_set(&blocks[boffset].slots[slot], key, value, refcount);
       // ValueType value_with_refcount = {.value    = value.value,
       //                                  .refcount = value.refcount};
       // // printf("tid %d %p %s %s before update refcount: %d\n", thread_id,
@@ -900,19 +1035,22 @@ start:;
       // printf("tid %d %p %s %s after update refcount: %d\n", thread_id, (void
       // *)table, __func__, key, blocks[boffset].slots[slot].val.refcount);
 
-      metadata->lv2_md[bindex][boffset].block_md[slot] = fprint;
-      return true;
+      // Lookups of other keys do not lock this block, publish the slot last
+      __atomic_store_n(&metadata->lv2_md[bindex][boffset].block_md[slot],
+                       fprint,
+                       __ATOMIC_RELEASE);
+      return TRUE;
    }
    goto start;
    /*}*/
 
-   return false;
+   return FALSE;
 }
 
 static inline bool
 iceberg_lv2_insert(iceberg_table *table,
                    slice          key,
-                   ValueType      value,
+                   ValueType     *value,
                    uint64_t       refcount,
                    uint64_t       lv3_index,
                    threadid       thread_id)
@@ -934,11 +1072,11 @@ iceberg_lv2_insert(iceberg_table *table,
    get_index_offset(table->metadata.log_init_size, index1, &bindex1, &boffset1);
    get_index_offset(table->metadata.log_init_size, index2, &bindex2, &boffset2);
 
-   __mmask32 md_mask1 =
-      slot_mask_32(metadata->lv2_md[bindex1][boffset1].block_md, 0)
+   uint32_t md_mask1 =
+      table->simd->slot_mask_32(metadata->lv2_md[bindex1][boffset1].block_md, 0)
       & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
-   __mmask32 md_mask2 =
-      slot_mask_32(metadata->lv2_md[bindex2][boffset2].block_md, 0)
+   uint32_t md_mask2 =
+      table->simd->slot_mask_32(metadata->lv2_md[bindex2][boffset2].block_md, 0)
       & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
 
    uint8_t popct1 = __builtin_popcountll(md_mask1);
@@ -950,46 +1088,12 @@ iceberg_lv2_insert(iceberg_table *table,
       bindex1  = bindex2;
       boffset1 = boffset2;
       md_mask1 = md_mask2;
-      popct1   = popct2;
-   }
-
-#ifdef ENABLE_RESIZE
-   // move blocks if resize is active and not already moved.
-   if (unlikely(index1 < (table->metadata.nblocks >> 1)
-                && is_lv2_resize_active(table)))
-   {
-      uint64_t chunk_idx = index1 / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      // if fixing is needed set the marker
-      if (!__sync_lock_test_and_set(
-             &table->metadata.lv2_resize_marker[mindex][moffset], 1))
-      {
-         for (uint8_t i = 0; i < 8; ++i) {
-            uint64_t idx = chunk_idx * 8 + i;
-            /*printf("LV2 Before: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 2));*/
-            iceberg_lv2_move_block(table, idx, thread_id);
-            /*printf("LV2 After: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 2));*/
-         }
-         // set the marker for the dest block
-         uint64_t dest_chunk_idx = chunk_idx + table->metadata.nblocks / 8 / 2;
-         uint64_t mindex, moffset;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         __sync_lock_test_and_set(
-            &table->metadata.lv2_resize_marker[mindex][moffset], 1);
-      }
+      popct1   = popct2;
    }
-#endif
 
    if (iceberg_lv2_insert_internal(
           table, key, value, refcount, fprint1, index1, thread_id))
-      return true;
+      return TRUE;
 
    return iceberg_lv3_insert(table, key, value, refcount, lv3_index, thread_id);
 }
@@ -997,7 +1101,7 @@ iceberg_lv2_insert(iceberg_table *table,
 static bool
 iceberg_insert_internal(iceberg_table *table,
                         slice          key,
-                        ValueType      value,
+                        ValueType     *value,
                         uint64_t       refcount,
                         uint8_t        fprint,
                         uint64_t       bindex,
@@ -1007,23 +1111,21 @@ iceberg_insert_internal(iceberg_table *table,
    iceberg_metadata  *metadata = &table->metadata;
    iceberg_lv1_block *blocks   = table->level1[bindex];
 start:;
-   __mmask64 md_mask =
-      slot_mask_64(metadata->lv1_md[bindex][boffset].block_md, 0);
+   uint64_t md_mask =
+      table->simd->slot_mask_64(metadata->lv1_md[bindex][boffset].block_md, 0);
 
    uint8_t popct = __builtin_popcountll(md_mask);
 
    if (unlikely(!popct))
-      return false;
+      return FALSE;
 
    uint8_t start = 0;
-   uint8_t slot  = word_select(md_mask, start);
+   uint8_t slot  = table->simd->word_select(md_mask, start);
 
    /*if(__sync_bool_compare_and_swap(metadata->lv1_md[bindex][boffset].block_md
     * + slot, 0, 1)) {*/
    pc_add(&metadata->lv1_balls, 1, thread_id);
-   blocks[boffset].slots[slot].key      = key;
-   blocks[boffset].slots[slot].val      = value;
-   blocks[boffset].slots[slot].refcount = refcount;
+   kv_pair_set(&blocks[boffset].slots[slot], key, value, refcount);
    // ValueType value_with_refcount = {.value    = value.value,
    //                                  .refcount = value.refcount};
    // // printf("tid %d %p %s %s before update refcount: %d\n", thread_id, (void
@@ -1035,12 +1137,12 @@ start:;
    // *)table, __func__, key, blocks[boffset].slots[slot].val.refcount);
 
    metadata->lv1_md[bindex][boffset].block_md[slot] = fprint;
-   return true;
+   return TRUE;
    /*}*/
    goto start;
    /*}*/
 
-   return false;
+   return FALSE;
 }
 
 
@@ -1052,66 +1154,85 @@ iceberg_get_value_internal(iceberg_table *table,
                            bool           should_lock,
                            bool           should_lookup_sketch);
 
+/*
+ * Looks key up without locking its lv1 block, for readers that do not change
+ * the entry. Every change to the entry of a key, at any level, is made under
+ * the lock of its lv1 block, which makes the version of the block odd and
+ * then bumps it again. The lookup retries until the version it started with
+ * is even and unchanged at the end.
+ *
+ * Only short keys are looked up this way: they are compared with the copies
+ * in the slots, never with cells that a writer may free meanwhile.
+ */
 static bool
-iceberg_put_or_insert(iceberg_table *table,
-                      slice         *key,
-                      ValueType    **value,
-                      threadid       thread_id,
-                      bool           increase_refcount,
-                      bool           overwrite_value)
+iceberg_get_value_optimistic(iceberg_table *table,
+                             slice          key,
+                             kv_pair       *found_kv,
+                             threadid       thread_id)
 {
-#ifdef ENABLE_RESIZE
-   if (unlikely(need_resize(table))) {
-      iceberg_setup_resize(table);
+   debug_assert(is_inline_key(key));
+   iceberg_metadata *metadata = &table->metadata;
+   uint8_t           fprint;
+   uint64_t          index;
+   split_hash(lv1_hash(key), &fprint, &index, metadata);
+
+   uint64_t bindex, boffset;
+   get_index_offset(metadata->log_init_size, index, &bindex, &boffset);
+   iceberg_lv1_block_md *md = &metadata->lv1_md[bindex][boffset];
+
+   while (TRUE) {
+      uint64_t version = __atomic_load_n(&md->version, __ATOMIC_ACQUIRE);
+      if (version & 1) {
+         _mm_pause();
+         continue;
+      }
+
+      kv_pair *kv = NULL;
+      bool     found =
+         iceberg_get_value_internal(table, key, &kv, thread_id, FALSE, FALSE);
+      if (found) {
+         found_kv->key = kv->key;
+         found_kv->val = kv->val;
+      }
+
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&md->version, __ATOMIC_RELAXED) == version) {
+         return found;
+      }
    }
-#endif
+}
 
+static bool
+iceberg_put_or_insert_internal(iceberg_table *table,
+                               slice         *key,
+                               ValueType    **value,
+                               threadid       thread_id,
+                               bool           increase_refcount,
+                               bool           overwrite_value)
+{
    iceberg_metadata *metadata = &table->metadata;
    uint8_t           fprint;
    uint64_t          index;
 
-   split_hash(lv1_hash(*key), &fprint, &index, metadata);
-
-#ifdef ENABLE_RESIZE
-   // move blocks if resize is active and not already moved.
-   if (unlikely(index < (table->metadata.nblocks >> 1)
-                && is_lv1_resize_active(table)))
-   {
-      uint64_t chunk_idx = index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      // if fixing is needed set the marker
-      if (!__sync_lock_test_and_set(
-             &table->metadata.lv1_resize_marker[mindex][moffset], 1))
-      {
-         for (uint8_t i = 0; i < 8; ++i) {
-            uint64_t idx = chunk_idx * 8 + i;
-            /*printf("LV1 Before: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 1));*/
-            iceberg_lv1_move_block(table, idx, thread_id);
-            /*printf("LV1 After: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 1));*/
-         }
-         // set the marker for the dest block
-         uint64_t dest_chunk_idx = chunk_idx + table->metadata.nblocks / 8 / 2;
-         uint64_t mindex, moffset;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         __sync_lock_test_and_set(
-            &table->metadata.lv1_resize_marker[mindex][moffset], 1);
+   // A lookup that does not change the entry needs no lock when it hits
+   if (!increase_refcount && !overwrite_value && is_inline_key(*key)) {
+      kv_pair kv;
+      if (iceberg_get_value_optimistic(table, *key, &kv, thread_id)) {
+         *key   = kv.key;
+         *value = kv.val;
+         return FALSE;
       }
    }
-#endif
+
+   split_hash(lv1_hash(*key), &fprint, &index, metadata);
+
    uint64_t bindex, boffset;
    get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
 
    // struct timespec before_lock, after_lock, unlock;
    // clock_gettime(CLOCK_MONOTONIC, &before_lock);
 
-   lock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+   lock_block(&metadata->lv1_md[bindex][boffset]);
 
    // clock_gettime(CLOCK_MONOTONIC, &after_lock);
    // printf("tid %d: %s before_lock - after_lock: %lu ns\n", thread_id,
@@ -1120,7 +1241,7 @@ iceberg_put_or_insert(iceberg_table *table,
 
    kv_pair *kv = NULL;
    if (unlikely(iceberg_get_value_internal(
-          table, *key, &kv, thread_id, false, false)))
+          table, *key, &kv, thread_id, FALSE, FALSE)))
    {
       // printf("tid %d %p %s %s previous refcount: %lu\n", thread_id, (void
       // *)table, __func__, key, kv->refcount);
@@ -1129,11 +1250,11 @@ iceberg_put_or_insert(iceberg_table *table,
          kv->refcount++;
       }
       if (overwrite_value) {
-         kv->val = **value;
+         *kv->val = **value;
       }
 
       *key   = kv->key;
-      *value = &kv->val;
+      *value = kv->val;
 
       // printf("tid %d %p %s %s refcount: %d\n", thread_id, (void *)table,
       // __func__, key, v->refcount);
@@ -1147,38 +1268,37 @@ iceberg_put_or_insert(iceberg_table *table,
       // before_lock.tv_nsec));
 
       /*printf("Found!\n");*/
-      unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
-      return true && overwrite_value;
+      unlock_block(&metadata->lv1_md[bindex][boffset]);
+      return TRUE && overwrite_value;
    }
 
    const uint64_t refcount = 1;
 
-   // Copy the key and insert it to the table.
-   char *key_copy_buffer;
-   key_copy_buffer = TYPED_ARRAY_ZALLOC(0, key_copy_buffer, slice_length(*key));
-   *key            = slice_copy_contents(key_copy_buffer, *key);
+   // Copy the key and the value to a new cell and insert it to the table.
+   kv_cell *cell = kv_cell_create(table, *key, **value, thread_id);
+   *key          = slice_create(slice_length(*key), cell->key);
+
+   // If the sketch is enabled, get the value from the sketch to
+   // the new item and set the max.
+   if (table->sktch && !overwrite_value) {
+      table->sktch->config->insert_value_fn(&cell->val,
+                                            sketch_get(table->sktch, *key));
+   }
 
    bool ret = iceberg_insert_internal(
-      table, *key, **value, refcount, fprint, bindex, boffset, thread_id);
+      table, *key, &cell->val, refcount, fprint, bindex, boffset, thread_id);
    if (!ret)
-      ret =
-         iceberg_lv2_insert(table, *key, **value, refcount, index, thread_id);
+      ret = iceberg_lv2_insert(
+         table, *key, &cell->val, refcount, index, thread_id);
 
    if (ret) {
-      iceberg_get_value_internal(table, *key, &kv, thread_id, false, false);
-      // If the sketch is enabled, get the value from the sketch to
-      // the new item and set the max.
-      if (table->sktch && !overwrite_value) {
-         table->sktch->config->insert_value_fn(&kv->val,
-                                               sketch_get(table->sktch, *key));
-      }
-      *value = &kv->val;
+      *value = &cell->val;
    }
 
-   // If it fails to insert the key, free the key memory and return
-   // the key as NULL.
+   // If it fails to insert the key, free the cell and return the key as
+   // NULL.
    if (!ret) {
-      platform_free_from_heap(0, key_copy_buffer);
+      kv_cell_destroy(table, &cell->val, *key, thread_id);
       *key = NULL_SLICE;
    }
 
@@ -1192,7 +1312,22 @@ iceberg_put_or_insert(iceberg_table *table,
 
    // printf("tid %d %p %s %s is newly inserted\n", thread_id, (void *)table,
    // __func__, key);
-   unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+   unlock_block(&metadata->lv1_md[bindex][boffset]);
+   return ret;
+}
+
+static bool
+iceberg_put_or_insert(iceberg_table *table,
+                      slice         *key,
+                      ValueType    **value,
+                      threadid       thread_id,
+                      bool           increase_refcount,
+                      bool           overwrite_value)
+{
+   iceberg_enter(table, *key, thread_id);
+   bool ret = iceberg_put_or_insert_internal(
+      table, key, value, thread_id, increase_refcount, overwrite_value);
+   iceberg_exit(table, thread_id);
    return ret;
 }
 
@@ -1204,7 +1339,7 @@ iceberg_insert(iceberg_table *table,
 {
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
    ValueType *value_ptr = &value;
-   return iceberg_put_or_insert(table, key, &value_ptr, thread_id, true, false);
+   return iceberg_put_or_insert(table, key, &value_ptr, thread_id, TRUE, FALSE);
 }
 
 __attribute__((always_inline)) bool
@@ -1216,7 +1351,7 @@ iceberg_insert_without_increasing_refcount(iceberg_table *table,
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
    ValueType *value_ptr = &value;
    return iceberg_put_or_insert(
-      table, key, &value_ptr, thread_id, false, false);
+      table, key, &value_ptr, thread_id, FALSE, FALSE);
 }
 
 __attribute__((always_inline)) bool
@@ -1226,7 +1361,7 @@ iceberg_insert_and_get(iceberg_table *table,
                        threadid       thread_id)
 {
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
-   return iceberg_put_or_insert(table, key, value, thread_id, true, false);
+   return iceberg_put_or_insert(table, key, value, thread_id, TRUE, FALSE);
 }
 
 __attribute__((always_inline)) bool
@@ -1236,7 +1371,7 @@ iceberg_insert_and_get_without_increasing_refcount(iceberg_table *table,
                                                    threadid       thread_id)
 {
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
-   return iceberg_put_or_insert(table, key, value, thread_id, false, false);
+   return iceberg_put_or_insert(table, key, value, thread_id, FALSE, FALSE);
 }
 
 // __attribute__((always_inline)) bool
@@ -1259,13 +1394,12 @@ iceberg_insert_and_get_without_increasing_refcount(iceberg_table *table,
 //    return iceberg_put_or_insert(table, key, value, thread_id, false, false);
 // }
 
-bool
-iceberg_update(iceberg_table *table,
-               slice         *key,
-               ValueType      value,
-               threadid       thread_id)
+static bool
+iceberg_update_internal(iceberg_table *table,
+                        slice         *key,
+                        ValueType      value,
+                        threadid       thread_id)
 {
-
    iceberg_metadata *metadata = &table->metadata;
    uint8_t           fprint;
    uint64_t          index;
@@ -1275,23 +1409,35 @@ iceberg_update(iceberg_table *table,
    uint64_t bindex, boffset;
    get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
 
-   lock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+   lock_block(&metadata->lv1_md[bindex][boffset]);
 
    kv_pair *kv;
    if (likely(iceberg_get_value_internal(
-          table, *key, &kv, thread_id, false, false)))
+          table, *key, &kv, thread_id, FALSE, FALSE)))
    {
-      kv->val = value;
-      *key    = kv->key;
+      *kv->val = value;
+      *key     = kv->key;
       /*printf("Found!\n");*/
-      unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
-      return true;
+      unlock_block(&metadata->lv1_md[bindex][boffset]);
+      return TRUE;
    }
 
    *key = NULL_SLICE;
 
-   unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
-   return false;
+   unlock_block(&metadata->lv1_md[bindex][boffset]);
+   return FALSE;
+}
+
+bool
+iceberg_update(iceberg_table *table,
+               slice         *key,
+               ValueType      value,
+               threadid       thread_id)
+{
+   iceberg_enter(table, *key, thread_id);
+   bool ret = iceberg_update_internal(table, key, value, thread_id);
+   iceberg_exit(table, thread_id);
+   return ret;
 }
 
 __attribute__((always_inline)) bool
@@ -1301,14 +1447,20 @@ iceberg_put(iceberg_table *table,
             threadid       thread_id)
 {
    ValueType *value_ptr = &value;
-   return iceberg_put_or_insert(table, key, &value_ptr, thread_id, true, true);
+   return iceberg_put_or_insert(table, key, &value_ptr, thread_id, TRUE, TRUE);
 }
 
 static inline void
-iceberg_lv3_node_deinit(iceberg_lv3_node *node)
+iceberg_lv3_node_deinit(iceberg_table    *table,
+                        iceberg_lv3_node *node,
+                        threadid          thread_id)
 {
-   platform_free_from_heap(0, (void *)slice_data(node->kv.key));
-   platform_free_from_heap(0, (void *)node);
+   kv_cell_destroy(table, node->kv.val, node->kv.key, thread_id);
+
+   iceberg_lv3_node_cache *cache = &table->lv3_node_caches[thread_id];
+   node->next_node               = cache->head;
+   cache->head                   = node;
+   cache->count++;
 }
 
 static inline bool
@@ -1327,7 +1479,7 @@ iceberg_lv3_remove_internal(iceberg_table *table,
    iceberg_lv3_list *lists    = table->level3[bindex];
 
    if (metadata->lv3_sizes[bindex][boffset] == 0) {
-      return false;
+      return FALSE;
    }
 
    while (__sync_lock_test_and_set(metadata->lv3_locks[bindex] + boffset, 1))
@@ -1335,24 +1487,24 @@ iceberg_lv3_remove_internal(iceberg_table *table,
 
    iceberg_lv3_node *head = lists[boffset].head;
 
-   bool ret = false;
+   bool ret = FALSE;
 
-   if (iceberg_key_compare(table->spl_data_config, head->kv.key, key) == 0) {
+   if (kv_pair_key_equal(table, &head->kv, key)) {
       // printf("tid %d %p %s %s previous head refcount: %d\n", thread_id, (void
       // *)table, __func__, key, head->val.refcount);
       if (force_remove || (delete_item && head->kv.refcount == 1)) {
          // If it has a sketch, insert the removed value to it.
          if (table->sktch) {
-            sketch_insert(table->sktch, head->kv.key, head->kv.val);
+            sketch_insert(table->sktch, head->kv.key, *head->kv.val);
          }
 
          head->kv.refcount          = 0;
          iceberg_lv3_node *old_head = lists[boffset].head;
          lists[boffset].head        = lists[boffset].head->next_node;
-         iceberg_lv3_node_deinit(old_head);
+         iceberg_lv3_node_deinit(table, old_head, thread_id);
          metadata->lv3_sizes[bindex][boffset]--;
          pc_add(&metadata->lv3_balls, -1, thread_id);
-         ret = true;
+         ret = TRUE;
       } else if (head->kv.refcount == 0) {
          ;
       } else {
@@ -1370,8 +1522,7 @@ iceberg_lv3_remove_internal(iceberg_table *table,
    for (uint64_t i = 0; i < metadata->lv3_sizes[bindex][boffset] - 1; ++i) {
       iceberg_lv3_node *next_node = current_node->next_node;
 
-      if (iceberg_key_compare(table->spl_data_config, next_node->kv.key, key)
-          == 0) {
+      if (kv_pair_key_equal(table, &next_node->kv, key)) {
          // printf("tid %d %p %s %s before next_node refcount: %d\n", thread_id,
          // (void *)table, __func__, key, next_node->val.refcount);
 
@@ -1379,17 +1530,17 @@ iceberg_lv3_remove_internal(iceberg_table *table,
             // If it has a sketch, insert the removed value to it.
             if (table->sktch) {
                sketch_insert(
-                  table->sktch, next_node->kv.key, next_node->kv.val);
+                  table->sktch, next_node->kv.key, *next_node->kv.val);
             }
 
             key                        = next_node->kv.key;
             next_node->kv.refcount     = 0;
             iceberg_lv3_node *old_node = current_node->next_node;
             current_node->next_node    = current_node->next_node->next_node;
-            iceberg_lv3_node_deinit(old_node);
+            iceberg_lv3_node_deinit(table, old_node, thread_id);
             metadata->lv3_sizes[bindex][boffset]--;
             pc_add(&metadata->lv3_balls, -1, thread_id);
-            ret = true;
+            ret = TRUE;
          } else if (next_node->kv.refcount == 0) {
             ;
          } else {
@@ -1406,7 +1557,7 @@ iceberg_lv3_remove_internal(iceberg_table *table,
    }
 
    metadata->lv3_locks[bindex][boffset] = 0;
-   return false;
+   return FALSE;
 }
 
 static inline bool
@@ -1422,42 +1573,10 @@ iceberg_lv3_remove(iceberg_table *table,
       table, key, lv3_index, delete_item, force_remove, thread_id);
 
    if (ret)
-      return true;
+      return TRUE;
 
-#ifdef ENABLE_RESIZE
-   // check if there's an active resize and block isn't fixed yet
-   if (unlikely(is_lv3_resize_active(table)
-                && lv3_index >= (table->metadata.nblocks >> 1)))
-   {
-      uint64_t mask      = ~(1ULL << (table->metadata.block_bits - 1));
-      uint64_t old_index = lv3_index & mask;
-      uint64_t chunk_idx = old_index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      if (__atomic_load_n(&table->metadata.lv3_resize_marker[mindex][moffset],
-                          __ATOMIC_SEQ_CST)
-          == 0)
-      { // not fixed yet
-         return iceberg_lv3_remove_internal(
-            table, key, old_index, delete_item, force_remove, thread_id);
-      } else {
-         // wait for the old block to be fixed
-         uint64_t dest_chunk_idx = lv3_index / 8;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         while (
-            __atomic_load_n(&table->metadata.lv3_resize_marker[mindex][moffset],
-                            __ATOMIC_SEQ_CST)
-            == 0)
-            ;
-      }
-   }
-#endif
 
-   return false;
+   return FALSE;
 }
 
 static inline bool
@@ -1481,116 +1600,26 @@ iceberg_lv2_remove(iceberg_table *table,
       get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
       iceberg_lv2_block *blocks = table->level2[bindex];
 
-#ifdef ENABLE_RESIZE
-      // check if there's an active resize and block isn't fixed yet
-      if (unlikely(is_lv2_resize_active(table)
-                   && index >= (table->metadata.nblocks >> 1)))
-      {
-         uint64_t mask      = ~(1ULL << (table->metadata.block_bits - 1));
-         uint64_t old_index = index & mask;
-         uint64_t chunk_idx = old_index / 8;
-         uint64_t mindex, moffset;
-         get_index_offset(
-            table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-         if (__atomic_load_n(
-                &table->metadata.lv2_resize_marker[mindex][moffset],
-                __ATOMIC_SEQ_CST)
-             == 0)
-         { // not fixed yet
-            uint64_t old_bindex, old_boffset;
-            get_index_offset(table->metadata.log_init_size,
-                             old_index,
-                             &old_bindex,
-                             &old_boffset);
-            __mmask32 md_mask =
-               slot_mask_32(metadata->lv2_md[old_bindex][old_boffset].block_md,
-                            fprint)
-               & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
-            int                popct  = __builtin_popcount(md_mask);
-            iceberg_lv2_block *blocks = table->level2[old_bindex];
-
-            bool ret = false;
-            for (int i = 0; i < popct; ++i) {
-               uint8_t slot = word_select(md_mask, i);
-
-               if (iceberg_key_compare(table->spl_data_config,
-                                       blocks[old_boffset].slots[slot].key,
-                                       key)
-                   == 0)
-               {
-                  // printf("tid %d %p %s %s Found in the old index refcount:
-                  // %d\n", thread_id, (void *)table, __func__, key,
-                  // blocks[old_boffset].slots[slot].val.refcount);
-
-                  if (value) {
-                     *value = blocks[old_boffset].slots[slot].val;
-                  }
-
-                  if (force_remove
-                      || (delete_item
-                          && blocks[old_boffset].slots[slot].refcount == 1))
-                  {
-                     // If it has a sketch, insert the removed value to it.
-                     if (table->sktch) {
-                        sketch_insert(table->sktch,
-                                      blocks[old_boffset].slots[slot].key,
-                                      blocks[old_boffset].slots[slot].val);
-                     }
-
-                     metadata->lv2_md[old_bindex][old_boffset].block_md[slot] =
-                        0;
-                     platform_free_from_heap(
-                        0, slice_data(blocks[old_boffset].slots[slot].key));
-                     blocks[old_boffset].slots[slot].key      = NULL_SLICE;
-                     blocks[old_boffset].slots[slot].refcount = 0;
-                     pc_add(&metadata->lv2_balls, -1, thread_id);
-                     ret = true;
-                  } else if (blocks[old_boffset].slots[slot].refcount == 0) {
-                     return false;
-                  } else {
-                     blocks[old_boffset].slots[slot].refcount--;
-                  }
-
-                  return ret;
-               }
-            }
-         } else {
-            // wait for the old block to be fixed
-            uint64_t dest_chunk_idx = index / 8;
-            get_index_offset(table->metadata.log_init_size - 3,
-                             dest_chunk_idx,
-                             &mindex,
-                             &moffset);
-            while (__atomic_load_n(
-                      &table->metadata.lv2_resize_marker[mindex][moffset],
-                      __ATOMIC_SEQ_CST)
-                   == 0)
-               ;
-         }
-      }
-#endif
 
-      __mmask32 md_mask =
-         slot_mask_32(metadata->lv2_md[bindex][boffset].block_md, fprint)
+      uint32_t md_mask =
+         table->simd->slot_mask_32(metadata->lv2_md[bindex][boffset].block_md,
+                                   fprint)
          & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
       int popct = __builtin_popcount(md_mask);
 
-      bool ret = false;
+      bool ret = FALSE;
 
       for (int i = 0; i < popct; ++i) {
-         uint8_t slot = word_select(md_mask, i);
+         uint8_t slot = table->simd->word_select(md_mask, i);
 
-         if (iceberg_key_compare(
-                table->spl_data_config, blocks[boffset].slots[slot].key, key)
-             == 0)
-         {
+         if (kv_pair_key_equal(table, &blocks[boffset].slots[slot], key)) {
 
             // printf("tid %d %p %s %s Found refcount: %d\n", thread_id, (void
             // *)table, __func__, key,
             // blocks[boffset].slots[slot].val.refcount);
 
             if (value) {
-               *value = blocks[boffset].slots[slot].val;
+               *value = *blocks[boffset].slots[slot].val;
             }
 
             if (force_remove
@@ -1599,17 +1628,19 @@ iceberg_lv2_remove(iceberg_table *table,
                if (table->sktch) {
                   sketch_insert(table->sktch,
                                 blocks[boffset].slots[slot].key,
-                                blocks[boffset].slots[slot].val);
+                                *blocks[boffset].slots[slot].val);
                }
                metadata->lv2_md[bindex][boffset].block_md[slot] = 0;
-               platform_free_from_heap(
-                  0, (void *)slice_data(blocks[boffset].slots[slot].key));
+               kv_cell_destroy(table,
+                               blocks[boffset].slots[slot].val,
+                               blocks[boffset].slots[slot].key,
+                               thread_id);
                blocks[boffset].slots[slot].key      = NULL_SLICE;
                blocks[boffset].slots[slot].refcount = 0;
                pc_add(&metadata->lv2_balls, -1, thread_id);
-               ret = true;
+               ret = TRUE;
             } else if (blocks[boffset].slots[slot].refcount == 0) {
-               return false;
+               return FALSE;
             } else {
                blocks[boffset].slots[slot].refcount--;
             }
@@ -1624,12 +1655,12 @@ iceberg_lv2_remove(iceberg_table *table,
 }
 
 static inline bool
-iceberg_get_and_remove_with_force(iceberg_table *table,
-                                  slice          key,
-                                  ValueType     *value,
-                                  bool           delete_item,
-                                  bool           force_remove,
-                                  threadid       thread_id)
+iceberg_get_and_remove_with_force_internal(iceberg_table *table,
+                                           slice          key,
+                                           ValueType     *value,
+                                           bool           delete_item,
+                                           bool           force_remove,
+                                           threadid       thread_id)
 {
    iceberg_metadata *metadata = &table->metadata;
    uint8_t           fprint;
@@ -1643,118 +1674,20 @@ iceberg_get_and_remove_with_force(iceberg_table *table,
    // printf("tid %d %p %s %s started\n", thread_id, (void *)table, __func__,
    // key);
 
-#ifdef ENABLE_RESIZE
-   // check if there's an active resize and block isn't fixed yet
-   if (unlikely(is_lv1_resize_active(table)
-                && index >= (table->metadata.nblocks >> 1)))
-   {
-      uint64_t mask      = ~(1ULL << (table->metadata.block_bits - 1));
-      uint64_t old_index = index & mask;
-      uint64_t chunk_idx = old_index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      if (__atomic_load_n(&table->metadata.lv1_resize_marker[mindex][moffset],
-                          __ATOMIC_SEQ_CST)
-          == 0)
-      { // not fixed yet
-         uint64_t old_bindex, old_boffset;
-         get_index_offset(table->metadata.log_init_size,
-                          old_index,
-                          &old_bindex,
-                          &old_boffset);
-
-         // lock_block(
-         //    (uint64_t *)&metadata->lv1_md[old_bindex][old_boffset].block_md);
-
-         __mmask64 md_mask = slot_mask_64(
-            metadata->lv1_md[old_bindex][old_boffset].block_md, fprint);
-         uint8_t popct = __builtin_popcountll(md_mask);
-
-         iceberg_lv1_block *blocks = table->level1[old_bindex];
-
-         bool ret = false;
-         for (int i = 0; i < popct; ++i) {
-            uint8_t slot = word_select(md_mask, i);
-
-            if (iceberg_key_compare(table->spl_data_config,
-                                    blocks[old_boffset].slots[slot].key,
-                                    key)
-                == 0)
-            {
-               if (value) {
-                  *value = blocks[old_boffset].slots[slot].val;
-               }
-
-               // printf("tid %d %p %s %s Found in old index refcount: %d\n",
-               // thread_id, (void *)table, __func__, key,
-               // blocks[old_boffset].slots[slot].val.refcount);
-
-
-               if (force_remove
-                   || (delete_item
-                       && blocks[old_boffset].slots[slot].refcount == 1))
-               {
-                  // If it has a sketch, insert the removed value to it.
-                  if (table->sktch) {
-                     sketch_insert(table->sktch,
-                                   blocks[old_boffset].slots[slot].key,
-                                   blocks[old_boffset].slots[slot].val);
-                  }
-                  metadata->lv1_md[old_bindex][old_boffset].block_md[slot] = 0;
-                  platform_free_from_heap(
-                     0, slice_data(blocks[old_boffset].slots[slot].key));
-                  blocks[old_boffset].slots[slot].key      = NULL_SLICE;
-                  blocks[old_boffset].slots[slot].refcount = 0;
-                  pc_add(&metadata->lv1_balls, -1, thread_id);
-                  ret = true;
-               } else if (blocks[old_boffset].slots[slot].refcount == 0) {
-                  // unlock_block(
-                  //    (uint64_t *)&metadata->lv1_md[old_bindex][old_boffset]
-                  //       .block_md);
-                  return false;
-               } else {
-                  blocks[old_boffset].slots[slot].refcount--;
-               }
-               // unlock_block(
-               //    (uint64_t *)&metadata->lv1_md[old_bindex][old_boffset]
-               //       .block_md);
-               return ret;
-            }
-         }
-      } else {
-         // wait for the old block to be fixed
-         uint64_t dest_chunk_idx = index / 8;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         while (
-            __atomic_load_n(&table->metadata.lv1_resize_marker[mindex][moffset],
-                            __ATOMIC_SEQ_CST)
-            == 0)
-            ;
-      }
-   }
-#endif
-
-   lock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+   lock_block(&metadata->lv1_md[bindex][boffset]);
    // printf("tid %d %p %s %s lock acquired\n", thread_id, (void *)table,
    // __func__, key);
 
-   __mmask64 md_mask =
-      slot_mask_64(metadata->lv1_md[bindex][boffset].block_md, fprint);
+   uint64_t md_mask = table->simd->slot_mask_64(
+      metadata->lv1_md[bindex][boffset].block_md, fprint);
    uint8_t popct = __builtin_popcountll(md_mask);
 
-   bool ret = false;
+   bool ret = FALSE;
 
    for (int i = 0; i < popct; ++i) {
-      uint8_t slot = word_select(md_mask, i);
+      uint8_t slot = table->simd->word_select(md_mask, i);
 
-      if (iceberg_key_compare(
-             table->spl_data_config, blocks[boffset].slots[slot].key, key)
-          == 0)
-      {
+      if (kv_pair_key_equal(table, &blocks[boffset].slots[slot], key)) {
 
          // printf("tid %lu %p %s %s boffset=%lu slot=%d\n", thread_id, (void
          // *)table,
@@ -1764,7 +1697,7 @@ iceberg_get_and_remove_with_force(iceberg_table *table,
          // *)table, __func__, key, blocks[boffset].slots[slot].refcount);
 
          if (value) {
-            *value = blocks[boffset].slots[slot].val;
+            *value = *blocks[boffset].slots[slot].val;
          }
 
          if (force_remove
@@ -1773,19 +1706,20 @@ iceberg_get_and_remove_with_force(iceberg_table *table,
             if (table->sktch) {
                sketch_insert(table->sktch,
                              blocks[boffset].slots[slot].key,
-                             blocks[boffset].slots[slot].val);
+                             *blocks[boffset].slots[slot].val);
             }
             metadata->lv1_md[bindex][boffset].block_md[slot] = 0;
-            platform_free_from_heap(
-               0, (void *)slice_data(blocks[boffset].slots[slot].key));
+            kv_cell_destroy(table,
+                            blocks[boffset].slots[slot].val,
+                            blocks[boffset].slots[slot].key,
+                            thread_id);
             blocks[boffset].slots[slot].key      = NULL_SLICE;
             blocks[boffset].slots[slot].refcount = 0;
             pc_add(&metadata->lv1_balls, -1, thread_id);
-            ret = true;
+            ret = TRUE;
          } else if (blocks[boffset].slots[slot].refcount == 0) {
-            unlock_block(
-               (uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
-            return false;
+            unlock_block(&metadata->lv1_md[bindex][boffset]);
+            return FALSE;
          } else {
             blocks[boffset].slots[slot].refcount--;
          }
@@ -1793,7 +1727,7 @@ iceberg_get_and_remove_with_force(iceberg_table *table,
          // __func__, (char *)slice_data(key), ret ? "DELETED" : "REFCOUNT
          // DECREASED", blocks[boffset].slots[slot].refcount);
 
-         unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+         unlock_block(&metadata->lv1_md[bindex][boffset]);
          return ret;
       }
    }
@@ -1801,7 +1735,22 @@ iceberg_get_and_remove_with_force(iceberg_table *table,
    ret = iceberg_lv2_remove(
       table, key, value, index, delete_item, force_remove, thread_id);
 
-   unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+   unlock_block(&metadata->lv1_md[bindex][boffset]);
+   return ret;
+}
+
+static inline bool
+iceberg_get_and_remove_with_force(iceberg_table *table,
+                                  slice          key,
+                                  ValueType     *value,
+                                  bool           delete_item,
+                                  bool           force_remove,
+                                  threadid       thread_id)
+{
+   iceberg_enter(table, key, thread_id);
+   bool ret = iceberg_get_and_remove_with_force_internal(
+      table, key, value, delete_item, force_remove, thread_id);
+   iceberg_exit(table, thread_id);
    return ret;
 }
 
@@ -1811,7 +1760,7 @@ iceberg_remove(iceberg_table *table, slice key, threadid thread_id)
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
 
    return iceberg_get_and_remove_with_force(
-      table, key, NULL, true, false, thread_id);
+      table, key, NULL, TRUE, FALSE, thread_id);
 }
 
 __attribute__((always_inline)) bool
@@ -1823,7 +1772,7 @@ iceberg_get_and_remove(iceberg_table *table,
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
 
    return iceberg_get_and_remove_with_force(
-      table, key, value, true, false, thread_id);
+      table, key, value, TRUE, FALSE, thread_id);
 }
 
 __attribute__((always_inline)) bool
@@ -1832,14 +1781,14 @@ iceberg_force_remove(iceberg_table *table, slice key, threadid thread_id)
    // printf("tid %d %p %s %s\n", thread_id, (void *)table, __func__, key);
 
    return iceberg_get_and_remove_with_force(
-      table, key, NULL, true, true, thread_id);
+      table, key, NULL, TRUE, TRUE, thread_id);
 }
 
 __attribute__((always_inline)) bool
 iceberg_decrease_refcount(iceberg_table *table, slice key, threadid thread_id)
 {
    return iceberg_get_and_remove_with_force(
-      table, key, NULL, false, false, thread_id);
+      table, key, NULL, FALSE, FALSE, thread_id);
 }
 
 
@@ -1860,7 +1809,7 @@ iceberg_lv3_get_value_internal(iceberg_table *table,
    iceberg_lv3_list *lists    = table->level3[bindex];
 
    if (likely(!metadata->lv3_sizes[bindex][boffset]))
-      return false;
+      return FALSE;
 
    while (__sync_lock_test_and_set(metadata->lv3_locks[bindex] + boffset, 1))
       ;
@@ -1868,18 +1817,17 @@ iceberg_lv3_get_value_internal(iceberg_table *table,
    iceberg_lv3_node *current_node = lists[boffset].head;
 
    for (uint64_t i = 0; i < metadata->lv3_sizes[bindex][boffset]; ++i) {
-      if (iceberg_key_compare(table->spl_data_config, current_node->kv.key, key)
-          == 0) {
+      if (kv_pair_key_equal(table, &current_node->kv, key)) {
          *kv                                  = &current_node->kv;
          metadata->lv3_locks[bindex][boffset] = 0;
-         return true;
+         return TRUE;
       }
       current_node = current_node->next_node;
    }
 
    metadata->lv3_locks[bindex][boffset] = 0;
 
-   return false;
+   return FALSE;
 }
 
 static inline bool
@@ -1891,37 +1839,6 @@ iceberg_lv3_get_value(iceberg_table *table,
    // printf("tid x %p %s %s\n", (void *)table, __func__, key);
 
 
-#ifdef ENABLE_RESIZE
-   // check if there's an active resize and block isn't fixed yet
-   if (unlikely(is_lv3_resize_active(table)
-                && lv3_index >= (table->metadata.nblocks >> 1)))
-   {
-      uint64_t mask      = ~(1ULL << (table->metadata.block_bits - 1));
-      uint64_t old_index = lv3_index & mask;
-      uint64_t chunk_idx = old_index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      if (__atomic_load_n(&table->metadata.lv3_resize_marker[mindex][moffset],
-                          __ATOMIC_SEQ_CST)
-          == 0)
-      { // not fixed yet
-         return iceberg_lv3_get_value_internal(table, key, kv, old_index);
-      } else {
-         // wait for the old block to be fixed
-         uint64_t dest_chunk_idx = lv3_index / 8;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         while (
-            __atomic_load_n(&table->metadata.lv3_resize_marker[mindex][moffset],
-                            __ATOMIC_SEQ_CST)
-            == 0)
-            ;
-      }
-   }
-#endif
 
    return iceberg_lv3_get_value_internal(table, key, kv, lv3_index);
 }
@@ -1948,76 +1865,19 @@ iceberg_lv2_get_value(iceberg_table *table,
       get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
       iceberg_lv2_block *blocks = table->level2[bindex];
 
-#ifdef ENABLE_RESIZE
-      // check if there's an active resize and block isn't fixed yet
-      if (unlikely(is_lv2_resize_active(table)
-                   && index >= (table->metadata.nblocks >> 1)))
-      {
-         uint64_t mask      = ~(1ULL << (table->metadata.block_bits - 1));
-         uint64_t old_index = index & mask;
-         uint64_t chunk_idx = old_index / 8;
-         uint64_t mindex, moffset;
-         get_index_offset(
-            table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-         if (__atomic_load_n(
-                &table->metadata.lv2_resize_marker[mindex][moffset],
-                __ATOMIC_SEQ_CST)
-             == 0)
-         { // not fixed yet
-            uint64_t old_bindex, old_boffset;
-            get_index_offset(table->metadata.log_init_size,
-                             old_index,
-                             &old_bindex,
-                             &old_boffset);
-            __mmask32 md_mask =
-               slot_mask_32(metadata->lv2_md[old_bindex][old_boffset].block_md,
-                            fprint)
-               & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
-
-            iceberg_lv2_block *blocks = table->level2[old_bindex];
-            while (md_mask != 0) {
-               int slot = __builtin_ctz(md_mask);
-               md_mask  = md_mask & ~(1U << slot);
-
-               if (iceberg_key_compare(table->spl_data_config,
-                                       blocks[old_boffset].slots[slot].key,
-                                       key)
-                   == 0)
-               {
-                  *kv = &blocks[old_boffset].slots[slot];
-                  return true;
-               }
-            }
-         } else {
-            // wait for the old block to be fixed
-            uint64_t dest_chunk_idx = index / 8;
-            get_index_offset(table->metadata.log_init_size - 3,
-                             dest_chunk_idx,
-                             &mindex,
-                             &moffset);
-            while (__atomic_load_n(
-                      &table->metadata.lv2_resize_marker[mindex][moffset],
-                      __ATOMIC_SEQ_CST)
-                   == 0)
-               ;
-         }
-      }
-#endif
 
-      __mmask32 md_mask =
-         slot_mask_32(metadata->lv2_md[bindex][boffset].block_md, fprint)
+      uint32_t md_mask =
+         table->simd->slot_mask_32(metadata->lv2_md[bindex][boffset].block_md,
+                                   fprint)
          & ((1 << (C_LV2 + MAX_LG_LG_N / D_CHOICES)) - 1);
 
       while (md_mask != 0) {
          int slot = __builtin_ctz(md_mask);
          md_mask  = md_mask & ~(1U << slot);
 
-         if (iceberg_key_compare(
-                table->spl_data_config, blocks[boffset].slots[slot].key, key)
-             == 0)
-         {
+         if (kv_pair_key_equal(table, &blocks[boffset].slots[slot], key)) {
             *kv = &blocks[boffset].slots[slot];
-            return true;
+            return TRUE;
          }
       }
    }
@@ -2031,61 +1891,29 @@ iceberg_put_nolock(iceberg_table *table,
                    ValueType      value,
                    threadid       thread_id)
 {
-#ifdef ENABLE_RESIZE
-   if (unlikely(need_resize(table))) {
-      iceberg_setup_resize(table);
-   }
-#endif
-
    iceberg_metadata *metadata = &table->metadata;
    uint8_t           fprint;
    uint64_t          index;
 
    split_hash(lv1_hash(key), &fprint, &index, metadata);
 
-#ifdef ENABLE_RESIZE
-   // move blocks if resize is active and not already moved.
-   if (unlikely(index < (table->metadata.nblocks >> 1)
-                && is_lv1_resize_active(table)))
-   {
-      uint64_t chunk_idx = index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      // if fixing is needed set the marker
-      if (!__sync_lock_test_and_set(
-             &table->metadata.lv1_resize_marker[mindex][moffset], 1))
-      {
-         for (uint8_t i = 0; i < 8; ++i) {
-            uint64_t idx = chunk_idx * 8 + i;
-            /*printf("LV1 Before: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 1));*/
-            iceberg_lv1_move_block(table, idx, thread_id);
-            /*printf("LV1 After: Moving block: %ld load: %f\n", idx,
-             * iceberg_block_load(table, idx, 1));*/
-         }
-         // set the marker for the dest block
-         uint64_t dest_chunk_idx = chunk_idx + table->metadata.nblocks / 8 / 2;
-         uint64_t mindex, moffset;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         __sync_lock_test_and_set(
-            &table->metadata.lv1_resize_marker[mindex][moffset], 1);
-      }
-   }
-#endif
    uint64_t bindex, boffset;
    get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
 
    const uint64_t refcount = 1;
 
+   kv_cell *cell = kv_cell_create(table, key, value, thread_id);
+   key           = slice_create(slice_length(key), cell->key);
+
    bool ret = iceberg_insert_internal(
-      table, key, value, refcount, fprint, bindex, boffset, thread_id);
+      table, key, &cell->val, refcount, fprint, bindex, boffset, thread_id);
    if (!ret)
-      ret = iceberg_lv2_insert(table, key, value, refcount, index, thread_id);
+      ret =
+         iceberg_lv2_insert(table, key, &cell->val, refcount, index, thread_id);
 
+   if (!ret) {
+      kv_cell_destroy(table, &cell->val, key, thread_id);
+   }
    return ret;
 }
 
@@ -2104,99 +1932,21 @@ iceberg_get_value_internal(iceberg_table                   *table,
 
    split_hash(lv1_hash(key), &fprint, &index, metadata);
 
-#ifdef ENABLE_RESIZE
-   // check if there's an active resize and block isn't fixed yet
-   if (unlikely(is_lv1_resize_active(table)
-                && index >= (table->metadata.nblocks >> 1)))
-   {
-      uint64_t mask      = ~(1ULL << (table->metadata.block_bits - 1));
-      uint64_t old_index = index & mask;
-      uint64_t chunk_idx = old_index / 8;
-      uint64_t mindex, moffset;
-      get_index_offset(
-         table->metadata.log_init_size - 3, chunk_idx, &mindex, &moffset);
-      if (__atomic_load_n(&table->metadata.lv1_resize_marker[mindex][moffset],
-                          __ATOMIC_SEQ_CST)
-          == 0)
-      { // not fixed yet
-         uint64_t old_bindex, old_boffset;
-         get_index_offset(table->metadata.log_init_size,
-                          old_index,
-                          &old_bindex,
-                          &old_boffset);
-
-         // if (should_lock) {
-         //    lock_block(
-         //       (uint64_t
-         //       *)&metadata->lv1_md[old_bindex][old_boffset].block_md);
-         // }
-
-         __mmask64 md_mask = slot_mask_64(
-            metadata->lv1_md[old_bindex][old_boffset].block_md, fprint);
-
-         iceberg_lv1_block *blocks = table->level1[old_bindex];
-         while (md_mask != 0) {
-            int slot = __builtin_ctzll(md_mask);
-            md_mask  = md_mask & ~(1ULL << slot);
-
-            if (iceberg_key_compare(table->spl_data_config,
-                                    blocks[old_boffset].slots[slot].key,
-                                    key)
-                == 0)
-            {
-               *kv = &blocks[old_boffset].slots[slot];
-               // printf("tid %d %p %s %s refcount: %d Found in old lv1\n",
-               // thread_id, (void *)table, __func__, key,
-               // blocks[old_boffset].slots[slot].val.refcount);
-
-               // if (should_lock) {
-               //    unlock_block(
-               //       (uint64_t *)&metadata->lv1_md[old_bindex][old_boffset]
-               //          .block_md);
-               // }
-               return true;
-            }
-         }
-
-         // if (should_lock) {
-         //    unlock_block(
-         //       (uint64_t
-         //       *)&metadata->lv1_md[old_bindex][old_boffset].block_md);
-         // }
-      } else {
-         // wait for the old block to be fixed
-         uint64_t dest_chunk_idx = index / 8;
-         get_index_offset(table->metadata.log_init_size - 3,
-                          dest_chunk_idx,
-                          &mindex,
-                          &moffset);
-         while (
-            __atomic_load_n(&table->metadata.lv1_resize_marker[mindex][moffset],
-                            __ATOMIC_SEQ_CST)
-            == 0)
-            ;
-      }
-   }
-#endif
-
    uint64_t bindex, boffset;
    get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
    iceberg_lv1_block *blocks = table->level1[bindex];
 
    if (should_lock) {
-      lock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+      lock_block(&metadata->lv1_md[bindex][boffset]);
    }
-   __mmask64 md_mask =
-      slot_mask_64(metadata->lv1_md[bindex][boffset].block_md, fprint);
+   uint64_t md_mask = table->simd->slot_mask_64(
+      metadata->lv1_md[bindex][boffset].block_md, fprint);
 
    while (md_mask != 0) {
       int slot = __builtin_ctzll(md_mask);
       md_mask  = md_mask & ~(1ULL << slot);
 
-      if (iceberg_key_compare(
-             table->spl_data_config, blocks[boffset].slots[slot].key, key)
-          == 0)
-      {
+      if (kv_pair_key_equal(table, &blocks[boffset].slots[slot], key)) {
          // printf("tid %lu %p %s %s boffset=%lu slot=%d\n", thread_id, (void
          // *)table,
          // __func__, (char *)slice_data(key), boffset, slot);
@@ -2212,10 +1962,9 @@ iceberg_get_value_internal(iceberg_table                   *table,
          // blocks[boffset].slots[slot].val.refcount);
 
          if (should_lock) {
-            unlock_block(
-               (uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+            unlock_block(&metadata->lv1_md[bindex][boffset]);
          }
-         return true;
+         return TRUE;
       }
    }
 
@@ -2232,12 +1981,12 @@ iceberg_get_value_internal(iceberg_table                   *table,
          ValueType value_from_sketch = sketch_get(table->sktch, key);
          iceberg_put_nolock(table, key, value_from_sketch, thread_id);
          ret =
-            iceberg_get_value_internal(table, key, kv, thread_id, false, false);
+            iceberg_get_value_internal(table, key, kv, thread_id, FALSE, FALSE);
       }
    }
 
    if (should_lock) {
-      unlock_block((uint64_t *)&metadata->lv1_md[bindex][boffset].block_md);
+      unlock_block(&metadata->lv1_md[bindex][boffset]);
    }
    return ret;
 }
@@ -2250,223 +1999,25 @@ iceberg_get_value(iceberg_table *table,
 {
    // printf("tid %lu %p %s %s\n", thread_id, (void *)table, __func__, (char
    // *)slice_data(key));
-   kv_pair *kv = NULL;
-   bool     found =
-      iceberg_get_value_internal(table, key, &kv, thread_id, true, true);
-   *value = &kv->val;
-   return found;
-}
-
-#ifdef ENABLE_RESIZE
-static bool
-iceberg_nuke_key(iceberg_table *table,
-                 uint64_t       level,
-                 uint64_t       index,
-                 uint64_t       slot,
-                 threadid       thread_id)
-{
-   uint64_t bindex, boffset;
-   get_index_offset(table->metadata.log_init_size, index, &bindex, &boffset);
-   iceberg_metadata *metadata = &table->metadata;
-
-   if (level == 1) {
-      iceberg_lv1_block *blocks                        = table->level1[bindex];
-      metadata->lv1_md[bindex][boffset].block_md[slot] = 0;
-      blocks[boffset].slots[slot].key                  = NULL_SLICE;
-      blocks[boffset].slots[slot].refcount             = 0;
-      pc_add(&metadata->lv1_balls, -1, thread_id);
-   } else if (level == 2) {
-      iceberg_lv2_block *blocks                        = table->level2[bindex];
-      metadata->lv2_md[bindex][boffset].block_md[slot] = 0;
-      blocks[boffset].slots[slot].key                  = NULL_SLICE;
-      blocks[boffset].slots[slot].refcount             = 0;
-      pc_add(&metadata->lv2_balls, -1, thread_id);
+   iceberg_enter(table, key, thread_id);
+   kv_pair found_kv;
+   bool    found = FALSE;
+   if (is_inline_key(key)) {
+      found = iceberg_get_value_optimistic(table, key, &found_kv, thread_id);
    }
-
-   return true;
-}
-
-static bool
-iceberg_lv1_move_block(iceberg_table *table, uint64_t bnum, threadid thread_id)
-{
-   // printf("tid %d %p %s %lu\n", thread_id, (void *)table, __func__, bnum);
-
-   // grab a block
-   uint64_t bctr =
-      __atomic_fetch_add(&table->metadata.lv1_resize_ctr, 1, __ATOMIC_SEQ_CST);
-   if (bctr >= (table->metadata.nblocks >> 1))
-      return true;
-
-   uint64_t bindex, boffset;
-   get_index_offset(table->metadata.log_init_size, bnum, &bindex, &boffset);
-   // relocate items in level1
-   for (uint64_t j = 0; j < (1 << SLOT_BITS); ++j) {
-      slice key = table->level1[bindex][boffset].slots[j].key;
-      if (slice_is_null(key)) {
-         continue;
-      }
-      ValueType value    = table->level1[bindex][boffset].slots[j].val;
-      uint64_t  refcount = table->level1[bindex][boffset].slots[j].refcount;
-      uint8_t   fprint;
-      uint64_t  index;
-
-      split_hash(lv1_hash(key), &fprint, &index, &table->metadata);
-
-      // move to new location
-      if (index != bnum) {
-         uint64_t local_bindex, local_boffset;
-         get_index_offset(table->metadata.log_init_size,
-                          index,
-                          &local_bindex,
-                          &local_boffset);
-         if (!iceberg_insert_internal(table,
-                                      key,
-                                      value,
-                                      refcount,
-                                      fprint,
-                                      local_bindex,
-                                      local_boffset,
-                                      thread_id))
-         {
-            printf("Failed insert during resize lv1\n");
-            exit(0);
-         }
-         if (!iceberg_nuke_key(table, 1, bnum, j, thread_id)) {
-            printf("Failed remove during resize lv1. key: %s, block: %ld\n",
-                   key,
-                   bnum);
-            exit(0);
-         }
-         // ValueType *val;
-         // if (!iceberg_get_value(table, key, &val, thread_id)) {
-         //  printf("Key not found during resize lv1: %ld\n", key);
-         // exit(0);
-         // }
-      }
-   }
-
-   return false;
-}
-
-static bool
-iceberg_lv2_move_block(iceberg_table *table, uint64_t bnum, threadid thread_id)
-{
-   // printf("tid %d %p %s %lu\n", thread_id, (void *)table, __func__, bnum);
-
-
-   // grab a block
-   uint64_t bctr =
-      __atomic_fetch_add(&table->metadata.lv2_resize_ctr, 1, __ATOMIC_SEQ_CST);
-   if (bctr >= (table->metadata.nblocks >> 1))
-      return true;
-
-   uint64_t bindex, boffset;
-   get_index_offset(table->metadata.log_init_size, bnum, &bindex, &boffset);
-   uint64_t mask = ~(1ULL << (table->metadata.block_bits - 1));
-   // relocate items in level2
-   for (uint64_t j = 0; j < C_LV2 + MAX_LG_LG_N / D_CHOICES; ++j) {
-      slice key = table->level2[bindex][boffset].slots[j].key;
-      if (slice_is_null(key)) {
-         continue;
-      }
-      ValueType value    = table->level2[bindex][boffset].slots[j].val;
-      uint64_t  refcount = table->level2[bindex][boffset].slots[j].refcount;
-      uint8_t   fprint;
-      uint64_t  index;
-
-      split_hash(lv1_hash(key), &fprint, &index, &table->metadata);
-
-      for (int i = 0; i < D_CHOICES; ++i) {
-         uint8_t  l2fprint;
-         uint64_t l2index;
-
-         split_hash(lv2_hash(key, i), &l2fprint, &l2index, &table->metadata);
-
-         // move to new location
-         if ((l2index & mask) == bnum && l2index != bnum) {
-            if (!iceberg_lv2_insert_internal(
-                   table, key, value, refcount, l2fprint, l2index, thread_id))
-            {
-               if (!iceberg_lv2_insert(
-                      table, key, value, refcount, index, thread_id)) {
-                  printf("Failed insert during resize lv2\n");
-                  exit(0);
-               }
-            }
-            if (!iceberg_nuke_key(table, 2, bnum, j, thread_id)) {
-               printf("Failed remove during resize lv2\n");
-               exit(0);
-            }
-            break;
-            // ValueType *val;
-            // if (!iceberg_get_value(table, key, &val, thread_id)) {
-            // printf("Key not found during resize lv2: %ld\n", key);
-            // exit(0);
-            // }
-         }
-      }
-   }
-
-   return false;
-}
-
-static bool
-iceberg_lv3_move_block(iceberg_table *table, uint64_t bnum, threadid thread_id)
-{
-   // printf("tid %d %p %s %lu\n", thread_id, (void *)table, __func__, bnum);
-
-
-   // grab a block
-   uint64_t bctr =
-      __atomic_fetch_add(&table->metadata.lv3_resize_ctr, 1, __ATOMIC_SEQ_CST);
-   if (bctr >= (table->metadata.nblocks >> 1))
-      return true;
-
-   uint64_t bindex, boffset;
-   get_index_offset(table->metadata.log_init_size, bnum, &bindex, &boffset);
-   // relocate items in level3
-   if (unlikely(table->metadata.lv3_sizes[bindex][boffset])) {
-      iceberg_lv3_node *current_node = table->level3[bindex][boffset].head;
-      while (current_node != NULL) {
-         kv_pair current_node_kv = current_node->kv;
-
-         uint8_t  fprint;
-         uint64_t index;
-
-         split_hash(
-            lv1_hash(current_node_kv.key), &fprint, &index, &table->metadata);
-         // move to new location
-         if (index != bnum) {
-            if (!iceberg_lv3_insert(table,
-                                    current_node_kv.key,
-                                    current_node_kv.val,
-                                    current_node_kv.refcount,
-                                    index,
-                                    thread_id))
-            {
-               printf("Failed insert during resize lv3\n");
-               exit(0);
-            }
-            if (!iceberg_lv3_remove(
-                   table, current_node_kv.key, bnum, true, true, thread_id))
-            {
-               printf("Failed remove during resize lv3: %s\n",
-                      current_node_kv.key);
-               exit(0);
-            }
-            // ValueType *val;
-            // if (!iceberg_get_value(table, key, &val, thread_id)) {
-            // printf("Key not found during resize lv3: %ld\n", key);
-            // exit(0);
-            //}
-         }
-         current_node = current_node->next_node;
+   // A miss has to fill the entry from the sketch, under the lock
+   if (!found && (!is_inline_key(key) || table->sktch)) {
+      kv_pair *kv = NULL;
+      found =
+         iceberg_get_value_internal(table, key, &kv, thread_id, TRUE, TRUE);
+      if (found) {
+         found_kv.val = kv->val;
       }
    }
-
-   return false;
+   *value = found ? found_kv.val : NULL;
+   iceberg_exit(table, thread_id);
+   return found;
 }
-#endif
 
 void
 iceberg_print_state(iceberg_table *table)
@@ -2481,4 +2032,26 @@ iceberg_print_state(iceberg_table *table)
    printf("Number level 2 inserts: %ld\n", lv2_balls(table));
    printf("Number level 3 inserts: %ld\n", lv3_balls(table));
    printf("Total inserts: %ld\n", tot_balls(table));
+
+   iceberg_lv3_stats lv3;
+   iceberg_lv3_get_stats(table, &lv3);
+   printf("Level 3 lists: %ld, longest: %ld\n", lv3.lists, lv3.longest_list);
+   printf("Level 3 nodes: %ld, free: %ld\n", lv3.slab_nodes, lv3.free_nodes);
+}
+
+void
+iceberg_lv3_get_stats(iceberg_table *table, iceberg_lv3_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+   for (uint64_t i = 0; i < table->metadata.nblocks; ++i) {
+      uint64_t size = iceberg_block_load(table, i, 3);
+      stats->items += size;
+      stats->lists += size != 0;
+      stats->longest_list = MAX(stats->longest_list, size);
+   }
+   for (uint64_t tid = 0; tid < MAX_THREADS; tid++) {
+      iceberg_lv3_node_cache *cache = &table->lv3_node_caches[tid];
+      stats->slab_nodes += cache->slabs * LV3_SLAB_NODES;
+      stats->free_nodes += cache->count;
+   }
 }
@@ -4,6 +4,7 @@
 #include "lock.h"
 #include "types.h"
 #include "sketch.h"
+#include "iceberg_simd.h"
 #include "platform.h"
 
 #ifdef __cplusplus
@@ -22,8 +23,12 @@ typedef struct __attribute__((__packed__)) iceberg_lv1_block {
    kv_pair slots[1 << SLOT_BITS];
 } iceberg_lv1_block;
 
-typedef struct __attribute__((__packed__)) iceberg_lv1_block_md {
+typedef struct iceberg_lv1_block_md {
    uint8_t block_md[1 << SLOT_BITS];
+   // Odd while a writer holds the block lock, so that lookups can run
+   // without taking it and retry if it changed (see iceberg_get_value)
+   uint64_t version;
+   uint8_t  pad[PLATFORM_CACHELINE_SIZE - sizeof(uint64_t)];
 } iceberg_lv1_block_md;
 
 typedef struct __attribute__((__packed__)) iceberg_lv2_block {
@@ -63,17 +68,32 @@ typedef struct iceberg_metadata {
    uint64_t              nblocks_parts[MAX_RESIZES];
 #ifdef ENABLE_RESIZE
    volatile int lock;
-   uint64_t     resize_cnt;
-   uint64_t     marker_sizes[MAX_RESIZES];
-   uint64_t     lv1_resize_ctr;
-   uint64_t     lv2_resize_ctr;
-   uint64_t     lv3_resize_ctr;
-   uint8_t     *lv1_resize_marker[MAX_RESIZES];
-   uint8_t     *lv2_resize_marker[MAX_RESIZES];
-   uint8_t     *lv3_resize_marker[MAX_RESIZES];
+   // Held shared by every operation, and exclusively to set up a resize
+   ReaderWriterLock resize_rwlock;
+   uint64_t         resize_cnt;
+   // Chunks of the old blocks the current resize has yet to split
+   uint64_t resize_chunks_left;
+   uint64_t marker_sizes[MAX_RESIZES];
+   uint8_t *resize_marker[MAX_RESIZES];
 #endif
 } iceberg_metadata;
 
+// Cells of short keys a thread removed, reused by its next inserts
+typedef struct iceberg_cell_cache {
+   kv_cell *head;
+   uint64_t count;
+   char     pad[PLATFORM_CACHELINE_SIZE - 2 * sizeof(uint64_t)];
+} iceberg_cell_cache;
+
+// Free nodes for the lv3 lists of a thread, carved from the slabs it allocated
+// or left by its removes
+typedef struct iceberg_lv3_node_cache {
+   iceberg_lv3_node *head;
+   uint64_t          count;
+   uint64_t          slabs;
+   char              pad[PLATFORM_CACHELINE_SIZE - 3 * sizeof(uint64_t)];
+} iceberg_lv3_node_cache;
+
 typedef struct iceberg_table {
    iceberg_metadata metadata;
    /* Only things that are persisted on PMEM */
@@ -82,6 +102,12 @@ typedef struct iceberg_table {
    iceberg_lv3_list  *level3[MAX_RESIZES];
    const data_config *spl_data_config;
    sketch            *sktch;
+   // Metadata scans for the instruction sets of this cpu, chosen at init
+   const iceberg_simd_ops *simd;
+   iceberg_lv3_node_cache  lv3_node_caches[MAX_THREADS];
+#if ICEBERG_INLINE_KEY_SIZE
+   iceberg_cell_cache cell_caches[MAX_THREADS];
+#endif
 } iceberg_table;
 
 uint64_t
@@ -93,6 +119,19 @@ lv3_balls(iceberg_table *table);
 uint64_t
 tot_balls(iceberg_table *table);
 
+// How full the lv3 lists are, and the memory their nodes take
+typedef struct iceberg_lv3_stats {
+   uint64_t items;
+   uint64_t lists;        // lists with at least one item
+   uint64_t longest_list; // items in the longest list
+   uint64_t slab_nodes;   // nodes allocated for the lists, used or free
+   uint64_t free_nodes;   // nodes in the caches of the threads
+} iceberg_lv3_stats;
+
+// The counts are approximate while other threads change the table
+void
+iceberg_lv3_get_stats(iceberg_table *table, iceberg_lv3_stats *stats);
+
 int
 iceberg_init(iceberg_table     *table,
              uint64_t           log_slots,
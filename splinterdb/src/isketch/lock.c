@@ -19,10 +19,10 @@ lock(volatile int *var, uint8_t flag)
       while (__sync_lock_test_and_set(var, 1))
          while (var)
             ;
-      return true;
+      return TRUE;
    }
 
-   return false;
+   return FALSE;
 }
 
 void
@@ -57,7 +57,7 @@ bool read_lock(ReaderWriterLock *rwlock, uint8_t flag, uint8_t thread_id) {
     __sync_lock_test_and_set(&rwlock->pc_counter.local_counters[thread_id].counter, 1);
   }
 
-  return true;
+  return TRUE;
 }
 
 void read_unlock(ReaderWriterLock *rwlock, uint8_t thread_id) {
@@ -82,9 +82,9 @@ read_lock(ReaderWriterLock *rwlock, uint8_t flag, uint8_t thread_id)
             &rwlock->pc_counter.local_counters[thread_id].counter,
             -1,
             __ATOMIC_SEQ_CST);
-         return false;
+         return FALSE;
       }
-      return true;
+      return TRUE;
    }
 
    while (rwlock->writer) {
@@ -98,7 +98,7 @@ read_lock(ReaderWriterLock *rwlock, uint8_t flag, uint8_t thread_id)
                          __ATOMIC_SEQ_CST);
    }
 
-   return true;
+   return TRUE;
 }
 
 void
@@ -121,7 +121,7 @@ write_lock(ReaderWriterLock *rwlock, uint8_t flag)
    // acquire write lock.
    if (GET_WAIT_FOR_LOCK(flag) != WAIT_FOR_LOCK) {
       if (__sync_lock_test_and_set(&rwlock->writer, 1))
-         return false;
+         return FALSE;
    } else {
       while (__sync_lock_test_and_set(&rwlock->writer, 1))
          while (rwlock->writer != 0)
@@ -132,7 +132,7 @@ write_lock(ReaderWriterLock *rwlock, uint8_t flag)
       while (rwlock->pc_counter.local_counters[i].counter)
          ;
 
-   return true;
+   return TRUE;
 }
 
 void
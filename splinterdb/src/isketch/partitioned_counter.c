@@ -13,7 +13,6 @@
 
 #include "partitioned_counter.h"
 
-#define min(a, b) ((a) < (b) ? (a) : (b))
 
 int
 pc_init(pc_t    *pc,
@@ -28,8 +27,8 @@ pc_init(pc_t    *pc,
       return PC_ERROR;
    }
 
-   pc->num_counters =
-      num_counters == 0 ? num_cpus : min(num_cpus, num_counters);
+   // Callers index the counters by thread id, not by cpu
+   pc->num_counters = num_counters == 0 ? num_cpus : num_counters;
    pc->local_counters =
       (lctr_t *)calloc(pc->num_counters, sizeof(*pc->local_counters));
 
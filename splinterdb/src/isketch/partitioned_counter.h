@@ -2,7 +2,6 @@
 #define _PARTITIONED_COUNTER_H_
 
 #include <inttypes.h>
-#include <stdbool.h>
 #include "platform.h"
 
 #ifdef __cplusplus
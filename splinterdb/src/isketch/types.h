@@ -11,10 +11,36 @@ extern "C" {
 
 typedef unsigned __int128 ValueType;
 
+/*
+ * The value of a key lives in a cell along with the table's copy of the key,
+ * not in the slot of the key: a resize moves slots between blocks, while
+ * callers keep the pointers to values they got from the table.
+ */
+typedef struct kv_cell {
+   union {
+      ValueType       val;
+      struct kv_cell *next_free; // while in the free list of a thread
+   };
+   char key[];
+} kv_cell;
+
+/*
+ * Keys of up to ICEBERG_INLINE_KEY_SIZE bytes are also copied into their
+ * slot, so probing a block compares them without touching their cells, and
+ * their cells are recycled rather than freed. 0 keeps every key in its cell
+ * only. The default fits the 24-byte keys of YCSB and TPC-C.
+ */
+#ifndef ICEBERG_INLINE_KEY_SIZE
+#   define ICEBERG_INLINE_KEY_SIZE 24
+#endif
+
 typedef struct kv_pair {
-   slice     key;
-   ValueType val;
-   uint64_t  refcount;
+   slice      key; // points into the cell of val
+   ValueType *val;
+   uint64_t   refcount;
+#if ICEBERG_INLINE_KEY_SIZE
+   char inline_key[ICEBERG_INLINE_KEY_SIZE];
+#endif
 } kv_pair;
 
 #ifdef __cplusplus
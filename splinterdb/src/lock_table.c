@@ -1,24 +1,8 @@
 #include "lock_table.h"
-#include "experimental_mode.h"
-
-#define USE_LOCK_TABLE 1
-
-#if EXPERIMENTAL_MODE_TICTOC_DISK
-#   include "transaction_impl/tictoc_disk_internal.h"
-#elif EXPERIMENTAL_MODE_STO_DISK
-#   include "transaction_impl/sto_disk_internal.h"
-#elif EXPERIMENTAL_MODE_SILO_MEMORY
-#   include "transaction_impl/fantasticc_internal.h"
-#else
-#   undef USE_LOCK_TABLE
-#   define USE_LOCK_TABLE 0
-#endif
-
-#if USE_LOCK_TABLE
-#   include "isketch/iceberg_table.h"
-#   include "poison.h"
+#include "isketch/iceberg_table.h"
+#include "poison.h"
 
-#   define LOCK_TABLE_DEBUG 0
+#define LOCK_TABLE_DEBUG 0
 
 typedef struct lock_table {
    iceberg_table table;
@@ -46,70 +30,73 @@ get_tid()
 }
 
 lock_table_rc
-lock_table_try_acquire_entry_lock(lock_table *lock_tbl, rw_entry *entry)
+lock_table_try_acquire_entry_lock(lock_table *lock_tbl,
+                                  slice       key,
+                                  char       *is_locked)
 {
-   if (entry->is_locked) {
-#   if LOCK_TABLE_DEBUG
+   if (*is_locked) {
+#if LOCK_TABLE_DEBUG
       platform_default_log("[Thread %lu] Already acquired lock on key %s\n",
                            get_tid(),
-                           (char *)slice_data(entry->key));
-#   endif
+                           (char *)slice_data(key));
+#endif
       return LOCK_TABLE_RC_DEADLK;
    }
 
    ValueType lock_owner = get_tid();
-   slice     entry_key  = entry->key;
+   slice     entry_key  = key;
    if (iceberg_insert_without_increasing_refcount(
           &lock_tbl->table, &entry_key, lock_owner, get_tid()))
    {
-#   if LOCK_TABLE_DEBUG
+#if LOCK_TABLE_DEBUG
       platform_default_log("[Thread %lu] Acquired lock on key %s(%p)\n",
                            get_tid(),
-                           (char *)slice_data(entry->key),
-                           slice_data(entry->key));
-#   endif
-      entry->is_locked = 1;
+                           (char *)slice_data(key),
+                           slice_data(key));
+#endif
+      *is_locked = 1;
       return LOCK_TABLE_RC_OK;
    }
-#   if LOCK_TABLE_DEBUG
+#if LOCK_TABLE_DEBUG
    platform_default_log("[Thread %lu] Fail to acquire lock on key %s\n",
                         get_tid(),
-                        (char *)slice_data(entry->key));
-#   endif
+                        (char *)slice_data(key));
+#endif
    return LOCK_TABLE_RC_BUSY;
 }
 
 lock_table_rc
 lock_table_try_acquire_entry_lock_timeouts(lock_table *lock_tbl,
-                                           rw_entry   *entry,
+                                           slice       key,
+                                           char       *is_locked,
                                            timestamp   timeout_ns)
 {
-   if (entry->is_locked) {
-#   if LOCK_TABLE_DEBUG
+   if (*is_locked) {
+#if LOCK_TABLE_DEBUG
       platform_default_log("[Thread %lu] Already acquired lock on key %s\n",
                            get_tid(),
-                           (char *)slice_data(entry->key));
-#   endif
+                           (char *)slice_data(key));
+#endif
       return LOCK_TABLE_RC_DEADLK;
    }
 
    if (timeout_ns == 0) {
-      return lock_table_try_acquire_entry_lock(lock_tbl, entry);
+      return lock_table_try_acquire_entry_lock(lock_tbl, key, is_locked);
    }
 
    ValueType lock_owner = get_tid();
    timestamp start_ns   = platform_get_timestamp();
    while (TRUE) {
-      slice entry_key = entry->key;
+      slice entry_key = key;
       if (iceberg_insert_without_increasing_refcount(
              &lock_tbl->table, &entry_key, lock_owner, get_tid()))
       {
-#   if LOCK_TABLE_DEBUG
+#if LOCK_TABLE_DEBUG
          platform_default_log("[Thread %lu] Acquired lock on key %s\n",
                               get_tid(),
-                              (char *)slice_data(entry->key));
-#   endif
-         entry->is_locked = 1;
+                              (char *)slice_data(key));
+#endif
+         *is_locked = 1;
          return LOCK_TABLE_RC_OK;
       }
 
@@ -119,93 +106,54 @@ lock_table_try_acquire_entry_lock_timeouts(lock_table *lock_tbl,
       }
    }
 
-#   if LOCK_TABLE_DEBUG
+#if LOCK_TABLE_DEBUG
    platform_default_log("[Thread %lu] Fail to acquire lock on key %s\n",
                         get_tid(),
-                        (char *)slice_data(entry->key));
-#   endif
+                        (char *)slice_data(key));
+#endif
 
    return LOCK_TABLE_RC_BUSY;
 }
 
 
 lock_table_rc
-lock_table_release_entry_lock(lock_table *lock_tbl, rw_entry *entry)
+lock_table_release_entry_lock(lock_table *lock_tbl,
+                              slice       key,
+                              char       *is_locked)
 {
-   platform_assert(entry->is_locked,
+   platform_assert(*is_locked,
                    "[Thread %lu] Trying to release lock that is not locked by "
                    "this thread (key: %s)",
                    get_tid(),
-                   (char *)slice_data(entry->key));
+                   (char *)slice_data(key));
 
-#   if LOCK_TABLE_DEBUG
+#if LOCK_TABLE_DEBUG
    platform_default_log("[Thread %lu] Release lock on key %s(%p)\n",
                         get_tid(),
-                        (char *)slice_data(entry->key),
-                        slice_data(entry->key));
-#   endif
+                        (char *)slice_data(key),
+                        slice_data(key));
+#endif
 
-   platform_assert(
-      iceberg_force_remove(&lock_tbl->table, entry->key, get_tid()));
-   entry->is_locked = 0;
+   platform_assert(iceberg_force_remove(&lock_tbl->table, key, get_tid()));
+   *is_locked = 0;
 
    return LOCK_TABLE_RC_OK;
 }
 
 lock_table_rc
-lock_table_get_entry_lock_state(lock_table *lock_tbl, rw_entry *entry)
+lock_table_get_entry_lock_state(lock_table *lock_tbl, slice key)
 {
 
-   // #   if LOCK_TABLE_DEBUG
+   // #if LOCK_TABLE_DEBUG
    //    platform_default_log("[Thread %lu] Get a lock state on key %s(%p)\n",
    //                         get_tid(),
-   //                         (char *)slice_data(entry->key),
-   //                         slice_data(entry->key));
-   // #   endif
+   //                         (char *)slice_data(key),
+   //                         slice_data(key));
+   // #endif
 
    ValueType *value = NULL;
-   if (iceberg_get_value(&lock_tbl->table, entry->key, &value, get_tid())) {
+   if (iceberg_get_value(&lock_tbl->table, key, &value, get_tid())) {
       return LOCK_TABLE_RC_BUSY;
    }
    return LOCK_TABLE_RC_OK;
 }
-#else
-lock_table *
-lock_table_create(const data_config *spl_data_config)
-{
-   platform_assert(FALSE, "Not implemented");
-   return NULL;
-}
-void
-lock_table_destroy(lock_table *lock_tbl)
-{
-   platform_assert(FALSE, "Not implemented");
-}
-
-lock_table_rc
-lock_table_try_acquire_entry_lock(lock_table *lock_tbl, rw_entry *entry)
-{
-   platform_assert(FALSE, "Not implemented");
-   return LOCK_TABLE_RC_INVALID;
-}
-lock_table_rc
-lock_table_try_acquire_entry_lock_timeouts(lock_table *lock_tbl,
-                                           rw_entry   *entry,
-                                           timestamp   timeout_ns)
-{
-   platform_assert(FALSE, "Not implemented");
-   return LOCK_TABLE_RC_INVALID;
-}
-lock_table_rc
-lock_table_release_entry_lock(lock_table *lock_tbl, rw_entry *entry)
-{
-   platform_assert(FALSE, "Not implemented");
-   return LOCK_TABLE_RC_INVALID;
-}
-lock_table_rc
-lock_table_get_entry_lock_state(lock_table *lock_tbl, rw_entry *entry)
-{
-   platform_assert(FALSE, "Not implemented");
-   return LOCK_TABLE_RC_INVALID;
-}
-#endif
\ No newline at end of file
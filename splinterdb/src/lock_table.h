@@ -6,10 +6,6 @@
 #include "splinterdb/data.h"
 #include "platform.h"
 
-// FIXME: This lock table assumes rw_entry has 'is_locked' field.
-// Currently, make sure that the rw_entry struct has 'is_locked'.
-typedef struct rw_entry rw_entry;
-
 typedef enum lock_table_rc {
    LOCK_TABLE_RC_INVALID = 0,
    LOCK_TABLE_RC_OK,
@@ -20,6 +16,10 @@ typedef enum lock_table_rc {
 
 /*
  * Lock Table Functions
+ *
+ * The lock table is shared by several protocols, each with its own rw_entry
+ * layout. So, the functions take the key to lock and the flag of the
+ * caller's entry that records whether the caller already holds the lock.
  */
 
 typedef struct lock_table lock_table;
@@ -30,12 +30,17 @@ void
 lock_table_destroy(lock_table *lock_tbl);
 
 lock_table_rc
-lock_table_try_acquire_entry_lock(lock_table *lock_tbl, rw_entry *entry);
+lock_table_try_acquire_entry_lock(lock_table *lock_tbl,
+                                  slice       key,
+                                  char       *is_locked);
 lock_table_rc
 lock_table_try_acquire_entry_lock_timeouts(lock_table *lock_tbl,
-                                           rw_entry   *entry,
+                                           slice       key,
+                                           char       *is_locked,
                                            timestamp   timeout_ns);
 lock_table_rc
-lock_table_release_entry_lock(lock_table *lock_tbl, rw_entry *entry);
+lock_table_release_entry_lock(lock_table *lock_tbl,
+                              slice       key,
+                              char       *is_locked);
 lock_table_rc
-lock_table_get_entry_lock_state(lock_table *lock_tbl, rw_entry *entry);
+lock_table_get_entry_lock_state(lock_table *lock_tbl, slice key);
@@ -1,20 +1,31 @@
 #include "lock_table_rw.h"
-#include "experimental_mode.h"
-#include "poison.h"
 #include "transaction_impl/2pl_internal.h"
+#include "poison.h"
 
 lock_table_rw *
-lock_table_rw_create(const data_config *spl_data_config)
+lock_table_rw_create(const data_config      *spl_data_config,
+                     lock_table_rw_policy    policy,
+                     transaction_contention *contention)
 {
    lock_table_rw *lt;
    lt = TYPED_ZALLOC(0, lt);
    iceberg_init(&lt->table, 20, spl_data_config);
+   lt->policy     = policy;
+   lt->contention = contention;
    return lt;
 }
 
 void
 lock_table_rw_destroy(lock_table_rw *lock_tbl)
 {
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      lock_req_chunk *chunk = lock_tbl->pools[tid].chunks;
+      while (chunk) {
+         lock_req_chunk *next = chunk->next;
+         platform_free(0, chunk);
+         chunk = next;
+      }
+   }
    platform_free(0, lock_tbl);
 }
 
@@ -24,481 +35,542 @@ get_tid()
    return platform_get_tid();
 }
 
-#if EXPERIMENTAL_MODE_2PL_NO_WAIT == 1 || EXPERIMENTAL_MODE_2PL_WAIT_DIE == 1  \
-   || EXPERIMENTAL_MODE_2PL_WOUND_WAIT == 1
-
 static inline lock_req *
-get_lock_req(lock_type lt, transaction *txn)
+get_lock_req(lock_table_rw *lock_tbl, lock_type lt, transaction *txn)
 {
-   lock_req *lreq;
-   lreq       = TYPED_ZALLOC(0, lreq);
-   lreq->next = NULL;
-   lreq->lt   = lt;
-   lreq->txn  = txn;
+   lock_req_pool *pool = &lock_tbl->pools[get_tid()];
+   if (pool->idle == NULL) {
+      lock_req_chunk *chunk;
+      chunk        = TYPED_ZALLOC(0, chunk);
+      chunk->next  = pool->chunks;
+      pool->chunks = chunk;
+      for (uint64 i = 0; i < LOCK_REQ_CHUNK_SIZE; i++) {
+         chunk->reqs[i].next = pool->idle;
+         pool->idle          = &chunk->reqs[i];
+      }
+   }
+
+   lock_req *lreq = pool->idle;
+   pool->idle     = lreq->next;
+   lreq->next     = NULL;
+   lreq->lt       = lt;
+   lreq->waiting  = FALSE;
+   lreq->tid      = get_tid();
+   lreq->txn      = txn;
    return lreq;
 }
-#endif
 
-//*******************************************
-#if EXPERIMENTAL_MODE_2PL_NO_WAIT == 1
-//*******************************************
-// we're not using pthread_rw_lock because it does not
-// support upgrading from shared to exclusive
-lock_entry *
-lock_entry_init()
+static inline void
+put_lock_req(lock_table_rw *lock_tbl, lock_req *lreq)
 {
-   lock_entry *le;
-   le = TYPED_ZALLOC(0, le);
-   platform_mutex_init(&le->latch, 0, 0);
-   return le;
+   lock_req_pool *pool = &lock_tbl->pools[get_tid()];
+   lreq->next          = pool->idle;
+   pool->idle          = lreq;
 }
 
-void
-lock_entry_destroy(lock_entry *le)
+static inline void
+lock_entry_load(lock_entry *le, lock_entry *v)
 {
-   platform_mutex_destroy(&le->latch);
-   platform_free(0, le);
+   __atomic_load(le, v, __ATOMIC_ACQUIRE);
 }
 
-lock_table_rw_rc
-_lock(lock_entry *le, lock_type lt, transaction *txn)
+static inline bool
+lock_entry_compare_and_swap(lock_entry *le, lock_entry *v1, lock_entry *v2)
 {
+   return __atomic_compare_exchange(
+      le, v1, v2, TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
 
-   platform_mutex_lock(&le->latch);
+// The state of le when only the caller, with held, owns it
+static inline uint64
+lock_entry_own_state(lock_held held)
+{
+   return held == LOCK_HELD_READ ? 1 : 0;
+}
 
-   if (le->owners == NULL) {
-      // we need to create a new lock_req and obtain the lock
-      le->owners = get_lock_req(lt, txn);
-      platform_mutex_unlock(&le->latch);
-      return LOCK_TABLE_RW_RC_OK;
+// Whether txn, which holds held, can take lt in state without waiting
+static inline bool
+lock_entry_is_compatible(uint64 state, lock_held held, lock_type lt)
+{
+   if (lt == READ_LOCK) {
+      return !(state & LOCK_ENTRY_WRITER);
    }
+   return state == lock_entry_own_state(held);
+}
 
-   lock_req *iter = le->owners;
+// The lock word once txn took lt in v
+static inline void
+lock_entry_grant(const lock_entry *v, lock_type lt, uint64 ts, lock_entry *v2)
+{
+   if (lt == WRITE_LOCK) {
+      // A reader that upgrades was the only reader
+      v2->state = LOCK_ENTRY_WRITER;
+      v2->ts    = ts;
+   } else {
+      v2->state = v->state + 1;
+      v2->ts    = v->state == 0 ? ts : MIN(v->ts, ts);
+   }
+}
 
-   if (iter->lt == WRITE_LOCK) {
-      platform_assert(iter->next == NULL,
-                      "More than one owners holding an exclusive lock");
-      if (iter->txn->ts != txn->ts) {
-         // another writer holding the lock
-         platform_mutex_unlock(&le->latch);
-         return LOCK_TABLE_RW_RC_BUSY;
-      } else {
-         // we already hold an exclusive lock
-         platform_mutex_unlock(&le->latch);
-         return LOCK_TABLE_RW_RC_OK;
-      }
-   } else if (lt == WRITE_LOCK) {
-      if (iter->txn->ts == txn->ts && iter->next == NULL) {
-         // we can upgrade the shared lock which we are
-         // already exclusively holding
-         iter->lt = WRITE_LOCK;
-         platform_mutex_unlock(&le->latch);
-         return LOCK_TABLE_RW_RC_OK;
+// A waiter yields to the owners a few times, then sleeps, so that it does not
+// take the CPU away from them while they hold the lock for long
+#define LOCK_ENTRY_WAIT_YIELDS   (8)
+#define LOCK_ENTRY_WAIT_SLEEP_NS (USEC_TO_NSEC(50))
+
+/*
+ * Waits for le to change from v, or txn to be wounded, for at most the
+ * backoff of attempt, so that a waiter tries again as soon as the lock is
+ * released.
+ */
+static inline void
+lock_entry_wait(transaction_contention *cm,
+                lock_entry             *le,
+                const lock_entry       *v,
+                const transaction      *txn,
+                uint64                  attempt)
+{
+   uint64     wait_ns = transaction_contention_wait_ns(cm, attempt);
+   timestamp  start   = platform_get_timestamp();
+   lock_entry cur;
+   for (uint64 polls = 0; TRUE; polls++) {
+      if (polls < LOCK_ENTRY_WAIT_YIELDS) {
+         platform_yield();
       } else {
-         // some reader is holding the lock,
-         // but we want exclusive access
-         platform_mutex_unlock(&le->latch);
-         return LOCK_TABLE_RW_RC_BUSY;
+         platform_sleep_ns(LOCK_ENTRY_WAIT_SLEEP_NS);
       }
-   } else if (lt == READ_LOCK) {
-      // we keep owners sorted in ts descending order
-      lock_req *prev = NULL;
-      while (iter && iter->txn->ts > txn->ts) {
-         prev = iter;
-         iter = iter->next;
+      lock_entry_load(le, &cur);
+      if ((cur.state & ~LOCK_ENTRY_LATCH) != (v->state & ~LOCK_ENTRY_LATCH)
+          || cur.ts != v->ts || txn->wounded)
+      {
+         return;
       }
-      if (iter && iter->txn->ts == txn->ts) {
-         // we already hold the lock
-         platform_mutex_unlock(&le->latch);
-         return LOCK_TABLE_RW_RC_OK;
+      if (platform_timestamp_elapsed(start) >= wait_ns) {
+         return;
       }
-      lock_req *lr = get_lock_req(lt, txn);
-      lr->next     = iter;
-      if (prev != NULL)
-         prev->next = lr;
-      else
-         le->owners = lr;
-      platform_mutex_unlock(&le->latch);
-      return LOCK_TABLE_RW_RC_OK;
    }
+}
 
-   // Should not get here
-   platform_assert(false, "Dead code branch");
-   platform_mutex_unlock(&le->latch);
+/*
+ * NO_WAIT: give up as soon as the lock is held in a conflicting mode.
+ */
+static lock_table_rw_rc
+_lock_no_wait(lock_entry *le, lock_held held, lock_type lt, transaction *txn)
+{
+   lock_entry v1, v2;
+   lock_entry_load(le, &v1);
+   do {
+      if (!lock_entry_is_compatible(v1.state, held, lt)) {
+         return LOCK_TABLE_RW_RC_BUSY;
+      }
+      lock_entry_grant(&v1, lt, txn->ts, &v2);
+   } while (!lock_entry_compare_and_swap(le, &v1, &v2));
    return LOCK_TABLE_RW_RC_OK;
 }
 
-lock_table_rw_rc
-_unlock(lock_entry *le, lock_type lt, transaction *txn)
+/*
+ * WAIT_DIE: an older transaction waits for a younger one; a younger
+ * transaction dies instead of waiting for an older one.
+ */
+static lock_table_rw_rc
+_lock_wait_die(transaction_contention *cm,
+               lock_entry             *le,
+               lock_held               held,
+               lock_type               lt,
+               transaction            *txn)
 {
-
-   platform_mutex_lock(&le->latch);
-   lock_req *iter = le->owners;
-   lock_req *prev = NULL;
-
-   while (iter != NULL) {
-      if (iter->txn->ts == txn->ts) {
-         if (iter->lt == lt) {
-            // request is valid, release the lock
-            if (prev != NULL) {
-               prev->next = iter->next;
-            } else {
-               le->owners = iter->next;
-            }
-            platform_free(0, iter);
-            platform_mutex_unlock(&le->latch);
+   uint64     attempt = 0;
+   lock_entry v1, v2;
+   lock_entry_load(le, &v1);
+   while (TRUE) {
+      if (lock_entry_is_compatible(v1.state, held, lt)) {
+         lock_entry_grant(&v1, lt, txn->ts, &v2);
+         if (lock_entry_compare_and_swap(le, &v1, &v2)) {
             return LOCK_TABLE_RW_RC_OK;
-         } else {
-            platform_mutex_unlock(&le->latch);
-            return LOCK_TABLE_RW_RC_INVALID;
          }
+         continue;
       }
-      prev = iter;
-      iter = iter->next;
-   }
 
-   platform_mutex_unlock(&le->latch);
-   return LOCK_TABLE_RW_RC_NODATA;
+      // v1.ts is the writer, or at least as old as the oldest reader, which
+      // may be txn itself
+      if (v1.ts < txn->ts) {
+         return LOCK_TABLE_RW_RC_BUSY;
+      }
+      lock_entry_wait(cm, le, &v1, txn, attempt++);
+      lock_entry_load(le, &v1);
+   }
 }
 
-//*******************************************
-#elif EXPERIMENTAL_MODE_2PL_WAIT_DIE == 1
-//*******************************************
-lock_entry *
-lock_entry_init()
+// Waits until nobody else changes the owners of le, and returns its state in
+// v
+static inline void
+lock_entry_latch(lock_entry *le, lock_entry *v)
 {
-   lock_entry *le;
-   le = TYPED_ZALLOC(0, le);
-   platform_condvar_init(&le->condvar, 0);
-   return le;
+   lock_entry v2;
+   lock_entry_load(le, v);
+   while (TRUE) {
+      if (v->state & LOCK_ENTRY_LATCH) {
+         platform_yield();
+         lock_entry_load(le, v);
+         continue;
+      }
+      v2 = *v;
+      v2.state |= LOCK_ENTRY_LATCH;
+      if (lock_entry_compare_and_swap(le, v, &v2)) {
+         return;
+      }
+   }
 }
 
-void
-lock_entry_destroy(lock_entry *le)
+static inline void
+lock_entry_unlatch(lock_entry *le, lock_entry *v)
 {
-   platform_condvar_destroy(&le->condvar);
-   platform_free(0, le);
+   v->state &= ~LOCK_ENTRY_LATCH;
+   __atomic_store(le, v, __ATOMIC_RELEASE);
 }
 
-lock_table_rw_rc
-_lock(lock_entry *le, lock_type lt, transaction *txn)
+// Links lr into the owners of v, youngest first
+static inline void
+lock_entry_insert_req(lock_entry *v, lock_req *lr)
 {
-   // owners are sorted by ts such that the
-   // oldest owner (with the smallest ts) is the first
-   platform_condvar_lock(&le->condvar);
-   while (true) {
-      if (le->owners == NULL) {
-         // we need to create a new lock_req and obtain the lock
-         le->owners = get_lock_req(lt, txn);
-         platform_condvar_unlock(&le->condvar);
-         return LOCK_TABLE_RW_RC_OK;
-      }
-
-      lock_req *iter = le->owners;
-
-      if (iter->lt == WRITE_LOCK) {
-         platform_assert(iter->next == NULL,
-                         "More than one owners holding an exclusive lock");
-         if (iter->txn->ts != txn->ts) {
-            // another writer holding the lock
-            if (iter->txn->ts < txn->ts) {
-               platform_condvar_unlock(&le->condvar);
-               return LOCK_TABLE_RW_RC_BUSY;
-            }
-         } else {
-            // we already hold an exclusive lock
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         }
-      } else if (lt == WRITE_LOCK) {
-         if (iter->txn->ts == txn->ts && iter->next == NULL) {
-            // we can upgrade the shared lock which we are
-            // already exclusively holding
-            iter->lt = WRITE_LOCK;
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         } else {
-            // some reader is holding the lock,
-            // but we want exclusive access
-            // if all readers are older, we die
-            if (iter->txn->ts < txn->ts) {
-               platform_condvar_unlock(&le->condvar);
-               return LOCK_TABLE_RW_RC_BUSY;
-            }
-         }
-      } else if (lt == READ_LOCK) {
-         // we keep owners sorted in ts ascending order
-         lock_req *prev = NULL;
-         while (iter && iter->txn->ts < txn->ts) {
-            prev = iter;
-            iter = iter->next;
-         }
-         if (iter && iter->txn->ts == txn->ts) {
-            // we already hold the lock
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         }
-         lock_req *lr = get_lock_req(lt, txn);
-         lr->next     = iter;
-         if (prev != NULL)
-            prev->next = lr;
-         else
-            le->owners = lr;
-         platform_condvar_unlock(&le->condvar);
-         return LOCK_TABLE_RW_RC_OK;
-      }
+   lock_req **link = &v->owners;
+   while (*link && (*link)->txn->ts > lr->txn->ts) {
+      link = &(*link)->next;
+   }
+   lr->next = *link;
+   *link    = lr;
+}
 
-      platform_condvar_wait(&le->condvar);
+static inline void
+lock_entry_remove_req(lock_entry *v, lock_req *lr)
+{
+   lock_req **link = &v->owners;
+   while (*link != lr) {
+      link = &(*link)->next;
    }
+   *link = lr->next;
+}
 
-   // Should not get here
-   platform_assert(false, "Dead code branch");
-   platform_condvar_unlock(&le->condvar);
-   return LOCK_TABLE_RW_RC_OK;
+static inline void
+lock_wait_begin(lock_wait *w, const transaction *txn)
+{
+   w->cost = txn->num_rw_entries;
+   w->ts   = txn->ts;
+   __atomic_store_n(&w->wait, w->wait + 1, __ATOMIC_RELEASE);
 }
 
-lock_table_rw_rc
-_unlock(lock_entry *le, lock_type lt, transaction *txn)
+static inline void
+lock_wait_end(lock_wait *w)
 {
+   __atomic_store_n(&w->blockers, 0, __ATOMIC_RELEASE);
+}
 
-   platform_condvar_lock(&le->condvar);
-   lock_req *iter = le->owners;
-   lock_req *prev = NULL;
-
-   while (iter != NULL) {
-      if (iter->txn->ts == txn->ts) {
-         if (iter->lt == lt) {
-            // request is valid, release the lock
-            if (prev != NULL) {
-               prev->next = iter->next;
-            } else {
-               le->owners = iter->next;
-            }
-            platform_free(0, iter);
-            platform_condvar_broadcast(&le->condvar);
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         } else {
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_INVALID;
-         }
+static inline bool
+lock_wait_is_victim(const lock_wait *w)
+{
+   return __atomic_load_n(&w->victim, __ATOMIC_ACQUIRE) == w->wait;
+}
+
+/*
+ * Looks for a path of waits from thread from to thread to, through threads
+ * that are not in visited yet, and appends the threads on it to path.
+ */
+static bool
+lock_wait_find_path(const uint64 *blockers,
+                    threadid      from,
+                    threadid      to,
+                    uint64       *visited,
+                    threadid     *path,
+                    uint64       *path_len)
+{
+   uint64 next = blockers[from];
+   while (next != 0) {
+      threadid t = __builtin_ctzll(next);
+      next &= next - 1;
+      if (t == to) {
+         return TRUE;
       }
-      prev = iter;
-      iter = iter->next;
+      if (*visited & (1ULL << t)) {
+         continue;
+      }
+      *visited |= 1ULL << t;
+      path[(*path_len)++] = t;
+      if (lock_wait_find_path(blockers, t, to, visited, path, path_len)) {
+         return TRUE;
+      }
+      (*path_len)--;
    }
-
-   platform_condvar_unlock(&le->condvar);
-   return LOCK_TABLE_RW_RC_NODATA;
+   return FALSE;
 }
 
-
-#elif EXPERIMENTAL_MODE_2PL_WOUND_WAIT == 1
-lock_entry *
-lock_entry_init()
+/*
+ * Looks for a cycle of waits through thread tid, and picks the wait on it
+ * whose transaction is the cheapest to abort, or the youngest one among
+ * equals, as the victim. The threads publish their waits without stopping,
+ * so a cycle may be gone by the time it is found, which costs an abort
+ * that was not needed. Returns whether the victim is the wait of tid.
+ */
+static bool
+lock_table_rw_break_cycle(lock_table_rw *lock_tbl, threadid tid)
 {
-   lock_entry *le;
-   le = TYPED_ZALLOC(0, le);
-   platform_condvar_init(&le->condvar, 0);
-   return le;
+   uint64 blockers[MAX_THREADS];
+   uint64 waits[MAX_THREADS];
+   for (threadid t = 0; t < MAX_THREADS; t++) {
+      waits[t] = __atomic_load_n(&lock_tbl->waits[t].wait, __ATOMIC_ACQUIRE);
+      blockers[t] =
+         __atomic_load_n(&lock_tbl->waits[t].blockers, __ATOMIC_ACQUIRE);
+   }
+
+   threadid path[MAX_THREADS];
+   uint64   path_len = 1;
+   uint64   visited  = 1ULL << tid;
+   path[0]           = tid;
+   if (!lock_wait_find_path(blockers, tid, tid, &visited, path, &path_len)) {
+      return FALSE;
+   }
+
+   threadid victim = tid;
+   for (uint64 i = 1; i < path_len; i++) {
+      const lock_wait *w        = &lock_tbl->waits[path[i]];
+      const lock_wait *victim_w = &lock_tbl->waits[victim];
+      if (w->cost < victim_w->cost
+          || (w->cost == victim_w->cost && w->ts > victim_w->ts))
+      {
+         victim = path[i];
+      }
+   }
+   __atomic_store_n(
+      &lock_tbl->waits[victim].victim, waits[victim], __ATOMIC_RELEASE);
+   return victim == tid;
 }
 
-void
-lock_entry_destroy(lock_entry *le)
+// Takes lr out of the waiters of le, which the caller latched in v, and gives
+// up on the lock
+static inline void
+lock_entry_give_up(lock_table_rw *lock_tbl,
+                   lock_entry    *le,
+                   lock_entry    *v,
+                   lock_req      *lr)
 {
-   platform_condvar_destroy(&le->condvar);
-   platform_free(0, le);
+   if (lr->waiting) {
+      lock_entry_remove_req(v, lr);
+   }
+   lock_entry_unlatch(le, v);
+   put_lock_req(lock_tbl, lr);
 }
 
-lock_table_rw_rc
-_lock(lock_entry *le, lock_type lt, transaction *txn)
+/*
+ * WOUND_WAIT: an older transaction wounds (aborts) younger owners; a
+ * younger transaction waits for an older one.
+ *
+ * DETECT: every transaction waits, and publishes the threads it waits for.
+ * One that waited LOCK_TABLE_DETECT_ATTEMPTS times looks for a cycle of
+ * waits through its thread, and aborts the cheapest transaction on it.
+ *
+ * Waiters queue among the owners, so that a younger transaction cannot take
+ * the lock from under an older one that waits for it.
+ */
+static lock_table_rw_rc
+_lock_queued(lock_table_rw *lock_tbl,
+             lock_entry    *le,
+             lock_held      held,
+             lock_type      lt,
+             transaction   *txn)
 {
-   platform_condvar_lock(&le->condvar);
-   while (true) {
+   bool       detect  = lock_tbl->policy == LOCK_TABLE_RW_POLICY_DETECT;
+   threadid   tid     = get_tid();
+   lock_wait *w       = &lock_tbl->waits[tid];
+   uint64     attempt = 0;
+   lock_req  *lr      = get_lock_req(lock_tbl, lt, txn);
+   lock_entry v;
+   if (detect) {
+      lock_wait_begin(w, txn);
+   }
+   while (TRUE) {
+      lock_entry_latch(le, &v);
       if (txn->wounded) {
-         platform_condvar_unlock(&le->condvar);
+         lock_entry_give_up(lock_tbl, le, &v, lr);
          return LOCK_TABLE_RW_RC_BUSY;
       }
-
-      if (le->owners == NULL) {
-         // we need to create a new lock_req and obtain the lock
-         le->owners = get_lock_req(lt, txn);
-         platform_condvar_unlock(&le->condvar);
-         return LOCK_TABLE_RW_RC_OK;
+      if (detect && lock_wait_is_victim(w)) {
+         lock_entry_give_up(lock_tbl, le, &v, lr);
+         lock_wait_end(w);
+         return LOCK_TABLE_RW_RC_DEADLK;
       }
 
-      lock_req *iter = le->owners;
-
-      if (iter->lt == WRITE_LOCK) {
-         platform_assert(iter->next == NULL,
-                         "More than one owners holding an exclusive lock");
-         if (iter->txn->ts != txn->ts) {
-            // another writer holding the lock
-            if (iter->txn->ts > txn->ts) {
-               // wound the exclusive owner
-               iter->txn->wounded = true;
+      uint64    blockers = 0;
+      lock_req *upgraded = NULL;
+      for (lock_req *iter = v.owners; iter != NULL; iter = iter->next) {
+         if (iter->txn == txn) {
+            if (iter != lr) {
+               // the read lock txn already holds
+               upgraded = iter;
             }
-         } else {
-            // we already hold an exclusive lock
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         }
-      } else if (lt == WRITE_LOCK) {
-         if (iter->txn->ts == txn->ts && iter->next == NULL) {
-            // we can upgrade the shared lock which we are
-            // already exclusively holding
-            iter->lt = WRITE_LOCK;
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         } else {
-            // wound all younger readers (i.e., with ts > txn->ts)
-            while (iter && iter->txn->ts > txn->ts) {
-               // lazy wound; txn aborts on the next lock attempt
-               iter->txn->wounded = true;
-               iter               = iter->next;
+         } else if (lt == WRITE_LOCK || iter->lt == WRITE_LOCK) {
+            if (!iter->waiting) {
+               blockers |= 1ULL << iter->tid;
+               if (!detect && iter->txn->ts > txn->ts) {
+                  // lazy wound; txn aborts on the next lock attempt
+                  iter->txn->wounded = TRUE;
+               }
+            } else if (iter->txn->ts < txn->ts) {
+               // queue behind an older waiter
+               blockers |= 1ULL << iter->tid;
             }
          }
-      } else if (lt == READ_LOCK) {
-         // we keep owners sorted in ts descending order
-         lock_req *prev = NULL;
-         while (iter && iter->txn->ts > txn->ts) {
-            prev = iter;
-            iter = iter->next;
+      }
+
+      if (blockers == 0) {
+         if (upgraded != NULL) {
+            lock_entry_remove_req(&v, upgraded);
          }
-         if (iter && iter->txn->ts == txn->ts) {
-            // we already hold the lock
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
+         if (!lr->waiting) {
+            lock_entry_insert_req(&v, lr);
+         }
+         lr->waiting = FALSE;
+         v.state     = lt == WRITE_LOCK ? LOCK_ENTRY_WRITER : v.state + 1;
+         lock_entry_unlatch(le, &v);
+         if (upgraded != NULL) {
+            put_lock_req(lock_tbl, upgraded);
+         }
+         if (detect) {
+            lock_wait_end(w);
          }
-         lock_req *lr = get_lock_req(lt, txn);
-         lr->next     = iter;
-         if (prev != NULL)
-            prev->next = lr;
-         else
-            le->owners = lr;
-         platform_condvar_unlock(&le->condvar);
          return LOCK_TABLE_RW_RC_OK;
       }
-      platform_condvar_timedwait(&le->condvar, WOUND_WAIT_TIMEOUT);
-   }
 
-   // Should not get here
-   platform_assert(false, "Dead code branch");
-   platform_condvar_unlock(&le->condvar);
-   return LOCK_TABLE_RW_RC_OK;
-}
+      if (detect && (blockers & (1ULL << tid))) {
+         // Another transaction of this thread owns the lock, and this one
+         // would wait for it forever
+         lock_entry_give_up(lock_tbl, le, &v, lr);
+         lock_wait_end(w);
+         return LOCK_TABLE_RW_RC_DEADLK;
+      }
 
-lock_table_rw_rc
-_unlock(lock_entry *le, lock_type lt, transaction *txn)
-{
-   platform_condvar_lock(&le->condvar);
-   lock_req *iter = le->owners;
-   lock_req *prev = NULL;
-
-   while (iter != NULL) {
-      if (iter->txn->ts == txn->ts) {
-         if (iter->lt == lt) {
-            // request is valid, release the lock
-            if (prev != NULL) {
-               prev->next = iter->next;
-            } else {
-               le->owners = iter->next;
-            }
-            platform_free(0, iter);
-            platform_condvar_broadcast(&le->condvar);
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_OK;
-         } else {
-            platform_condvar_unlock(&le->condvar);
-            return LOCK_TABLE_RW_RC_INVALID;
+      if (!lr->waiting) {
+         lr->waiting = TRUE;
+         lock_entry_insert_req(&v, lr);
+      }
+      lock_entry_unlatch(le, &v);
+
+      if (detect) {
+         __atomic_store_n(&w->blockers, blockers, __ATOMIC_RELEASE);
+         if (attempt >= LOCK_TABLE_DETECT_ATTEMPTS
+             && lock_table_rw_break_cycle(lock_tbl, tid))
+         {
+            attempt++;
+            continue;
          }
       }
-      prev = iter;
-      iter = iter->next;
-   }
 
-   platform_condvar_unlock(&le->condvar);
-   return LOCK_TABLE_RW_RC_NODATA;
+      // Wake up now and then to notice being wounded, or chosen as a victim
+      lock_entry_wait(lock_tbl->contention, le, &v, txn, attempt++);
+   }
 }
-#else
 
-lock_entry *
-lock_entry_init()
+static void
+_unlock_queued(lock_table_rw *lock_tbl, lock_entry *le, transaction *txn)
 {
-   platform_assert(FALSE, "Not implemented");
-   return NULL;
+   lock_entry v;
+   lock_entry_latch(le, &v);
+   lock_req *iter = v.owners;
+   while (iter && iter->txn != txn) {
+      iter = iter->next;
+   }
+   platform_assert(iter != NULL && !iter->waiting,
+                   "Releasing a lock that is not held");
+   lock_entry_remove_req(&v, iter);
+   v.state = iter->lt == WRITE_LOCK ? 0 : v.state - 1;
+   lock_entry_unlatch(le, &v);
+   put_lock_req(lock_tbl, iter);
 }
 
-void
-lock_entry_destroy(lock_entry *le)
+// Releasing a lock is a single swap, except under WOUND_WAIT and DETECT
+static void
+_unlock(lock_table_rw *lock_tbl,
+        lock_entry    *le,
+        lock_held      held,
+        transaction   *txn)
 {
-   platform_assert(FALSE, "Not implemented");
-}
+   if (lock_tbl->policy == LOCK_TABLE_RW_POLICY_WOUND_WAIT
+       || lock_tbl->policy == LOCK_TABLE_RW_POLICY_DETECT)
+   {
+      _unlock_queued(lock_tbl, le, txn);
+      return;
+   }
 
-lock_table_rw_rc
-_lock(lock_entry *le, lock_type lt, transaction *txn)
-{
-   platform_assert(FALSE, "Not implemented");
-   return 0;
+   lock_entry v1, v2;
+   lock_entry_load(le, &v1);
+   do {
+      v2.state = held == LOCK_HELD_WRITE ? 0 : v1.state - 1;
+      v2.ts    = v2.state == 0 ? 0 : v1.ts;
+   } while (!lock_entry_compare_and_swap(le, &v1, &v2));
 }
 
-lock_table_rw_rc
-_unlock(lock_entry *le, lock_type lt, transaction *txn)
+static lock_table_rw_rc
+_lock(lock_table_rw *lock_tbl,
+      lock_entry    *le,
+      lock_held      held,
+      lock_type      lt,
+      transaction   *txn)
 {
-   platform_assert(FALSE, "Not implemented");
-   return 0;
+   switch (lock_tbl->policy) {
+      case LOCK_TABLE_RW_POLICY_NO_WAIT:
+         return _lock_no_wait(le, held, lt, txn);
+      case LOCK_TABLE_RW_POLICY_WAIT_DIE:
+         return _lock_wait_die(lock_tbl->contention, le, held, lt, txn);
+      case LOCK_TABLE_RW_POLICY_WOUND_WAIT:
+      case LOCK_TABLE_RW_POLICY_DETECT:
+         return _lock_queued(lock_tbl, le, held, lt, txn);
+      default:
+         platform_assert(FALSE, "Unknown locking policy %d", lock_tbl->policy);
+         return LOCK_TABLE_RW_RC_INVALID;
+   }
 }
 
-#endif
-
 lock_table_rw_rc
 lock_table_rw_try_acquire_entry_lock(lock_table_rw *lock_tbl,
                                      rw_entry      *entry,
                                      lock_type      lt,
                                      transaction   *txn)
 {
-   if (entry->le) {
-      // we already have a pointer to the lock status
-      return _lock(entry->le, lt, txn);
+   if (entry->held == LOCK_HELD_WRITE
+       || (entry->held == LOCK_HELD_READ && lt == READ_LOCK))
+   {
+      // we already hold the lock
+      return LOCK_TABLE_RW_RC_OK;
    }
 
-   // else we either get a pointer to an existing lock status
-   // or create a new one
-   entry->le = lock_entry_init();
-
-   ValueType  value_to_be_inserted     = (ValueType)entry->le;
-   ValueType *pointer_of_iceberg_value = &value_to_be_inserted;
-   bool       is_newly_inserted =
-      iceberg_insert_and_get(&lock_tbl->table,
-                             &entry->key,
-                             (ValueType **)&pointer_of_iceberg_value,
-                             get_tid());
-   if (!is_newly_inserted) {
-      // there's already a lock_entry for this key in the lock_table
-      lock_entry_destroy(entry->le);
-      entry->le = (lock_entry *)*pointer_of_iceberg_value;
+   if (!entry->le) {
+      // we either get the lock_entry of the key in the lock_table, or insert
+      // an unused one
+      lock_entry  unused = {0};
+      ValueType  *value  = (ValueType *)&unused;
+      iceberg_insert_and_get(&lock_tbl->table, &entry->key, &value, get_tid());
+      entry->le = (lock_entry *)value;
    }
 
-   // get the latch then update the lock status
-   return _lock(entry->le, lt, txn);
+   lock_table_rw_rc rc = _lock(lock_tbl, entry->le, entry->held, lt, txn);
+   if (rc == LOCK_TABLE_RW_RC_OK) {
+      entry->held = lt == WRITE_LOCK ? LOCK_HELD_WRITE : LOCK_HELD_READ;
+   }
+   return rc;
 }
 
 lock_table_rw_rc
 lock_table_rw_release_entry_lock(lock_table_rw *lock_tbl,
                                  rw_entry      *entry,
-                                 lock_type      lt,
                                  transaction   *txn)
 {
    platform_assert(entry->le != NULL,
                    "Trying to release a lock using NULL lock entry");
 
-   if (_unlock(entry->le, lt, txn) == LOCK_TABLE_RW_RC_OK) {
-      // platform_assert(iceberg_force_remove(&lock_tbl->table, key,
-      // get_tid()));
-      if (iceberg_remove(&lock_tbl->table, entry->key, get_tid())) {
-         lock_entry_destroy(entry->le);
-         entry->le = NULL;
-      }
+   if (entry->held != LOCK_HELD_NONE) {
+      _unlock(lock_tbl, entry->le, entry->held, txn);
+      entry->held = LOCK_HELD_NONE;
    }
+   // The last entry that refers to the lock_entry removes it
+   iceberg_remove(&lock_tbl->table, entry->key, get_tid());
+   entry->le = NULL;
 
 #if LOCK_TABLE_DEBUG
    platform_default_log("[Thread %d] Release lock on key %s\n",
@@ -507,4 +579,4 @@ lock_table_rw_release_entry_lock(lock_table_rw *lock_tbl,
 #endif
 
    return LOCK_TABLE_RW_RC_OK;
-}
\ No newline at end of file
+}
@@ -6,49 +6,122 @@
 #include "platform.h"
 #include "isketch/iceberg_table.h"
 #include "splinterdb/transaction.h"
-#include "experimental_mode.h"
+#include "transaction_contention.h"
 
 /*
- * Implements a lock table that uses READ/WRITE locks and 3 locking policies:
- * NO_WAIT, WAIT-DIE, and WOUND-WAIT
+ * Implements a lock table that uses READ/WRITE locks and 4 locking policies:
+ * NO_WAIT, WAIT-DIE, and WOUND-WAIT, which prevent deadlocks by aborting
+ * transactions that might take part in one, and DETECT, which lets them wait
+ * and only aborts one transaction of each cycle of waits that forms.
+ *
+ * The lock of a key is a lock_entry that lives in the value of the key in
+ * the iceberg table, for as long as some rw_entry refers to it. A lock is
+ * taken and released with compare-and-swaps on the lock_entry. Transactions
+ * that wait for a lock retry once it changes, or after the wait of the
+ * contention manager.
  */
 
-#define LOCK_TABLE_DEBUG   0
-#define WOUND_WAIT_TIMEOUT 10
+#define LOCK_TABLE_DEBUG 0
 
-// The lock table is just a hash map
-typedef struct lock_table_rw {
-   iceberg_table table;
-} lock_table_rw;
+typedef enum lock_table_rw_policy {
+   LOCK_TABLE_RW_POLICY_NO_WAIT = 0,
+   LOCK_TABLE_RW_POLICY_WAIT_DIE,
+   LOCK_TABLE_RW_POLICY_WOUND_WAIT,
+   LOCK_TABLE_RW_POLICY_DETECT
+} lock_table_rw_policy;
 
 typedef enum lock_type {
    READ_LOCK = 0, // shared lock
    WRITE_LOCK     // exclusive lock
 } lock_type;
 
+// The lock an rw_entry holds on its key
+typedef enum lock_held {
+   LOCK_HELD_NONE = 0,
+   LOCK_HELD_READ,
+   LOCK_HELD_WRITE
+} lock_held;
+
+// An owner of a lock under WOUND_WAIT or DETECT, which other transactions may
+// wound or wait for, or a transaction waiting for it, which younger ones
+// queue behind
 typedef struct lock_req {
    lock_type        lt;
+   bool             waiting;
+   threadid         tid;  // that runs txn
    transaction     *txn;  // access to transaction ts as well
    struct lock_req *next; // to form a linked list
 } lock_req;
 
-// Each lock_entry in this lock table contains some certain state required to
-// implement the chosen locking policy
+#define LOCK_REQ_CHUNK_SIZE (64)
+
+typedef struct lock_req_chunk {
+   struct lock_req_chunk *next;
+   lock_req               reqs[LOCK_REQ_CHUNK_SIZE];
+} lock_req_chunk;
+
+// The lock_reqs of the transactions of a thread, which only that thread
+// takes and gives back
+typedef struct lock_req_pool {
+   lock_req       *idle;
+   lock_req_chunk *chunks;
+} PLATFORM_CACHELINE_ALIGNED lock_req_pool;
+
+/*
+ * What the transaction of a thread waits for, under DETECT. The waits-for
+ * graph is between threads rather than transactions: a thread that waits
+ * for a lock runs none of its other transactions until it gets it.
+ */
+typedef struct lock_wait {
+   uint64 blockers; // the threads it waits for, as a bitmap; 0 if none
+   uint64 wait;     // counts the waits of the thread, to tell them apart
+   uint64 cost;     // of aborting its transaction: the keys it accessed
+   uint64 ts;       // of its transaction
+   uint64 victim;   // the wait to abort, to break a cycle
+} PLATFORM_CACHELINE_ALIGNED lock_wait;
+
+_Static_assert(MAX_THREADS <= 64, "lock_wait.blockers is a 64-bit bitmap");
+
+// Times a transaction waits for a lock before it looks for a cycle of waits
+// through its thread, under DETECT. It looks again every time after that.
+#define LOCK_TABLE_DETECT_ATTEMPTS (4)
+
+// The lock table is just a hash map
+typedef struct lock_table_rw {
+   iceberg_table           table;
+   lock_table_rw_policy    policy;
+   transaction_contention *contention; // how long waiters wait
+   lock_req_pool           pools[MAX_THREADS];
+   lock_wait               waits[MAX_THREADS]; // DETECT only
+} lock_table_rw;
+
+// In lock_entry.state
+#define LOCK_ENTRY_WRITER  (1ULL << 63)
+#define LOCK_ENTRY_LATCH   (1ULL << 62) // WOUND_WAIT and DETECT only
+#define LOCK_ENTRY_READERS (LOCK_ENTRY_LATCH - 1)
+
+// The lock word of a key. Every field changes in a single compare-and-swap.
+// An unused lock is all zeroes.
 typedef struct lock_entry {
-#if EXPERIMENTAL_MODE_2PL_NO_WAIT == 1
-   platform_mutex latch;
-#endif
-   lock_req *owners;
-#if EXPERIMENTAL_MODE_2PL_WOUND_WAIT == 1 || EXPERIMENTAL_MODE_2PL_WAIT_DIE == 1
-   platform_condvar condvar;
-#endif
-} lock_entry;
+   // LOCK_ENTRY_WRITER, or the number of readers
+   uint64 state;
+   union {
+      // NO_WAIT and WAIT_DIE: the ts of the writer, or of the oldest reader
+      // since there were none. Readers that leave do not move it, so it may
+      // be older than the oldest reader.
+      uint64 ts;
+      // WOUND_WAIT and DETECT: the owners and the waiters, youngest first.
+      // Changed under LOCK_ENTRY_LATCH.
+      lock_req *owners;
+   };
+} __attribute__((aligned(sizeof(ValueType)))) lock_entry;
+
+_Static_assert(sizeof(lock_entry) == sizeof(ValueType),
+               "A lock_entry must fit in the value of the iceberg table");
 
 // FIXME: This lock table assumes rw_entry,
 // which is defined in the transactional layer (2pl_internal.h),
-// has 'is_locked' field.
-// Currently, make sure that the rw_entry struct has 'is_locked'
-// and a pointer to a lock_state stucture.
+// has the 'key', 'le' and 'held' fields.
 typedef struct rw_entry rw_entry;
 
 typedef enum lock_table_rw_rc {
@@ -63,21 +136,29 @@ typedef enum lock_table_rw_rc {
  * Lock Table Functions
  */
 lock_table_rw *
-lock_table_rw_create(const data_config *spl_data_config);
+lock_table_rw_create(const data_config      *spl_data_config,
+                     lock_table_rw_policy    policy,
+                     transaction_contention *contention);
 void
 lock_table_rw_destroy(lock_table_rw *lock_tbl);
 
 // Assumption: transaction contains a TS field
+//
+// Returns LOCK_TABLE_RW_RC_BUSY if the policy gave up on the lock, and
+// LOCK_TABLE_RW_RC_DEADLK if txn was chosen to break a cycle of waits.
 lock_table_rw_rc
 lock_table_rw_try_acquire_entry_lock(lock_table_rw *lock_tbl,
                                      rw_entry      *entry,
                                      lock_type      lt,
                                      transaction   *txn);
 
+/*
+ * Releases the lock entry holds, if any, and forgets its lock_entry. Call it
+ * for every entry whose le was set by a try_acquire, even one that failed.
+ */
 lock_table_rw_rc
 lock_table_rw_release_entry_lock(lock_table_rw *lock_tbl,
                                  rw_entry      *entry,
-                                 lock_type      lt,
                                  transaction   *txn);
 
 // lock_table_rw_rc
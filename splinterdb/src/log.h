@@ -22,16 +22,28 @@ typedef int (*log_write_fn)(log_handle *log,
                             key         tuple_key,
                             message     data,
                             uint64      generation);
+typedef int (*log_write_batch_fn)(log_handle    *log,
+                                  uint64         num_tuples,
+                                  const key     *tuple_keys,
+                                  const message *msgs,
+                                  const uint64  *generations);
 typedef void (*log_release_fn)(log_handle *log);
 typedef uint64 (*log_addr_fn)(log_handle *log);
 typedef uint64 (*log_magic_fn)(log_handle *log);
+typedef uint64 (*log_lsn_fn)(log_handle *log);
+typedef bool (*log_sync_fn)(log_handle *log, uint64 lsn, bool wait);
+typedef uint64 (*log_num_syncs_fn)(log_handle *log);
 
 typedef struct log_ops {
-   log_write_fn   write;
-   log_release_fn release;
-   log_addr_fn    addr;
-   log_addr_fn    meta_addr;
-   log_magic_fn   magic;
+   log_write_fn       write;
+   log_write_batch_fn write_batch; // Optional
+   log_release_fn     release;
+   log_addr_fn        addr;
+   log_addr_fn        meta_addr;
+   log_magic_fn       magic;
+   log_lsn_fn         lsn;
+   log_sync_fn        sync;
+   log_num_syncs_fn   num_syncs;
 } log_ops;
 
 // to sub-class log, make a log_handle your first field
@@ -45,6 +57,59 @@ log_write(log_handle *log, key tuple_key, message data, uint64 generation)
    return log->ops->write(log, tuple_key, data, generation);
 }
 
+/*
+ * Logs the num_tuples tuples (tuple_keys[i], msgs[i]) at generations[i], one
+ * after the other. Logs without a write_batch op write them one by one.
+ */
+static inline int
+log_write_batch(log_handle    *log,
+                uint64         num_tuples,
+                const key     *tuple_keys,
+                const message *msgs,
+                const uint64  *generations)
+{
+   if (log->ops->write_batch) {
+      return log->ops->write_batch(
+         log, num_tuples, tuple_keys, msgs, generations);
+   }
+   for (uint64 i = 0; i < num_tuples; i++) {
+      int rc = log_write(log, tuple_keys[i], msgs[i], generations[i]);
+      if (rc != 0) {
+         return rc;
+      }
+   }
+   return 0;
+}
+
+/*
+ * Returns the log sequence number of the last write (or batch of writes)
+ * logged so far. Every write gets a larger one than the writes logged before
+ * it.
+ */
+static inline uint64
+log_lsn(log_handle *log)
+{
+   return log->ops->lsn(log);
+}
+
+/*
+ * Returns TRUE if every write logged up to lsn is on disk. If wait is set,
+ * it makes sure they are first; otherwise it only writes them out if the
+ * log decides that enough writes are waiting for it.
+ */
+static inline bool
+log_sync(log_handle *log, uint64 lsn, bool wait)
+{
+   return log->ops->sync(log, lsn, wait);
+}
+
+// Returns how many times the log has been written out for log_sync()
+static inline uint64
+log_num_syncs(log_handle *log)
+{
+   return log->ops->num_syncs(log);
+}
+
 static inline void
 log_release(log_handle *log)
 {
@@ -6,6 +6,8 @@
 #include "platform.h"
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
 
 __thread threadid xxxtid = INVALID_TID;
 
@@ -271,6 +273,21 @@ platform_strtok_r(char *str, const char *delim, platform_strtok_ctx *ctx)
    return strtok_r(str, delim, &ctx->token_str);
 }
 
+bool
+platform_heavy_barrier_init(void)
+{
+   return syscall(
+             __NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0)
+          == 0;
+}
+
+void
+platform_heavy_barrier(void)
+{
+   int rc = syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+   platform_assert(rc == 0);
+}
+
 void
 platform_sort_slow(void               *base,
                    size_t              nmemb,
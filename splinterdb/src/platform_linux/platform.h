@@ -670,6 +670,18 @@ platform_thread_id_self();
 char *
 platform_strtok_r(char *str, const char *delim, platform_strtok_ctx *ctx);
 
+/*
+ * Asymmetric barrier: platform_heavy_barrier() runs a full memory barrier on
+ * every running thread of the process, so that the threads it races with
+ * rarely can do with a compiler barrier. Returns FALSE if the system cannot,
+ * else platform_heavy_barrier() may be called from then on.
+ */
+bool
+platform_heavy_barrier_init(void);
+
+void
+platform_heavy_barrier(void);
+
 
 /*
  * Section 5:
@@ -23,18 +23,34 @@ static uint64 shard_log_magic_idx = 0;
 
 int
 shard_log_write(log_handle *log, key tuple_key, message msg, uint64 generation);
+int
+shard_log_write_batch(log_handle    *log,
+                      uint64         num_tuples,
+                      const key     *tuple_keys,
+                      const message *msgs,
+                      const uint64  *generations);
 uint64
 shard_log_addr(log_handle *log);
 uint64
 shard_log_meta_addr(log_handle *log);
 uint64
 shard_log_magic(log_handle *log);
+uint64
+shard_log_lsn(log_handle *log);
+bool
+shard_log_sync(log_handle *log, uint64 lsn, bool wait);
+uint64
+shard_log_num_syncs(log_handle *log);
 
 static log_ops shard_log_ops = {
-   .write     = shard_log_write,
-   .addr      = shard_log_addr,
-   .meta_addr = shard_log_meta_addr,
-   .magic     = shard_log_magic,
+   .write       = shard_log_write,
+   .write_batch = shard_log_write_batch,
+   .addr        = shard_log_addr,
+   .meta_addr   = shard_log_meta_addr,
+   .magic       = shard_log_magic,
+   .lsn         = shard_log_lsn,
+   .sync        = shard_log_sync,
+   .num_syncs   = shard_log_num_syncs,
 };
 
 void
@@ -76,6 +92,81 @@ shard_log_get_thread_data(shard_log *log, threadid thr_id)
    return &log->thread_data[thr_id];
 }
 
+static inline void
+shard_log_lock_thread_data(shard_log_thread_data *thread_data)
+{
+   uint64 wait = 1;
+   while (__sync_lock_test_and_set(&thread_data->lock, 1)) {
+      platform_sleep_ns(wait);
+      wait = wait > 1024 ? wait : 2 * wait;
+   }
+}
+
+static inline void
+shard_log_unlock_thread_data(shard_log_thread_data *thread_data)
+{
+   __sync_lock_release(&thread_data->lock);
+}
+
+/*
+ * Claims and write-locks a page of the log. Locking waits for a write of the
+ * page still in flight.
+ */
+static page_handle *
+shard_log_get_page(shard_log *log, uint64 addr)
+{
+   cache       *cc   = log->cc;
+   page_handle *page = cache_get(cc, addr, TRUE, PAGE_TYPE_LOG);
+   uint64       wait = 1;
+   while (!cache_try_claim(cc, page)) {
+      platform_sleep_ns(wait);
+      wait = wait > 1024 ? wait : 2 * wait;
+   }
+   cache_lock(cc, page);
+   return page;
+}
+
+static inline void
+shard_log_put_page(shard_log *log, page_handle *page)
+{
+   cache_unlock(log->cc, page);
+   cache_unclaim(log->cc, page);
+   cache_unget(log->cc, page);
+}
+
+// Waits for the write of a full page, started when the page filled up
+static void
+shard_log_wait_for_page(shard_log *log, uint64 addr)
+{
+   shard_log_put_page(log, shard_log_get_page(log, addr));
+}
+
+/*
+ * Starts writing out a page a thread has filled and remembers it, so that
+ * the next sync waits for it. When too many are in flight, the oldest is
+ * waited for first; by then its write has usually completed.
+ */
+static void
+shard_log_write_full_page(shard_log             *log,
+                          shard_log_thread_data *thread_data,
+                          page_handle           *page)
+{
+   cache *cc = log->cc;
+   if (thread_data->num_full_pages == SHARD_LOG_MAX_FULL_PAGES) {
+      shard_log_wait_for_page(log, thread_data->full_pages[0]);
+      memmove(&thread_data->full_pages[0],
+              &thread_data->full_pages[1],
+              (SHARD_LOG_MAX_FULL_PAGES - 1) * sizeof(uint64));
+      thread_data->num_full_pages--;
+   }
+   thread_data->full_pages[thread_data->num_full_pages++] = page->disk_addr;
+
+   cache_unlock(cc, page);
+   cache_unclaim(cc, page);
+   cache_page_sync(cc, page, FALSE, PAGE_TYPE_LOG);
+   cache_unget(cc, page);
+}
+
 page_handle *
 shard_log_alloc(shard_log *log, uint64 *next_extent)
 {
@@ -129,6 +220,7 @@ shard_log_zap(shard_log *log)
       shard_log_thread_data *thread_data = shard_log_get_thread_data(log, i);
       thread_data->addr                  = SHARD_UNMAPPED;
       thread_data->offset                = 0;
+      thread_data->num_full_pages        = 0;
    }
 
    mini_unkeyed_dec_ref(cc, log->meta_head, PAGE_TYPE_LOG, FALSE);
@@ -212,68 +304,194 @@ get_new_page_for_thread(shard_log             *log,
 int
 shard_log_write(log_handle *logh, key tuple_key, message msg, uint64 generation)
 {
-   debug_assert(key_is_user_key(tuple_key));
+   return shard_log_write_batch(logh, 1, &tuple_key, &msg, &generation);
+}
 
+/*
+ * Appends the entries of a batch to the page of this thread, claiming it
+ * once, and moves on to new pages as they fill up.
+ */
+int
+shard_log_write_batch(log_handle    *logh,
+                      uint64         num_tuples,
+                      const key     *tuple_keys,
+                      const message *msgs,
+                      const uint64  *generations)
+{
    shard_log             *log = (shard_log *)logh;
    cache                 *cc  = log->cc;
    shard_log_thread_data *thread_data =
       shard_log_get_thread_data(log, platform_get_tid());
 
+   shard_log_lock_thread_data(thread_data);
    page_handle *page;
    if (thread_data->addr == SHARD_UNMAPPED) {
       if (get_new_page_for_thread(log, thread_data, &page)) {
+         shard_log_unlock_thread_data(thread_data);
          return -1;
       }
    } else {
-      page        = cache_get(cc, thread_data->addr, TRUE, PAGE_TYPE_LOG);
-      uint64 wait = 1;
-      while (!cache_try_claim(cc, page)) {
-         platform_sleep_ns(wait);
-         wait = wait > 1024 ? wait : 2 * wait;
-      }
-      cache_lock(cc, page);
+      page = shard_log_get_page(log, thread_data->addr);
    }
 
-   shard_log_hdr *hdr    = (shard_log_hdr *)page->data;
-   log_entry     *cursor = (log_entry *)(page->data + thread_data->offset);
-   uint64         new_entry_size = log_entry_required_capacity(tuple_key, msg);
-   uint64 free_space = shard_log_page_size(log->cfg) - thread_data->offset;
-   debug_assert(new_entry_size
-                <= shard_log_page_size(log->cfg) - sizeof(shard_log_hdr));
-
-   if (free_space < new_entry_size) {
-      if (sizeof(log_entry) <= free_space) {
-         cursor->generation = INVALID_GENERATION;
-      }
-      hdr->checksum = shard_log_checksum(log->cfg, page);
+   shard_log_hdr *hdr = (shard_log_hdr *)page->data;
+   for (uint64 i = 0; i < num_tuples; i++) {
+      debug_assert(key_is_user_key(tuple_keys[i]));
+
+      log_entry *cursor = (log_entry *)(page->data + thread_data->offset);
+      uint64     new_entry_size =
+         log_entry_required_capacity(tuple_keys[i], msgs[i]);
+      uint64 free_space = shard_log_page_size(log->cfg) - thread_data->offset;
+      debug_assert(new_entry_size
+                   <= shard_log_page_size(log->cfg) - sizeof(shard_log_hdr));
+
+      if (free_space < new_entry_size) {
+         if (sizeof(log_entry) <= free_space) {
+            cursor->generation = INVALID_GENERATION;
+         }
+         hdr->checksum = shard_log_checksum(log->cfg, page);
 
-      cache_unlock(cc, page);
-      cache_unclaim(cc, page);
-      cache_page_sync(cc, page, FALSE, PAGE_TYPE_LOG);
-      cache_unget(cc, page);
+         // Full pages are written out in the background, so that a sync
+         // only has to wait for them and write the pages still being filled.
+         shard_log_write_full_page(log, thread_data, page);
 
-      if (get_new_page_for_thread(log, thread_data, &page)) {
-         return -1;
+         if (get_new_page_for_thread(log, thread_data, &page)) {
+            shard_log_unlock_thread_data(thread_data);
+            return -1;
+         }
+         cursor = (log_entry *)(page->data + thread_data->offset);
+         hdr    = (shard_log_hdr *)page->data;
       }
-      cursor = (log_entry *)(page->data + thread_data->offset);
-      hdr    = (shard_log_hdr *)page->data;
-   }
 
-   cursor->generation = generation;
-   copy_tuple_to_ondisk_tuple(&cursor->tuple, tuple_key, msg);
+      cursor->generation = generations[i];
+      copy_tuple_to_ondisk_tuple(&cursor->tuple, tuple_keys[i], msgs[i]);
 
-   hdr->num_entries++;
+      hdr->num_entries++;
 
-   thread_data->offset += new_entry_size;
-   debug_assert(thread_data->offset <= shard_log_page_size(log->cfg));
+      thread_data->offset += new_entry_size;
+      debug_assert(thread_data->offset <= shard_log_page_size(log->cfg));
+   }
+   thread_data->lsn = __sync_add_and_fetch(&log->lsn.v, 1);
 
    cache_unlock(cc, page);
    cache_unclaim(cc, page);
    cache_unget(cc, page);
+   shard_log_unlock_thread_data(thread_data);
 
    return 0;
 }
 
+/*
+ * Waits for the full pages of every thread and writes out the page each is
+ * filling, so that every write logged before the call is on disk once it
+ * returns.
+ */
+static void
+shard_log_sync_pages(shard_log *log)
+{
+   cache *cc     = log->cc;
+   uint64 target = __atomic_load_n(&log->lsn.v, __ATOMIC_ACQUIRE);
+
+   for (threadid thr_i = 0; thr_i < MAX_THREADS; thr_i++) {
+      shard_log_thread_data *thread_data =
+         shard_log_get_thread_data(log, thr_i);
+      if (thread_data->addr == SHARD_UNMAPPED) {
+         continue;
+      }
+
+      shard_log_lock_thread_data(thread_data);
+      for (uint64 i = 0; i < thread_data->num_full_pages; i++) {
+         shard_log_wait_for_page(log, thread_data->full_pages[i]);
+      }
+      thread_data->num_full_pages = 0;
+      if (thread_data->lsn != thread_data->synced_lsn) {
+         page_handle   *page   = shard_log_get_page(log, thread_data->addr);
+         shard_log_hdr *hdr    = (shard_log_hdr *)page->data;
+         uint64         offset = thread_data->offset;
+         log_entry     *cursor = (log_entry *)(page->data + offset);
+         if (sizeof(log_entry) <= shard_log_page_size(log->cfg) - offset) {
+            cursor->generation = INVALID_GENERATION;
+         }
+         hdr->checksum = shard_log_checksum(log->cfg, page);
+
+         cache_unlock(cc, page);
+         cache_unclaim(cc, page);
+         cache_page_sync(cc, page, TRUE, PAGE_TYPE_LOG);
+         cache_unget(cc, page);
+         thread_data->synced_lsn = thread_data->lsn;
+      }
+      shard_log_unlock_thread_data(thread_data);
+   }
+
+   if (log->durable_lsn.v < target) {
+      __atomic_store_n(&log->durable_lsn.v, target, __ATOMIC_RELEASE);
+   }
+   __sync_fetch_and_add(&log->num_syncs, 1);
+}
+
+static inline bool
+shard_log_is_durable(shard_log *log, uint64 lsn)
+{
+   return lsn <= __atomic_load_n(&log->durable_lsn.v, __ATOMIC_ACQUIRE);
+}
+
+uint64
+shard_log_lsn(log_handle *logh)
+{
+   shard_log *log = (shard_log *)logh;
+   return __atomic_load_n(&log->lsn.v, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Group commit: the first caller to find a sync due writes out the pages of
+ * every thread, which makes the writes of all the callers waiting on it
+ * durable at once. A sync is due once sync_batch writes are waiting for it,
+ * or once sync_delay_ns have passed since a sync was first asked for.
+ *
+ * A caller that finds no request pending, and no sync running that might
+ * cover its write, makes the request with its own timestamp.
+ */
+bool
+shard_log_sync(log_handle *logh, uint64 lsn, bool wait)
+{
+   shard_log *log = (shard_log *)logh;
+
+   uint64 backoff = 1;
+   while (!shard_log_is_durable(log, lsn)) {
+      timestamp requested = log->sync_requested;
+      if (requested == 0 && !log->syncing) {
+         timestamp now = platform_get_timestamp();
+         requested     = __sync_val_compare_and_swap(
+            &log->sync_requested, 0, now);
+         requested = requested == 0 ? now : requested;
+      }
+      uint64 pending = log->lsn.v - log->durable_lsn.v;
+      bool   due     = pending >= log->cfg->sync_batch
+                 || (requested != 0
+                     && platform_timestamp_elapsed(requested)
+                           >= log->cfg->sync_delay_ns);
+      if (due && __sync_bool_compare_and_swap(&log->syncing, 0, 1)) {
+         log->sync_requested = 0;
+         shard_log_sync_pages(log);
+         __sync_lock_release(&log->syncing);
+         continue;
+      }
+      if (!wait) {
+         return FALSE;
+      }
+      platform_sleep_ns(backoff);
+      backoff = backoff > 1024 ? backoff : 2 * backoff;
+   }
+   return TRUE;
+}
+
+uint64
+shard_log_num_syncs(log_handle *logh)
+{
+   shard_log *log = (shard_log *)logh;
+   return __atomic_load_n(&log->num_syncs, __ATOMIC_ACQUIRE);
+}
+
 uint64
 shard_log_addr(log_handle *logh)
 {
@@ -358,9 +576,11 @@ shard_log_iterator_init(cache              *cc,
       for (i = 0; i < pages_per_extent; i++) {
          page_addr = extent_addr + i * shard_log_page_size(cfg);
          page      = cache_get(cc, page_addr, TRUE, PAGE_TYPE_LOG);
+         // Pages are handed out to threads in order, but written out as
+         // each thread fills or syncs its own, so skip those not written yet
          if (!shard_log_valid(cfg, page, magic)) {
             cache_unget(cc, page);
-            goto finished_first_pass;
+            continue;
          }
          num_valid_pages++;
          itor->num_entries += ((shard_log_hdr *)page->data)->num_entries;
@@ -370,8 +590,6 @@ shard_log_iterator_init(cache              *cc,
       extent_addr = next_extent_addr;
    }
 
-finished_first_pass:
-
    itor->contents = TYPED_ARRAY_MALLOC(
       hid, itor->contents, num_valid_pages * shard_log_page_size(cfg));
    itor->entries = TYPED_ARRAY_MALLOC(hid, itor->entries, itor->num_entries);
@@ -388,7 +606,7 @@ finished_first_pass:
          page      = cache_get(cc, page_addr, TRUE, PAGE_TYPE_LOG);
          if (!shard_log_valid(cfg, page, magic)) {
             cache_unget(cc, page);
-            goto finished_second_pass;
+            continue;
          }
          for (log_entry *le = first_log_entry(page->data);
               !terminal_log_entry(cfg, page->data, le);
@@ -409,7 +627,6 @@ finished_first_pass:
 
    // sort by generation
    log_entry *tmp;
-finished_second_pass:
    platform_sort_slow(itor->entries,
                       itor->num_entries,
                       sizeof(log_entry *),
@@ -465,9 +682,11 @@ shard_log_config_init(shard_log_config *log_cfg,
                       data_config      *data_cfg)
 {
    ZERO_CONTENTS(log_cfg);
-   log_cfg->cache_cfg = cache_cfg;
-   log_cfg->data_cfg  = data_cfg;
-   log_cfg->seed      = HASH_SEED;
+   log_cfg->cache_cfg     = cache_cfg;
+   log_cfg->data_cfg      = data_cfg;
+   log_cfg->seed          = HASH_SEED;
+   log_cfg->sync_delay_ns = 0;
+   log_cfg->sync_batch    = 1;
 }
 
 void
@@ -23,11 +23,29 @@ typedef struct shard_log_config {
    data_config  *data_cfg;
    uint64        seed;
    // data config of point message tree
+
+   // Group commit: a sync writes out the pages of every thread at once. It
+   // waits up to sync_delay_ns for more writes to join it, unless sync_batch
+   // writes are already waiting.
+   uint64 sync_delay_ns;
+   uint64 sync_batch;
 } shard_log_config;
 
+// Full pages a thread tracks until a sync; past that, it waits for the oldest
+#define SHARD_LOG_MAX_FULL_PAGES 16
+
 typedef struct shard_log_thread_data {
    uint64 addr;
    uint64 offset;
+   // Held while the thread appends to its page, or while a sync writes it out
+   volatile uint64 lock;
+   // The last write on the page, and the last one written out
+   uint64 lsn;
+   uint64 synced_lsn;
+   // Pages the thread filled since the last sync, whose writes may be in
+   // flight
+   uint64 full_pages[SHARD_LOG_MAX_FULL_PAGES];
+   uint64 num_full_pages;
 } PLATFORM_CACHELINE_ALIGNED shard_log_thread_data;
 
 /*
@@ -42,6 +60,15 @@ typedef struct shard_log {
    uint64                addr;
    uint64                meta_head;
    uint64                magic;
+
+   // The last log sequence number handed out, and the last one on disk
+   cache_aligned_uint64 lsn;
+   cache_aligned_uint64 durable_lsn;
+   // Set while a thread syncs the log for everyone
+   volatile uint64 syncing;
+   // When the oldest unanswered sync request was made, 0 if there is none
+   volatile timestamp sync_requested;
+   uint64             num_syncs;
 } shard_log;
 
 typedef struct log_entry log_entry;
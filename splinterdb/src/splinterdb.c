@@ -24,6 +24,13 @@
 #include "poison.h"
 
 const char *BUILD_VERSION = "splinterdb_build_version " GIT_VERSION;
+
+// Write batches up to this size are converted on the stack
+#define SPLINTERDB_WRITE_BATCH_STACK_WRITES 64
+
+// Lookups that splinterdb_prefetch() keeps in flight at once
+#define SPLINTERDB_PREFETCH_INFLIGHT 16
+
 const char *
 splinterdb_get_version()
 {
@@ -189,6 +196,10 @@ splinterdb_init_config(const splinterdb_config *kvs_cfg, // IN
                           cfg.use_stats);
 
    shard_log_config_init(&kvs->log_cfg, &kvs->cache_cfg.super, kvs->data_cfg);
+   kvs->log_cfg.sync_delay_ns = cfg.log_sync_delay_ns;
+   if (cfg.log_sync_batch) {
+      kvs->log_cfg.sync_batch = cfg.log_sync_batch;
+   }
 
    uint64 num_bg_threads[NUM_TASK_TYPES] = {0};
    num_bg_threads[TASK_TYPE_MEMTABLE]    = kvs_cfg->num_memtable_bg_threads;
@@ -495,6 +506,116 @@ splinterdb_update(const splinterdb *kvsb, slice user_key, slice update)
    return splinterdb_insert_message(kvsb, user_key, msg);
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * splinterdb_write_batch --
+ *
+ *      Insert the keys and messages of a batch into splinter, in order
+ *
+ * Results:
+ *      0 on success, otherwise an errno
+ *
+ * Side effects:
+ *      Allocates memory for large batches
+ *-----------------------------------------------------------------------------
+ */
+int
+splinterdb_write_batch(const splinterdb       *kvs,        // IN
+                       uint64                  num_writes, // IN
+                       const splinterdb_write *writes      // IN
+)
+{
+   platform_assert(kvs != NULL);
+   if (num_writes == 0) {
+      return 0;
+   }
+
+   key     stack_keys[SPLINTERDB_WRITE_BATCH_STACK_WRITES];
+   message stack_msgs[SPLINTERDB_WRITE_BATCH_STACK_WRITES];
+   key     *tuple_keys = stack_keys;
+   message *msgs       = stack_msgs;
+   if (num_writes > SPLINTERDB_WRITE_BATCH_STACK_WRITES) {
+      tuple_keys = TYPED_ARRAY_MALLOC(kvs->heap_id, tuple_keys, num_writes);
+      msgs       = TYPED_ARRAY_MALLOC(kvs->heap_id, msgs, num_writes);
+      if (tuple_keys == NULL || msgs == NULL) {
+         platform_free(kvs->heap_id, tuple_keys);
+         platform_free(kvs->heap_id, msgs);
+         return ENOMEM;
+      }
+   }
+
+   platform_status status = STATUS_OK;
+   for (uint64 i = 0; i < num_writes; i++) {
+      tuple_keys[i] = key_create_from_slice(writes[i].key);
+      switch (writes[i].type) {
+         case MESSAGE_TYPE_INSERT:
+         case MESSAGE_TYPE_UPDATE:
+            msgs[i] = message_create(writes[i].type, writes[i].value);
+            break;
+         case MESSAGE_TYPE_DELETE:
+            msgs[i] = DELETE_MESSAGE;
+            break;
+         default:
+            status = STATUS_BAD_PARAM;
+            break;
+      }
+   }
+   if (SUCCESS(status)) {
+      status = trunk_insert_batch(kvs->spl, num_writes, tuple_keys, msgs);
+   }
+
+   if (tuple_keys != stack_keys) {
+      platform_free(kvs->heap_id, tuple_keys);
+      platform_free(kvs->heap_id, msgs);
+   }
+   return platform_status_to_int(status);
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * splinterdb_log_lsn, splinterdb_log_is_durable, splinterdb_log_sync,
+ * splinterdb_log_num_syncs --
+ *
+ *      Group commit of the log, see shard_log_sync()
+ *-----------------------------------------------------------------------------
+ */
+uint64
+splinterdb_log_lsn(const splinterdb *kvs)
+{
+   if (!kvs->spl->cfg.use_log) {
+      return 0;
+   }
+   return log_lsn(kvs->spl->log);
+}
+
+bool
+splinterdb_log_is_durable(const splinterdb *kvs, uint64 lsn)
+{
+   if (!kvs->spl->cfg.use_log) {
+      return FALSE;
+   }
+   return log_sync(kvs->spl->log, lsn, FALSE);
+}
+
+int
+splinterdb_log_sync(const splinterdb *kvs, uint64 lsn)
+{
+   if (!kvs->spl->cfg.use_log) {
+      return EINVAL;
+   }
+   log_sync(kvs->spl->log, lsn, TRUE);
+   return 0;
+}
+
+uint64
+splinterdb_log_num_syncs(const splinterdb *kvs)
+{
+   if (!kvs->spl->cfg.use_log) {
+      return 0;
+   }
+   return log_num_syncs(kvs->spl->log);
+}
+
 void
 splinterdb_lookup_result_init(const splinterdb         *kvs,        // IN
                               splinterdb_lookup_result *result,     // IN/OUT
@@ -574,6 +695,101 @@ splinterdb_lookup(const splinterdb         *kvs, // IN
 }
 
 
+// An async lookup of splinterdb_prefetch()
+typedef struct splinterdb_prefetch_ctxt {
+   trunk_async_ctxt  ctxt;
+   merge_accumulator data;
+   key               target;
+   bool              busy;  // target is being looked up
+   bool              ready; // the lookup can go on, set by IO completions
+} splinterdb_prefetch_ctxt;
+
+static void
+splinterdb_prefetch_cb(trunk_async_ctxt *ctxt)
+{
+   splinterdb_prefetch_ctxt *pctxt =
+      container_of(ctxt, splinterdb_prefetch_ctxt, ctxt);
+   __atomic_store_n(&pctxt->ready, TRUE, __ATOMIC_RELEASE);
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * splinterdb_prefetch --
+ *
+ *      Looks up keys with up to SPLINTERDB_PREFETCH_INFLIGHT async lookups in
+ *      flight at once, so that their disk reads overlap, and throws the
+ *      values away.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The pages that lookups of keys read are in the cache, unless they
+ *      were evicted again already.
+ *-----------------------------------------------------------------------------
+ */
+void
+splinterdb_prefetch(const splinterdb *kvs,      // IN
+                    uint64            num_keys, // IN
+                    const slice      *keys      // IN
+)
+{
+   platform_assert(kvs != NULL);
+   splinterdb_prefetch_ctxt pctxts[SPLINTERDB_PREFETCH_INFLIGHT];
+   uint64                   num_pctxts = MIN(num_keys, ARRAY_SIZE(pctxts));
+   for (uint64 i = 0; i < num_pctxts; i++) {
+      merge_accumulator_init(&pctxts[i].data, kvs->spl->heap_id);
+      pctxts[i].busy = FALSE;
+   }
+
+   uint64 next     = 0;
+   uint64 inflight = 0;
+   while (next < num_keys || inflight > 0) {
+      for (uint64 i = 0; i < num_pctxts; i++) {
+         splinterdb_prefetch_ctxt *pctxt = &pctxts[i];
+         if (!pctxt->busy) {
+            if (next == num_keys) {
+               continue;
+            }
+            trunk_async_ctxt_init(&pctxt->ctxt, splinterdb_prefetch_cb);
+            pctxt->target = key_create_from_slice(keys[next++]);
+            pctxt->busy   = TRUE;
+            pctxt->ready  = TRUE;
+            inflight++;
+         }
+         if (!__atomic_load_n(&pctxt->ready, __ATOMIC_ACQUIRE)) {
+            continue;
+         }
+
+         pctxt->ready = FALSE;
+         cache_async_result res = trunk_lookup_async(
+            kvs->spl, pctxt->target, &pctxt->data, &pctxt->ctxt);
+         switch (res) {
+            case async_success:
+               pctxt->busy = FALSE;
+               inflight--;
+               break;
+            case async_locked:
+            case async_no_reqs:
+               pctxt->ready = TRUE;
+               break;
+            case async_io_started:
+               break;
+            default:
+               platform_assert(0, "Unexpected async lookup result %d", res);
+         }
+      }
+      if (inflight > 0) {
+         // Polls for the completions of the reads in flight
+         cache_cleanup(kvs->spl->cc);
+      }
+   }
+
+   for (uint64 i = 0; i < num_pctxts; i++) {
+      merge_accumulator_deinit(&pctxts[i].data);
+   }
+}
+
 struct splinterdb_iterator {
    trunk_range_iterator sri;
    platform_status      last_rc;
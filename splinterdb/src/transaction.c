@@ -1,32 +1,825 @@
-#include "experimental_mode.h"
-
-#if EXPERIMENTAL_MODE_TICTOC_DISK
-#   include "transaction_impl/transaction_tictoc_disk.h"
-#elif EXPERIMENTAL_MODE_TICTOC_MEMORY
-#   include "transaction_impl/transaction_tictoc_memory.h"
-#elif EXPERIMENTAL_MODE_TICTOC_COUNTER
-#   include "transaction_impl/transaction_tictoc_sketch.h"
-#elif EXPERIMENTAL_MODE_TICTOC_SKETCH
-#   include "transaction_impl/transaction_tictoc_sketch.h"
-#elif EXPERIMENTAL_MODE_STO_DISK
-#   include "transaction_impl/transaction_sto_disk.h"
-#elif EXPERIMENTAL_MODE_STO_MEMORY
-#   include "transaction_impl/transaction_sto_memory.h"
-#elif EXPERIMENTAL_MODE_STO_COUNTER
-#   include "transaction_impl/transaction_sto.h"
-#elif EXPERIMENTAL_MODE_STO_SKETCH
-#   include "transaction_impl/transaction_sto.h"
-#elif EXPERIMENTAL_MODE_2PL_NO_WAIT || EXPERIMENTAL_MODE_2PL_WAIT_DIE          \
-   || EXPERIMENTAL_MODE_2PL_WOUND_WAIT
-#   include "transaction_impl/transaction_2pl.h"
-#elif EXPERIMENTAL_MODE_SILO_MEMORY
-#   include "transaction_impl/transaction_tictoc_lock_silo.h"
-#else
-#   error "Unknown experimental mode"
-#endif
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction.c --
+ *
+ *     Chooses the concurrency control protocol of a transactional splinterdb
+ *     and dispatches the public API to it.
+ */
+
+#include "transaction_internal.h"
+#include "poison.h"
+
+typedef int (*transactional_splinterdb_create_or_open_fn)(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing);
+
+typedef struct transaction_protocol_entry {
+   const char                                *name;
+   transactional_splinterdb_create_or_open_fn create_or_open;
+   // Defaults filled in by transactional_splinterdb_config_init()
+   uint64                      tscache_log_slots;
+   uint64                      sketch_rows;
+   uint64                      sketch_cols;
+   transaction_isolation_level isol_level; // SERIALIZABLE if left out
+} transaction_protocol_entry;
+
+static const transaction_protocol_entry
+   transaction_protocols[TRANSACTION_PROTOCOL_MAX_VALID] = {
+      [TRANSACTION_PROTOCOL_TICTOC_DISK]    = {"tictoc-disk",
+                                               tictoc_disk_create_or_open},
+      [TRANSACTION_PROTOCOL_TICTOC_MEMORY]  = {"tictoc-memory",
+                                               tictoc_memory_create_or_open,
+                                               16},
+      [TRANSACTION_PROTOCOL_TICTOC_COUNTER] = {"tictoc-counter",
+                                               tictoc_sketch_create_or_open,
+                                               16,
+                                               2,
+                                               1},
+      [TRANSACTION_PROTOCOL_TICTOC_SKETCH]  = {"tictoc-sketch",
+                                               tictoc_sketch_create_or_open,
+                                               16,
+                                               2,
+                                               131072},
+      [TRANSACTION_PROTOCOL_STO_DISK]       = {"sto-disk",
+                                               sto_disk_create_or_open},
+      [TRANSACTION_PROTOCOL_STO_MEMORY]     = {"sto-memory",
+                                               sto_memory_create_or_open,
+                                               16},
+      [TRANSACTION_PROTOCOL_STO_COUNTER]    = {"sto-counter",
+                                               sto_sketch_create_or_open,
+                                               16,
+                                               1,
+                                               1},
+      [TRANSACTION_PROTOCOL_STO_SKETCH]     = {"sto-sketch",
+                                               sto_sketch_create_or_open,
+                                               16,
+                                               2,
+                                               131072},
+      [TRANSACTION_PROTOCOL_2PL_NO_WAIT]    = {"2pl-no-wait",
+                                               two_phase_locking_create_or_open},
+      [TRANSACTION_PROTOCOL_2PL_WAIT_DIE]   = {"2pl-wait-die",
+                                               two_phase_locking_create_or_open},
+      [TRANSACTION_PROTOCOL_2PL_WOUND_WAIT] = {"2pl-wound-wait",
+                                               two_phase_locking_create_or_open},
+      [TRANSACTION_PROTOCOL_2PL_DETECT]     = {"2pl-detect",
+                                               two_phase_locking_create_or_open},
+      [TRANSACTION_PROTOCOL_SILO_MEMORY]    = {"silo-memory",
+                                               silo_create_or_open,
+                                               16},
+      [TRANSACTION_PROTOCOL_MVCC]           = {"mvcc",
+                                               mvcc_create_or_open,
+                                               0,
+                                               0,
+                                               0,
+                                               TRANSACTION_ISOLATION_LEVEL_SNAPSHOT},
+};
+
+static inline bool
+transaction_protocol_is_valid(transaction_protocol protocol)
+{
+   return TRANSACTION_PROTOCOL_INVALID < protocol
+          && protocol < TRANSACTION_PROTOCOL_MAX_VALID;
+}
+
+const char *
+transaction_protocol_name(transaction_protocol protocol)
+{
+   if (!transaction_protocol_is_valid(protocol)) {
+      return "invalid";
+   }
+   return transaction_protocols[protocol].name;
+}
+
+transaction_protocol
+transaction_protocol_from_name(const char *name)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      if (strcmp(name, transaction_protocols[p].name) == 0) {
+         return p;
+      }
+   }
+   return TRANSACTION_PROTOCOL_INVALID;
+}
+
+// These protocols store the timestamps of begin as txn_disk_timestamp
+static inline bool
+transaction_protocol_has_small_timestamps(transaction_protocol protocol)
+{
+   return protocol == TRANSACTION_PROTOCOL_STO_DISK;
+}
+
+void
+transactional_splinterdb_config_init(
+   transactional_splinterdb_config *txn_kvsb_cfg,
+   const splinterdb_config         *kvsb_cfg,
+   transaction_protocol             protocol)
+{
+   platform_assert(transaction_protocol_is_valid(protocol));
+
+   ZERO_CONTENTS(txn_kvsb_cfg);
+   // TODO things like filename, logfile, or data_cfg would need a
+   // deep-copy
+   memcpy(&txn_kvsb_cfg->kvsb_cfg, kvsb_cfg, sizeof(txn_kvsb_cfg->kvsb_cfg));
+   txn_kvsb_cfg->protocol = protocol;
+
+   const transaction_protocol_entry *entry = &transaction_protocols[protocol];
+   txn_kvsb_cfg->isol_level                = entry->isol_level;
+   if (txn_kvsb_cfg->isol_level == TRANSACTION_ISOLATION_LEVEL_INVALID) {
+      txn_kvsb_cfg->isol_level = TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE;
+   }
+   txn_kvsb_cfg->tscache_log_slots = entry->tscache_log_slots;
+   txn_kvsb_cfg->sketch_rows       = entry->sketch_rows;
+   txn_kvsb_cfg->sketch_cols       = entry->sketch_cols;
+
+   txn_kvsb_cfg->contention_policy      = TRANSACTION_CONTENTION_DEFAULT;
+   txn_kvsb_cfg->contention_min_wait_ns = TRANSACTION_CONTENTION_MIN_WAIT_NS;
+   txn_kvsb_cfg->contention_max_wait_ns = TRANSACTION_CONTENTION_MAX_WAIT_NS;
+   txn_kvsb_cfg->read_wait_policy       = TRANSACTION_READ_WAIT_DEFAULT;
+   txn_kvsb_cfg->read_wait_spins        = TRANSACTION_READ_WAIT_SPINS;
+
+   txn_kvsb_cfg->timestamp_source =
+      transaction_protocol_has_small_timestamps(protocol)
+         ? TRANSACTION_TIMESTAMP_BATCHED
+         : TRANSACTION_TIMESTAMP_DEFAULT;
+
+   txn_kvsb_cfg->hot_key_sample_interval = TRANSACTION_HOT_KEY_SAMPLE_INTERVAL;
+}
+
+static int
+transactional_splinterdb_create_or_open(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing)
+{
+   // Only mvcc keeps the old versions that snapshots read
+   bool snapshot =
+      txn_kvsb_cfg->isol_level == TRANSACTION_ISOLATION_LEVEL_SNAPSHOT;
+   transaction_protocol protocol = txn_kvsb_cfg->protocol;
+   if (protocol == TRANSACTION_PROTOCOL_INVALID) {
+      protocol =
+         snapshot ? TRANSACTION_PROTOCOL_MVCC : TRANSACTION_PROTOCOL_DEFAULT;
+   }
+   if (!transaction_protocol_is_valid(protocol)) {
+      platform_error_log("Invalid transaction protocol: %d\n", protocol);
+      return EINVAL;
+   }
+   if (snapshot && protocol != TRANSACTION_PROTOCOL_MVCC) {
+      platform_error_log("%s does not provide snapshot isolation\n",
+                         transaction_protocol_name(protocol));
+      return EINVAL;
+   }
+
+   // Fill in the defaults for any field the caller left zeroed
+   transactional_splinterdb_config cfg;
+   transactional_splinterdb_config_init(&cfg, &txn_kvsb_cfg->kvsb_cfg, protocol);
+   if (txn_kvsb_cfg->isol_level != TRANSACTION_ISOLATION_LEVEL_INVALID) {
+      cfg.isol_level = txn_kvsb_cfg->isol_level;
+   }
+   if (txn_kvsb_cfg->tscache_log_slots) {
+      cfg.tscache_log_slots = txn_kvsb_cfg->tscache_log_slots;
+   }
+   if (txn_kvsb_cfg->sketch_rows) {
+      cfg.sketch_rows = txn_kvsb_cfg->sketch_rows;
+   }
+   if (txn_kvsb_cfg->sketch_cols) {
+      cfg.sketch_cols = txn_kvsb_cfg->sketch_cols;
+   }
+   if (txn_kvsb_cfg->contention_policy != TRANSACTION_CONTENTION_INVALID) {
+      cfg.contention_policy = txn_kvsb_cfg->contention_policy;
+   }
+   if (txn_kvsb_cfg->contention_min_wait_ns) {
+      cfg.contention_min_wait_ns = txn_kvsb_cfg->contention_min_wait_ns;
+   }
+   if (txn_kvsb_cfg->contention_max_wait_ns) {
+      cfg.contention_max_wait_ns = txn_kvsb_cfg->contention_max_wait_ns;
+   }
+   if (cfg.contention_policy >= TRANSACTION_CONTENTION_MAX_VALID) {
+      platform_error_log("Invalid contention policy: %d\n",
+                         cfg.contention_policy);
+      return EINVAL;
+   }
+   if (txn_kvsb_cfg->read_wait_policy != TRANSACTION_READ_WAIT_INVALID) {
+      cfg.read_wait_policy = txn_kvsb_cfg->read_wait_policy;
+   }
+   if (txn_kvsb_cfg->read_wait_spins) {
+      cfg.read_wait_spins = txn_kvsb_cfg->read_wait_spins;
+   }
+   if (txn_kvsb_cfg->read_wait_no_spin) {
+      cfg.read_wait_spins = 0;
+   }
+   if (cfg.read_wait_policy >= TRANSACTION_READ_WAIT_MAX_VALID) {
+      platform_error_log("Invalid read wait policy: %d\n",
+                         cfg.read_wait_policy);
+      return EINVAL;
+   }
+   if (txn_kvsb_cfg->timestamp_source != TRANSACTION_TIMESTAMP_INVALID) {
+      cfg.timestamp_source = txn_kvsb_cfg->timestamp_source;
+   }
+   if (cfg.timestamp_source >= TRANSACTION_TIMESTAMP_MAX_VALID) {
+      platform_error_log("Invalid timestamp source: %d\n",
+                         cfg.timestamp_source);
+      return EINVAL;
+   }
+   if (transaction_protocol_has_small_timestamps(protocol)
+       && !transaction_timestamp_is_dense(cfg.timestamp_source))
+   {
+      platform_error_log(
+         "%s needs dense timestamps, not %s\n",
+         transaction_protocol_name(protocol),
+         transaction_timestamp_source_name(cfg.timestamp_source));
+      return EINVAL;
+   }
+   if (txn_kvsb_cfg->hot_key_sample_interval) {
+      cfg.hot_key_sample_interval = txn_kvsb_cfg->hot_key_sample_interval;
+   }
+   cfg.phase_stats         = txn_kvsb_cfg->phase_stats;
+   cfg.sync_commits        = txn_kvsb_cfg->sync_commits;
+   cfg.commutative_updates = txn_kvsb_cfg->commutative_updates;
+   cfg.hot_lock_threshold  = txn_kvsb_cfg->hot_lock_threshold;
+   cfg.compact_timestamps  = txn_kvsb_cfg->compact_timestamps;
+   if (cfg.sync_commits && !cfg.kvsb_cfg.use_log) {
+      platform_error_log("sync_commits requires use_log\n");
+      return EINVAL;
+   }
+
+   platform_default_log("Transaction protocol: %s\n",
+                        transaction_protocol_name(protocol));
+
+   int rc = transaction_protocols[protocol].create_or_open(
+      &cfg, txn_kvsb, open_existing);
+   if (rc == 0) {
+      (*txn_kvsb)->app_data_cfg        = cfg.kvsb_cfg.data_cfg;
+      (*txn_kvsb)->sync_commits        = cfg.sync_commits;
+      (*txn_kvsb)->commutative_updates = cfg.commutative_updates;
+      (*txn_kvsb)->heavy_scan_barrier  = platform_heavy_barrier_init();
+      transaction_contention_init(&(*txn_kvsb)->contention,
+                                  cfg.contention_policy,
+                                  cfg.contention_min_wait_ns,
+                                  cfg.contention_max_wait_ns);
+      transaction_contention_set_read_wait(&(*txn_kvsb)->contention,
+                                           cfg.read_wait_policy,
+                                           cfg.read_wait_spins);
+      transaction_timestamp_init(&(*txn_kvsb)->timestamps,
+                                 cfg.timestamp_source);
+      transaction_abort_profile_init(&(*txn_kvsb)->aborts,
+                                     cfg.hot_key_sample_interval);
+      transaction_phase_stats_init(&(*txn_kvsb)->phases, cfg.phase_stats);
+      transaction_hotness_init(&(*txn_kvsb)->hotness, cfg.hot_lock_threshold);
+   }
+   return rc;
+}
+
+int
+transactional_splinterdb_create_with_config(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb)
+{
+   return transactional_splinterdb_create_or_open(txn_kvsb_cfg, txn_kvsb, FALSE);
+}
+
+int
+transactional_splinterdb_open_with_config(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb)
+{
+   return transactional_splinterdb_create_or_open(txn_kvsb_cfg, txn_kvsb, TRUE);
+}
+
+int
+transactional_splinterdb_create(const splinterdb_config   *kvsb_cfg,
+                                transactional_splinterdb **txn_kvsb)
+{
+   transactional_splinterdb_config txn_kvsb_cfg;
+   transactional_splinterdb_config_init(
+      &txn_kvsb_cfg, kvsb_cfg, TRANSACTION_PROTOCOL_DEFAULT);
+   return transactional_splinterdb_create_or_open(
+      &txn_kvsb_cfg, txn_kvsb, FALSE);
+}
+
+int
+transactional_splinterdb_open(const splinterdb_config   *kvsb_cfg,
+                              transactional_splinterdb **txn_kvsb)
+{
+   transactional_splinterdb_config txn_kvsb_cfg;
+   transactional_splinterdb_config_init(
+      &txn_kvsb_cfg, kvsb_cfg, TRANSACTION_PROTOCOL_DEFAULT);
+   return transactional_splinterdb_create_or_open(&txn_kvsb_cfg, txn_kvsb, TRUE);
+}
+
+/*
+ * Transactions take their arena from the pool of the calling thread and give
+ * it back when they finish, so a thread that runs one transaction at a time
+ * keeps reusing the same arena.
+ */
+static transaction_arena *
+get_arena(transactional_splinterdb *txn_kvsb)
+{
+   threadid           tid   = platform_get_tid();
+   transaction_arena *arena = txn_kvsb->idle_arenas[tid];
+   if (arena) {
+      txn_kvsb->idle_arenas[tid] = arena->next;
+      arena->next                = NULL;
+      return arena;
+   }
+   return transaction_arena_create(0);
+}
+
+static void
+put_arena(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   transaction_arena *arena = txn->arena;
+   if (!arena) {
+      return;
+   }
+   txn->arena          = NULL;
+   txn->rw_entries     = NULL;
+   txn->rw_keys        = NULL;
+   txn->num_rw_entries = 0;
+   txn->max_rw_entries = 0;
+   txn->rw_index       = NULL;
+   txn->rw_index_size  = 0;
+   txn->scans          = NULL;
+
+   threadid tid = platform_get_tid();
+   transaction_arena_reset(arena);
+   arena->next                = txn_kvsb->idle_arenas[tid];
+   txn_kvsb->idle_arenas[tid] = arena;
+}
+
+static inline void
+count_abort(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   transaction_contention_on_abort(&txn_kvsb->contention);
+   transaction_abort_profile_on_abort(&txn_kvsb->aborts);
+   if (txn->begin_ns) {
+      transaction_phase_stats_record(&txn_kvsb->phases,
+                                     TRANSACTION_PHASE_ABORT,
+                                     platform_timestamp_elapsed(txn->begin_ns));
+   }
+}
+
+// Splits the time from the commit of txn to end into its phases
+static inline void
+record_commit_phases(transactional_splinterdb *txn_kvsb,
+                     const transaction        *txn,
+                     uint64                    end)
+{
+   transaction_phase_stats *ps = &txn_kvsb->phases;
+   transaction_phase_stats_record(
+      ps, TRANSACTION_PHASE_EXECUTION, txn->commit_ns - txn->begin_ns);
+   if (txn->write_ns) {
+      transaction_phase_stats_record(
+         ps, TRANSACTION_PHASE_VALIDATION, txn->write_ns - txn->commit_ns);
+      transaction_phase_stats_record(
+         ps, TRANSACTION_PHASE_WRITE, end - txn->write_ns);
+   } else {
+      transaction_phase_stats_record(
+         ps, TRANSACTION_PHASE_VALIDATION, end - txn->commit_ns);
+   }
+}
+
+/*
+ * A protocol that fails an operation because of a conflict has already
+ * aborted the transaction. One that fails with an error from splinterdb has
+ * not, so it is aborted here. Either way, the caller will not commit or
+ * abort it.
+ */
+static inline void
+put_arena_if_failed(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    int                       rc)
+{
+   if (rc != 0 && txn) {
+      if (rc != TRANSACTION_ABORTED) {
+         txn_kvsb->ops->abort(txn_kvsb, txn);
+      }
+      count_abort(txn_kvsb, txn);
+      put_arena(txn_kvsb, txn);
+   }
+}
+
+static void
+destroy_idle_arenas(transactional_splinterdb *txn_kvsb, threadid tid)
+{
+   while (txn_kvsb->idle_arenas[tid]) {
+      transaction_arena *arena   = txn_kvsb->idle_arenas[tid];
+      txn_kvsb->idle_arenas[tid] = arena->next;
+      transaction_arena_destroy(arena);
+   }
+}
+
+void
+transactional_splinterdb_close(transactional_splinterdb **txn_kvsb)
+{
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      destroy_idle_arenas(*txn_kvsb, tid);
+   }
+   transaction_hotness_deinit(&(*txn_kvsb)->hotness);
+   (*txn_kvsb)->ops->close(*txn_kvsb);
+   *txn_kvsb = NULL;
+}
+
+void
+transactional_splinterdb_register_thread(transactional_splinterdb *kvs)
+{
+   kvs->ops->register_thread(kvs);
+}
+
+void
+transactional_splinterdb_deregister_thread(transactional_splinterdb *kvs)
+{
+   destroy_idle_arenas(kvs, platform_get_tid());
+   kvs->ops->deregister_thread(kvs);
+}
+
+int
+transactional_splinterdb_begin(transactional_splinterdb *txn_kvsb,
+                               transaction              *txn)
+{
+   int rc        = txn_kvsb->ops->begin(txn_kvsb, txn);
+   txn->arena    = get_arena(txn_kvsb);
+   txn->begin_ns = transaction_phase_stats_enabled(&txn_kvsb->phases)
+                      ? platform_get_timestamp()
+                      : 0;
+   return rc;
+}
+
+int
+transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn)
+{
+   uint64 ticket;
+   int    rc = transactional_splinterdb_commit_async(txn_kvsb, txn, &ticket);
+   if (rc == 0 && txn_kvsb->sync_commits) {
+      rc = transactional_splinterdb_wait_durable(txn_kvsb, ticket);
+   }
+   return rc;
+}
+
+/*
+ * The ticket of a commit is the last position of the log once its writes are
+ * in it. It also covers the commits txn read from, which were logged before.
+ */
+int
+transactional_splinterdb_commit_async(transactional_splinterdb *txn_kvsb,
+                                      transaction              *txn,
+                                      uint64                   *ticket)
+{
+   if (txn->begin_ns) {
+      txn->commit_ns = platform_get_timestamp();
+      txn->write_ns  = 0;
+   }
+   int rc = txn_kvsb->ops->commit(txn_kvsb, txn);
+   transaction_finish_commit(txn_kvsb);
+   put_arena(txn_kvsb, txn);
+   if (rc != 0) {
+      count_abort(txn_kvsb, txn);
+   } else {
+      if (txn->begin_ns) {
+         record_commit_phases(txn_kvsb, txn, platform_get_timestamp());
+      }
+      transaction_contention_on_commit(&txn_kvsb->contention);
+      *ticket = splinterdb_log_lsn(transactional_splinterdb_get_db(txn_kvsb));
+   }
+   return rc;
+}
+
+bool
+transactional_splinterdb_is_durable(transactional_splinterdb *txn_kvsb,
+                                    uint64                    ticket)
+{
+   return splinterdb_log_is_durable(transactional_splinterdb_get_db(txn_kvsb),
+                                    ticket);
+}
+
+int
+transactional_splinterdb_wait_durable(transactional_splinterdb *txn_kvsb,
+                                      uint64                    ticket)
+{
+   return splinterdb_log_sync(transactional_splinterdb_get_db(txn_kvsb),
+                              ticket);
+}
+
+int
+transactional_splinterdb_abort(transactional_splinterdb *txn_kvsb,
+                               transaction              *txn)
+{
+   int rc = txn_kvsb->ops->abort(txn_kvsb, txn);
+   transaction_abort_profile_note(
+      &txn_kvsb->aborts, TRANSACTION_ABORT_USER, NULL_SLICE);
+   count_abort(txn_kvsb, txn);
+   put_arena(txn_kvsb, txn);
+   return rc;
+}
+
+int
+transactional_splinterdb_insert(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn,
+                                slice                     user_key,
+                                slice                     value)
+{
+   int rc = txn_kvsb->ops->insert(txn_kvsb, txn, user_key, value);
+   put_arena_if_failed(txn_kvsb, txn, rc);
+   return rc;
+}
+
+int
+transactional_splinterdb_delete(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn,
+                                slice                     user_key)
+{
+   int rc = txn_kvsb->ops->delete(txn_kvsb, txn, user_key);
+   put_arena_if_failed(txn_kvsb, txn, rc);
+   return rc;
+}
+
+int
+transactional_splinterdb_update(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn,
+                                slice                     user_key,
+                                slice                     delta)
+{
+   int rc = txn_kvsb->ops->update(txn_kvsb, txn, user_key, delta);
+   put_arena_if_failed(txn_kvsb, txn, rc);
+   return rc;
+}
+
+int
+transactional_splinterdb_lookup(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn,
+                                slice                     user_key,
+                                splinterdb_lookup_result *result)
+{
+   int rc = txn_kvsb->ops->lookup(txn_kvsb, txn, user_key, result);
+   put_arena_if_failed(txn_kvsb, txn, rc);
+   return rc;
+}
+
+void
+transactional_splinterdb_lookup_result_init(
+   transactional_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   txn_kvsb->ops->lookup_result_init(txn_kvsb, result, buffer_len, buffer);
+}
+
+void
+transactional_splinterdb_set_isolation_level(
+   transactional_splinterdb   *txn_kvsb,
+   transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->ops->set_isolation_level(txn_kvsb, isol_level);
+}
 
 const splinterdb *
 transactional_splinterdb_get_db(transactional_splinterdb *txn_kvsb)
 {
-   return txn_kvsb->kvsb;
+   return txn_kvsb->ops->get_db(txn_kvsb);
+}
+
+/*
+ * An operation or commit that fails gives the arena of txn back, so an
+ * attempt that lost txn->arena was aborted. Only TRANSACTION_ABORTED says
+ * that the protocol aborted it over a conflict, and is worth a retry. The
+ * next begin takes the same arena from the idle list of the thread, so the
+ * read/write set of the retry reuses the memory of the failed attempt.
+ *
+ * A declared footprint is prefetched only once: retries find it in the cache
+ * still, or else read just the keys the body actually looks up.
+ */
+int
+transactional_splinterdb_run(
+   transactional_splinterdb                   *txn_kvsb,
+   transactional_splinterdb_body               body,
+   void                                       *ctx,
+   const transactional_splinterdb_run_options *opts,
+   transactional_splinterdb_run_stats         *stats)
+{
+   uint64 max_attempts = opts ? opts->max_attempts : 0;
+   transactional_splinterdb_run_stats run_stats = {0};
+   int                                rc;
+
+   if (opts && opts->footprint_size > 0) {
+      splinterdb_prefetch(transactional_splinterdb_get_db(txn_kvsb),
+                          opts->footprint_size,
+                          opts->footprint);
+   }
+
+   while (TRUE) {
+      timestamp   start = platform_get_timestamp();
+      transaction txn;
+      run_stats.attempts++;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      rc             = body(txn_kvsb, &txn, ctx);
+      bool is_aborted = rc == TRANSACTION_ABORTED;
+      if (txn.arena) {
+         if (rc != 0) {
+            // The body gave up
+            transactional_splinterdb_abort(txn_kvsb, &txn);
+            run_stats.wasted_ns += platform_timestamp_elapsed(start);
+            break;
+         }
+         uint64 ticket;
+         rc = transactional_splinterdb_commit_async(txn_kvsb, &txn, &ticket);
+         if (rc == 0) {
+            if (txn_kvsb->sync_commits) {
+               rc = transactional_splinterdb_wait_durable(txn_kvsb, ticket);
+            }
+            break;
+         }
+         is_aborted = rc == TRANSACTION_ABORTED;
+      } else if (rc == 0) {
+         // The body ignored a failed operation, taken for an abort
+         rc         = EAGAIN;
+         is_aborted = TRUE;
+      }
+
+      if (!is_aborted || (max_attempts && run_stats.attempts >= max_attempts))
+      {
+         run_stats.wasted_ns += platform_timestamp_elapsed(start);
+         break;
+      }
+      transaction_contention_backoff(&txn_kvsb->contention,
+                                     run_stats.attempts - 1);
+      run_stats.wasted_ns += platform_timestamp_elapsed(start);
+   }
+
+   if (stats) {
+      *stats = run_stats;
+   }
+   return rc;
+}
+
+void
+transactional_splinterdb_thread_contention_stats(
+   transactional_splinterdb     *txn_kvsb,
+   transaction_contention_stats *stats)
+{
+   transaction_contention_get_stats(
+      &txn_kvsb->contention, platform_get_tid(), stats);
+}
+
+void
+transactional_splinterdb_contention_stats(
+   transactional_splinterdb     *txn_kvsb,
+   transaction_contention_stats *stats)
+{
+   ZERO_CONTENTS(stats);
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      transaction_contention_stats thread_stats;
+      transaction_contention_get_stats(
+         &txn_kvsb->contention, tid, &thread_stats);
+      stats->commits += thread_stats.commits;
+      stats->aborts += thread_stats.aborts;
+      stats->lock_waits += thread_stats.lock_waits;
+      stats->wait_ns += thread_stats.wait_ns;
+      stats->read_waits += thread_stats.read_waits;
+      stats->read_wait_ns += thread_stats.read_wait_ns;
+   }
+}
+
+void
+transactional_splinterdb_reset_contention_stats(
+   transactional_splinterdb *txn_kvsb)
+{
+   transaction_contention_reset_stats(&txn_kvsb->contention);
+}
+
+void
+transactional_splinterdb_thread_abort_stats(transactional_splinterdb *txn_kvsb,
+                                            transaction_abort_stats  *stats)
+{
+   transaction_abort_profile_get_stats(
+      &txn_kvsb->aborts, platform_get_tid(), stats);
+}
+
+void
+transactional_splinterdb_abort_stats(transactional_splinterdb *txn_kvsb,
+                                     transaction_abort_stats  *stats)
+{
+   ZERO_CONTENTS(stats);
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      transaction_abort_stats thread_stats;
+      transaction_abort_profile_get_stats(
+         &txn_kvsb->aborts, tid, &thread_stats);
+      for (int r = 0; r < TRANSACTION_ABORT_MAX_VALID; r++) {
+         stats->aborts[r] += thread_stats.aborts[r];
+      }
+   }
+}
+
+uint64
+transactional_splinterdb_hot_keys(transactional_splinterdb *txn_kvsb,
+                                  transaction_hot_key      *keys,
+                                  uint64                    max_keys)
+{
+   return transaction_abort_profile_hot_keys(&txn_kvsb->aborts, keys, max_keys);
+}
+
+#define TRANSACTION_PRINTED_HOT_KEYS (10)
+
+void
+transactional_splinterdb_print_abort_stats(transactional_splinterdb *txn_kvsb)
+{
+   transaction_abort_stats stats;
+   transactional_splinterdb_abort_stats(txn_kvsb, &stats);
+   uint64 total = 0;
+   for (int r = 0; r < TRANSACTION_ABORT_MAX_VALID; r++) {
+      total += stats.aborts[r];
+   }
+   platform_default_log("Aborts: %lu\n", total);
+   for (int r = 0; r < TRANSACTION_ABORT_MAX_VALID; r++) {
+      if (stats.aborts[r]) {
+         platform_default_log("   %-16s %12lu (%5.1f%%)\n",
+                              transaction_abort_reason_name(r),
+                              stats.aborts[r],
+                              100.0 * stats.aborts[r] / total);
+      }
+   }
+
+   transaction_hot_key keys[TRANSACTION_PRINTED_HOT_KEYS];
+   uint64              num_keys = transactional_splinterdb_hot_keys(
+      txn_kvsb, keys, TRANSACTION_PRINTED_HOT_KEYS);
+   if (num_keys) {
+      platform_default_log("Hottest keys (sampled aborts, error, key):\n");
+   }
+   for (uint64 i = 0; i < num_keys; i++) {
+      uint64 length = MIN(keys[i].length, TRANSACTION_HOT_KEY_MAX_LENGTH);
+      char   hex[2 * TRANSACTION_HOT_KEY_MAX_LENGTH + 1];
+      for (uint64 j = 0; j < length; j++) {
+         snprintf(&hex[2 * j], 3, "%02x", (uint8)keys[i].key[j]);
+      }
+      hex[2 * length] = '\0';
+      platform_default_log("   %12lu %12lu %s%s\n",
+                           keys[i].conflicts,
+                           keys[i].error,
+                           hex,
+                           length < keys[i].length ? "..." : "");
+   }
+}
+
+void
+transactional_splinterdb_reset_abort_stats(transactional_splinterdb *txn_kvsb)
+{
+   transaction_abort_profile_reset(&txn_kvsb->aborts);
+}
+
+void
+transactional_splinterdb_enable_phase_stats(transactional_splinterdb *txn_kvsb,
+                                            bool                      enable)
+{
+   transaction_phase_stats_enable(&txn_kvsb->phases, enable);
+}
+
+void
+transactional_splinterdb_phase_histogram(transactional_splinterdb *txn_kvsb,
+                                         transaction_phase         phase,
+                                         transaction_histogram    *hist)
+{
+   transaction_phase_stats_get(&txn_kvsb->phases, phase, hist);
+}
+
+void
+transactional_splinterdb_print_phase_stats(transactional_splinterdb *txn_kvsb)
+{
+   platform_default_log("%-10s %12s %10s %10s %10s %10s %10s (ns)\n",
+                        "Phase",
+                        "count",
+                        "mean",
+                        "p50",
+                        "p99",
+                        "p99.9",
+                        "max");
+   for (transaction_phase phase = 0; phase < TRANSACTION_PHASE_MAX_VALID;
+        phase++)
+   {
+      transaction_histogram hist;
+      transactional_splinterdb_phase_histogram(txn_kvsb, phase, &hist);
+      platform_default_log("%-10s %12lu %10lu %10lu %10lu %10lu %10lu\n",
+                           transaction_phase_name(phase),
+                           hist.count,
+                           hist.count ? hist.sum_ns / hist.count : 0,
+                           transaction_histogram_percentile(&hist, 50),
+                           transaction_histogram_percentile(&hist, 99),
+                           transaction_histogram_percentile(&hist, 99.9),
+                           hist.max_ns);
+   }
+}
+
+void
+transactional_splinterdb_reset_phase_stats(transactional_splinterdb *txn_kvsb)
+{
+   transaction_phase_stats_reset(&txn_kvsb->phases);
 }
@@ -0,0 +1,193 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "transaction_abort_profile.h"
+#include "poison.h"
+
+void
+transaction_abort_profile_init(transaction_abort_profile *prof,
+                               uint64                     sample_interval)
+{
+   ZERO_CONTENTS(prof);
+   prof->sample_interval = MAX(sample_interval, 1);
+}
+
+static uint64
+transaction_abort_profile_hash(slice key)
+{
+   return platform_hash64(slice_data(key), slice_length(key), HASH_SEED);
+}
+
+// One step of the space-saving algorithm
+static void
+transaction_abort_profile_count_key(transaction_abort_thread *thread,
+                                    slice                     key)
+{
+   uint64 hash   = transaction_abort_profile_hash(key);
+   uint64 victim = 0;
+   for (uint64 i = 0; i < TRANSACTION_HOT_KEYS_PER_THREAD; i++) {
+      transaction_hot_key *hot = &thread->hot_keys[i];
+      if (hot->conflicts && thread->hashes[i] == hash
+          && hot->length == slice_length(key))
+      {
+         hot->conflicts++;
+         return;
+      }
+      if (hot->conflicts < thread->hot_keys[victim].conflicts) {
+         victim = i;
+      }
+   }
+
+   transaction_hot_key *hot = &thread->hot_keys[victim];
+   hot->error               = hot->conflicts;
+   hot->conflicts++;
+   hot->length = slice_length(key);
+   memcpy(hot->key,
+          slice_data(key),
+          MIN(slice_length(key), TRANSACTION_HOT_KEY_MAX_LENGTH));
+   thread->hashes[victim] = hash;
+}
+
+void
+transaction_abort_profile_note(transaction_abort_profile *prof,
+                               transaction_abort_reason   reason,
+                               slice                      key)
+{
+   transaction_abort_thread *thread = &prof->threads[platform_get_tid()];
+   thread->pending                  = reason;
+   if (!slice_is_null(key) && thread->notes++ % prof->sample_interval == 0) {
+      transaction_abort_profile_count_key(thread, key);
+   }
+}
+
+void
+transaction_abort_profile_on_abort(transaction_abort_profile *prof)
+{
+   transaction_abort_thread *thread = &prof->threads[platform_get_tid()];
+   thread->stats.aborts[thread->pending]++;
+   thread->pending = TRANSACTION_ABORT_UNKNOWN;
+}
+
+void
+transaction_abort_profile_get_stats(const transaction_abort_profile *prof,
+                                    threadid                         tid,
+                                    transaction_abort_stats         *stats)
+{
+   *stats = prof->threads[tid].stats;
+}
+
+typedef struct hashed_hot_key {
+   uint64              hash;
+   transaction_hot_key key;
+} hashed_hot_key;
+
+static int
+hashed_hot_key_compare_hash(const void *a, const void *b, void *arg)
+{
+   const hashed_hot_key *x = (const hashed_hot_key *)a;
+   const hashed_hot_key *y = (const hashed_hot_key *)b;
+   if (x->hash != y->hash) {
+      return x->hash < y->hash ? -1 : 1;
+   }
+   return x->key.length < y->key.length ? -1 : x->key.length > y->key.length;
+}
+
+// Most conflicts first
+static int
+hashed_hot_key_compare_conflicts(const void *a, const void *b, void *arg)
+{
+   const hashed_hot_key *x = (const hashed_hot_key *)a;
+   const hashed_hot_key *y = (const hashed_hot_key *)b;
+   return x->key.conflicts > y->key.conflicts   ? -1
+          : x->key.conflicts < y->key.conflicts ? 1
+                                                : 0;
+}
+
+/*
+ * A key that is hot on several threads has an entry on each. Their counts
+ * and errors add up, like those of a single table that saw every abort.
+ */
+uint64
+transaction_abort_profile_hot_keys(const transaction_abort_profile *prof,
+                                   transaction_hot_key             *keys,
+                                   uint64                           max_keys)
+{
+   hashed_hot_key *all = TYPED_ARRAY_MALLOC(
+      0, all, MAX_THREADS * TRANSACTION_HOT_KEYS_PER_THREAD);
+   platform_assert(all != NULL);
+
+   uint64 num_keys = 0;
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      const transaction_abort_thread *thread = &prof->threads[tid];
+      for (uint64 i = 0; i < TRANSACTION_HOT_KEYS_PER_THREAD; i++) {
+         if (thread->hot_keys[i].conflicts) {
+            all[num_keys].hash = thread->hashes[i];
+            all[num_keys].key  = thread->hot_keys[i];
+            num_keys++;
+         }
+      }
+   }
+
+   hashed_hot_key tmp;
+   platform_sort_slow(
+      all, num_keys, sizeof(*all), hashed_hot_key_compare_hash, NULL, &tmp);
+   uint64 num_merged = 0;
+   for (uint64 i = 0; i < num_keys; i++) {
+      if (num_merged
+          && hashed_hot_key_compare_hash(&all[num_merged - 1], &all[i], NULL)
+                == 0)
+      {
+         all[num_merged - 1].key.conflicts += all[i].key.conflicts;
+         all[num_merged - 1].key.error += all[i].key.error;
+      } else {
+         all[num_merged++] = all[i];
+      }
+   }
+   platform_sort_slow(all,
+                      num_merged,
+                      sizeof(*all),
+                      hashed_hot_key_compare_conflicts,
+                      NULL,
+                      &tmp);
+
+   uint64 num_copied = MIN(num_merged, max_keys);
+   for (uint64 i = 0; i < num_copied; i++) {
+      keys[i] = all[i].key;
+   }
+   platform_free(0, all);
+   return num_copied;
+}
+
+void
+transaction_abort_profile_reset(transaction_abort_profile *prof)
+{
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      transaction_abort_thread *thread = &prof->threads[tid];
+      ZERO_STRUCT(thread->stats);
+      ZERO_ARRAY(thread->hot_keys);
+      thread->notes = 0;
+   }
+}
+
+static const char *transaction_abort_reason_names[] = {
+   [TRANSACTION_ABORT_UNKNOWN]          = "unknown",
+   [TRANSACTION_ABORT_USER]             = "user",
+   [TRANSACTION_ABORT_READ_CHANGED]     = "read-changed",
+   [TRANSACTION_ABORT_READ_LOCKED]      = "read-locked",
+   [TRANSACTION_ABORT_LOCK_BUSY]        = "lock-busy",
+   [TRANSACTION_ABORT_WOUNDED]          = "wounded",
+   [TRANSACTION_ABORT_DEADLOCK]         = "deadlock",
+   [TRANSACTION_ABORT_TOO_LATE]         = "too-late",
+   [TRANSACTION_ABORT_WRITE_CONFLICT]   = "write-conflict",
+   [TRANSACTION_ABORT_SNAPSHOT_TOO_OLD] = "snapshot-too-old",
+   [TRANSACTION_ABORT_PHANTOM]          = "phantom",
+};
+
+const char *
+transaction_abort_reason_name(transaction_abort_reason reason)
+{
+   if (TRANSACTION_ABORT_MAX_VALID <= reason) {
+      return "invalid";
+   }
+   return transaction_abort_reason_names[reason];
+}
@@ -0,0 +1,77 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_abort_profile.h --
+ *
+ *     Counts why transactions abort, and which keys they abort on.
+ *
+ *     A protocol that decides to abort a transaction says why, and on which
+ *     key if it knows, through transaction_abort_profile_note(). transaction.c
+ *     counts the reason once the abort reaches the caller, as
+ *     TRANSACTION_ABORT_UNKNOWN if the protocol gave none.
+ *
+ *     The keys go into a small space-saving table on each thread, which
+ *     keeps the TRANSACTION_HOT_KEYS_PER_THREAD keys that aborted the most
+ *     transactions so far. When the table is full, a new key takes the place
+ *     of the key with the fewest aborts, and starts from its count, so counts
+ *     can only be too high, and by no more than the error kept with them.
+ */
+
+#pragma once
+
+#include "platform.h"
+#include "splinterdb/transaction.h"
+
+#define TRANSACTION_HOT_KEYS_PER_THREAD (16)
+
+typedef struct transaction_abort_thread {
+   transaction_abort_reason pending; // noted by the protocol, not counted yet
+   uint64                   notes;   // keys noted, for sampling
+   transaction_abort_stats  stats;
+   uint64                   hashes[TRANSACTION_HOT_KEYS_PER_THREAD];
+   transaction_hot_key      hot_keys[TRANSACTION_HOT_KEYS_PER_THREAD];
+} PLATFORM_CACHELINE_ALIGNED transaction_abort_thread;
+
+typedef struct transaction_abort_profile {
+   uint64                   sample_interval;
+   transaction_abort_thread threads[MAX_THREADS];
+} transaction_abort_profile;
+
+void
+transaction_abort_profile_init(transaction_abort_profile *prof,
+                               uint64                     sample_interval);
+
+/*
+ * Records why the calling thread is aborting its transaction. key is the key
+ * that made it abort, or NULL_SLICE if there is none.
+ */
+void
+transaction_abort_profile_note(transaction_abort_profile *prof,
+                               transaction_abort_reason   reason,
+                               slice                      key);
+
+/*
+ * Counts the abort of the transaction of the calling thread, under the
+ * reason noted last.
+ */
+void
+transaction_abort_profile_on_abort(transaction_abort_profile *prof);
+
+void
+transaction_abort_profile_get_stats(const transaction_abort_profile *prof,
+                                    threadid                         tid,
+                                    transaction_abort_stats         *stats);
+
+/*
+ * Merges the hot keys of all threads, and copies the max_keys that aborted
+ * the most transactions into keys, most aborts first. Returns how many it
+ * copied.
+ */
+uint64
+transaction_abort_profile_hot_keys(const transaction_abort_profile *prof,
+                                   transaction_hot_key             *keys,
+                                   uint64                           max_keys);
+
+void
+transaction_abort_profile_reset(transaction_abort_profile *prof);
@@ -0,0 +1,77 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "transaction_arena.h"
+#include "poison.h"
+
+struct transaction_arena_chunk {
+   transaction_arena_chunk *next;
+   uint64                   size;
+   char data[] __attribute__((aligned(TRANSACTION_ARENA_ALIGNMENT)));
+};
+
+static transaction_arena_chunk *
+transaction_arena_chunk_create(platform_heap_id heap_id, uint64 size)
+{
+   transaction_arena_chunk *chunk;
+   chunk = TYPED_FLEXIBLE_STRUCT_MALLOC(heap_id, chunk, data, size);
+   platform_assert(chunk != NULL);
+   chunk->next = NULL;
+   chunk->size = size;
+   return chunk;
+}
+
+transaction_arena *
+transaction_arena_create(platform_heap_id heap_id)
+{
+   transaction_arena *arena;
+   arena          = TYPED_ZALLOC(heap_id, arena);
+   arena->heap_id = heap_id;
+   arena->first =
+      transaction_arena_chunk_create(heap_id, TRANSACTION_ARENA_CHUNK_SIZE);
+   arena->cur = arena->first;
+   return arena;
+}
+
+void
+transaction_arena_destroy(transaction_arena *arena)
+{
+   transaction_arena_chunk *chunk = arena->first;
+   while (chunk) {
+      transaction_arena_chunk *next = chunk->next;
+      platform_free(arena->heap_id, chunk);
+      chunk = next;
+   }
+   platform_free(arena->heap_id, arena);
+}
+
+void *
+transaction_arena_alloc(transaction_arena *arena, uint64 size)
+{
+   size = ROUNDUP(size, TRANSACTION_ARENA_ALIGNMENT);
+
+   if (arena->used + size > arena->cur->size) {
+      transaction_arena_chunk *next = arena->cur->next;
+      if (next == NULL || next->size < size) {
+         // Chunks after cur are kept, so later transactions can still use
+         // them.
+         next = transaction_arena_chunk_create(
+            arena->heap_id, MAX(size, TRANSACTION_ARENA_CHUNK_SIZE));
+         next->next       = arena->cur->next;
+         arena->cur->next = next;
+      }
+      arena->cur  = next;
+      arena->used = 0;
+   }
+
+   void *ptr = arena->cur->data + arena->used;
+   arena->used += size;
+   return ptr;
+}
+
+void
+transaction_arena_reset(transaction_arena *arena)
+{
+   arena->cur  = arena->first;
+   arena->used = 0;
+}
@@ -0,0 +1,84 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_arena.h --
+ *
+ *     A bump allocator for the read/write set of a transaction.
+ *
+ *     Everything a transaction allocates (rw entries, copies of keys and
+ *     messages, the commit-time read/write sets) comes from its arena and is
+ *     released all at once by transaction_arena_reset() when the transaction
+ *     finishes. The arena keeps its chunks across resets, so once an arena
+ *     has grown to the size of the largest transaction of its thread, running
+ *     a transaction does not call malloc/free at all.
+ */
+
+#pragma once
+
+#include "platform.h"
+#include "util.h"
+#include "data_internal.h"
+
+// Every allocation is aligned so that entries holding uint128 timestamps can
+// live in the arena.
+#define TRANSACTION_ARENA_ALIGNMENT (16)
+
+// Allocations larger than this get a chunk of their own
+#define TRANSACTION_ARENA_CHUNK_SIZE (64 * KiB)
+
+typedef struct transaction_arena_chunk transaction_arena_chunk;
+
+typedef struct transaction_arena {
+   platform_heap_id         heap_id;
+   transaction_arena_chunk *first;
+   transaction_arena_chunk *cur;
+   uint64                   used; // bytes used in cur
+
+   // For keeping idle arenas in a free list
+   struct transaction_arena *next;
+} transaction_arena;
+
+transaction_arena *
+transaction_arena_create(platform_heap_id heap_id);
+
+void
+transaction_arena_destroy(transaction_arena *arena);
+
+void *
+transaction_arena_alloc(transaction_arena *arena, uint64 size);
+
+/*
+ * Releases everything allocated from the arena in O(1). The memory is kept
+ * for the next transaction.
+ */
+void
+transaction_arena_reset(transaction_arena *arena);
+
+static inline void *
+transaction_arena_zalloc(transaction_arena *arena, uint64 size)
+{
+   void *ptr = transaction_arena_alloc(arena, size);
+   memset(ptr, 0, size);
+   return ptr;
+}
+
+#define TYPED_ARENA_ZALLOC(arena, v)                                           \
+   ((typeof(v))transaction_arena_zalloc((arena), sizeof(*(v))))
+
+#define TYPED_ARENA_ARRAY_MALLOC(arena, v, n)                                  \
+   ((typeof(v))transaction_arena_alloc((arena), (n) * sizeof(*(v))))
+
+static inline slice
+transaction_arena_copy_slice(transaction_arena *arena, slice src)
+{
+   void *dst = transaction_arena_alloc(arena, slice_length(src));
+   return slice_copy_contents(dst, src);
+}
+
+static inline message
+transaction_arena_copy_message(transaction_arena *arena, message src)
+{
+   slice data = transaction_arena_copy_slice(arena, message_slice(src));
+   return message_create(message_class(src), data);
+}
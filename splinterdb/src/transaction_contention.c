@@ -0,0 +1,252 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "transaction_contention.h"
+#include "poison.h"
+
+void
+transaction_contention_init(transaction_contention       *cm,
+                            transaction_contention_policy policy,
+                            uint64                        min_wait_ns,
+                            uint64                        max_wait_ns)
+{
+   platform_assert(TRANSACTION_CONTENTION_INVALID < policy
+                   && policy < TRANSACTION_CONTENTION_MAX_VALID);
+   ZERO_CONTENTS(cm);
+   cm->policy      = policy;
+   cm->min_wait_ns = min_wait_ns;
+   cm->max_wait_ns = MAX(min_wait_ns, max_wait_ns);
+   transaction_contention_set_read_wait(
+      cm, TRANSACTION_READ_WAIT_DEFAULT, TRANSACTION_READ_WAIT_SPINS);
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      cm->threads[tid].seed = tid + 1;
+   }
+}
+
+// xorshift64
+static inline uint64
+transaction_contention_random(transaction_contention_thread *thread)
+{
+   uint64 x     = thread->seed;
+   x           ^= x << 13;
+   x           ^= x >> 7;
+   x           ^= x << 17;
+   thread->seed = x;
+   return x;
+}
+
+// Picks a wait in [wait / 2, wait], so that threads that failed together
+// do not all retry together
+static inline uint64
+transaction_contention_jitter(transaction_contention_thread *thread,
+                              uint64                         wait)
+{
+   uint64 half = wait / 2;
+   return wait - transaction_contention_random(thread) % (half + 1);
+}
+
+// min_wait_ns * 2^attempt, capped at max_wait_ns
+static inline uint64
+transaction_contention_exponential(const transaction_contention *cm,
+                                   uint64                        attempt)
+{
+   uint64 wait = MAX(cm->min_wait_ns, 1);
+   while (attempt-- > 0 && wait < cm->max_wait_ns) {
+      wait *= 2;
+   }
+   return MIN(wait, cm->max_wait_ns);
+}
+
+uint64
+transaction_contention_wait_ns(transaction_contention *cm, uint64 attempt)
+{
+   transaction_contention_thread *thread = &cm->threads[platform_get_tid()];
+
+   uint64 wait = cm->min_wait_ns;
+   switch (cm->policy) {
+      case TRANSACTION_CONTENTION_FIXED:
+         break;
+      case TRANSACTION_CONTENTION_BACKOFF:
+         wait = transaction_contention_jitter(
+            thread, transaction_contention_exponential(cm, attempt));
+         break;
+      case TRANSACTION_CONTENTION_ABORT_RATE:
+         wait += (cm->max_wait_ns - cm->min_wait_ns) * thread->abort_rate
+                 / TRANSACTION_CONTENTION_RATE_ONE;
+         wait = transaction_contention_jitter(thread, wait);
+         break;
+      case TRANSACTION_CONTENTION_AGE:
+         wait = transaction_contention_exponential(cm, attempt);
+         wait = MAX(wait >> MIN(thread->retries, 63), cm->min_wait_ns);
+         wait = transaction_contention_jitter(thread, wait);
+         break;
+      default:
+         platform_assert(FALSE, "Invalid contention policy %d", cm->policy);
+   }
+
+   thread->stats.lock_waits++;
+   thread->stats.wait_ns += wait;
+   return wait;
+}
+
+void
+transaction_contention_set_read_wait(transaction_contention      *cm,
+                                     transaction_read_wait_policy policy,
+                                     uint64                       spins)
+{
+   platform_assert(TRANSACTION_READ_WAIT_INVALID < policy
+                   && policy < TRANSACTION_READ_WAIT_MAX_VALID);
+   cm->read_wait_policy = policy;
+   cm->read_wait_spins  = spins;
+}
+
+/*
+ * The commit that holds the lock is installing its writes, which takes
+ * microseconds, so reads spin on it first. Past read_wait_spins, the holder
+ * has likely been descheduled, and spinning only keeps it off the CPU.
+ */
+bool
+transaction_contention_wait_locked_read(transaction_contention *cm,
+                                        uint64                  attempt)
+{
+   transaction_contention_thread *thread = &cm->threads[platform_get_tid()];
+   if (attempt == 0) {
+      thread->read_wait_start = platform_get_timestamp();
+      thread->stats.read_waits++;
+   }
+
+   if (attempt < cm->read_wait_spins
+       || cm->read_wait_policy == TRANSACTION_READ_WAIT_SPIN)
+   {
+      platform_pause();
+      return TRUE;
+   }
+   switch (cm->read_wait_policy) {
+      case TRANSACTION_READ_WAIT_YIELD:
+         platform_yield();
+         return TRUE;
+      case TRANSACTION_READ_WAIT_ABORT:
+         transaction_contention_end_locked_read(cm);
+         return FALSE;
+      default:
+         platform_assert(
+            FALSE, "Invalid read wait policy %d", cm->read_wait_policy);
+   }
+   return FALSE;
+}
+
+void
+transaction_contention_end_locked_read(transaction_contention *cm)
+{
+   transaction_contention_thread *thread = &cm->threads[platform_get_tid()];
+   thread->stats.read_wait_ns +=
+      platform_timestamp_elapsed(thread->read_wait_start);
+}
+
+static inline void
+transaction_contention_update_rate(transaction_contention_thread *thread,
+                                   bool                           aborted)
+{
+   const uint64 shift = TRANSACTION_CONTENTION_RATE_SHIFT;
+   thread->abort_rate -= thread->abort_rate >> shift;
+   if (aborted) {
+      thread->abort_rate += TRANSACTION_CONTENTION_RATE_ONE >> shift;
+   }
+}
+
+void
+transaction_contention_on_commit(transaction_contention *cm)
+{
+   transaction_contention_thread *thread = &cm->threads[platform_get_tid()];
+   transaction_contention_update_rate(thread, FALSE);
+   thread->retries = 0;
+   thread->stats.commits++;
+}
+
+void
+transaction_contention_on_abort(transaction_contention *cm)
+{
+   transaction_contention_thread *thread = &cm->threads[platform_get_tid()];
+   transaction_contention_update_rate(thread, TRUE);
+   thread->retries++;
+   thread->stats.aborts++;
+}
+
+void
+transaction_contention_get_stats(const transaction_contention *cm,
+                                 threadid                      tid,
+                                 transaction_contention_stats *stats)
+{
+   *stats = cm->threads[tid].stats;
+}
+
+void
+transaction_contention_reset_stats(transaction_contention *cm)
+{
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      ZERO_STRUCT(cm->threads[tid].stats);
+   }
+}
+
+static const char *transaction_contention_policy_names[] = {
+   [TRANSACTION_CONTENTION_FIXED]      = "fixed",
+   [TRANSACTION_CONTENTION_BACKOFF]    = "backoff",
+   [TRANSACTION_CONTENTION_ABORT_RATE] = "abort-rate",
+   [TRANSACTION_CONTENTION_AGE]        = "age",
+};
+
+const char *
+transaction_contention_policy_name(transaction_contention_policy policy)
+{
+   if (policy <= TRANSACTION_CONTENTION_INVALID
+       || TRANSACTION_CONTENTION_MAX_VALID <= policy)
+   {
+      return "invalid";
+   }
+   return transaction_contention_policy_names[policy];
+}
+
+transaction_contention_policy
+transaction_contention_policy_from_name(const char *name)
+{
+   for (transaction_contention_policy p = TRANSACTION_CONTENTION_INVALID + 1;
+        p < TRANSACTION_CONTENTION_MAX_VALID;
+        p++)
+   {
+      if (strcmp(name, transaction_contention_policy_names[p]) == 0) {
+         return p;
+      }
+   }
+   return TRANSACTION_CONTENTION_INVALID;
+}
+
+static const char *transaction_read_wait_policy_names[] = {
+   [TRANSACTION_READ_WAIT_SPIN]  = "spin",
+   [TRANSACTION_READ_WAIT_YIELD] = "yield",
+   [TRANSACTION_READ_WAIT_ABORT] = "abort",
+};
+
+const char *
+transaction_read_wait_policy_name(transaction_read_wait_policy policy)
+{
+   if (policy <= TRANSACTION_READ_WAIT_INVALID
+       || TRANSACTION_READ_WAIT_MAX_VALID <= policy)
+   {
+      return "invalid";
+   }
+   return transaction_read_wait_policy_names[policy];
+}
+
+transaction_read_wait_policy
+transaction_read_wait_policy_from_name(const char *name)
+{
+   for (transaction_read_wait_policy p = TRANSACTION_READ_WAIT_INVALID + 1;
+        p < TRANSACTION_READ_WAIT_MAX_VALID;
+        p++)
+   {
+      if (strcmp(name, transaction_read_wait_policy_names[p]) == 0) {
+         return p;
+      }
+   }
+   return TRANSACTION_READ_WAIT_INVALID;
+}
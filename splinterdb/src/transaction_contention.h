@@ -0,0 +1,110 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_contention.h --
+ *
+ *     The contention manager, which every protocol consults when a lock it
+ *     needs is taken, instead of sleeping for a fixed time of its own.
+ *
+ *     It decides how long to wait before the next attempt from the policy
+ *     chosen in transactional_splinterdb_config, and from what it sees on the
+ *     calling thread: how many attempts already failed, how many of the
+ *     recent transactions aborted, and how many times the current one has
+ *     been retried. transaction.c tells it about every commit and abort.
+ */
+
+#pragma once
+
+#include "platform.h"
+#include "splinterdb/transaction.h"
+
+// The default shortest wait. 1us is the value the TicToc paper uses.
+#define TRANSACTION_CONTENTION_MIN_WAIT_NS (1000)
+#define TRANSACTION_CONTENTION_MAX_WAIT_NS (1000 * 1000)
+
+// The abort rate is kept in fixed point, out of this
+#define TRANSACTION_CONTENTION_RATE_ONE (1024)
+
+// Every transaction moves the abort rate by 1/2^this of the way to 0 or to
+// TRANSACTION_CONTENTION_RATE_ONE
+#define TRANSACTION_CONTENTION_RATE_SHIFT (3)
+
+typedef struct transaction_contention_thread {
+   uint64 seed;            // for jitter
+   uint64 abort_rate;      // out of TRANSACTION_CONTENTION_RATE_ONE
+   uint64 retries;         // aborts since the last commit of the thread
+   uint64 read_wait_start; // when the current read found its tuple locked
+   transaction_contention_stats stats;
+} PLATFORM_CACHELINE_ALIGNED transaction_contention_thread;
+
+typedef struct transaction_contention {
+   transaction_contention_policy policy;
+   uint64                        min_wait_ns;
+   uint64                        max_wait_ns;
+   transaction_read_wait_policy  read_wait_policy;
+   uint64                        read_wait_spins;
+   transaction_contention_thread threads[MAX_THREADS];
+} transaction_contention;
+
+void
+transaction_contention_init(transaction_contention       *cm,
+                            transaction_contention_policy policy,
+                            uint64                        min_wait_ns,
+                            uint64                        max_wait_ns);
+
+/*
+ * Returns how long to wait before retrying a lock that has already been
+ * tried attempt times (starting from 0), and counts the wait.
+ */
+uint64
+transaction_contention_wait_ns(transaction_contention *cm, uint64 attempt);
+
+/*
+ * Waits before retrying a lock, see transaction_contention_wait_ns().
+ */
+static inline void
+transaction_contention_backoff(transaction_contention *cm, uint64 attempt)
+{
+   platform_sleep_ns(transaction_contention_wait_ns(cm, attempt));
+}
+
+/*
+ * Sets what reads do when they find their tuple locked. init() leaves
+ * TRANSACTION_READ_WAIT_DEFAULT.
+ */
+void
+transaction_contention_set_read_wait(transaction_contention      *cm,
+                                     transaction_read_wait_policy policy,
+                                     uint64                       spins);
+
+/*
+ * Called by a read that found its tuple locked attempt times in a row
+ * (starting from 0), before it looks again. Spins or yields as the read wait
+ * policy says, and returns FALSE if the read should abort its transaction
+ * instead.
+ */
+bool
+transaction_contention_wait_locked_read(transaction_contention *cm,
+                                        uint64                  attempt);
+
+/*
+ * Called by a read that waited for its tuple once it got it, to count how
+ * long it waited.
+ */
+void
+transaction_contention_end_locked_read(transaction_contention *cm);
+
+void
+transaction_contention_on_commit(transaction_contention *cm);
+
+void
+transaction_contention_on_abort(transaction_contention *cm);
+
+void
+transaction_contention_get_stats(const transaction_contention *cm,
+                                 threadid                      tid,
+                                 transaction_contention_stats *stats);
+
+void
+transaction_contention_reset_stats(transaction_contention *cm);
@@ -0,0 +1,106 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "transaction_histogram.h"
+#include "poison.h"
+
+void
+transaction_phase_stats_init(transaction_phase_stats *ps, bool enabled)
+{
+   ZERO_CONTENTS(ps);
+   ps->enabled = enabled;
+}
+
+void
+transaction_phase_stats_enable(transaction_phase_stats *ps, bool enable)
+{
+   __atomic_store_n(&ps->enabled, enable, __ATOMIC_RELAXED);
+}
+
+uint64
+transaction_histogram_bucket_min(uint64 bucket)
+{
+   uint64 group = bucket >> TRANSACTION_HISTOGRAM_SUB_BITS;
+   uint64 sub   = bucket & ((1ULL << TRANSACTION_HISTOGRAM_SUB_BITS) - 1);
+   if (group == 0) {
+      return sub;
+   }
+   return ((1ULL << TRANSACTION_HISTOGRAM_SUB_BITS) + sub) << (group - 1);
+}
+
+void
+transaction_histogram_merge(transaction_histogram       *dst,
+                            const transaction_histogram *src)
+{
+   for (uint64 i = 0; i < TRANSACTION_HISTOGRAM_BUCKETS; i++) {
+      dst->buckets[i] += __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+   }
+   dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+   dst->sum_ns += __atomic_load_n(&src->sum_ns, __ATOMIC_RELAXED);
+   dst->max_ns =
+      MAX(dst->max_ns, __atomic_load_n(&src->max_ns, __ATOMIC_RELAXED));
+}
+
+/*
+ * The count may be ahead of or behind the buckets while the histogram is
+ * recorded into, so this goes by the buckets alone.
+ */
+uint64
+transaction_histogram_percentile(const transaction_histogram *hist,
+                                 double                       percentile)
+{
+   uint64 count = 0;
+   for (uint64 i = 0; i < TRANSACTION_HISTOGRAM_BUCKETS; i++) {
+      count += hist->buckets[i];
+   }
+   if (count == 0) {
+      return 0;
+   }
+
+   uint64 rank = (uint64)(percentile / 100 * count + 0.5);
+   rank        = MAX(rank, 1);
+   uint64 seen = 0;
+   for (uint64 i = 0; i < TRANSACTION_HISTOGRAM_BUCKETS - 1; i++) {
+      seen += hist->buckets[i];
+      if (seen >= rank) {
+         uint64 max = transaction_histogram_bucket_min(i + 1) - 1;
+         return hist->max_ns ? MIN(max, hist->max_ns) : max;
+      }
+   }
+   return hist->max_ns;
+}
+
+void
+transaction_phase_stats_get(const transaction_phase_stats *ps,
+                            transaction_phase              phase,
+                            transaction_histogram         *hist)
+{
+   ZERO_CONTENTS(hist);
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      transaction_histogram_merge(hist, &ps->threads[tid].phases[phase]);
+   }
+}
+
+void
+transaction_phase_stats_reset(transaction_phase_stats *ps)
+{
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      ZERO_ARRAY(ps->threads[tid].phases);
+   }
+}
+
+static const char *transaction_phase_names[] = {
+   [TRANSACTION_PHASE_EXECUTION]  = "execution",
+   [TRANSACTION_PHASE_VALIDATION] = "validation",
+   [TRANSACTION_PHASE_WRITE]      = "write",
+   [TRANSACTION_PHASE_ABORT]      = "abort",
+};
+
+const char *
+transaction_phase_name(transaction_phase phase)
+{
+   if (TRANSACTION_PHASE_MAX_VALID <= phase) {
+      return "invalid";
+   }
+   return transaction_phase_names[phase];
+}
@@ -0,0 +1,93 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_histogram.h --
+ *
+ *     Times the phases of transactions into log-linear histograms, one set
+ *     per thread, so that recording a duration is a couple of increments on
+ *     a cache line of the thread. Readers add the histograms of all threads
+ *     up without stopping them, and may miss the durations being recorded.
+ *
+ *     transaction.c stamps the transaction at begin, commit and abort, and
+ *     transaction_write_batch_init() stamps the start of the writes.
+ */
+
+#pragma once
+
+#include "platform.h"
+#include "splinterdb/transaction.h"
+
+typedef struct transaction_phase_thread {
+   transaction_histogram phases[TRANSACTION_PHASE_MAX_VALID];
+} PLATFORM_CACHELINE_ALIGNED transaction_phase_thread;
+
+typedef struct transaction_phase_stats {
+   bool                     enabled;
+   transaction_phase_thread threads[MAX_THREADS];
+} transaction_phase_stats;
+
+void
+transaction_phase_stats_init(transaction_phase_stats *ps, bool enabled);
+
+static inline uint64
+transaction_histogram_bucket(uint64 ns)
+{
+   if (ns < (1ULL << TRANSACTION_HISTOGRAM_SUB_BITS)) {
+      return ns;
+   }
+   uint64 log = 63 - __builtin_clzll(ns);
+   if (log >= TRANSACTION_HISTOGRAM_MAX_BITS) {
+      return TRANSACTION_HISTOGRAM_BUCKETS - 1;
+   }
+   uint64 shift = log - TRANSACTION_HISTOGRAM_SUB_BITS;
+   uint64 mask  = (1ULL << TRANSACTION_HISTOGRAM_SUB_BITS) - 1;
+   uint64 sub   = (ns >> shift) & mask;
+   return ((shift + 1) << TRANSACTION_HISTOGRAM_SUB_BITS) | sub;
+}
+
+// The smallest duration that goes into bucket
+uint64
+transaction_histogram_bucket_min(uint64 bucket);
+
+static inline void
+transaction_histogram_record(transaction_histogram *hist, uint64 ns)
+{
+   hist->buckets[transaction_histogram_bucket(ns)]++;
+   hist->count++;
+   hist->sum_ns += ns;
+   hist->max_ns = MAX(hist->max_ns, ns);
+}
+
+/*
+ * Adds src to dst. src may be recorded into at the same time.
+ */
+void
+transaction_histogram_merge(transaction_histogram       *dst,
+                            const transaction_histogram *src);
+
+static inline bool
+transaction_phase_stats_enabled(const transaction_phase_stats *ps)
+{
+   return __atomic_load_n(&ps->enabled, __ATOMIC_RELAXED);
+}
+
+void
+transaction_phase_stats_enable(transaction_phase_stats *ps, bool enable);
+
+static inline void
+transaction_phase_stats_record(transaction_phase_stats *ps,
+                               transaction_phase        phase,
+                               uint64                   ns)
+{
+   transaction_histogram_record(&ps->threads[platform_get_tid()].phases[phase],
+                                ns);
+}
+
+void
+transaction_phase_stats_get(const transaction_phase_stats *ps,
+                            transaction_phase              phase,
+                            transaction_histogram         *hist);
+
+void
+transaction_phase_stats_reset(transaction_phase_stats *ps);
@@ -0,0 +1,105 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "transaction_hotness.h"
+#include "poison.h"
+
+/*
+ * A counter of the sketch holds the epoch it was last counted in, in its
+ * upper 64 bits, and the count in that epoch, in the lower ones.
+ */
+static inline ValueType
+hotness_counter(uint64 epoch, uint64 count)
+{
+   return ((ValueType)epoch << 64) | count;
+}
+
+static inline uint64
+hotness_counter_epoch(ValueType counter)
+{
+   return (uint64)(counter >> 64);
+}
+
+// The count of counter, halved once for every epoch it is behind epoch
+static inline uint64
+hotness_counter_decay(ValueType counter, uint64 epoch)
+{
+   uint64 count   = (uint64)counter;
+   uint64 counted = hotness_counter_epoch(counter);
+   if (epoch <= counted) {
+      return count;
+   }
+   return epoch - counted < 64 ? count >> (epoch - counted) : 0;
+}
+
+static void
+hotness_insert_value(ValueType *current_value, ValueType new_value)
+{
+   uint64 epoch = MAX(hotness_counter_epoch(*current_value),
+                      hotness_counter_epoch(new_value));
+   *current_value =
+      hotness_counter(epoch,
+                      hotness_counter_decay(*current_value, epoch)
+                         + hotness_counter_decay(new_value, epoch));
+}
+
+static void
+hotness_get_value(ValueType current_value, ValueType *new_value)
+{
+   uint64 epoch = MAX(hotness_counter_epoch(current_value),
+                      hotness_counter_epoch(*new_value));
+   *new_value = hotness_counter(
+      epoch,
+      MIN(hotness_counter_decay(current_value, epoch),
+          hotness_counter_decay(*new_value, epoch)));
+}
+
+static inline uint64
+hotness_epoch(const transaction_hotness *h)
+{
+   return platform_get_timestamp() / h->epoch_ns;
+}
+
+void
+transaction_hotness_init(transaction_hotness *h, uint64 threshold)
+{
+   ZERO_CONTENTS(h);
+   h->threshold = threshold;
+   h->epoch_ns  = TRANSACTION_HOTNESS_EPOCH_NS;
+   if (!transaction_hotness_enabled(h)) {
+      return;
+   }
+
+   sketch_config_default_init(&h->cfg);
+   h->cfg.rows            = TRANSACTION_HOTNESS_ROWS;
+   h->cfg.cols            = TRANSACTION_HOTNESS_COLS;
+   h->cfg.insert_value_fn = &hotness_insert_value;
+   h->cfg.get_value_fn    = &hotness_get_value;
+   sketch_init(&h->cfg, &h->sktch);
+}
+
+void
+transaction_hotness_deinit(transaction_hotness *h)
+{
+   if (transaction_hotness_enabled(h)) {
+      sketch_deinit(&h->sktch);
+   }
+   ZERO_CONTENTS(h);
+}
+
+void
+transaction_hotness_note_conflict(transaction_hotness *h, slice key)
+{
+   if (transaction_hotness_enabled(h)) {
+      sketch_insert(&h->sktch, key, hotness_counter(hotness_epoch(h), 1));
+   }
+}
+
+uint64
+transaction_hotness_conflicts(transaction_hotness *h, slice key)
+{
+   if (!transaction_hotness_enabled(h)) {
+      return 0;
+   }
+   return hotness_counter_decay(sketch_get(&h->sktch, key), hotness_epoch(h));
+}
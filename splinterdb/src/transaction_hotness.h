@@ -0,0 +1,117 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_hotness.h --
+ *
+ *     Tells the optimistic protocols which keys to read under a lock.
+ *
+ *     Every read that fails validation counts as a conflict on its key, in a
+ *     count-min sketch (isketch/sketch.h) that halves its counts every
+ *     TRANSACTION_HOTNESS_EPOCH_NS. A key whose count reaches the threshold
+ *     of transactional_splinterdb_config.hot_lock_threshold is hot: TicToc
+ *     and Silo lock its tuple when they read it, and keep it locked until
+ *     the transaction finishes, so that the read cannot fail validation. The
+ *     other keys stay optimistic.
+ *
+ *     Since such locks are held across reads, transactions may wait for each
+ *     other in a cycle, so no lock is waited for more than
+ *     TRANSACTION_HOTNESS_LOCK_ATTEMPTS times while hot keys are locked.
+ */
+
+#pragma once
+
+#include "platform.h"
+#include "transaction_contention.h"
+#include "isketch/sketch.h"
+
+#define TRANSACTION_HOTNESS_ROWS (2)
+#define TRANSACTION_HOTNESS_COLS (4096)
+
+// How often the conflict counts halve
+#define TRANSACTION_HOTNESS_EPOCH_NS (10 * 1000 * 1000)
+
+// Tries of a lock before giving up on it, while hot keys are locked
+#define TRANSACTION_HOTNESS_LOCK_ATTEMPTS (64)
+
+typedef struct transaction_hotness {
+   uint64        threshold; // 0 if disabled
+   uint64        epoch_ns;
+   sketch_config cfg;
+   sketch        sktch;
+} transaction_hotness;
+
+/*
+ * Sets up h for threshold conflicts. A threshold of 0 disables it, and
+ * allocates nothing.
+ */
+void
+transaction_hotness_init(transaction_hotness *h, uint64 threshold);
+
+void
+transaction_hotness_deinit(transaction_hotness *h);
+
+static inline bool
+transaction_hotness_enabled(const transaction_hotness *h)
+{
+   return h->threshold != 0;
+}
+
+/*
+ * Counts a conflict on key, if h is enabled.
+ */
+void
+transaction_hotness_note_conflict(transaction_hotness *h, slice key);
+
+/*
+ * Returns the conflicts on key counted so far, decayed to now. It may count
+ * the conflicts of other keys too, never fewer than those of key.
+ */
+uint64
+transaction_hotness_conflicts(transaction_hotness *h, slice key);
+
+/*
+ * Whether reads of key should lock it. Always FALSE if h is disabled.
+ */
+static inline bool
+transaction_hotness_is_hot(transaction_hotness *h, slice key)
+{
+   return transaction_hotness_enabled(h)
+          && transaction_hotness_conflicts(h, key) >= h->threshold;
+}
+
+/*
+ * Waits before trying a lock again, like transaction_contention_backoff(),
+ * unless it has already been tried TRANSACTION_HOTNESS_LOCK_ATTEMPTS times,
+ * in which case it returns FALSE and the caller must give up on the lock.
+ */
+static inline bool
+transaction_hotness_backoff(transaction_contention *cm, uint64 attempt)
+{
+   if (attempt >= TRANSACTION_HOTNESS_LOCK_ATTEMPTS) {
+      return FALSE;
+   }
+   transaction_contention_backoff(cm, attempt);
+   return TRUE;
+}
+
+/*
+ * What a read does when it finds its tuple locked, in place of
+ * transaction_contention_wait_locked_read(). While h is enabled, the lock
+ * may be held by a transaction that waits for one of the caller, so the read
+ * gives up past TRANSACTION_HOTNESS_LOCK_ATTEMPTS attempts more than the
+ * spins of the read wait policy.
+ */
+static inline bool
+transaction_hotness_wait_locked_read(const transaction_hotness *h,
+                                     transaction_contention    *cm,
+                                     uint64                     attempt)
+{
+   if (transaction_hotness_enabled(h)
+       && attempt >= cm->read_wait_spins + TRANSACTION_HOTNESS_LOCK_ATTEMPTS)
+   {
+      transaction_contention_end_locked_read(cm);
+      return FALSE;
+   }
+   return transaction_contention_wait_locked_read(cm, attempt);
+}
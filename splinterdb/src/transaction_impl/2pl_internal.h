@@ -5,24 +5,22 @@
 #include "data_internal.h"
 #include "splinterdb/transaction.h"
 #include "util.h"
+#include "transaction_internal.h"
 #include "experimental_mode.h"
 #include "splinterdb_internal.h"
 #include "isketch/iceberg_table.h"
 #include "lock_table_rw.h"
 
-typedef struct transactional_splinterdb_config {
-   splinterdb_config           kvsb_cfg;
-   transaction_isolation_level isol_level;
-} transactional_splinterdb_config;
-
-typedef struct transactional_splinterdb {
+typedef struct two_phase_locking_splinterdb {
+   transactional_splinterdb         super;
    splinterdb                      *kvsb;
    transactional_splinterdb_config *tcfg;
    lock_table_rw                   *lock_tbl;
-} transactional_splinterdb;
+} two_phase_locking_splinterdb;
 
 typedef struct rw_entry {
    slice       key;
    message     msg; // value + op
-   lock_entry *le;
+   lock_entry *le;   // in the lock table, once txn tried to lock key
+   lock_held   held; // what txn holds of the lock of key
 } rw_entry;
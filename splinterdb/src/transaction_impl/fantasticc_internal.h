@@ -2,25 +2,20 @@
 
 #include "platform.h"
 #include "data_internal.h"
-#include "splinterdb/transaction.h"
+#include "transaction_internal.h"
 #include "util.h"
 #include "experimental_mode.h"
 #include "splinterdb_internal.h"
 #include "isketch/iceberg_table.h"
 #include "lock_table.h"
 
-typedef struct transactional_splinterdb_config {
-   splinterdb_config           kvsb_cfg;
-   transaction_isolation_level isol_level;
-   uint64                      tscache_log_slots;
-} transactional_splinterdb_config;
-
-typedef struct transactional_splinterdb {
+typedef struct silo_splinterdb {
+   transactional_splinterdb         super;
    splinterdb                      *kvsb;
    transactional_splinterdb_config *tcfg;
    lock_table                      *lock_tbl;
    iceberg_table                   *tscache;
-} transactional_splinterdb;
+} silo_splinterdb;
 
 // This causes a lot of delta overflow with tictoc
 /* typedef struct timestamp_set { */
@@ -43,18 +38,15 @@ typedef struct rw_entry {
    txn_timestamp  rts;
    timestamp_set *tuple_ts;
    char           is_read;
-   char           need_to_keep_key;
    char           is_locked;
+   char           is_hot; // read under its lock, which is still held
 } rw_entry;
 
 static inline txn_timestamp
 timestamp_set_get_rts(timestamp_set *ts)
 {
-#if EXPERIMENTAL_MODE_SILO == 1
+   // Silo does not extend the read timestamp of a tuple
    return ts->wts;
-#else
-   return ts->wts + ts->delta;
-#endif
 }
 
 static inline void
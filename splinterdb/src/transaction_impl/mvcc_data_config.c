@@ -0,0 +1,161 @@
+#include "transactional_data_config.h"
+#include "data_internal.h"
+#include "mvcc_internal.h"
+#include <string.h>
+#include "poison.h"
+
+/*
+ * Rewrites chain into out. The versions that no snapshot at or after the gc
+ * horizon can see are dropped, and the chain is truncated to fit in
+ * max_chain_size. Every version holds a whole value (see mvcc_version), so
+ * the chain can be cut anywhere.
+ *
+ * Unless is_final, older versions of the key may lie below chain. out only
+ * hides them once it holds a version at or before the horizon.
+ */
+static void
+rewrite_chain(const mvcc_data_config *cfg,
+              slice                   chain,
+              bool                    is_final,
+              merge_accumulator      *out)
+{
+   mvcc_timestamp horizon = __atomic_load_n(cfg->gc_horizon, __ATOMIC_ACQUIRE);
+
+   // Every snapshot sees the newest version at or before the horizon, or
+   // something newer, so nothing older is needed. Nothing is left below a
+   // truncated version.
+   const mvcc_version *start       = slice_data(chain);
+   const mvcc_version *end         = mvcc_chain_end(chain);
+   const mvcc_version *version     = start;
+   uint64              num_kept    = 0;
+   bool                is_complete = FALSE;
+   while (!is_complete && version < end) {
+      is_complete =
+         version->ts <= horizon || mvcc_version_is_truncated(version);
+      num_kept++;
+      version = mvcc_version_next(version);
+   }
+   platform_assert(num_kept > 0);
+   uint64 length = (const char *)version - (const char *)start;
+
+   // If that is still too long, keep the newest versions that fit, and a
+   // truncated version for the others
+   bool is_truncated = FALSE;
+   if (length > cfg->max_chain_size) {
+      uint64 max_length = cfg->max_chain_size - sizeof(mvcc_version);
+      uint64 num_fit    = 0;
+      version           = start;
+      while ((const char *)mvcc_version_next(version) - (const char *)start
+             <= max_length)
+      {
+         num_fit++;
+         version = mvcc_version_next(version);
+      }
+      if (num_fit > 0) {
+         num_kept     = num_fit;
+         length       = (const char *)version - (const char *)start;
+         is_truncated = TRUE;
+         is_complete  = TRUE;
+      }
+   }
+
+   if (num_kept == 1 && start->ts <= horizon
+       && start->class == MESSAGE_TYPE_DELETE)
+   {
+      // The key is deleted for every snapshot
+      merge_accumulator_resize(out, 0);
+      merge_accumulator_set_class(out, MESSAGE_TYPE_DELETE);
+      return;
+   }
+
+   // out may hold chain, the versions kept are its prefix
+   merge_accumulator_resize(
+      out, length + (is_truncated ? sizeof(mvcc_version) : 0));
+   memmove(merge_accumulator_data(out), start, length);
+   if (is_truncated) {
+      mvcc_version *truncated =
+         (mvcc_version *)((char *)merge_accumulator_data(out) + length);
+      truncated->ts     = 0;
+      truncated->length = 0;
+      truncated->class  = MESSAGE_TYPE_INVALID;
+   }
+   merge_accumulator_set_class(out,
+                               is_final || is_complete ? MESSAGE_TYPE_INSERT
+                                                       : MESSAGE_TYPE_UPDATE);
+}
+
+static int
+merge_mvcc_chain(const data_config *cfg,
+                 slice              key,         // IN
+                 message            old_message, // IN
+                 merge_accumulator *new_message) // IN/OUT
+{
+   // The versions of new_message are newer, so they go first
+   merge_accumulator chain;
+   merge_accumulator_init_from_message(
+      &chain,
+      new_message->data.heap_id,
+      merge_accumulator_to_message(new_message));
+   uint64 new_length = merge_accumulator_length(new_message);
+   merge_accumulator_resize(&chain, new_length + message_length(old_message));
+   memcpy((char *)merge_accumulator_data(&chain) + new_length,
+          message_data(old_message),
+          message_length(old_message));
+
+   rewrite_chain((const mvcc_data_config *)cfg,
+                 merge_accumulator_to_slice(&chain),
+                 FALSE,
+                 new_message);
+
+   merge_accumulator_deinit(&chain);
+   return 0;
+}
+
+static int
+merge_mvcc_chain_final(const data_config *cfg,
+                       slice              key,
+                       merge_accumulator *oldest_message)
+{
+   rewrite_chain((const mvcc_data_config *)cfg,
+                 merge_accumulator_to_slice(oldest_message),
+                 TRUE,
+                 oldest_message);
+   return 0;
+}
+
+void
+mvcc_data_config_collect(const data_config *cfg, merge_accumulator *chain)
+{
+   rewrite_chain((const mvcc_data_config *)cfg,
+                 merge_accumulator_to_slice(chain),
+                 TRUE,
+                 chain);
+}
+
+// MVCC_TS_BOUND_KEY goes first, the application orders the other keys
+static int
+mvcc_key_compare(const data_config *cfg, slice key1, slice key2)
+{
+   if (mvcc_key_is_reserved(key1) || mvcc_key_is_reserved(key2)) {
+      return (int)mvcc_key_is_reserved(key2) - (int)mvcc_key_is_reserved(key1);
+   }
+   const data_config *app_cfg =
+      ((const transactional_data_config *)cfg)->application_data_config;
+   return app_cfg->key_compare(app_cfg, key1, key2);
+}
+
+void
+mvcc_data_config_init(data_config      *in_cfg,         // IN
+                      const uint64     *gc_horizon,     // IN
+                      uint64            max_chain_size, // IN
+                      mvcc_data_config *out_cfg         // OUT
+)
+{
+   memcpy(&out_cfg->super.super, in_cfg, sizeof(out_cfg->super.super));
+   out_cfg->super.super.key_compare        = mvcc_key_compare;
+   out_cfg->super.super.merge_tuples       = merge_mvcc_chain;
+   out_cfg->super.super.merge_tuples_final = merge_mvcc_chain_final;
+   out_cfg->super.application_data_config  = in_cfg;
+   out_cfg->gc_horizon                     = gc_horizon;
+   out_cfg->max_chain_size                 = max_chain_size;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "platform.h"
+#include "data_internal.h"
+#include "transaction_internal.h"
+#include "util.h"
+#include "splinterdb_internal.h"
+#include "lock_table.h"
+#include "transactional_data_config.h"
+
+// Commit timestamps of mvcc. Every version keeps the timestamp of the
+// transaction that wrote it, so they must not wrap around.
+typedef uint64 mvcc_timestamp;
+
+// The snapshot of a thread that is not running a transaction
+#define MVCC_NO_SNAPSHOT UINT64_MAX
+
+/*
+ * Holds a bound on the commit timestamps handed out, so that a database
+ * opened again resumes past it. Its value is a chain with one version at the
+ * bound. It is the empty key, which mvcc_data_config sorts before every other
+ * key, and which applications may not use.
+ */
+#define MVCC_TS_BOUND_KEY slice_create(0, "")
+
+static inline bool
+mvcc_key_is_reserved(slice key)
+{
+   return slice_length(key) == 0;
+}
+
+/*
+ * The value of a key in splinterdb is its chain of versions, newest first.
+ * Each version is this header followed by length bytes: the whole value of
+ * an INSERT, or nothing for a DELETE. A commit applies its updates to the
+ * newest version of their key, so no version depends on an older one.
+ *
+ * A chain must fit in a splinterdb message, so the oldest versions of a long
+ * chain are replaced with a single truncated version, at timestamp 0 and of
+ * class MESSAGE_TYPE_INVALID. The snapshots that land on it are too old.
+ */
+typedef struct ONDISK mvcc_version {
+   mvcc_timestamp ts;
+   uint32         length;
+   uint8          class; // message_type
+   char           value[];
+} mvcc_version;
+
+typedef struct mvcc_data_config {
+   transactional_data_config super;
+   // Versions that no snapshot at or after this timestamp can see are
+   // dropped whenever splinterdb merges the messages of a key.
+   const uint64 *gc_horizon;
+   // Chains are truncated to fit in this many bytes
+   uint64 max_chain_size;
+} mvcc_data_config;
+
+typedef struct mvcc_splinterdb {
+   transactional_splinterdb         super;
+   splinterdb                      *kvsb;
+   transactional_splinterdb_config *tcfg;
+   mvcc_data_config                *txn_data_cfg;
+   lock_table                      *lock_tbl;
+
+   // The last commit timestamp handed out
+   cache_aligned_uint64 last_commit_ts;
+   // Every commit up to this timestamp is installed. New snapshots are taken
+   // here.
+   cache_aligned_uint64 visible_ts;
+   // No running transaction reads at a snapshot older than this
+   cache_aligned_uint64 gc_horizon;
+   // No commit timestamp past this is handed out before it is persisted at
+   // MVCC_TS_BOUND_KEY
+   cache_aligned_uint64 ts_bound;
+   // Set while a sweep runs, see mvcc_sweep(). Each one starts at the
+   // cursor, where the one before stopped.
+   cache_aligned_uint64 is_sweeping;
+   key_buffer           sweep_cursor;
+   // The oldest snapshot of the transactions running on each thread, which
+   // stays until they have all finished
+   cache_aligned_uint64 active_snapshot[MAX_THREADS];
+   // How many transactions are running on each thread
+   cache_aligned_uint64 num_active_txns[MAX_THREADS];
+} mvcc_splinterdb;
+
+// read_set and write_set entry stored locally. Reads are not validated, so
+// only writes get one.
+typedef struct rw_entry {
+   slice   key;
+   message msg; // value + op, as given by the application
+   char    is_locked;
+} rw_entry;
+
+static inline const mvcc_version *
+mvcc_version_next(const mvcc_version *version)
+{
+   return (const mvcc_version *)(version->value + version->length);
+}
+
+static inline const mvcc_version *
+mvcc_chain_end(slice chain)
+{
+   return (const mvcc_version *)((const char *)slice_data(chain)
+                                 + slice_length(chain));
+}
+
+static inline bool
+mvcc_version_is_truncated(const mvcc_version *version)
+{
+   return version->class == MESSAGE_TYPE_INVALID;
+}
+
+/*
+ * Returns the newest version of chain committed at or before snapshot, or
+ * NULL if there is none.
+ */
+static inline const mvcc_version *
+mvcc_chain_find(slice chain, mvcc_timestamp snapshot)
+{
+   const mvcc_version *version = slice_data(chain);
+   const mvcc_version *end     = mvcc_chain_end(chain);
+   while (version < end && version->ts > snapshot) {
+      version = mvcc_version_next(version);
+   }
+   return version < end ? version : NULL;
+}
+
+/*
+ * Returns whether rewriting chain would drop versions that no snapshot at or
+ * after horizon can see.
+ */
+static inline bool
+mvcc_chain_is_collectable(slice chain, mvcc_timestamp horizon)
+{
+   const mvcc_version *version = mvcc_chain_find(chain, horizon);
+   if (version == NULL || mvcc_version_is_truncated(version)) {
+      return FALSE;
+   }
+   return mvcc_version_next(version) < mvcc_chain_end(chain)
+          || (version == slice_data(chain)
+              && version->class == MESSAGE_TYPE_DELETE);
+}
+
+// Drops the versions of chain that no snapshot can see anymore
+void
+mvcc_data_config_collect(const data_config *cfg,  // IN
+                         merge_accumulator *chain // IN/OUT
+);
+
+void
+mvcc_data_config_init(data_config      *in_cfg,         // IN
+                      const uint64     *gc_horizon,     // IN
+                      uint64            max_chain_size, // IN
+                      mvcc_data_config *out_cfg         // OUT
+);
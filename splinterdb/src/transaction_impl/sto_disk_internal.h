@@ -2,21 +2,17 @@
 
 #include "../experimental_mode.h"
 #include "splinterdb_internal.h"
-#include "splinterdb/transaction.h"
+#include "../transaction_internal.h"
 #include "../lock_table.h"
 #include "../transactional_data_config.h"
 
-typedef struct transactional_splinterdb_config {
-   splinterdb_config           kvsb_cfg;
-   transaction_isolation_level isol_level;
-   transactional_data_config  *txn_data_cfg;
-} transactional_splinterdb_config;
-
-typedef struct transactional_splinterdb {
+typedef struct sto_disk_splinterdb {
+   transactional_splinterdb         super;
    splinterdb                      *kvsb;
    transactional_splinterdb_config *tcfg;
+   transactional_data_config       *txn_data_cfg;
    lock_table                      *lock_tbl;
-} transactional_splinterdb;
+} sto_disk_splinterdb;
 
 #define TIMESTAMP_UPDATE_MAGIC 0xdeadbeef
 #define TIMESTAMP_UPDATE_RTS (1 << 0)
@@ -26,17 +22,18 @@ typedef struct transactional_splinterdb {
 typedef struct ONDISK timestamp_set {
    uint32 magic; // to indicate valid timestamp update. The size is 32bits to align.
    uint32 type;  // to indicate which timestamp is updated. The size is 32bits to align.
-   txn_timestamp wts;
-   txn_timestamp rts;
+   txn_disk_timestamp wts;
+   txn_disk_timestamp rts;
 } timestamp_set __attribute__((aligned(64)));
 
 typedef struct rw_entry {
-   slice         key;
-   message       msg; // value + op
-   txn_timestamp wts;
-   txn_timestamp rts;
-   char          is_read;
-   char          is_locked;
+   slice              key;
+   message            msg; // value + op
+   txn_disk_timestamp wts;
+   txn_disk_timestamp rts;
+   char               is_read;
+   char               is_locked;
+   char               is_scanned; // Its rts is extended at commit
 } rw_entry;
 
 typedef struct ONDISK tuple_header {
@@ -0,0 +1,161 @@
+#include "transactional_data_config.h"
+#include "data_internal.h"
+#include "tictoc_disk_internal.h"
+#include <string.h>
+#include "poison.h"
+
+static inline bool
+is_message_rts_update(message msg)
+{
+   return message_length(msg) == sizeof(txn_disk_timestamp);
+}
+
+static inline bool
+is_merge_accumulator_rts_update(merge_accumulator *ma)
+{
+   return merge_accumulator_length(ma) == sizeof(txn_disk_timestamp);
+}
+
+static inline message
+get_app_value_from_message(message msg)
+{
+   return message_create(
+      message_class(msg),
+      slice_create(message_length(msg) - sizeof(tuple_header),
+                   message_data(msg) + sizeof(tuple_header)));
+}
+
+static inline message
+get_app_value_from_merge_accumulator(merge_accumulator *ma)
+{
+   return message_create(
+      merge_accumulator_message_class(ma),
+      slice_create(merge_accumulator_length(ma) - sizeof(tuple_header),
+                   merge_accumulator_data(ma) + sizeof(tuple_header)));
+}
+
+/*
+ * Commits give every tuple they write a wts of at least 1, except for
+ * commutative updates, which leave it 0 to keep the timestamps of the tuple
+ * they apply to.
+ */
+static inline bool
+is_commutative_update(const tuple_header *tuple)
+{
+   return tuple->ts.wts == 0;
+}
+
+static int
+merge_tictoc_tuple(const data_config *cfg,
+                   slice              key,         // IN
+                   message            old_message, // IN
+                   merge_accumulator *new_message) // IN/OUT
+{
+   if (is_message_rts_update(old_message)) {
+      if (!is_merge_accumulator_rts_update(new_message)) {
+         // Keep the rts for the tuple a commutative update applies to
+         tuple_header *new_tuple =
+            (tuple_header *)merge_accumulator_data(new_message);
+         if (is_commutative_update(new_tuple)) {
+            txn_disk_timestamp old_rts =
+               *((txn_disk_timestamp *)message_data(old_message));
+            new_tuple->ts.rts = MAX(new_tuple->ts.rts, old_rts);
+         }
+      }
+      // Otherwise, just discard
+      return 0;
+   }
+
+   if (is_merge_accumulator_rts_update(new_message)) {
+      txn_disk_timestamp new_rts =
+         *((txn_disk_timestamp *)merge_accumulator_data(new_message));
+      merge_accumulator_copy_message(new_message, old_message);
+      tuple_header *new_tuple =
+         (tuple_header *)merge_accumulator_data(new_message);
+      new_tuple->ts.rts = new_rts;
+
+      return 0;
+   }
+
+   message old_value_message = get_app_value_from_message(old_message);
+   message new_value_message =
+      get_app_value_from_merge_accumulator(new_message);
+
+   merge_accumulator new_value_ma;
+   merge_accumulator_init_from_message(
+      &new_value_ma,
+      new_message->data.heap_id,
+      new_value_message); // FIXME: use a correct heap_id
+
+   data_merge_tuples(
+      ((const transactional_data_config *)cfg)->application_data_config,
+      key_create_from_slice(key),
+      old_value_message,
+      &new_value_ma);
+
+   merge_accumulator_resize(new_message,
+                            sizeof(tuple_header)
+                               + merge_accumulator_length(&new_value_ma));
+
+   tuple_header *new_tuple = merge_accumulator_data(new_message);
+   memcpy(&new_tuple->value,
+          merge_accumulator_data(&new_value_ma),
+          merge_accumulator_length(&new_value_ma));
+   if (is_commutative_update(new_tuple)) {
+      const tuple_header *old_tuple =
+         (const tuple_header *)message_data(old_message);
+      new_tuple->ts.wts = old_tuple->ts.wts;
+      new_tuple->ts.rts = MAX(new_tuple->ts.rts, old_tuple->ts.rts);
+   }
+
+   merge_accumulator_deinit(&new_value_ma);
+
+   merge_accumulator_set_class(new_message, message_class(old_message));
+
+   return 0;
+}
+
+static int
+merge_tictoc_tuple_final(const data_config *cfg,
+                         slice              key,
+                         merge_accumulator *oldest_message)
+{
+   platform_assert(!is_merge_accumulator_rts_update(oldest_message),
+                   "oldest_message shouldn't be a rts update\n");
+
+   message oldest_message_value =
+      get_app_value_from_merge_accumulator(oldest_message);
+   merge_accumulator app_oldest_message;
+   merge_accumulator_init_from_message(
+      &app_oldest_message,
+      app_oldest_message.data.heap_id, // FIXME: use a correct heap id
+      oldest_message_value);
+
+   data_merge_tuples_final(
+      ((const transactional_data_config *)cfg)->application_data_config,
+      key_create_from_slice(key),
+      &app_oldest_message);
+
+   merge_accumulator_resize(oldest_message,
+                            sizeof(tuple_header)
+                               + merge_accumulator_length(&app_oldest_message));
+   tuple_header *tuple = merge_accumulator_data(oldest_message);
+   memcpy(&tuple->value,
+          merge_accumulator_data(&app_oldest_message),
+          merge_accumulator_length(&app_oldest_message));
+
+   merge_accumulator_deinit(&app_oldest_message);
+
+   return 0;
+}
+
+void
+tictoc_disk_data_config_init(data_config               *in_cfg, // IN
+                             transactional_data_config *out_cfg // OUT
+)
+{
+   memcpy(&out_cfg->super, in_cfg, sizeof(out_cfg->super));
+   out_cfg->super.merge_tuples       = merge_tictoc_tuple;
+   out_cfg->super.merge_tuples_final = merge_tictoc_tuple_final;
+   out_cfg->application_data_config  = in_cfg;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "platform.h"
+#include "transaction_internal.h"
+
+typedef struct {
+   txn_timestamp lock_bit : 1;
+   txn_timestamp wts : 63;
+   txn_timestamp delta : 64;
+} timestamp_set __attribute__((aligned(sizeof(txn_timestamp))));
+
+/*
+ * The layout of the TicToc paper, used instead of timestamp_set in the
+ * timestamp cache with transactional_splinterdb_config.compact_timestamps,
+ * so that locks, validations and write-backs swap 8 bytes rather than 16.
+ * The timestamps are still handled as timestamp_sets, which the loads and
+ * swaps of transaction_tictoc_memory.c convert from and to.
+ *
+ * When an rts is extended past what delta holds, wts is moved up by the
+ * excess instead, as in the delta-shift of the paper (see
+ * timestamp_set_extend()). The tuple then looks written later than it was,
+ * which only makes the transactions that read the older wts fail
+ * validation.
+ */
+typedef struct {
+   uint64 lock_bit : 1;
+   uint64 delta : 15;
+   uint64 wts : 48;
+} compact_timestamp_set __attribute__((aligned(sizeof(uint64))));
+
+_Static_assert(sizeof(compact_timestamp_set) == sizeof(uint64),
+               "compact_timestamp_set must fit in one word");
+
+#define COMPACT_TIMESTAMP_MAX_DELTA ((1ULL << 15) - 1)
+#define COMPACT_TIMESTAMP_MAX_WTS   ((1ULL << 48) - 1)
+
+static inline timestamp_set
+compact_timestamp_set_decode(compact_timestamp_set c)
+{
+   return (timestamp_set){
+      .lock_bit = c.lock_bit, .wts = c.wts, .delta = c.delta};
+}
+
+static inline compact_timestamp_set
+compact_timestamp_set_encode(const timestamp_set *ts)
+{
+   platform_assert(ts->wts <= COMPACT_TIMESTAMP_MAX_WTS,
+                   "Timestamps ran out of the compact layout");
+   debug_assert(ts->delta <= COMPACT_TIMESTAMP_MAX_DELTA);
+   return (compact_timestamp_set){
+      .lock_bit = ts->lock_bit, .delta = ts->delta, .wts = ts->wts};
+}
+
+static inline txn_timestamp
+timestamp_set_get_rts(const timestamp_set *ts)
+{
+   return ts->wts + ts->delta;
+}
+
+/*
+ * Extends the rts of ts to rts. With compact_ts, wts is moved up by what the
+ * delta cannot hold, and no more, so that the delta ends up full.
+ */
+static inline void
+timestamp_set_extend(timestamp_set *ts, txn_timestamp rts, bool compact_ts)
+{
+   txn_timestamp delta = rts - ts->wts;
+   if (compact_ts && delta > COMPACT_TIMESTAMP_MAX_DELTA) {
+      ts->wts += delta - COMPACT_TIMESTAMP_MAX_DELTA;
+      delta = COMPACT_TIMESTAMP_MAX_DELTA;
+   }
+   ts->delta = delta;
+}
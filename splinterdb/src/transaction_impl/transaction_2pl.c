@@ -0,0 +1,533 @@
+#include "2pl_internal.h"
+#include "poison.h"
+
+/*
+ * Implementation of the 2Phase-Locking(2PL). It uses a lock_table that
+ * implements three deadlock prevention mechanisms, and deadlock detection
+ * (see lock_table_rw.h).
+ */
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   return new_entry;
+}
+
+/*
+ * The msg is the msg from app.
+ */
+static inline void
+rw_entry_set_msg(rw_entry *e, message msg, transaction_arena *arena)
+{
+   e->msg = transaction_arena_copy_message(arena, msg);
+}
+
+static inline bool
+rw_entry_is_write(const rw_entry *entry)
+{
+   return !message_is_null(entry->msg);
+}
+
+// Only a commutative update leaves its key unlocked, until its transaction
+// reads the key or replaces the update
+static inline bool
+rw_entry_is_locked(const rw_entry *entry)
+{
+   return entry->held != LOCK_HELD_NONE;
+}
+
+static inline rw_entry *
+rw_entry_get(two_phase_locking_splinterdb *txn_kvsb,
+             transaction                  *txn,
+             slice                         user_key,
+             const data_config            *cfg,
+             const bool                    is_read)
+{
+   rw_entry *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry      = rw_entry_create(txn);
+      entry->key = transaction_arena_copy_slice(txn->arena, user_key);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+   }
+
+   return entry;
+}
+
+
+static void
+two_phase_locking_close(two_phase_locking_splinterdb *_txn_kvsb)
+{
+   lock_table_rw_destroy(_txn_kvsb->lock_tbl);
+
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+two_phase_locking_register_thread(two_phase_locking_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+two_phase_locking_deregister_thread(two_phase_locking_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+two_phase_locking_begin(two_phase_locking_splinterdb *txn_kvsb,
+                        transaction                  *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+   txn->ts = transaction_timestamp_next(&txn_kvsb->super.timestamps);
+   return 0;
+}
+
+static inline void
+transaction_deinit(two_phase_locking_splinterdb *txn_kvsb, transaction *txn)
+{
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+   }
+}
+
+static int
+two_phase_locking_abort(two_phase_locking_splinterdb *txn_kvsb,
+                        transaction                  *txn);
+
+// The lock of key was busy, txn was wounded while it waited for it, or it
+// waited for it in a cycle
+static void
+two_phase_locking_note_busy(two_phase_locking_splinterdb *txn_kvsb,
+                            transaction                  *txn,
+                            slice                         key,
+                            lock_table_rw_rc              rc)
+{
+   transaction_abort_reason reason = TRANSACTION_ABORT_LOCK_BUSY;
+   if (rc == LOCK_TABLE_RW_RC_DEADLK) {
+      reason = TRANSACTION_ABORT_DEADLOCK;
+   } else if (txn->wounded) {
+      reason = TRANSACTION_ABORT_WOUNDED;
+   }
+   transaction_abort_profile_note(&txn_kvsb->super.aborts, reason, key);
+}
+
+// Takes the write lock of entry, or aborts txn if it is busy
+static int
+two_phase_locking_lock_write(two_phase_locking_splinterdb *txn_kvsb,
+                             transaction                  *txn,
+                             rw_entry                     *entry)
+{
+   // TODO: generate a transaction id to use as the unique lock request id
+   lock_table_rw_rc rc = lock_table_rw_try_acquire_entry_lock(
+      txn_kvsb->lock_tbl, entry, WRITE_LOCK, txn);
+   if (rc != LOCK_TABLE_RW_RC_OK) {
+      two_phase_locking_note_busy(txn_kvsb, txn, entry->key, rc);
+      two_phase_locking_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+   return 0;
+}
+
+static int
+two_phase_locking_commit(two_phase_locking_splinterdb *txn_kvsb,
+                         transaction                  *txn)
+{
+   if (!transaction_validate_scans(&txn_kvsb->super, txn)) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_PHANTOM, NULL_SLICE);
+      two_phase_locking_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+
+   // update the DB
+   transaction_write_batch batch;
+   transaction_write_batch_init(&batch, txn, txn->num_rw_entries);
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (rw_entry_is_write(entry)) {
+         transaction_write_batch_add(&batch, entry->key, entry->msg);
+      }
+   }
+   int rc = 0;
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+   rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+#endif
+
+   // unlock all entries
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (entry->le) {
+         lock_table_rw_release_entry_lock(txn_kvsb->lock_tbl, entry, txn);
+      }
+   }
+
+   transaction_deinit(txn_kvsb, txn);
+
+   return rc;
+}
+
+static int
+two_phase_locking_abort(two_phase_locking_splinterdb *txn_kvsb,
+                        transaction                  *txn)
+{
+   // unlock all entries that are locked so far
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (entry->le) {
+         lock_table_rw_release_entry_lock(txn_kvsb->lock_tbl, entry, txn);
+      }
+   }
+
+   transaction_deinit(txn_kvsb, txn);
+
+   return 0;
+}
+
+static int
+local_write(two_phase_locking_splinterdb *txn_kvsb,
+            transaction                  *txn,
+            slice                         user_key,
+            message                       msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, FALSE);
+   /* if (message_class(msg) == MESSAGE_TYPE_UPDATE */
+   /*     || message_class(msg) == MESSAGE_TYPE_DELETE) */
+   /* { */
+   /*    rw_entry_iceberg_insert(txn_kvsb, entry); */
+   /*    timestamp_set v = *entry->tuple_ts; */
+   /*    entry->wts      = v.wts; */
+   /*    entry->rts      = timestamp_set_get_rts(&v); */
+   /* } */
+
+   if (!rw_entry_is_write(entry)) {
+      // A key txn read before is locked, and so is not only updated
+      bool is_commutative = transaction_is_commutative_update(
+         &txn_kvsb->super, rw_entry_is_locked(entry), msg);
+      if (!is_commutative && two_phase_locking_lock_write(txn_kvsb, txn, entry))
+      {
+         return TRANSACTION_ABORTED;
+      }
+      rw_entry_set_msg(entry, msg, txn->arena);
+   } else {
+      // TODO it needs to be checked later for upsert
+      key       wkey = key_create_from_slice(entry->key);
+      const key ukey = key_create_from_slice(user_key);
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         if (message_is_definitive(msg)) {
+            if (!rw_entry_is_locked(entry)
+                && two_phase_locking_lock_write(txn_kvsb, txn, entry))
+            {
+               return TRANSACTION_ABORTED;
+            }
+            rw_entry_set_msg(entry, msg, txn->arena);
+         } else {
+            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
+            merge_accumulator new_message;
+            merge_accumulator_init_from_message(&new_message, 0, msg);
+            data_merge_tuples(cfg, ukey, entry->msg, &new_message);
+            entry->msg = transaction_arena_copy_message(
+               txn->arena, merge_accumulator_to_message(&new_message));
+            merge_accumulator_deinit(&new_message);
+         }
+      }
+   }
+   return 0;
+}
+
+static int
+two_phase_locking_insert(two_phase_locking_splinterdb *txn_kvsb,
+                         transaction                  *txn,
+                         slice                         user_key,
+                         slice                         value)
+{
+   if (!txn) {
+      return splinterdb_insert(txn_kvsb->kvsb, user_key, value);
+   }
+
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+two_phase_locking_delete(two_phase_locking_splinterdb *txn_kvsb,
+                         transaction                  *txn,
+                         slice                         user_key)
+{
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+two_phase_locking_update(two_phase_locking_splinterdb *txn_kvsb,
+                         transaction                  *txn,
+                         slice                         user_key,
+                         slice                         delta)
+{
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+static int
+two_phase_locking_lookup(two_phase_locking_splinterdb *txn_kvsb,
+                         transaction                  *txn,
+                         slice                         user_key,
+                         splinterdb_lookup_result     *result)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+
+   int rc = 0;
+
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+   if (rw_entry_is_write(entry)) {
+      // A commutative update takes the write lock once txn reads its key
+      if (!rw_entry_is_locked(entry)
+          && two_phase_locking_lock_write(txn_kvsb, txn, entry))
+      {
+         return TRANSACTION_ABORTED;
+      }
+      // read my write. txn holds the write lock of the key, so an update of
+      // txn reads the value it applies to without taking the read lock.
+      // TODO if it was an insert or a delete, this read should not be
+      // considered for validation. entry->is_read should be false.
+      if (!message_is_definitive(entry->msg)) {
+         rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+      }
+      if (rc == 0) {
+         _splinterdb_lookup_result *_result =
+            (_splinterdb_lookup_result *)result;
+         transaction_read_own_write(
+            cfg, entry->key, entry->msg, &_result->value);
+      }
+   } else {
+      // TODO: generate a transaction id to use as the unique lock request id
+      lock_table_rw_rc lock_rc = lock_table_rw_try_acquire_entry_lock(
+         txn_kvsb->lock_tbl, entry, READ_LOCK, txn);
+      if (lock_rc != LOCK_TABLE_RW_RC_OK) {
+         two_phase_locking_note_busy(txn_kvsb, txn, entry->key, lock_rc);
+         two_phase_locking_abort(txn_kvsb, txn);
+         return TRANSACTION_ABORTED;
+      }
+      rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+   }
+#endif
+   return rc;
+}
+
+static void
+two_phase_locking_lookup_result_init(
+   two_phase_locking_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+two_phase_locking_set_isolation_level(two_phase_locking_splinterdb *txn_kvsb,
+                                      transaction_isolation_level   isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+two_phase_locking_get_db(two_phase_locking_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+two_phase_locking_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   two_phase_locking_close(_txn_kvsb);
+}
+
+static void
+two_phase_locking_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   two_phase_locking_register_thread(_txn_kvsb);
+}
+
+static void
+two_phase_locking_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   two_phase_locking_deregister_thread(_txn_kvsb);
+}
+
+static int
+two_phase_locking_begin_virtual(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_begin(_txn_kvsb, txn);
+}
+
+static int
+two_phase_locking_commit_virtual(transactional_splinterdb *txn_kvsb,
+                                 transaction              *txn)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_commit(_txn_kvsb, txn);
+}
+
+static int
+two_phase_locking_abort_virtual(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_abort(_txn_kvsb, txn);
+}
+
+static int
+two_phase_locking_insert_virtual(transactional_splinterdb *txn_kvsb,
+                                 transaction              *txn,
+                                 slice                     user_key,
+                                 slice                     value)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+two_phase_locking_delete_virtual(transactional_splinterdb *txn_kvsb,
+                                 transaction              *txn,
+                                 slice                     user_key)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+two_phase_locking_update_virtual(transactional_splinterdb *txn_kvsb,
+                                 transaction              *txn,
+                                 slice                     user_key,
+                                 slice                     delta)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+two_phase_locking_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                                 transaction              *txn,
+                                 slice                     user_key,
+                                 splinterdb_lookup_result *result)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+two_phase_locking_lookup_result_init_virtual(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_lookup_result *result,
+   uint64                    buffer_len,
+   char                     *buffer)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   two_phase_locking_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+two_phase_locking_set_isolation_level_virtual(
+   transactional_splinterdb   *txn_kvsb,
+   transaction_isolation_level isol_level)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   two_phase_locking_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+two_phase_locking_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   two_phase_locking_splinterdb *_txn_kvsb = (two_phase_locking_splinterdb *)txn_kvsb;
+   return two_phase_locking_get_db(_txn_kvsb);
+}
+
+static lock_table_rw_policy
+two_phase_locking_policy(transaction_protocol protocol)
+{
+   switch (protocol) {
+      case TRANSACTION_PROTOCOL_2PL_NO_WAIT:
+         return LOCK_TABLE_RW_POLICY_NO_WAIT;
+      case TRANSACTION_PROTOCOL_2PL_WAIT_DIE:
+         return LOCK_TABLE_RW_POLICY_WAIT_DIE;
+      case TRANSACTION_PROTOCOL_2PL_WOUND_WAIT:
+         return LOCK_TABLE_RW_POLICY_WOUND_WAIT;
+      case TRANSACTION_PROTOCOL_2PL_DETECT:
+         return LOCK_TABLE_RW_POLICY_DETECT;
+      default:
+         platform_assert(FALSE, "Not a 2PL protocol: %d", protocol);
+         return LOCK_TABLE_RW_POLICY_NO_WAIT;
+   }
+}
+
+static const transactional_splinterdb_ops two_phase_locking_ops = {
+   .close               = two_phase_locking_close_virtual,
+   .register_thread     = two_phase_locking_register_thread_virtual,
+   .deregister_thread   = two_phase_locking_deregister_thread_virtual,
+   .begin               = two_phase_locking_begin_virtual,
+   .commit              = two_phase_locking_commit_virtual,
+   .abort               = two_phase_locking_abort_virtual,
+   .insert              = two_phase_locking_insert_virtual,
+   .delete              = two_phase_locking_delete_virtual,
+   .update              = two_phase_locking_update_virtual,
+   .lookup              = two_phase_locking_lookup_virtual,
+   .lookup_result_init  = two_phase_locking_lookup_result_init_virtual,
+   .set_isolation_level = two_phase_locking_set_isolation_level_virtual,
+   .get_db              = two_phase_locking_get_db_virtual,
+};
+
+int
+two_phase_locking_create_or_open(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing)
+{
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   two_phase_locking_splinterdb *_txn_kvsb;
+   _txn_kvsb            = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops = &two_phase_locking_ops;
+   _txn_kvsb->tcfg      = txn_splinterdb_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+
+   _txn_kvsb->lock_tbl = lock_table_rw_create(
+      txn_splinterdb_cfg->kvsb_cfg.data_cfg,
+      two_phase_locking_policy(txn_splinterdb_cfg->protocol),
+      &_txn_kvsb->super.contention);
+
+   *txn_kvsb = &_txn_kvsb->super;
+
+   return 0;
+}
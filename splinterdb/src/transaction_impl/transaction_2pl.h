@@ -1,397 +0,0 @@
-#pragma once
-
-#include "2pl_internal.h"
-#include "poison.h"
-
-/*
- * Implementation of the 2Phase-Locking(2PL). It uses a lock_table that
- * implements three deadlock prevention mechanisms (see lock_table_rw.h).
- */
-txn_timestamp global_ts = 0;
-
-static inline txn_timestamp
-get_next_global_ts()
-{
-   return __atomic_add_fetch(&global_ts, 1, __ATOMIC_RELAXED);
-}
-
-static rw_entry *
-rw_entry_create()
-{
-   rw_entry *new_entry;
-   new_entry = TYPED_ZALLOC(0, new_entry);
-   platform_assert(new_entry != NULL);
-   return new_entry;
-}
-
-static inline void
-rw_entry_deinit(rw_entry *entry)
-{
-   if (!message_is_null(entry->msg)) {
-      platform_free_from_heap(0, (void *)message_data(entry->msg));
-   }
-}
-
-/*
- * The msg is the msg from app.
- * In EXPERIMENTAL_MODE_TICTOC_DISK, this function adds timestamps at the begin
- * of the msg
- */
-static inline void
-rw_entry_set_msg(rw_entry *e, message msg)
-{
-   char *msg_buf;
-   msg_buf = TYPED_ARRAY_ZALLOC(0, msg_buf, message_length(msg));
-   memcpy(msg_buf, message_data(msg), message_length(msg));
-   e->msg = message_create(message_class(msg),
-                           slice_create(message_length(msg), msg_buf));
-}
-
-static inline bool
-rw_entry_is_write(const rw_entry *entry)
-{
-   return !message_is_null(entry->msg);
-}
-
-static inline rw_entry *
-rw_entry_get(transactional_splinterdb *txn_kvsb,
-             transaction              *txn,
-             slice                     user_key,
-             const data_config        *cfg,
-             const bool                is_read)
-{
-   bool      need_to_create_new_entry = TRUE;
-   rw_entry *entry                    = NULL;
-   const key ukey                     = key_create_from_slice(user_key);
-   for (int i = 0; i < txn->num_rw_entries; ++i) {
-      entry = txn->rw_entries[i];
-
-      if (data_key_compare(cfg, ukey, key_create_from_slice(entry->key)) == 0) {
-         need_to_create_new_entry = FALSE;
-         break;
-      }
-   }
-
-   if (need_to_create_new_entry) {
-      entry                                  = rw_entry_create();
-      entry->key                             = user_key;
-      txn->rw_entries[txn->num_rw_entries++] = entry;
-   }
-
-   return entry;
-}
-
-static void
-transactional_splinterdb_config_init(
-   transactional_splinterdb_config *txn_splinterdb_cfg,
-   const splinterdb_config         *kvsb_cfg)
-{
-   memcpy(&txn_splinterdb_cfg->kvsb_cfg,
-          kvsb_cfg,
-          sizeof(txn_splinterdb_cfg->kvsb_cfg));
-
-   // TODO things like filename, logfile, or data_cfg would need a
-   // deep-copy
-   txn_splinterdb_cfg->isol_level = TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE;
-}
-
-static int
-transactional_splinterdb_create_or_open(const splinterdb_config   *kvsb_cfg,
-                                        transactional_splinterdb **txn_kvsb,
-                                        bool open_existing)
-{
-   check_experimental_mode_is_valid();
-   print_current_experimental_modes();
-
-   transactional_splinterdb_config *txn_splinterdb_cfg;
-   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
-   transactional_splinterdb_config_init(txn_splinterdb_cfg, kvsb_cfg);
-
-   transactional_splinterdb *_txn_kvsb;
-   _txn_kvsb       = TYPED_ZALLOC(0, _txn_kvsb);
-   _txn_kvsb->tcfg = txn_splinterdb_cfg;
-
-   int rc = splinterdb_create_or_open(
-      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
-   bool fail_to_create_splinterdb = (rc != 0);
-   if (fail_to_create_splinterdb) {
-      platform_free(0, _txn_kvsb);
-      platform_free(0, txn_splinterdb_cfg);
-      return rc;
-   }
-
-   _txn_kvsb->lock_tbl = lock_table_rw_create(kvsb_cfg->data_cfg);
-
-   *txn_kvsb = _txn_kvsb;
-
-   return 0;
-}
-
-int
-transactional_splinterdb_create(const splinterdb_config   *kvsb_cfg,
-                                transactional_splinterdb **txn_kvsb)
-{
-   return transactional_splinterdb_create_or_open(kvsb_cfg, txn_kvsb, FALSE);
-}
-
-
-int
-transactional_splinterdb_open(const splinterdb_config   *kvsb_cfg,
-                              transactional_splinterdb **txn_kvsb)
-{
-   return transactional_splinterdb_create_or_open(kvsb_cfg, txn_kvsb, TRUE);
-}
-
-void
-transactional_splinterdb_close(transactional_splinterdb **txn_kvsb)
-{
-   transactional_splinterdb *_txn_kvsb = *txn_kvsb;
-   lock_table_rw_destroy(_txn_kvsb->lock_tbl);
-
-   splinterdb_close(&_txn_kvsb->kvsb);
-
-   platform_free(0, _txn_kvsb->tcfg);
-   platform_free(0, _txn_kvsb);
-
-   *txn_kvsb = NULL;
-}
-
-void
-transactional_splinterdb_register_thread(transactional_splinterdb *kvs)
-{
-   splinterdb_register_thread(kvs->kvsb);
-}
-
-void
-transactional_splinterdb_deregister_thread(transactional_splinterdb *kvs)
-{
-   splinterdb_deregister_thread(kvs->kvsb);
-}
-
-int
-transactional_splinterdb_begin(transactional_splinterdb *txn_kvsb,
-                               transaction              *txn)
-{
-   platform_assert(txn);
-   memset(txn, 0, sizeof(*txn));
-   txn->ts = get_next_global_ts();
-   return 0;
-}
-
-static inline void
-transaction_deinit(transactional_splinterdb *txn_kvsb, transaction *txn)
-{
-   for (int i = 0; i < txn->num_rw_entries; ++i) {
-      rw_entry_deinit(txn->rw_entries[i]);
-      platform_free(0, txn->rw_entries[i]);
-   }
-}
-
-int
-transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
-                                transaction              *txn)
-{
-   // update the DB and unlock all entries
-   for (int i = 0; i < txn->num_rw_entries; ++i) {
-      rw_entry *entry = txn->rw_entries[i];
-      if (rw_entry_is_write(entry)) {
-#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 1
-         if (0) {
-#endif
-            int rc = 0;
-            switch (message_class(entry->msg)) {
-               case MESSAGE_TYPE_INSERT:
-                  rc = splinterdb_insert(
-                     txn_kvsb->kvsb, entry->key, message_slice(entry->msg));
-                  break;
-               case MESSAGE_TYPE_UPDATE:
-                  rc = splinterdb_update(
-                     txn_kvsb->kvsb, entry->key, message_slice(entry->msg));
-                  break;
-               case MESSAGE_TYPE_DELETE:
-                  rc = splinterdb_delete(txn_kvsb->kvsb, entry->key);
-                  break;
-               default:
-                  break;
-            }
-            platform_assert(rc == 0, "Error from SplinterDB: %d\n", rc);
-#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 1
-         }
-#endif
-         lock_table_rw_release_entry_lock(
-            txn_kvsb->lock_tbl, entry, WRITE_LOCK, txn);
-      } else {
-         lock_table_rw_release_entry_lock(
-            txn_kvsb->lock_tbl, entry, READ_LOCK, txn);
-      }
-   }
-
-   transaction_deinit(txn_kvsb, txn);
-
-   return 0;
-}
-
-int
-transactional_splinterdb_abort(transactional_splinterdb *txn_kvsb,
-                               transaction              *txn)
-{
-   // unlock all entries that are locked so far
-   for (int i = 0; i < txn->num_rw_entries; ++i) {
-      rw_entry *entry = txn->rw_entries[i];
-      if (rw_entry_is_write(entry)) {
-         lock_table_rw_release_entry_lock(
-            txn_kvsb->lock_tbl, entry, WRITE_LOCK, txn);
-      } else {
-         lock_table_rw_release_entry_lock(
-            txn_kvsb->lock_tbl, entry, READ_LOCK, txn);
-      }
-   }
-
-   transaction_deinit(txn_kvsb, txn);
-
-   return 0;
-}
-
-static int
-local_write(transactional_splinterdb *txn_kvsb,
-            transaction              *txn,
-            slice                     user_key,
-            message                   msg)
-{
-   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
-   char              *user_key_copy;
-   user_key_copy = TYPED_ARRAY_ZALLOC(0, user_key_copy, slice_length(user_key));
-   rw_entry *entry = rw_entry_get(
-      txn_kvsb, txn, slice_copy_contents(user_key_copy, user_key), cfg, FALSE);
-   /* if (message_class(msg) == MESSAGE_TYPE_UPDATE */
-   /*     || message_class(msg) == MESSAGE_TYPE_DELETE) */
-   /* { */
-   /*    rw_entry_iceberg_insert(txn_kvsb, entry); */
-   /*    timestamp_set v = *entry->tuple_ts; */
-   /*    entry->wts      = v.wts; */
-   /*    entry->rts      = timestamp_set_get_rts(&v); */
-   /* } */
-
-   if (!rw_entry_is_write(entry)) {
-      // TODO: generate a transaction id to use as the unique lock request id
-      if (lock_table_rw_try_acquire_entry_lock(
-             txn_kvsb->lock_tbl, entry, WRITE_LOCK, txn)
-          == LOCK_TABLE_RW_RC_BUSY)
-      {
-         transactional_splinterdb_abort(txn_kvsb, txn);
-         return 1;
-      }
-      rw_entry_set_msg(entry, msg);
-   } else {
-      // TODO it needs to be checked later for upsert
-      key       wkey = key_create_from_slice(entry->key);
-      const key ukey = key_create_from_slice(user_key);
-      if (data_key_compare(cfg, wkey, ukey) == 0) {
-         if (message_is_definitive(msg)) {
-            platform_free_from_heap(0, (void *)message_data(entry->msg));
-            rw_entry_set_msg(entry, msg);
-         } else {
-            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
-            merge_accumulator new_message;
-            merge_accumulator_init_from_message(&new_message, 0, msg);
-            data_merge_tuples(cfg, ukey, entry->msg, &new_message);
-            platform_free_from_heap(0, (void *)message_data(entry->msg));
-            entry->msg = merge_accumulator_to_message(&new_message);
-         }
-      }
-   }
-   return 0;
-}
-
-int
-transactional_splinterdb_insert(transactional_splinterdb *txn_kvsb,
-                                transaction              *txn,
-                                slice                     user_key,
-                                slice                     value)
-{
-   if (!txn) {
-      return splinterdb_insert(txn_kvsb->kvsb, user_key, value);
-   }
-
-   return local_write(
-      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
-}
-
-int
-transactional_splinterdb_delete(transactional_splinterdb *txn_kvsb,
-                                transaction              *txn,
-                                slice                     user_key)
-{
-   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
-}
-
-int
-transactional_splinterdb_update(transactional_splinterdb *txn_kvsb,
-                                transaction              *txn,
-                                slice                     user_key,
-                                slice                     delta)
-{
-   return local_write(
-      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
-}
-
-int
-transactional_splinterdb_lookup(transactional_splinterdb *txn_kvsb,
-                                transaction              *txn,
-                                slice                     user_key,
-                                splinterdb_lookup_result *result)
-{
-   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
-   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
-
-   int rc = 0;
-
-#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
-   if (rw_entry_is_write(entry)) {
-      // read my write
-      // TODO This works for simple insert/update. However, it doesn't work
-      // for upsert.
-      // TODO if it succeeded, this read should not be considered for
-      // validation. entry->is_read should be false.
-      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
-      merge_accumulator_resize(&_result->value, message_length(entry->msg));
-      memcpy(merge_accumulator_data(&_result->value),
-             message_data(entry->msg),
-             message_length(entry->msg));
-   } else {
-      // TODO: generate a transaction id to use as the unique lock request id
-      if (lock_table_rw_try_acquire_entry_lock(
-             txn_kvsb->lock_tbl, entry, READ_LOCK, txn)
-          == LOCK_TABLE_RW_RC_BUSY)
-      {
-         transactional_splinterdb_abort(txn_kvsb, txn);
-         return 1;
-      }
-      rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
-   }
-#endif
-   return rc;
-}
-
-void
-transactional_splinterdb_lookup_result_init(
-   transactional_splinterdb *txn_kvsb,   // IN
-   splinterdb_lookup_result *result,     // IN/OUT
-   uint64                    buffer_len, // IN
-   char                     *buffer      // IN
-)
-{
-   return splinterdb_lookup_result_init(
-      txn_kvsb->kvsb, result, buffer_len, buffer);
-}
-
-void
-transactional_splinterdb_set_isolation_level(
-   transactional_splinterdb   *txn_kvsb,
-   transaction_isolation_level isol_level)
-{
-   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
-   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
-
-   txn_kvsb->tcfg->isol_level = isol_level;
-}
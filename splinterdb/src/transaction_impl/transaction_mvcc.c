@@ -0,0 +1,936 @@
+#include "splinterdb/data.h"
+#include "platform.h"
+#include "data_internal.h"
+#include "util.h"
+#include "btree.h"
+#include "mvcc_internal.h"
+#include "poison.h"
+
+/*
+ * Multi-version concurrency control, providing snapshot isolation.
+ *
+ * Every key keeps the versions committed to it, each tagged with the commit
+ * timestamp of its transaction (see mvcc_version). A transaction reads at
+ * the snapshot of the commits that were visible when it began, so reads
+ * never wait and are never validated. At commit, the write set is locked,
+ * and the transaction aborts if another one committed to a key it writes
+ * after its snapshot (first committer wins). Otherwise it takes the next
+ * commit timestamp and adds a version to each key it writes, with its
+ * updates applied to the newest version of their key.
+ *
+ * Old versions are dropped by the merge functions of mvcc_data_config,
+ * whenever splinterdb merges the messages of a key, once no running
+ * transaction can see them anymore. Keys that are no longer written are
+ * never merged again, so commits also sweep through the database, a few
+ * keys at a time, and rewrite their chains (see mvcc_sweep).
+ *
+ * Unlike textbook snapshot isolation, a read can still abort its
+ * transaction. Garbage collection never drops a version that a running
+ * snapshot needs, since the gc horizon is the oldest active snapshot, but a
+ * chain must fit in a splinterdb message (see mvcc_version). When a key is
+ * written so often that its chain outgrows one, the oldest versions are
+ * truncated, and a transaction whose snapshot lands on them is too old:
+ * its lookup fails, or its scan makes the commit fail.
+ */
+
+// Commits between two updates of the gc horizon
+#define MVCC_GC_INTERVAL 64
+
+// Commit timestamps reserved by each write of MVCC_TS_BOUND_KEY
+#define MVCC_TS_BOUND_INTERVAL (1ULL << 16)
+
+// Keys a sweep looks at, once per MVCC_GC_INTERVAL commits
+#define MVCC_SWEEP_KEYS 16
+
+// Locks key alone, waiting for the commit that holds it
+static void
+mvcc_lock_key(mvcc_splinterdb *txn_kvsb, slice key, char *is_locked)
+{
+   uint64 lock_attempt = 0;
+   while (lock_table_try_acquire_entry_lock(txn_kvsb->lock_tbl, key, is_locked)
+          == LOCK_TABLE_RC_BUSY)
+   {
+      transaction_contention_backoff(&txn_kvsb->super.contention,
+                                     lock_attempt++);
+   }
+}
+
+/*
+ * Returns a snapshot for a new transaction of the calling thread, and
+ * publishes it if the thread has no older one. It is taken again if
+ * visible_ts moves meanwhile, so that a gc horizon computed without it is
+ * never newer than it.
+ */
+static mvcc_timestamp
+mvcc_take_snapshot(mvcc_splinterdb *txn_kvsb)
+{
+   threadid       tid      = platform_get_tid();
+   uint64        *active   = &txn_kvsb->active_snapshot[tid].v;
+   mvcc_timestamp snapshot =
+      __atomic_load_n(&txn_kvsb->visible_ts.v, __ATOMIC_SEQ_CST);
+   if (txn_kvsb->num_active_txns[tid].v++ > 0) {
+      return snapshot;
+   }
+   while (TRUE) {
+      __atomic_store_n(active, snapshot, __ATOMIC_SEQ_CST);
+      mvcc_timestamp visible_ts =
+         __atomic_load_n(&txn_kvsb->visible_ts.v, __ATOMIC_SEQ_CST);
+      if (visible_ts == snapshot) {
+         return snapshot;
+      }
+      snapshot = visible_ts;
+   }
+}
+
+static void
+mvcc_end_snapshot(mvcc_splinterdb *txn_kvsb)
+{
+   threadid tid = platform_get_tid();
+   platform_assert(txn_kvsb->num_active_txns[tid].v > 0);
+   if (--txn_kvsb->num_active_txns[tid].v == 0) {
+      __atomic_store_n(&txn_kvsb->active_snapshot[tid].v,
+                       MVCC_NO_SNAPSHOT,
+                       __ATOMIC_RELEASE);
+   }
+}
+
+static void
+mvcc_advance_gc_horizon(mvcc_splinterdb *txn_kvsb)
+{
+   // visible_ts must be read before the snapshots, see mvcc_take_snapshot()
+   uint64 horizon = __atomic_load_n(&txn_kvsb->visible_ts.v, __ATOMIC_SEQ_CST);
+   for (threadid i = 0; i < MAX_THREADS; i++) {
+      horizon = MIN(horizon,
+                    __atomic_load_n(&txn_kvsb->active_snapshot[i].v,
+                                    __ATOMIC_SEQ_CST));
+   }
+   __atomic_store_n(&txn_kvsb->gc_horizon.v, horizon, __ATOMIC_RELEASE);
+}
+
+/*
+ * Rewrites the chain of key without the versions that no snapshot can see
+ * anymore. A chain is only rewritten when splinterdb merges new versions
+ * into it, so this is what collects the keys that are no longer written.
+ * Keys locked by a commit are skipped, their chain is about to be merged.
+ */
+static void
+mvcc_collect_key(mvcc_splinterdb *txn_kvsb, slice key)
+{
+   char          is_locked = 0;
+   lock_table_rc lock_rc =
+      lock_table_try_acquire_entry_lock(txn_kvsb->lock_tbl, key, &is_locked);
+   if (lock_rc != LOCK_TABLE_RC_OK) {
+      return;
+   }
+
+   const splinterdb        *kvsb = txn_kvsb->kvsb;
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(kvsb, &result, 0, NULL);
+   int rc = splinterdb_lookup(kvsb, key, &result);
+   if (rc == 0 && splinterdb_lookup_found(&result)) {
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)&result;
+      merge_accumulator         *chain   = &_result->value;
+
+      // A write that fails leaves the versions to the next sweep
+      uint64 length = merge_accumulator_length(chain);
+      mvcc_data_config_collect((const data_config *)txn_kvsb->txn_data_cfg,
+                               chain);
+      if (merge_accumulator_message_class(chain) == MESSAGE_TYPE_DELETE) {
+         splinterdb_delete(kvsb, key);
+      } else if (merge_accumulator_length(chain) < length) {
+         splinterdb_insert(kvsb, key, merge_accumulator_to_slice(chain));
+      }
+   }
+   splinterdb_lookup_result_deinit(&result);
+
+   lock_table_release_entry_lock(txn_kvsb->lock_tbl, key, &is_locked);
+}
+
+/*
+ * Looks at the next MVCC_SWEEP_KEYS keys, and collects those whose chains
+ * hold versions older than the gc horizon. Sweeps go round the whole
+ * database, a few keys at a time, and only one runs at once.
+ */
+static void
+mvcc_sweep(mvcc_splinterdb *txn_kvsb)
+{
+   if (__atomic_exchange_n(&txn_kvsb->is_sweeping.v, TRUE, __ATOMIC_ACQUIRE)) {
+      return;
+   }
+   mvcc_timestamp horizon =
+      __atomic_load_n(&txn_kvsb->gc_horizon.v, __ATOMIC_ACQUIRE);
+
+   // Iterators hold locks that writes need, so the keys are collected once
+   // it is gone
+   key_buffer collectable[MVCC_SWEEP_KEYS];
+   uint64     num_collectable = 0;
+   uint64     num_keys        = 0;
+
+   slice cursor = key_slice(key_buffer_key(&txn_kvsb->sweep_cursor));
+   splinterdb_iterator *iter = NULL;
+   int rc = splinterdb_iterator_init(txn_kvsb->kvsb, &iter, cursor);
+   if (rc == 0) {
+      for (; num_keys < MVCC_SWEEP_KEYS && splinterdb_iterator_valid(iter);
+           splinterdb_iterator_next(iter))
+      {
+         slice key, chain;
+         splinterdb_iterator_get_current(iter, &key, &chain);
+         num_keys++;
+         if (!mvcc_key_is_reserved(key)
+             && mvcc_chain_is_collectable(chain, horizon))
+         {
+            key_buffer_init(&collectable[num_collectable], 0);
+            key_buffer_copy_slice(&collectable[num_collectable], key);
+            num_collectable++;
+         }
+         key_buffer_copy_slice(&txn_kvsb->sweep_cursor, key);
+      }
+      splinterdb_iterator_deinit(iter);
+   }
+   if (num_keys < MVCC_SWEEP_KEYS) {
+      // Start over from the first key
+      key_buffer_copy_slice(&txn_kvsb->sweep_cursor, MVCC_TS_BOUND_KEY);
+   }
+
+   for (uint64 i = 0; i < num_collectable; i++) {
+      mvcc_collect_key(txn_kvsb, key_slice(key_buffer_key(&collectable[i])));
+      key_buffer_deinit(&collectable[i]);
+   }
+
+   __atomic_store_n(&txn_kvsb->is_sweeping.v, FALSE, __ATOMIC_RELEASE);
+}
+
+/*
+ * Makes the commit at commit_ts visible to new snapshots. Commits become
+ * visible in timestamp order, so a snapshot sees every commit before it.
+ */
+static void
+mvcc_publish_commit(mvcc_splinterdb *txn_kvsb, mvcc_timestamp commit_ts)
+{
+   while (__atomic_load_n(&txn_kvsb->visible_ts.v, __ATOMIC_ACQUIRE)
+          != commit_ts - 1)
+   {
+      platform_pause();
+   }
+   __atomic_store_n(&txn_kvsb->visible_ts.v, commit_ts, __ATOMIC_SEQ_CST);
+
+   if (commit_ts % MVCC_GC_INTERVAL == 0) {
+      mvcc_advance_gc_horizon(txn_kvsb);
+      mvcc_sweep(txn_kvsb);
+   }
+}
+
+/*
+ * Replaces the chain of versions in value with the value a snapshot at
+ * snapshot sees, or with nothing if the key does not exist there. Returns
+ * FALSE if the versions of that snapshot were truncated away.
+ */
+static bool
+mvcc_select_version(merge_accumulator *value, mvcc_timestamp snapshot)
+{
+   if (merge_accumulator_is_null(value)) {
+      return TRUE;
+   }
+
+   const mvcc_version *version =
+      mvcc_chain_find(merge_accumulator_to_slice(value), snapshot);
+   if (version && mvcc_version_is_truncated(version)) {
+      return FALSE;
+   }
+   if (version == NULL || version->class == MESSAGE_TYPE_DELETE) {
+      merge_accumulator_set_to_null(value);
+      return TRUE;
+   }
+
+   platform_assert(version->class == MESSAGE_TYPE_INSERT);
+   uint32 length = version->length;
+   memmove(merge_accumulator_data(value), version->value, length);
+   merge_accumulator_resize(value, length);
+   merge_accumulator_set_class(value, MESSAGE_TYPE_INSERT);
+   return TRUE;
+}
+
+/*
+ * Returns the commit timestamp of the newest version of the key of w, or 0.
+ * If w is an update, applies it to that version, so that the version w adds
+ * holds a whole value. The key must be locked.
+ */
+static mvcc_timestamp
+mvcc_resolve_write(mvcc_splinterdb *txn_kvsb, transaction *txn, rw_entry *w)
+{
+   const splinterdb *kvsb = txn_kvsb->kvsb;
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(kvsb, &result, 0, NULL);
+
+   splinterdb_lookup(kvsb, w->key, &result);
+
+   mvcc_timestamp ts     = 0;
+   message        newest = DELETE_MESSAGE;
+   if (splinterdb_lookup_found(&result)) {
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)&result;
+      const mvcc_version *version = merge_accumulator_data(&_result->value);
+      platform_assert(!mvcc_version_is_truncated(version));
+      ts     = version->ts;
+      newest = message_create(version->class,
+                              slice_create(version->length, version->value));
+   }
+
+   if (!message_is_definitive(w->msg)) {
+      merge_accumulator resolved;
+      merge_accumulator_init_from_message(&resolved, 0, w->msg);
+      transaction_apply_delta(
+         txn_kvsb->txn_data_cfg->super.application_data_config,
+         w->key,
+         newest,
+         &resolved);
+      w->msg = transaction_arena_copy_message(
+         txn->arena, merge_accumulator_to_message(&resolved));
+      merge_accumulator_deinit(&resolved);
+   }
+
+   splinterdb_lookup_result_deinit(&result);
+   return ts;
+}
+
+/*
+ * Returns the bound persisted at MVCC_TS_BOUND_KEY, or 0 if nothing was ever
+ * committed. Every commit timestamp handed out before is at or below it.
+ */
+static int
+mvcc_read_ts_bound(const splinterdb *kvsb, mvcc_timestamp *bound)
+{
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(kvsb, &result, 0, NULL);
+
+   int rc = splinterdb_lookup(kvsb, MVCC_TS_BOUND_KEY, &result);
+   *bound = 0;
+   if (rc == 0 && splinterdb_lookup_found(&result)) {
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)&result;
+      const mvcc_version *version = merge_accumulator_data(&_result->value);
+      *bound                      = version->ts;
+   }
+
+   splinterdb_lookup_result_deinit(&result);
+   return rc;
+}
+
+/*
+ * Persists a bound past commit_ts at MVCC_TS_BOUND_KEY, before any version at
+ * commit_ts is written, so that a database opened again never hands out a
+ * timestamp that is already in use. The commits that outrun the bound wait
+ * for the one extending it.
+ */
+static int
+mvcc_extend_ts_bound(mvcc_splinterdb *txn_kvsb, mvcc_timestamp commit_ts)
+{
+   slice key       = MVCC_TS_BOUND_KEY;
+   char  is_locked = 0;
+   mvcc_lock_key(txn_kvsb, key, &is_locked);
+
+   int rc = 0;
+   if (commit_ts > __atomic_load_n(&txn_kvsb->ts_bound.v, __ATOMIC_RELAXED)) {
+      mvcc_version bound = {.ts     = commit_ts + MVCC_TS_BOUND_INTERVAL,
+                            .length = 0,
+                            .class  = MESSAGE_TYPE_INSERT};
+      rc                 = splinterdb_insert(
+         txn_kvsb->kvsb, key, slice_create(sizeof(bound), &bound));
+      if (rc == 0) {
+         __atomic_store_n(&txn_kvsb->ts_bound.v, bound.ts, __ATOMIC_RELEASE);
+      }
+   }
+
+   lock_table_release_entry_lock(txn_kvsb->lock_tbl, key, &is_locked);
+   return rc;
+}
+
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   return new_entry;
+}
+
+static int
+rw_entry_key_compare(const void *elem1, const void *elem2, void *args)
+{
+   const data_config *cfg = (const data_config *)args;
+
+   rw_entry *e1 = *((rw_entry **)elem1);
+   rw_entry *e2 = *((rw_entry **)elem2);
+
+   key akey = key_create_from_slice(e1->key);
+   key bkey = key_create_from_slice(e2->key);
+
+   return data_key_compare(cfg, akey, bkey);
+}
+
+// Adds the version of w at commit_ts to batch
+static void
+mvcc_add_version(transaction_write_batch *batch,
+                 transaction             *txn,
+                 rw_entry                *w,
+                 mvcc_timestamp           commit_ts)
+{
+   uint64 length = sizeof(mvcc_version) + message_length(w->msg);
+   char  *buf;
+   buf                   = TYPED_ARENA_ARRAY_MALLOC(txn->arena, buf, length);
+   mvcc_version *version = (mvcc_version *)buf;
+   version->ts           = commit_ts;
+   version->length       = message_length(w->msg);
+   version->class        = message_class(w->msg);
+   memcpy(version->value, message_data(w->msg), version->length);
+
+   transaction_write_batch_add(
+      batch,
+      w->key,
+      message_create(MESSAGE_TYPE_UPDATE, slice_create(length, version)));
+}
+
+static void
+mvcc_close(mvcc_splinterdb *_txn_kvsb)
+{
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   lock_table_destroy(_txn_kvsb->lock_tbl);
+   key_buffer_deinit(&_txn_kvsb->sweep_cursor);
+
+   platform_free(0, _txn_kvsb->txn_data_cfg);
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+mvcc_register_thread(mvcc_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+mvcc_deregister_thread(mvcc_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+mvcc_begin(mvcc_splinterdb *txn_kvsb, transaction *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+   txn->ts = mvcc_take_snapshot(txn_kvsb);
+
+   return 0;
+}
+
+static int
+mvcc_commit(mvcc_splinterdb *txn_kvsb, transaction *txn)
+{
+   if (txn->snapshot_too_old) {
+      // It scanned past keys whose versions of its snapshot are gone
+      transaction_abort_profile_note(&txn_kvsb->super.aborts,
+                                     TRANSACTION_ABORT_SNAPSHOT_TOO_OLD,
+                                     NULL_SLICE);
+      mvcc_end_snapshot(txn_kvsb);
+      return TRANSACTION_ABORTED;
+   }
+
+   // Only writes get an entry, and reads need no validation
+   int num_writes = txn->num_rw_entries;
+   if (num_writes == 0) {
+      mvcc_end_snapshot(txn_kvsb);
+      return 0;
+   }
+
+   // Sort a copy, the order of rw_entries is that of rw_keys
+   rw_entry **write_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, write_set, num_writes);
+   memcpy(write_set, txn->rw_entries, num_writes * sizeof(*write_set));
+
+   platform_sort_slow(write_set,
+                      num_writes,
+                      sizeof(rw_entry *),
+                      rw_entry_key_compare,
+                      (void *)txn_kvsb->tcfg->kvsb_cfg.data_cfg,
+                      NULL);
+
+   uint64 lock_attempt = 0;
+RETRY_LOCK_WRITE_SET:
+{
+   for (int lock_num = 0; lock_num < num_writes; ++lock_num) {
+      lock_table_rc lock_rc =
+         lock_table_try_acquire_entry_lock(txn_kvsb->lock_tbl,
+                                           write_set[lock_num]->key,
+                                           &write_set[lock_num]->is_locked);
+      platform_assert(lock_rc != LOCK_TABLE_RC_DEADLK);
+      if (lock_rc == LOCK_TABLE_RC_BUSY) {
+         for (int i = 0; i < lock_num; ++i) {
+            lock_table_release_entry_lock(
+               txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+         }
+
+         transaction_contention_backoff(&txn_kvsb->super.contention,
+                                        lock_attempt++);
+
+         goto RETRY_LOCK_WRITE_SET;
+      }
+   }
+}
+
+   // First committer wins. Commutative updates apply to whatever version
+   // is last, they only hold the lock to add theirs in commit_ts order.
+   bool is_abort = FALSE;
+   for (int i = 0; !is_abort && i < num_writes; ++i) {
+      bool is_commutative = transaction_is_commutative_update(
+         &txn_kvsb->super, FALSE, write_set[i]->msg);
+      mvcc_timestamp last_ts = mvcc_resolve_write(txn_kvsb, txn, write_set[i]);
+      is_abort               = !is_commutative && last_ts > txn->ts;
+      if (is_abort) {
+         transaction_abort_profile_note(&txn_kvsb->super.aborts,
+                                        TRANSACTION_ABORT_WRITE_CONFLICT,
+                                        write_set[i]->key);
+      }
+   }
+
+   int rc = 0;
+   mvcc_timestamp commit_ts = 0;
+   if (!is_abort) {
+      commit_ts = __atomic_add_fetch(
+         &txn_kvsb->last_commit_ts.v, 1, __ATOMIC_SEQ_CST);
+      if (commit_ts
+          > __atomic_load_n(&txn_kvsb->ts_bound.v, __ATOMIC_ACQUIRE))
+      {
+         rc = mvcc_extend_ts_bound(txn_kvsb, commit_ts);
+      }
+      if (rc == 0) {
+         transaction_write_batch batch;
+         transaction_write_batch_init(&batch, txn, num_writes);
+         for (int i = 0; i < num_writes; ++i) {
+            mvcc_add_version(&batch, txn, write_set[i], commit_ts);
+         }
+         rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+      }
+   }
+
+   for (int i = 0; i < num_writes; ++i) {
+      lock_table_release_entry_lock(
+         txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+   }
+
+   if (!is_abort) {
+      mvcc_publish_commit(txn_kvsb, commit_ts);
+   }
+   mvcc_end_snapshot(txn_kvsb);
+
+   return is_abort ? TRANSACTION_ABORTED : rc;
+}
+
+static int
+mvcc_abort(mvcc_splinterdb *txn_kvsb, transaction *txn)
+{
+   mvcc_end_snapshot(txn_kvsb);
+   return 0;
+}
+
+static int
+local_write(mvcc_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key,
+            message          msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry      = rw_entry_create(txn);
+      entry->key = transaction_arena_copy_slice(txn->arena, user_key);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+      entry->msg = transaction_arena_copy_message(txn->arena, msg);
+      return 0;
+   }
+
+   if (message_is_definitive(msg)) {
+      entry->msg = transaction_arena_copy_message(txn->arena, msg);
+      return 0;
+   }
+
+   merge_accumulator new_message;
+   merge_accumulator_init_from_message(&new_message, 0, msg);
+   transaction_apply_delta(
+      txn_kvsb->txn_data_cfg->super.application_data_config,
+      user_key,
+      entry->msg,
+      &new_message);
+   entry->msg = transaction_arena_copy_message(
+      txn->arena, merge_accumulator_to_message(&new_message));
+   merge_accumulator_deinit(&new_message);
+   return 0;
+}
+
+/*
+ * Writes outside of a transaction replace all the versions of the key with
+ * one that every snapshot sees, as when loading the database.
+ */
+static int
+non_transactional_splinterdb_insert(mvcc_splinterdb *txn_kvsb,
+                                    slice            key,
+                                    slice            value)
+{
+   uint64 length = sizeof(mvcc_version) + slice_length(value);
+   char  *buf;
+   buf                   = TYPED_ARRAY_ZALLOC(0, buf, length);
+   mvcc_version *version = (mvcc_version *)buf;
+   version->length       = slice_length(value);
+   version->class        = MESSAGE_TYPE_INSERT;
+   memcpy(version->value, slice_data(value), version->length);
+
+   // Keeps a sweep from putting back the versions this replaces
+   char is_locked = 0;
+   mvcc_lock_key(txn_kvsb, key, &is_locked);
+   int rc =
+      splinterdb_insert(txn_kvsb->kvsb, key, slice_create(length, version));
+   lock_table_release_entry_lock(txn_kvsb->lock_tbl, key, &is_locked);
+
+   platform_free(0, buf);
+   return rc;
+}
+
+static int
+mvcc_insert(mvcc_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key,
+            slice            value)
+{
+   if (mvcc_key_is_reserved(user_key)) {
+      return EINVAL;
+   }
+   if (!txn) {
+      return non_transactional_splinterdb_insert(txn_kvsb, user_key, value);
+   }
+
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+mvcc_delete(mvcc_splinterdb *txn_kvsb, transaction *txn, slice user_key)
+{
+   if (mvcc_key_is_reserved(user_key)) {
+      return EINVAL;
+   }
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+mvcc_update(mvcc_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key,
+            slice            delta)
+{
+   if (mvcc_key_is_reserved(user_key)) {
+      return EINVAL;
+   }
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+static int
+mvcc_lookup(mvcc_splinterdb          *txn_kvsb,
+            transaction              *txn,
+            slice                     user_key,
+            splinterdb_lookup_result *result)
+{
+   if (mvcc_key_is_reserved(user_key)) {
+      return EINVAL;
+   }
+
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = transaction_find_rw_entry(txn, cfg, user_key);
+
+   const data_config *app_cfg =
+      txn_kvsb->txn_data_cfg->super.application_data_config;
+
+   _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+
+   if (entry && message_is_definitive(entry->msg)) {
+      // read my write
+      transaction_read_own_write(
+         app_cfg, user_key, entry->msg, &_result->value);
+      return 0;
+   }
+
+   int rc = splinterdb_lookup(txn_kvsb->kvsb, user_key, result);
+   if (rc != 0) {
+      // txn is aborted on its way out, which ends its snapshot
+      return rc;
+   }
+   if (!mvcc_select_version(&_result->value, txn->ts)) {
+      // The snapshot of txn is too old to be read anymore
+      transaction_abort_profile_note(&txn_kvsb->super.aborts,
+                                     TRANSACTION_ABORT_SNAPSHOT_TOO_OLD,
+                                     user_key);
+      mvcc_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+
+   if (entry) {
+      // Apply the pending update of txn to what its snapshot sees
+      transaction_read_own_write(
+         app_cfg, user_key, entry->msg, &_result->value);
+   }
+
+   return 0;
+}
+
+static void
+mvcc_lookup_result_init(mvcc_splinterdb          *txn_kvsb,   // IN
+                        splinterdb_lookup_result *result,     // IN/OUT
+                        uint64                    buffer_len, // IN
+                        char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+mvcc_set_isolation_level(mvcc_splinterdb            *txn_kvsb,
+                         transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level == TRANSACTION_ISOLATION_LEVEL_SNAPSHOT,
+                   "mvcc only provides snapshot isolation\n");
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+mvcc_get_db(mvcc_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+static bool
+mvcc_scan_value(mvcc_splinterdb *txn_kvsb,
+                transaction     *txn,
+                slice            key,
+                slice            stored,
+                slice           *value)
+{
+   if (mvcc_key_is_reserved(key)) {
+      return FALSE;
+   }
+
+   const mvcc_version *version = mvcc_chain_find(stored, txn->ts);
+   if (version && mvcc_version_is_truncated(version)) {
+      // Iterators cannot fail, so the transaction aborts at commit instead
+      txn->snapshot_too_old = TRUE;
+      return FALSE;
+   }
+   if (version == NULL || version->class == MESSAGE_TYPE_DELETE) {
+      return FALSE;
+   }
+   *value = slice_create(version->length, version->value);
+   return TRUE;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+mvcc_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   mvcc_close(_txn_kvsb);
+}
+
+static void
+mvcc_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   mvcc_register_thread(_txn_kvsb);
+}
+
+static void
+mvcc_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   mvcc_deregister_thread(_txn_kvsb);
+}
+
+static int
+mvcc_begin_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_begin(_txn_kvsb, txn);
+}
+
+static int
+mvcc_commit_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_commit(_txn_kvsb, txn);
+}
+
+static int
+mvcc_abort_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_abort(_txn_kvsb, txn);
+}
+
+static int
+mvcc_insert_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key,
+                    slice                     value)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+mvcc_delete_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+mvcc_update_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key,
+                    slice                     delta)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+mvcc_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key,
+                    splinterdb_lookup_result *result)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+mvcc_lookup_result_init_virtual(transactional_splinterdb *txn_kvsb,
+                                splinterdb_lookup_result *result,
+                                uint64                    buffer_len,
+                                char                     *buffer)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   mvcc_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+mvcc_set_isolation_level_virtual(transactional_splinterdb   *txn_kvsb,
+                                 transaction_isolation_level isol_level)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   mvcc_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+mvcc_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_get_db(_txn_kvsb);
+}
+
+static bool
+mvcc_scan_value_virtual(transactional_splinterdb *txn_kvsb,
+                        transaction              *txn,
+                        slice                     key,
+                        slice                     stored,
+                        slice                    *value)
+{
+   mvcc_splinterdb *_txn_kvsb = (mvcc_splinterdb *)txn_kvsb;
+   return mvcc_scan_value(_txn_kvsb, txn, key, stored, value);
+}
+
+static const transactional_splinterdb_ops mvcc_ops = {
+   .close               = mvcc_close_virtual,
+   .register_thread     = mvcc_register_thread_virtual,
+   .deregister_thread   = mvcc_deregister_thread_virtual,
+   .begin               = mvcc_begin_virtual,
+   .commit              = mvcc_commit_virtual,
+   .abort               = mvcc_abort_virtual,
+   .insert              = mvcc_insert_virtual,
+   .delete              = mvcc_delete_virtual,
+   .update              = mvcc_update_virtual,
+   .lookup              = mvcc_lookup_virtual,
+   .lookup_result_init  = mvcc_lookup_result_init_virtual,
+   .set_isolation_level = mvcc_set_isolation_level_virtual,
+   .get_db              = mvcc_get_db_virtual,
+   .scan_value          = mvcc_scan_value_virtual,
+};
+
+int
+mvcc_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                    transactional_splinterdb             **txn_kvsb,
+                    bool                                   open_existing)
+{
+   if (txn_kvsb_cfg->isol_level != TRANSACTION_ISOLATION_LEVEL_SNAPSHOT) {
+      platform_error_log("mvcc only provides snapshot isolation\n");
+      return EINVAL;
+   }
+
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   mvcc_splinterdb *_txn_kvsb;
+   _txn_kvsb            = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops = &mvcc_ops;
+   _txn_kvsb->tcfg      = txn_splinterdb_cfg;
+   for (threadid i = 0; i < MAX_THREADS; i++) {
+      _txn_kvsb->active_snapshot[i].v = MVCC_NO_SNAPSHOT;
+   }
+
+   // Larger messages do not fit in the btrees of splinterdb
+   uint64 page_size = txn_kvsb_cfg->kvsb_cfg.page_size;
+   if (page_size == 0) {
+      page_size = LAIO_DEFAULT_PAGE_SIZE;
+   }
+   _txn_kvsb->txn_data_cfg = TYPED_ZALLOC(0, _txn_kvsb->txn_data_cfg);
+   mvcc_data_config_init(txn_kvsb_cfg->kvsb_cfg.data_cfg,
+                         &_txn_kvsb->gc_horizon.v,
+                         MAX_INLINE_MESSAGE_SIZE(page_size),
+                         _txn_kvsb->txn_data_cfg);
+   txn_splinterdb_cfg->kvsb_cfg.data_cfg =
+      (data_config *)_txn_kvsb->txn_data_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   if (rc == 0 && open_existing) {
+      // Resume past every timestamp that may have been handed out
+      mvcc_timestamp last_ts = 0;
+      rc = mvcc_read_ts_bound(_txn_kvsb->kvsb, &last_ts);
+      if (rc != 0) {
+         splinterdb_close(&_txn_kvsb->kvsb);
+      }
+      _txn_kvsb->last_commit_ts.v = last_ts;
+      _txn_kvsb->visible_ts.v     = last_ts;
+      _txn_kvsb->gc_horizon.v     = last_ts;
+      _txn_kvsb->ts_bound.v       = last_ts;
+   }
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb->txn_data_cfg);
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+   _txn_kvsb->lock_tbl = lock_table_create(txn_kvsb_cfg->kvsb_cfg.data_cfg);
+   key_buffer_init(&_txn_kvsb->sweep_cursor, 0);
+   *txn_kvsb           = &_txn_kvsb->super;
+
+   return 0;
+}
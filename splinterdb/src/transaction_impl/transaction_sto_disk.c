@@ -0,0 +1,817 @@
+#include "splinterdb/data.h"
+#include "platform.h"
+#include "data_internal.h"
+#include "util.h"
+#include "sto_disk_internal.h"
+#include "poison.h"
+
+
+/*
+ * Implementation of the classic Strict Timestamp Ordering.
+ * The implementation uses a dirty bit to prevent transactions
+ * from reading uncommitted data.
+ *
+ * The dirty bit is also used a latch to protect against race
+ * conditions that may appear from running multiple threads.
+ */
+
+enum sto_access_rc { STO_ACCESS_OK, STO_ACCESS_BUSY, STO_ACCESS_ABORT };
+
+static void
+get_global_timestamps(sto_disk_splinterdb *txn_kvsb,
+                      rw_entry            *entry,
+                      txn_disk_timestamp       *wts,
+                      txn_disk_timestamp       *rts)
+{
+   const splinterdb *kvsb = txn_kvsb->kvsb;
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(kvsb, &result, 0, NULL);
+
+   splinterdb_lookup(kvsb, entry->key, &result);
+
+   if (splinterdb_lookup_found(&result)) {
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)&result;
+      tuple_header *tuple = merge_accumulator_data(&_result->value);
+      if (wts) {
+         *wts = tuple->ts.wts;
+      }
+      if (rts) {
+         *rts = tuple->ts.rts;
+      }
+   }
+   splinterdb_lookup_result_deinit(&result);
+}
+
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   return new_entry;
+}
+
+static inline void
+rw_entry_set_key(rw_entry *e, slice key, transaction_arena *arena)
+{
+   e->key = transaction_arena_copy_slice(arena, key);
+}
+
+static inline void
+rw_entry_set_msg(rw_entry *e, message msg, transaction_arena *arena)
+{
+   uint64 msg_len = sizeof(tuple_header) + message_length(msg);
+   char  *msg_buf;
+   msg_buf = TYPED_ARENA_ARRAY_MALLOC(arena, msg_buf, msg_len);
+   memset(msg_buf, 0, sizeof(tuple_header));
+   memcpy(
+      msg_buf + sizeof(tuple_header), message_data(msg), message_length(msg));
+   e->msg = message_create(message_class(msg), slice_create(msg_len, msg_buf));
+}
+
+static inline bool
+rw_entry_is_read(const rw_entry *entry)
+{
+   return entry->is_read;
+}
+
+static inline bool
+rw_entry_is_write(const rw_entry *entry)
+{
+   return !message_is_null(entry->msg);
+}
+
+// The write of entry, without the tuple_header in front of its value
+static inline message
+rw_entry_value_msg(const rw_entry *entry)
+{
+   const tuple_header *tuple = (const tuple_header *)message_data(entry->msg);
+   return message_create(
+      message_class(entry->msg),
+      slice_create(message_length(entry->msg) - sizeof(tuple_header),
+                   tuple->value));
+}
+
+/*
+ * Will Set timestamps in entry later
+ */
+static inline rw_entry *
+rw_entry_get(sto_disk_splinterdb *txn_kvsb,
+             transaction         *txn,
+             slice                user_key,
+             const data_config   *cfg,
+             const bool           is_read)
+{
+   rw_entry *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry = rw_entry_create(txn);
+      rw_entry_set_key(entry, user_key, txn->arena);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+   }
+
+   entry->is_read = entry->is_read || is_read;
+   return entry;
+}
+
+static inline void
+rw_entry_unlock(lock_table *lock_tbl,
+                rw_entry   *entry,
+                uint64      UNUSED_PARAM(txn_ts))
+{
+   // platform_default_log("Unlock key = %s, %lu\n", (char*)entry->key.data,
+   // txn_ts);
+   lock_table_release_entry_lock(lock_tbl, entry->key, &entry->is_locked);
+}
+
+static inline enum sto_access_rc
+rw_entry_try_read_lock(sto_disk_splinterdb *txn_spl,
+                       rw_entry            *entry,
+                       uint64               txn_ts)
+{
+   get_global_timestamps(txn_spl, entry, &entry->wts, &entry->rts);
+   if (txn_ts < entry->wts) {
+      // platform_default_log(
+      //    "transaction abort at line %d: txn_ts=%lu, entry->wts=%d\n",
+      //    __LINE__,
+      //    txn_ts,
+      //    entry->wts);
+      return STO_ACCESS_ABORT;
+   }
+   if (lock_table_get_entry_lock_state(txn_spl->lock_tbl, entry->key)
+       == LOCK_TABLE_RC_BUSY)
+   {
+      return STO_ACCESS_BUSY;
+   }
+   if (lock_table_try_acquire_entry_lock(
+          txn_spl->lock_tbl, entry->key, &entry->is_locked)
+       == LOCK_TABLE_RC_OK)
+   {
+      get_global_timestamps(txn_spl, entry, &entry->wts, &entry->rts);
+      if (txn_ts < entry->wts) {
+         // TO rule would be violated so we need to abort
+         rw_entry_unlock(txn_spl->lock_tbl, entry, txn_ts);
+         // platform_default_log(
+         //    "transaction abort at line %d: txn_ts=%lu, entry->wts=%d\n",
+         //    __LINE__,
+         //    txn_ts,
+         //    entry->wts);
+         return STO_ACCESS_ABORT;
+      }
+   } else {
+      return STO_ACCESS_BUSY;
+   }
+   return STO_ACCESS_OK;
+}
+
+static inline enum sto_access_rc
+rw_entry_try_write_lock(sto_disk_splinterdb *txn_spl,
+                        rw_entry            *entry,
+                        uint64               txn_ts)
+{
+   get_global_timestamps(txn_spl, entry, &entry->wts, &entry->rts);
+   // platform_default_log("rw_entry_try_write_lock at line %d: txn_ts=%lu,
+   // entry->wts=%d, entry->rts=%d\n", __LINE__, txn_ts, entry->wts,
+   // entry->rts);
+
+   if (txn_ts < entry->wts || txn_ts < entry->rts) {
+      // TO rule would be violated so we need to abort
+      return STO_ACCESS_ABORT;
+   }
+   if (lock_table_get_entry_lock_state(txn_spl->lock_tbl, entry->key)
+       == LOCK_TABLE_RC_BUSY)
+   {
+      return STO_ACCESS_BUSY;
+   }
+   if (lock_table_try_acquire_entry_lock(
+          txn_spl->lock_tbl, entry->key, &entry->is_locked)
+       == LOCK_TABLE_RC_OK)
+   {
+      get_global_timestamps(txn_spl, entry, &entry->wts, &entry->rts);
+      if (txn_ts < entry->wts || txn_ts < entry->rts) {
+         // TO rule would be violated so we need to abort
+         rw_entry_unlock(txn_spl->lock_tbl, entry, txn_ts);
+         return STO_ACCESS_ABORT;
+      }
+   } else {
+      return STO_ACCESS_BUSY;
+   }
+   return STO_ACCESS_OK;
+}
+
+static inline enum sto_access_rc
+rw_entry_read_lock(sto_disk_splinterdb *txn_spl,
+                   rw_entry            *entry,
+                   uint64               txn_ts)
+{
+   // platform_default_log("Trying to lock key for read at ts = %s, %lu\n",
+   // (char*)entry->key.data, txn_ts);
+   enum sto_access_rc rc;
+   uint64             attempt = 0;
+   do {
+      rc = rw_entry_try_read_lock(txn_spl, entry, txn_ts);
+      if (rc == STO_ACCESS_BUSY) {
+         transaction_contention_backoff(&txn_spl->super.contention, attempt++);
+      }
+   } while (rc == STO_ACCESS_BUSY);
+   return rc;
+}
+
+static inline enum sto_access_rc
+rw_entry_write_lock(sto_disk_splinterdb *txn_spl,
+                    rw_entry            *entry,
+                    uint64               txn_ts)
+{
+   // platform_default_log("Trying to lock key for write = %s, %lu\n",
+   // (char*)entry->key.data, txn_ts);
+   enum sto_access_rc rc;
+   uint64             attempt = 0;
+   do {
+      rc = rw_entry_try_write_lock(txn_spl, entry, txn_ts);
+      if (rc == STO_ACCESS_BUSY) {
+         transaction_contention_backoff(&txn_spl->super.contention, attempt++);
+      }
+   } while (rc == STO_ACCESS_BUSY);
+   return rc;
+}
+
+
+
+static void
+sto_disk_close(sto_disk_splinterdb *_txn_kvsb)
+{
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   lock_table_destroy(_txn_kvsb->lock_tbl);
+
+   platform_free(0, _txn_kvsb->txn_data_cfg);
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+sto_disk_register_thread(sto_disk_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+sto_disk_deregister_thread(sto_disk_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+sto_disk_begin(sto_disk_splinterdb *txn_kvsb, transaction              *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+   txn->ts = transaction_timestamp_next(&txn_kvsb->super.timestamps);
+   // platform_default_log("Starting transaction, ts = %lu\n", txn->ts);
+   return 0;
+}
+
+static int
+sto_disk_abort(sto_disk_splinterdb *txn_kvsb, transaction *txn);
+
+/*
+ * Extends the rts of the keys txn scanned to txn->ts, as lookups do. Returns
+ * FALSE if a later transaction wrote one of them since.
+ */
+static bool
+sto_disk_extend_scanned_rts(sto_disk_splinterdb *txn_kvsb, transaction *txn)
+{
+   for (uint64 i = 0; i < txn->num_rw_entries; i++) {
+      rw_entry *r = txn->rw_entries[i];
+      if (!r->is_scanned) {
+         continue;
+      }
+      if (rw_entry_read_lock(txn_kvsb, r, txn->ts) == STO_ACCESS_ABORT) {
+         transaction_abort_profile_note(
+            &txn_kvsb->super.aborts, TRANSACTION_ABORT_TOO_LATE, r->key);
+         return FALSE;
+      }
+      if (txn->ts > r->rts) {
+         r->rts           = txn->ts;
+         timestamp_set ts = {.magic = TIMESTAMP_UPDATE_MAGIC,
+                             .type  = TIMESTAMP_UPDATE_RTS,
+                             .rts   = r->rts,
+                             .wts   = r->wts};
+         splinterdb_update(
+            txn_kvsb->kvsb, r->key, slice_create(sizeof(ts), &ts));
+      }
+      rw_entry_unlock(txn_kvsb->lock_tbl, r, txn->ts);
+   }
+   return TRUE;
+}
+
+static int
+sto_disk_commit(sto_disk_splinterdb *txn_kvsb, transaction              *txn)
+{
+   if (!sto_disk_extend_scanned_rts(txn_kvsb, txn)) {
+      sto_disk_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+   if (!transaction_validate_scans(&txn_kvsb->super, txn)) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_PHANTOM, NULL_SLICE);
+      sto_disk_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+
+   // update the DB
+   transaction_write_batch batch;
+   transaction_write_batch_init(&batch, txn, txn->num_rw_entries);
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *w = txn->rw_entries[i];
+      if (rw_entry_is_write(w)) {
+         // A commutative update is not locked, and keeps the zero wts
+         // rw_entry_set_msg() gave it to take the timestamps of the tuple
+         // it applies to
+         if (w->is_locked) {
+            timestamp_set ts = {
+               .magic = 0,
+               .type  = 0,
+               .wts   = w->wts,
+               .rts   = w->rts,
+            };
+            tuple_header *msg = (tuple_header *)message_data(w->msg);
+            memcpy(&msg->ts, &ts, sizeof(ts));
+         }
+
+         transaction_write_batch_add(&batch, w->key, w->msg);
+      }
+   }
+   int rc = 0;
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+   rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+#endif
+
+   // unlock all writes
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *w = txn->rw_entries[i];
+      if (w->is_locked) {
+         // w->ts->wts = txn->ts;
+         rw_entry_unlock(txn_kvsb->lock_tbl, w, txn->ts);
+      }
+   }
+
+   return rc;
+}
+
+static int
+sto_disk_abort(sto_disk_splinterdb *txn_kvsb, transaction              *txn)
+{
+   // unlock all writes
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *w = txn->rw_entries[i];
+      if (w->is_locked) {
+         rw_entry_unlock(txn_kvsb->lock_tbl, w, txn->ts);
+      }
+   }
+
+   return 0;
+}
+
+// Takes the write lock of entry for txn, or aborts txn if it is too late
+static int
+sto_disk_lock_write(sto_disk_splinterdb *txn_kvsb,
+                    transaction         *txn,
+                    rw_entry            *entry)
+{
+   if (rw_entry_write_lock(txn_kvsb, entry, txn->ts) == STO_ACCESS_ABORT) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_TOO_LATE, entry->key);
+      sto_disk_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+   // To prevent deadlocks, we have to update the wts
+   entry->wts = txn->ts;
+
+   timestamp_set ts = {.magic = TIMESTAMP_UPDATE_MAGIC,
+                       .type  = TIMESTAMP_UPDATE_WTS,
+                       .rts   = entry->rts,
+                       .wts   = entry->wts};
+   splinterdb_update(txn_kvsb->kvsb, entry->key, slice_create(sizeof(ts), &ts));
+   // platform_default_log("Locked key for write = %s, %lu\n",
+   // (char*)entry->key.data, (uint64)txn->ts);
+   return 0;
+}
+
+static int
+local_write(sto_disk_splinterdb *txn_kvsb,
+            transaction         *txn,
+            slice                user_key,
+            message              msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, FALSE);
+   /* if (message_class(msg) == MESSAGE_TYPE_UPDATE */
+   /*     || message_class(msg) == MESSAGE_TYPE_DELETE) */
+   /* { */
+   /*    get_global_timestamps(txn_kvsb, entry, &entry->wts, &entry->rts); */
+   /* } */
+
+   if (!rw_entry_is_write(entry)) {
+      if (!transaction_is_commutative_update(
+             &txn_kvsb->super, rw_entry_is_read(entry), msg)
+          && sto_disk_lock_write(txn_kvsb, txn, entry))
+      {
+         return TRANSACTION_ABORTED;
+      }
+      rw_entry_set_msg(entry, msg, txn->arena);
+   } else {
+      // TODO it needs to be checked later for upsert
+      key       wkey = key_create_from_slice(entry->key);
+      const key ukey = key_create_from_slice(user_key);
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         if (message_is_definitive(msg)) {
+            // A commutative update takes the lock once it is replaced
+            if (!entry->is_locked && sto_disk_lock_write(txn_kvsb, txn, entry))
+            {
+               return TRANSACTION_ABORTED;
+            }
+            rw_entry_set_msg(entry, msg, txn->arena);
+         } else {
+            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
+
+            // Unlike the pending write, msg has no tuple_header, so they are
+            // merged as values of the application
+            merge_accumulator new_message;
+            merge_accumulator_init_from_message(&new_message, 0, msg);
+            transaction_apply_delta(
+               txn_kvsb->txn_data_cfg->application_data_config,
+               user_key,
+               rw_entry_value_msg(entry),
+               &new_message);
+            rw_entry_set_msg(
+               entry, merge_accumulator_to_message(&new_message), txn->arena);
+            merge_accumulator_deinit(&new_message);
+         }
+      }
+   }
+   return 0;
+}
+
+static int
+non_transactional_splinterdb_insert(const splinterdb *kvsb,
+                                    slice             key,
+                                    slice             value)
+{
+   uint64 value_len = sizeof(tuple_header) + slice_length(value);
+   char  *value_buf;
+   value_buf = TYPED_ARRAY_ZALLOC(0, value_buf, value_len);
+   memcpy(value_buf + sizeof(tuple_header), slice_data(value), value_len);
+   int rc = splinterdb_insert(kvsb, key, slice_create(value_len, value_buf));
+   platform_free(0, value_buf);
+   return rc;
+}
+
+static int
+sto_disk_insert(sto_disk_splinterdb *txn_kvsb,
+                transaction         *txn,
+                slice                user_key,
+                slice                value)
+{
+   if (!txn) {
+      return non_transactional_splinterdb_insert(
+         txn_kvsb->kvsb, user_key, value);
+   }
+
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+sto_disk_delete(sto_disk_splinterdb *txn_kvsb,
+                transaction         *txn,
+                slice                user_key)
+{
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+sto_disk_update(sto_disk_splinterdb *txn_kvsb,
+                transaction         *txn,
+                slice                user_key,
+                slice                delta)
+{
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+static int
+sto_disk_lookup(sto_disk_splinterdb      *txn_kvsb,
+                transaction              *txn,
+                slice                     user_key,
+                splinterdb_lookup_result *result)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+
+   _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+
+   int rc = 0;
+
+   if (rw_entry_is_write(entry)) {
+      // A commutative update takes the write lock once txn reads its key
+      if (!entry->is_locked && sto_disk_lock_write(txn_kvsb, txn, entry)) {
+         return TRANSACTION_ABORTED;
+      }
+      // read my write. txn holds the write lock of the key, so an update of
+      // txn reads the value it applies to without taking the read lock.
+      // TODO if it was an insert or a delete, this read should not be
+      // considered for validation. entry->is_read should be false.
+      if (!message_is_definitive(entry->msg)) {
+         rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+         if (rc == 0 && splinterdb_lookup_found(result)) {
+            const size_t value_len =
+               merge_accumulator_length(&_result->value) - sizeof(tuple_header);
+            tuple_header *tuple =
+               (tuple_header *)merge_accumulator_data(&_result->value);
+            if (tuple->ts.magic == TIMESTAMP_UPDATE_MAGIC) {
+               // Only the timestamps of the write lock, the key does not
+               // exist
+               merge_accumulator_set_to_null(&_result->value);
+            } else {
+               memmove(tuple, tuple->value, value_len);
+               merge_accumulator_resize(&_result->value, value_len);
+            }
+         }
+      }
+      if (rc == 0) {
+         transaction_read_own_write(
+            txn_kvsb->txn_data_cfg->application_data_config,
+            entry->key,
+            rw_entry_value_msg(entry),
+            &_result->value);
+      }
+      return rc;
+   }
+
+   if (rw_entry_read_lock(txn_kvsb, entry, txn->ts) == STO_ACCESS_ABORT) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_TOO_LATE, entry->key);
+      sto_disk_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+   // platform_default_log("Locked key for read = %s, %lu\n",
+   // (char*)entry->key.data, txn->ts);
+   rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+
+   if (splinterdb_lookup_found(result)) {
+      _result = (_splinterdb_lookup_result *)result;
+      tuple_header *tuple =
+         (tuple_header *)merge_accumulator_data(&_result->value);
+
+      const size_t value_len =
+         merge_accumulator_length(&_result->value) - sizeof(tuple_header);
+      memmove(merge_accumulator_data(&_result->value), tuple->value, value_len);
+      merge_accumulator_resize(&_result->value, value_len);
+
+      if (txn->ts > tuple->ts.wts) {
+         // This is hacky to distinguish between read and write timestamps
+         // updates by the update size.
+         entry->wts       = tuple->ts.wts;
+         entry->rts       = txn->ts;
+         timestamp_set ts = {.magic = TIMESTAMP_UPDATE_MAGIC, .type = TIMESTAMP_UPDATE_RTS, .rts = entry->rts, .wts = entry->wts};
+         splinterdb_update(
+            txn_kvsb->kvsb, entry->key, slice_create(sizeof(ts), &ts));
+      }
+      rw_entry_unlock(txn_kvsb->lock_tbl, entry, txn->ts);
+   } else {
+      transaction_pop_rw_entry(txn, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
+      rw_entry_unlock(txn_kvsb->lock_tbl, entry, txn->ts);
+   }
+
+   return rc;
+}
+
+/*
+ * Reads a key an iterator of txn returned, see scan_read in
+ * transactional_splinterdb_ops. It fails if a later transaction wrote the
+ * key, as a lookup would. splinterdb takes no writes while the iterator is
+ * open, so the commit extends the rts of the key.
+ */
+static bool
+sto_disk_scan_read(sto_disk_splinterdb *txn_kvsb,
+                   transaction         *txn,
+                   slice                user_key,
+                   slice                stored)
+{
+   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   if (transaction_find_rw_entry(txn, cfg, user_key)) {
+      // txn holds the write lock of a key it writes, and read the others
+      return TRUE;
+   }
+   const tuple_header *tuple = slice_data(stored);
+   if (txn->ts < tuple->ts.wts) {
+      return FALSE;
+   }
+   rw_entry *entry   = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+   entry->wts        = tuple->ts.wts;
+   entry->is_scanned = TRUE;
+   return TRUE;
+}
+
+static void
+sto_disk_lookup_result_init(
+   sto_disk_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+sto_disk_set_isolation_level(sto_disk_splinterdb        *txn_kvsb,
+                             transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+sto_disk_get_db(sto_disk_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+sto_disk_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   sto_disk_close(_txn_kvsb);
+}
+
+static void
+sto_disk_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   sto_disk_register_thread(_txn_kvsb);
+}
+
+static void
+sto_disk_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   sto_disk_deregister_thread(_txn_kvsb);
+}
+
+static int
+sto_disk_begin_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_begin(_txn_kvsb, txn);
+}
+
+static int
+sto_disk_commit_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_commit(_txn_kvsb, txn);
+}
+
+static int
+sto_disk_abort_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_abort(_txn_kvsb, txn);
+}
+
+static int
+sto_disk_insert_virtual(transactional_splinterdb *txn_kvsb,
+                        transaction              *txn,
+                        slice                     user_key,
+                        slice                     value)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+sto_disk_delete_virtual(transactional_splinterdb *txn_kvsb,
+                        transaction              *txn,
+                        slice                     user_key)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+sto_disk_update_virtual(transactional_splinterdb *txn_kvsb,
+                        transaction              *txn,
+                        slice                     user_key,
+                        slice                     delta)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+sto_disk_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                        transaction              *txn,
+                        slice                     user_key,
+                        splinterdb_lookup_result *result)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+sto_disk_lookup_result_init_virtual(transactional_splinterdb *txn_kvsb,
+                                    splinterdb_lookup_result *result,
+                                    uint64                    buffer_len,
+                                    char                     *buffer)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   sto_disk_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+sto_disk_set_isolation_level_virtual(transactional_splinterdb   *txn_kvsb,
+                                     transaction_isolation_level isol_level)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   sto_disk_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+sto_disk_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_get_db(_txn_kvsb);
+}
+
+static bool
+sto_disk_scan_read_virtual(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn,
+                           slice                     key,
+                           slice                     stored)
+{
+   sto_disk_splinterdb *_txn_kvsb = (sto_disk_splinterdb *)txn_kvsb;
+   return sto_disk_scan_read(_txn_kvsb, txn, key, stored);
+}
+
+static const transactional_splinterdb_ops sto_disk_ops = {
+   .close               = sto_disk_close_virtual,
+   .register_thread     = sto_disk_register_thread_virtual,
+   .deregister_thread   = sto_disk_deregister_thread_virtual,
+   .begin               = sto_disk_begin_virtual,
+   .commit              = sto_disk_commit_virtual,
+   .abort               = sto_disk_abort_virtual,
+   .insert              = sto_disk_insert_virtual,
+   .delete              = sto_disk_delete_virtual,
+   .update              = sto_disk_update_virtual,
+   .lookup              = sto_disk_lookup_virtual,
+   .lookup_result_init  = sto_disk_lookup_result_init_virtual,
+   .set_isolation_level = sto_disk_set_isolation_level_virtual,
+   .get_db              = sto_disk_get_db_virtual,
+   .scan_read           = sto_disk_scan_read_virtual,
+};
+
+int
+sto_disk_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                        transactional_splinterdb             **txn_kvsb,
+                        bool                                   open_existing)
+{
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   sto_disk_splinterdb *_txn_kvsb;
+   _txn_kvsb                          = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops               = &sto_disk_ops;
+   _txn_kvsb->super.value_header_size = sizeof(tuple_header);
+   _txn_kvsb->tcfg                    = txn_splinterdb_cfg;
+
+   _txn_kvsb->txn_data_cfg = TYPED_ZALLOC(0, _txn_kvsb->txn_data_cfg);
+   sto_disk_data_config_init(txn_kvsb_cfg->kvsb_cfg.data_cfg,
+                             _txn_kvsb->txn_data_cfg);
+   txn_splinterdb_cfg->kvsb_cfg.data_cfg =
+      (data_config *)_txn_kvsb->txn_data_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb->txn_data_cfg);
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+   _txn_kvsb->lock_tbl = lock_table_create(txn_kvsb_cfg->kvsb_cfg.data_cfg);
+   *txn_kvsb           = &_txn_kvsb->super;
+
+   return 0;
+}
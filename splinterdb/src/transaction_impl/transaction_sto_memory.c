@@ -0,0 +1,758 @@
+#include "splinterdb/data.h"
+#include "platform.h"
+#include "data_internal.h"
+#include "splinterdb/transaction.h"
+#include "util.h"
+#include "transaction_internal.h"
+#include "experimental_mode.h"
+#include "splinterdb_internal.h"
+#include "isketch/iceberg_table.h"
+#include "poison.h"
+
+
+/*
+ * Implementation of the classic Strict Timestamp Ordering.
+ * The implementation uses a dirty bit to prevent transactions
+ * from reading uncommitted data.
+ *
+ * The dirty bit is also used a latch to protect against race
+ * conditions that may appear from running multiple threads.
+ */
+
+typedef struct sto_memory_splinterdb {
+   transactional_splinterdb         super;
+   splinterdb                      *kvsb;
+   transactional_splinterdb_config *tcfg;
+   iceberg_table                   *tscache;
+} sto_memory_splinterdb;
+
+typedef struct {
+   txn_timestamp dirty_bit : 1;
+   txn_timestamp delete_bit : 1;
+   txn_timestamp wts : 62;
+   txn_timestamp rts : 64;
+} timestamp_set __attribute__((aligned(sizeof(txn_timestamp))));
+
+typedef struct rw_entry {
+   slice          key;
+   message        msg; // value + op
+   timestamp_set *ts;
+   bool           is_read;
+   bool           is_locked; // for write, which commutative updates are not
+} rw_entry;
+
+enum sto_access_rc { STO_ACCESS_OK, STO_ACCESS_BUSY, STO_ACCESS_ABORT };
+
+static inline bool
+timestamp_set_compare_and_swap(timestamp_set *ts,
+                               timestamp_set *v1,
+                               timestamp_set *v2)
+{
+   return __atomic_compare_exchange((volatile txn_timestamp *)ts,
+                                    (txn_timestamp *)v1,
+                                    (txn_timestamp *)v2,
+                                    TRUE,
+                                    __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED);
+}
+
+static inline void
+timestamp_set_load(timestamp_set *ts, timestamp_set *v)
+{
+   __atomic_load(
+      (volatile txn_timestamp *)ts, (txn_timestamp *)v, __ATOMIC_RELAXED);
+}
+
+/*
+ * This function has the following effects:
+ * A. If entry key is not in the cache, it inserts the key in the cache with
+ * refcount=1 and value=0. B. If the key is already in the cache, it just
+ * increases the refcount. C. returns the pointer to the value.
+ */
+static inline bool
+rw_entry_iceberg_insert(sto_memory_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   // Make sure increasing the refcount only once
+   if (entry->ts) {
+      return FALSE;
+   }
+
+   // increase refcount for key
+   timestamp_set ts = {0};
+   entry->ts        = &ts;
+   return iceberg_insert_and_get(txn_kvsb->tscache,
+                                 &entry->key,
+                                 (ValueType **)&entry->ts,
+                                 platform_get_tid());
+}
+
+static inline void
+rw_entry_iceberg_remove(sto_memory_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   if (!entry->ts) {
+      return;
+   }
+
+   entry->ts = NULL;
+
+   // KeyType   key_ht   = (KeyType)slice_data(entry->key);
+   // ValueType value_ht = {0};
+   // if (iceberg_get_and_remove(
+   //        txn_kvsb->tscache, &key_ht, &value_ht, platform_get_tid()))
+   // {
+   //    if (slice_data(entry->key) != key_ht) {
+   //       platform_free_from_heap(0, key_ht);
+   //    } else {
+   //       entry->need_to_keep_key = 0;
+   //    }
+   // }
+}
+
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   new_entry->ts = NULL;
+   return new_entry;
+}
+
+/*
+ * The msg is the msg from app.
+ */
+static inline void
+rw_entry_set_msg(rw_entry *e, message msg, transaction_arena *arena)
+{
+   e->msg = transaction_arena_copy_message(arena, msg);
+}
+
+static inline bool
+rw_entry_is_read(const rw_entry *entry)
+{
+   return entry->is_read;
+}
+
+static inline bool
+rw_entry_is_write(const rw_entry *entry)
+{
+   return !message_is_null(entry->msg);
+}
+
+/*
+ * Will Set timestamps in entry later
+ */
+static inline rw_entry *
+rw_entry_get(sto_memory_splinterdb *txn_kvsb,
+             transaction           *txn,
+             slice                  user_key,
+             const data_config     *cfg,
+             const bool             is_read)
+{
+   rw_entry *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry      = rw_entry_create(txn);
+      entry->key = transaction_arena_copy_slice(txn->arena, user_key);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+   }
+
+   entry->is_read = entry->is_read || is_read;
+   return entry;
+}
+
+static inline void
+rw_entry_unlock(rw_entry *entry, uint64 txn_ts)
+{
+   // platform_default_log("Unlock key = %s, %lu\n", (char*)entry->key.data,
+   // txn_ts);
+   timestamp_set v1, v2;
+   do {
+      timestamp_set_load(entry->ts, &v1);
+      v2           = v1;
+      v2.dirty_bit = 0;
+   } while (!timestamp_set_compare_and_swap(entry->ts, &v1, &v2));
+}
+
+static inline enum sto_access_rc
+rw_entry_try_read_lock(rw_entry *entry, uint64 txn_ts)
+{
+   timestamp_set v1, v2;
+   timestamp_set_load(entry->ts, &v1);
+   if (txn_ts < v1.wts) {
+      return STO_ACCESS_ABORT;
+   }
+   v2 = v1;
+   if (v1.dirty_bit) {
+      return STO_ACCESS_BUSY;
+   }
+   v2.dirty_bit = 1;
+   if (timestamp_set_compare_and_swap(entry->ts, &v1, &v2)) {
+      if (txn_ts < v1.wts) {
+         // TO rule would be violated so we need to abort
+         rw_entry_unlock(entry, txn_ts);
+         return STO_ACCESS_ABORT;
+      }
+   } else {
+      return STO_ACCESS_BUSY;
+   }
+   return STO_ACCESS_OK;
+}
+
+static inline enum sto_access_rc
+rw_entry_try_write_lock(rw_entry *entry, uint64 txn_ts)
+{
+   timestamp_set v1, v2;
+   timestamp_set_load(entry->ts, &v1);
+   if (txn_ts < v1.wts || txn_ts < v1.rts) {
+      // TO rule would be violated so we need to abort
+      return STO_ACCESS_ABORT;
+   }
+   v2 = v1;
+   if (v1.dirty_bit) {
+      return STO_ACCESS_BUSY;
+   }
+   v2.dirty_bit = 1;
+   if (timestamp_set_compare_and_swap(entry->ts, &v1, &v2)) {
+      if (txn_ts < v1.wts || txn_ts < v1.rts) {
+         rw_entry_unlock(entry, txn_ts);
+         return STO_ACCESS_ABORT;
+      }
+   } else {
+      return STO_ACCESS_BUSY;
+   }
+   return STO_ACCESS_OK;
+}
+
+static inline enum sto_access_rc
+rw_entry_read_lock(transaction_contention *cm, rw_entry *entry, uint64 txn_ts)
+{
+   // platform_default_log("Trying to lock key for read at ts = %s, %lu\n",
+   // (char*)entry->key.data, txn_ts);
+   enum sto_access_rc rc;
+   uint64             attempt = 0;
+   do {
+      rc = rw_entry_try_read_lock(entry, txn_ts);
+      if (rc == STO_ACCESS_BUSY) {
+         transaction_contention_backoff(cm, attempt++);
+      }
+   } while (rc == STO_ACCESS_BUSY);
+   return rc;
+}
+
+static inline enum sto_access_rc
+rw_entry_write_lock(transaction_contention *cm, rw_entry *entry, uint64 txn_ts)
+{
+   // platform_default_log("Trying to lock key for write = %s, %lu\n",
+   // (char*)entry->key.data, txn_ts);
+   enum sto_access_rc rc;
+   uint64             attempt = 0;
+   do {
+      rc = rw_entry_try_write_lock(entry, txn_ts);
+      if (rc == STO_ACCESS_BUSY) {
+         transaction_contention_backoff(cm, attempt++);
+      }
+   } while (rc == STO_ACCESS_BUSY);
+   return rc;
+}
+
+
+static void
+sto_memory_close(sto_memory_splinterdb *_txn_kvsb)
+{
+   iceberg_print_state(_txn_kvsb->tscache);
+
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   platform_free(0, _txn_kvsb->tscache);
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+sto_memory_register_thread(sto_memory_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+sto_memory_deregister_thread(sto_memory_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+sto_memory_begin(sto_memory_splinterdb *txn_kvsb, transaction              *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+   txn->ts = transaction_timestamp_next(&txn_kvsb->super.timestamps);
+   // platform_default_log("Starting transaction, ts = %lu\n", txn->ts);
+   return 0;
+}
+
+static inline void
+transaction_deinit(sto_memory_splinterdb *txn_kvsb, transaction *txn)
+{
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry_iceberg_remove(txn_kvsb, txn->rw_entries[i]);
+   }
+}
+
+static int
+sto_memory_abort(sto_memory_splinterdb *txn_kvsb, transaction *txn);
+
+// Takes the write lock of entry for txn, or aborts txn if it is too late
+static int
+sto_memory_lock_write(sto_memory_splinterdb *txn_kvsb,
+                      transaction           *txn,
+                      rw_entry              *entry)
+{
+   rw_entry_iceberg_insert(txn_kvsb, entry);
+   if (rw_entry_write_lock(&txn_kvsb->super.contention, entry, txn->ts)
+       == STO_ACCESS_ABORT)
+   {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_TOO_LATE, entry->key);
+      sto_memory_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+   entry->is_locked = TRUE;
+   // To prevent deadlocks, we have to update the wts
+   entry->ts->wts = txn->ts;
+   // platform_default_log("Locked key for write = %s, %lu\n",
+   // (char*)entry->key.data, txn->ts);
+   return 0;
+}
+
+static int
+sto_memory_commit(sto_memory_splinterdb *txn_kvsb,
+                  transaction           *txn)
+{
+   if (!transaction_validate_scans(&txn_kvsb->super, txn)) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_PHANTOM, NULL_SLICE);
+      sto_memory_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+
+   // update the DB
+   transaction_write_batch batch;
+   transaction_write_batch_init(&batch, txn, txn->num_rw_entries);
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *w = txn->rw_entries[i];
+      if (rw_entry_is_write(w)) {
+         transaction_write_batch_add(&batch, w->key, w->msg);
+      }
+   }
+   int rc = 0;
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+   rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+#endif
+
+   // unlock all writes
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *w = txn->rw_entries[i];
+      if (w->is_locked) {
+         // w->ts->wts = txn->ts;
+         rw_entry_unlock(w, txn->ts);
+      }
+   }
+
+   transaction_deinit(txn_kvsb, txn);
+
+   return rc;
+}
+
+static int
+sto_memory_abort(sto_memory_splinterdb *txn_kvsb, transaction              *txn)
+{
+   // unlock all writes
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *w = txn->rw_entries[i];
+      if (w->is_locked) {
+         rw_entry_unlock(w, txn->ts);
+      }
+   }
+
+   transaction_deinit(txn_kvsb, txn);
+
+   return 0;
+}
+
+static int
+local_write(sto_memory_splinterdb *txn_kvsb,
+            transaction           *txn,
+            slice                  user_key,
+            message                msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, FALSE);
+   /* if (message_class(msg) == MESSAGE_TYPE_UPDATE */
+   /*     || message_class(msg) == MESSAGE_TYPE_DELETE) */
+   /* { */
+   /*    rw_entry_iceberg_insert(txn_kvsb, entry); */
+   /*    timestamp_set v = *entry->tuple_ts; */
+   /*    entry->wts      = v.wts; */
+   /*    entry->rts      = timestamp_set_get_rts(&v); */
+   /* } */
+
+   if (!rw_entry_is_write(entry)) {
+      if (!transaction_is_commutative_update(
+             &txn_kvsb->super, rw_entry_is_read(entry), msg)
+          && sto_memory_lock_write(txn_kvsb, txn, entry))
+      {
+         return TRANSACTION_ABORTED;
+      }
+      rw_entry_set_msg(entry, msg, txn->arena);
+   } else {
+      // TODO it needs to be checked later for upsert
+      key       wkey = key_create_from_slice(entry->key);
+      const key ukey = key_create_from_slice(user_key);
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         if (message_is_definitive(msg)) {
+            // A commutative update takes the lock once it is replaced
+            if (!entry->is_locked
+                && sto_memory_lock_write(txn_kvsb, txn, entry))
+            {
+               return TRANSACTION_ABORTED;
+            }
+            rw_entry_set_msg(entry, msg, txn->arena);
+         } else {
+            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
+            merge_accumulator new_message;
+            merge_accumulator_init_from_message(&new_message, 0, msg);
+            data_merge_tuples(cfg, ukey, entry->msg, &new_message);
+            entry->msg = transaction_arena_copy_message(
+               txn->arena, merge_accumulator_to_message(&new_message));
+            merge_accumulator_deinit(&new_message);
+         }
+      }
+   }
+   return 0;
+}
+
+static int
+sto_memory_insert(sto_memory_splinterdb *txn_kvsb,
+                  transaction           *txn,
+                  slice                  user_key,
+                  slice                  value)
+{
+   if (!txn) {
+      return splinterdb_insert(txn_kvsb->kvsb, user_key, value);
+   }
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+sto_memory_delete(sto_memory_splinterdb *txn_kvsb,
+                  transaction           *txn,
+                  slice                  user_key)
+{
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+sto_memory_update(sto_memory_splinterdb *txn_kvsb,
+                  transaction           *txn,
+                  slice                  user_key,
+                  slice                  delta)
+{
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+static int
+sto_memory_lookup(sto_memory_splinterdb    *txn_kvsb,
+                  transaction              *txn,
+                  slice                     user_key,
+                  splinterdb_lookup_result *result)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+
+   int rc = 0;
+
+   // TODO: do not insert if already inserted for this transaction
+   rw_entry_iceberg_insert(txn_kvsb, entry);
+
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+   if (rw_entry_is_write(entry)) {
+      // A commutative update takes the write lock once txn reads its key
+      if (!entry->is_locked && sto_memory_lock_write(txn_kvsb, txn, entry)) {
+         return TRANSACTION_ABORTED;
+      }
+      // read my write. txn holds the write lock of the key, so an update of
+      // txn reads the value it applies to without taking the read lock.
+      // TODO if it was an insert or a delete, this read should not be
+      // considered for validation. entry->is_read should be false.
+      if (!message_is_definitive(entry->msg)) {
+         rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+      }
+      if (rc == 0) {
+         _splinterdb_lookup_result *_result =
+            (_splinterdb_lookup_result *)result;
+         transaction_read_own_write(
+            cfg, entry->key, entry->msg, &_result->value);
+      }
+   } else {
+      if (rw_entry_read_lock(&txn_kvsb->super.contention, entry, txn->ts)
+          == STO_ACCESS_ABORT)
+      {
+         transaction_abort_profile_note(
+            &txn_kvsb->super.aborts, TRANSACTION_ABORT_TOO_LATE, entry->key);
+         sto_memory_abort(txn_kvsb, txn);
+         return TRANSACTION_ABORTED;
+      }
+      // platform_default_log("Locked key for read = %s, %lu\n",
+      // (char*)entry->key.data, txn->ts);
+      rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+      if (txn->ts > entry->ts->rts) {
+         entry->ts->rts = txn->ts;
+      }
+      rw_entry_unlock(entry, txn->ts);
+   }
+#endif
+   return rc;
+}
+
+/*
+ * Reads a key an iterator of txn returned, see scan_read in
+ * transactional_splinterdb_ops. As a lookup would, it fails if a later
+ * transaction wrote the key, and keeps earlier ones from writing it.
+ */
+static bool
+sto_memory_scan_read(sto_memory_splinterdb *txn_kvsb,
+                     transaction           *txn,
+                     slice                  user_key)
+{
+   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   if (transaction_find_rw_entry(txn, cfg, user_key)) {
+      // txn holds the write lock of a key it writes, and read the others
+      return TRUE;
+   }
+   rw_entry *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+   rw_entry_iceberg_insert(txn_kvsb, entry);
+
+   // Unlike a lookup, do not wait long on a locked key: the iterator may
+   // hold the leaf its writer installs into
+   enum sto_access_rc rc;
+   uint64             spins = 0;
+   while ((rc = rw_entry_try_read_lock(entry, txn->ts)) == STO_ACCESS_BUSY) {
+      if (spins++ == txn_kvsb->super.contention.read_wait_spins) {
+         return FALSE;
+      }
+      platform_pause();
+   }
+   if (rc == STO_ACCESS_ABORT) {
+      return FALSE;
+   }
+   if (txn->ts > entry->ts->rts) {
+      entry->ts->rts = txn->ts;
+   }
+   rw_entry_unlock(entry, txn->ts);
+   return TRUE;
+}
+
+static void
+sto_memory_lookup_result_init(
+   sto_memory_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+sto_memory_set_isolation_level(sto_memory_splinterdb      *txn_kvsb,
+                               transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+sto_memory_get_db(sto_memory_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+sto_memory_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   sto_memory_close(_txn_kvsb);
+}
+
+static void
+sto_memory_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   sto_memory_register_thread(_txn_kvsb);
+}
+
+static void
+sto_memory_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   sto_memory_deregister_thread(_txn_kvsb);
+}
+
+static int
+sto_memory_begin_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_begin(_txn_kvsb, txn);
+}
+
+static int
+sto_memory_commit_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_commit(_txn_kvsb, txn);
+}
+
+static int
+sto_memory_abort_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_abort(_txn_kvsb, txn);
+}
+
+static int
+sto_memory_insert_virtual(transactional_splinterdb *txn_kvsb,
+                          transaction              *txn,
+                          slice                     user_key,
+                          slice                     value)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+sto_memory_delete_virtual(transactional_splinterdb *txn_kvsb,
+                          transaction              *txn,
+                          slice                     user_key)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+sto_memory_update_virtual(transactional_splinterdb *txn_kvsb,
+                          transaction              *txn,
+                          slice                     user_key,
+                          slice                     delta)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+sto_memory_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                          transaction              *txn,
+                          slice                     user_key,
+                          splinterdb_lookup_result *result)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+sto_memory_lookup_result_init_virtual(transactional_splinterdb *txn_kvsb,
+                                      splinterdb_lookup_result *result,
+                                      uint64                    buffer_len,
+                                      char                     *buffer)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   sto_memory_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+sto_memory_set_isolation_level_virtual(transactional_splinterdb   *txn_kvsb,
+                                       transaction_isolation_level isol_level)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   sto_memory_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+sto_memory_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_get_db(_txn_kvsb);
+}
+
+static bool
+sto_memory_scan_read_virtual(transactional_splinterdb *txn_kvsb,
+                             transaction              *txn,
+                             slice                     key,
+                             slice                     UNUSED_PARAM(stored))
+{
+   sto_memory_splinterdb *_txn_kvsb = (sto_memory_splinterdb *)txn_kvsb;
+   return sto_memory_scan_read(_txn_kvsb, txn, key);
+}
+
+static const transactional_splinterdb_ops sto_memory_ops = {
+   .close               = sto_memory_close_virtual,
+   .register_thread     = sto_memory_register_thread_virtual,
+   .deregister_thread   = sto_memory_deregister_thread_virtual,
+   .begin               = sto_memory_begin_virtual,
+   .commit              = sto_memory_commit_virtual,
+   .abort               = sto_memory_abort_virtual,
+   .insert              = sto_memory_insert_virtual,
+   .delete              = sto_memory_delete_virtual,
+   .update              = sto_memory_update_virtual,
+   .lookup              = sto_memory_lookup_virtual,
+   .lookup_result_init  = sto_memory_lookup_result_init_virtual,
+   .set_isolation_level = sto_memory_set_isolation_level_virtual,
+   .get_db              = sto_memory_get_db_virtual,
+   .scan_read           = sto_memory_scan_read_virtual,
+};
+
+int
+sto_memory_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                          transactional_splinterdb             **txn_kvsb,
+                          bool                                   open_existing)
+{
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   sto_memory_splinterdb *_txn_kvsb;
+   _txn_kvsb            = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops = &sto_memory_ops;
+   _txn_kvsb->tcfg      = txn_splinterdb_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+
+   iceberg_table *tscache;
+   tscache = TYPED_ZALLOC(0, tscache);
+   platform_assert(iceberg_init(tscache,
+                                txn_splinterdb_cfg->tscache_log_slots,
+                                txn_splinterdb_cfg->kvsb_cfg.data_cfg)
+                   == 0);
+
+   _txn_kvsb->tscache = tscache;
+
+   *txn_kvsb = &_txn_kvsb->super;
+
+   return 0;
+}
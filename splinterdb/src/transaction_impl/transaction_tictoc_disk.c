@@ -0,0 +1,698 @@
+#include "data_internal.h"
+#include "splinterdb/data.h"
+#include "tictoc_disk_internal.h"
+#include "poison.h"
+
+static void
+get_global_timestamps(tictoc_disk_splinterdb *txn_kvsb,
+                      rw_entry               *entry,
+                      txn_disk_timestamp          *wts,
+                      txn_disk_timestamp          *rts)
+{
+   const splinterdb *kvsb = txn_kvsb->kvsb;
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(kvsb, &result, 0, NULL);
+
+   splinterdb_lookup(kvsb, entry->key, &result);
+
+   if (splinterdb_lookup_found(&result)) {
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)&result;
+      tuple_header *tuple = merge_accumulator_data(&_result->value);
+      if (wts) {
+         *wts = tuple->ts.wts;
+      }
+      if (rts) {
+         *rts = tuple->ts.rts;
+      }
+   }
+   splinterdb_lookup_result_deinit(&result);
+}
+
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   return new_entry;
+}
+
+static inline void
+rw_entry_set_key(rw_entry *e, slice key, transaction_arena *arena)
+{
+   e->key = transaction_arena_copy_slice(arena, key);
+}
+
+/*
+ * The msg is the msg from app.
+ * This function adds the timestamps at the beginning
+ * of the msg
+ */
+static inline void
+rw_entry_set_msg(rw_entry *e, message msg, transaction_arena *arena)
+{
+   uint64 msg_len = sizeof(tuple_header) + message_length(msg);
+   char  *msg_buf;
+   msg_buf = TYPED_ARENA_ARRAY_MALLOC(arena, msg_buf, msg_len);
+   memset(msg_buf, 0, sizeof(tuple_header));
+   memcpy(
+      msg_buf + sizeof(tuple_header), message_data(msg), message_length(msg));
+   e->msg = message_create(message_class(msg), slice_create(msg_len, msg_buf));
+}
+
+static inline bool
+rw_entry_is_read(const rw_entry *entry)
+{
+   return entry->is_read;
+}
+
+static inline bool
+rw_entry_is_write(const rw_entry *entry)
+{
+   return !message_is_null(entry->msg);
+}
+
+// The write of entry, without the tuple_header in front of its value
+static inline message
+rw_entry_value_msg(const rw_entry *entry)
+{
+   const tuple_header *tuple = (const tuple_header *)message_data(entry->msg);
+   return message_create(
+      message_class(entry->msg),
+      slice_create(message_length(entry->msg) - sizeof(tuple_header),
+                   tuple->value));
+}
+
+/*
+ * Will Set timestamps in entry later
+ */
+static inline rw_entry *
+rw_entry_get(tictoc_disk_splinterdb *txn_kvsb,
+             transaction            *txn,
+             slice                   user_key,
+             const data_config      *cfg,
+             const bool              is_read)
+{
+   rw_entry *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry = rw_entry_create(txn);
+      rw_entry_set_key(entry, user_key, txn->arena);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+   }
+
+   entry->is_read = entry->is_read || is_read;
+   return entry;
+}
+
+static int
+rw_entry_key_compare(const void *elem1, const void *elem2, void *args)
+{
+   const data_config *cfg = (const data_config *)args;
+
+   rw_entry *e1 = *((rw_entry **)elem1);
+   rw_entry *e2 = *((rw_entry **)elem2);
+
+   key akey = key_create_from_slice(e1->key);
+   key bkey = key_create_from_slice(e2->key);
+
+   return data_key_compare(cfg, akey, bkey);
+}
+
+
+static void
+tictoc_disk_close(tictoc_disk_splinterdb *_txn_kvsb)
+{
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   lock_table_destroy(_txn_kvsb->lock_tbl);
+
+   platform_free(0, _txn_kvsb->txn_data_cfg);
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+tictoc_disk_register_thread(tictoc_disk_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+tictoc_disk_deregister_thread(tictoc_disk_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+tictoc_disk_begin(tictoc_disk_splinterdb *txn_kvsb,
+                  transaction            *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+
+   return 0;
+}
+
+static int
+tictoc_disk_commit(tictoc_disk_splinterdb *txn_kvsb,
+                   transaction            *txn)
+{
+   txn_disk_timestamp commit_ts = 0;
+
+   int        num_reads   = 0;
+   int        num_writes  = 0;
+   int        num_updates = 0;
+   rw_entry **read_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, read_set, txn->num_rw_entries);
+   rw_entry **write_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, write_set, txn->num_rw_entries);
+   // Commutative updates, which are applied without locks, and keep the
+   // timestamps of the tuple with the zero wts rw_entry_set_msg() gave them
+   rw_entry **update_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, update_set, txn->num_rw_entries);
+
+   for (int i = 0; i < txn->num_rw_entries; i++) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (transaction_is_commutative_update(
+             &txn_kvsb->super, rw_entry_is_read(entry), entry->msg))
+      {
+         update_set[num_updates++] = entry;
+      } else if (rw_entry_is_write(entry)) {
+         write_set[num_writes++] = entry;
+      }
+
+      if (rw_entry_is_read(entry)) {
+         read_set[num_reads++] = entry;
+         commit_ts             = MAX(commit_ts, entry->wts);
+      }
+   }
+
+   platform_sort_slow(write_set,
+                      num_writes,
+                      sizeof(rw_entry *),
+                      rw_entry_key_compare,
+                      (void *)txn_kvsb->tcfg->kvsb_cfg.data_cfg,
+                      NULL);
+
+   uint64 lock_attempt = 0;
+RETRY_LOCK_WRITE_SET:
+{
+   for (int lock_num = 0; lock_num < num_writes; ++lock_num) {
+      lock_table_rc lock_rc =
+         lock_table_try_acquire_entry_lock(txn_kvsb->lock_tbl,
+                                           write_set[lock_num]->key,
+                                           &write_set[lock_num]->is_locked);
+      platform_assert(lock_rc != LOCK_TABLE_RC_DEADLK);
+      if (lock_rc == LOCK_TABLE_RC_BUSY) {
+         for (int i = 0; i < lock_num; ++i) {
+            lock_table_release_entry_lock(
+               txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+         }
+
+         transaction_contention_backoff(&txn_kvsb->super.contention,
+                                        lock_attempt++);
+
+         goto RETRY_LOCK_WRITE_SET;
+      }
+   }
+}
+
+   for (uint64 i = 0; i < num_writes; ++i) {
+      txn_disk_timestamp rts = 0;
+      get_global_timestamps(txn_kvsb, write_set[i], NULL, &rts);
+      commit_ts = MAX(commit_ts, rts + 1);
+   }
+
+   bool is_abort = !transaction_validate_scans(&txn_kvsb->super, txn);
+   if (is_abort) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_PHANTOM, NULL_SLICE);
+   }
+   for (uint64 i = 0; !is_abort && i < num_reads; ++i) {
+      rw_entry *r = read_set[i];
+      platform_assert(rw_entry_is_read(r));
+
+      if (r->rts < commit_ts) {
+         lock_table_rc lock_rc = lock_table_try_acquire_entry_lock(
+            txn_kvsb->lock_tbl, r->key, &r->is_locked);
+
+         txn_disk_timestamp rts = 0;
+         txn_disk_timestamp wts = 0;
+         get_global_timestamps(txn_kvsb, r, &wts, &rts);
+
+         if (wts != r->wts) {
+            if (lock_rc == LOCK_TABLE_RC_OK) {
+               lock_table_release_entry_lock(
+                  txn_kvsb->lock_tbl, r->key, &r->is_locked);
+            }
+            transaction_abort_profile_note(
+               &txn_kvsb->super.aborts, TRANSACTION_ABORT_READ_CHANGED, r->key);
+            is_abort = TRUE;
+            break;
+         }
+
+         if (rts <= commit_ts && lock_rc == LOCK_TABLE_RC_BUSY) {
+            transaction_abort_profile_note(
+               &txn_kvsb->super.aborts, TRANSACTION_ABORT_READ_LOCKED, r->key);
+            is_abort = TRUE;
+            break;
+         }
+         if (rts < commit_ts) {
+            platform_assert(sizeof(commit_ts) == sizeof(uint32));
+            splinterdb_update(txn_kvsb->kvsb,
+                              r->key,
+                              slice_create(sizeof(commit_ts), &commit_ts));
+         }
+
+         if (lock_rc == LOCK_TABLE_RC_OK) {
+            lock_table_release_entry_lock(
+               txn_kvsb->lock_tbl, r->key, &r->is_locked);
+         }
+      }
+   }
+
+   int rc = 0;
+   if (!is_abort) {
+      transaction_write_batch batch;
+      transaction_write_batch_init(&batch, txn, num_writes + num_updates);
+      for (uint64 i = 0; i < num_writes; ++i) {
+         rw_entry *w = write_set[i];
+         platform_assert(rw_entry_is_write(w));
+
+         timestamp_set ts = {
+            .wts = commit_ts,
+            .rts = commit_ts,
+         };
+         tuple_header *msg = (tuple_header *)message_data(w->msg);
+         memcpy(&msg->ts, &ts, sizeof(ts));
+
+         transaction_write_batch_add(&batch, w->key, w->msg);
+      }
+      for (uint64 i = 0; i < num_updates; ++i) {
+         transaction_write_batch_add(
+            &batch, update_set[i]->key, update_set[i]->msg);
+      }
+
+      rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+
+      for (uint64 i = 0; i < num_writes; ++i) {
+         lock_table_release_entry_lock(
+            txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+      }
+   } else {
+      for (int i = 0; i < num_writes; ++i) {
+         lock_table_release_entry_lock(
+            txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+      }
+   }
+
+   return is_abort ? TRANSACTION_ABORTED : rc;
+}
+
+static int
+tictoc_disk_abort(tictoc_disk_splinterdb *txn_kvsb,
+                  transaction            *txn)
+{
+   return 0;
+}
+
+static int
+local_write(tictoc_disk_splinterdb *txn_kvsb,
+            transaction            *txn,
+            slice                   user_key,
+            message                 msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   const key          ukey  = key_create_from_slice(user_key);
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, FALSE);
+   /* if (message_class(msg) == MESSAGE_TYPE_UPDATE */
+   /*     || message_class(msg) == MESSAGE_TYPE_DELETE) */
+   /* { */
+   /*    get_global_timestamps(txn_kvsb, entry, &entry->wts, &entry->rts); */
+   /* } */
+
+   if (message_is_null(entry->msg)) {
+      rw_entry_set_msg(entry, msg, txn->arena);
+   } else {
+      key wkey = key_create_from_slice(entry->key);
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         if (message_is_definitive(msg)) {
+            rw_entry_set_msg(entry, msg, txn->arena);
+         } else {
+            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
+
+            // Unlike the pending write, msg has no tuple_header, so they are
+            // merged as values of the application
+            merge_accumulator new_message;
+            merge_accumulator_init_from_message(&new_message, 0, msg);
+            transaction_apply_delta(
+               txn_kvsb->txn_data_cfg->application_data_config,
+               user_key,
+               rw_entry_value_msg(entry),
+               &new_message);
+            rw_entry_set_msg(
+               entry, merge_accumulator_to_message(&new_message), txn->arena);
+            merge_accumulator_deinit(&new_message);
+         }
+      }
+   }
+   return 0;
+}
+
+static int
+non_transactional_splinterdb_insert(const splinterdb *kvsb,
+                                    slice             key,
+                                    slice             value)
+{
+   uint64 value_len = sizeof(tuple_header) + slice_length(value);
+   char  *value_buf;
+   value_buf = TYPED_ARRAY_ZALLOC(0, value_buf, value_len);
+   memcpy(value_buf + sizeof(tuple_header), slice_data(value), value_len);
+   int rc = splinterdb_insert(kvsb, key, slice_create(value_len, value_buf));
+   platform_free(0, value_buf);
+   return rc;
+}
+
+static int
+tictoc_disk_insert(tictoc_disk_splinterdb *txn_kvsb,
+                   transaction            *txn,
+                   slice                   user_key,
+                   slice                   value)
+{
+   if (!txn) {
+      return non_transactional_splinterdb_insert(
+         txn_kvsb->kvsb, user_key, value);
+   }
+
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+tictoc_disk_delete(tictoc_disk_splinterdb *txn_kvsb,
+                   transaction            *txn,
+                   slice                   user_key)
+{
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+tictoc_disk_update(tictoc_disk_splinterdb *txn_kvsb,
+                   transaction            *txn,
+                   slice                   user_key,
+                   slice                   delta)
+{
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+static int
+tictoc_disk_lookup(tictoc_disk_splinterdb   *txn_kvsb,
+                   transaction              *txn,
+                   slice                     user_key,
+                   splinterdb_lookup_result *result)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+
+   _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+
+   const data_config *app_cfg = txn_kvsb->txn_data_cfg->application_data_config;
+
+   // An update of txn applies to the stored value, which is read below and
+   // validated like any other
+   if (rw_entry_is_write(entry) && message_is_definitive(entry->msg)) {
+      get_global_timestamps(txn_kvsb, entry, &entry->wts, &entry->rts);
+
+      // read my write
+      // TODO if it succeeded, this read should not be considered for
+      // validation. entry->is_read should be false.
+      transaction_read_own_write(
+         app_cfg, entry->key, rw_entry_value_msg(entry), &_result->value);
+      return 0;
+   }
+
+   int rc = 0;
+   /* timestamp_set v1, v2; */
+
+   /* do { */
+   /*    get_global_timestamps(txn_kvsb, entry, &v1.wts, &v1.rts); */
+   /*    rc = splinterdb_lookup(txn_kvsb->kvsb, user_key, result); */
+   /*    get_global_timestamps(txn_kvsb, entry, &v2.wts, &v2.rts); */
+   /* } while (memcmp(&v1, &v2, sizeof(v1)) != 0 */
+   /*          || lock_table_get_entry_lock_state(txn_kvsb->lock_tbl, entry) */
+   /*                == LOCK_TABLE_RC_BUSY); */
+
+   do {
+      rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+   } while (lock_table_get_entry_lock_state(txn_kvsb->lock_tbl, entry->key)
+            == LOCK_TABLE_RC_BUSY);
+
+   if (splinterdb_lookup_found(result)) {
+      _result = (_splinterdb_lookup_result *)result;
+      tuple_header *tuple =
+         (tuple_header *)merge_accumulator_data(&_result->value);
+
+      entry->wts = tuple->ts.wts;
+      entry->rts = tuple->ts.rts;
+
+      const size_t value_len =
+         merge_accumulator_length(&_result->value) - sizeof(tuple_header);
+      memmove(merge_accumulator_data(&_result->value), tuple->value, value_len);
+      merge_accumulator_resize(&_result->value, value_len);
+   } else if (!rw_entry_is_write(entry)) {
+      transaction_pop_rw_entry(txn, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
+   }
+
+   if (rc == 0 && rw_entry_is_write(entry)) {
+      transaction_read_own_write(
+         app_cfg, entry->key, rw_entry_value_msg(entry), &_result->value);
+   }
+
+   return rc;
+}
+
+/*
+ * Reads the timestamps of a key an iterator of txn returned, from what it
+ * stored for the key, see scan_read in transactional_splinterdb_ops.
+ */
+static bool
+tictoc_disk_scan_read(tictoc_disk_splinterdb *txn_kvsb,
+                      transaction            *txn,
+                      slice                   user_key,
+                      slice                   stored)
+{
+   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   if (transaction_find_rw_entry(txn, cfg, user_key)) {
+      // A write of txn validates itself, and a read keeps its timestamps
+      return TRUE;
+   }
+   rw_entry           *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+   const tuple_header *tuple = slice_data(stored);
+   entry->wts                = tuple->ts.wts;
+   entry->rts                = tuple->ts.rts;
+   return TRUE;
+}
+
+static void
+tictoc_disk_lookup_result_init(
+   tictoc_disk_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+tictoc_disk_set_isolation_level(tictoc_disk_splinterdb     *txn_kvsb,
+                                transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+tictoc_disk_get_db(tictoc_disk_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+tictoc_disk_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   tictoc_disk_close(_txn_kvsb);
+}
+
+static void
+tictoc_disk_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   tictoc_disk_register_thread(_txn_kvsb);
+}
+
+static void
+tictoc_disk_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   tictoc_disk_deregister_thread(_txn_kvsb);
+}
+
+static int
+tictoc_disk_begin_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_begin(_txn_kvsb, txn);
+}
+
+static int
+tictoc_disk_commit_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_commit(_txn_kvsb, txn);
+}
+
+static int
+tictoc_disk_abort_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_abort(_txn_kvsb, txn);
+}
+
+static int
+tictoc_disk_insert_virtual(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn,
+                           slice                     user_key,
+                           slice                     value)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+tictoc_disk_delete_virtual(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn,
+                           slice                     user_key)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+tictoc_disk_update_virtual(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn,
+                           slice                     user_key,
+                           slice                     delta)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+tictoc_disk_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn,
+                           slice                     user_key,
+                           splinterdb_lookup_result *result)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+tictoc_disk_lookup_result_init_virtual(transactional_splinterdb *txn_kvsb,
+                                       splinterdb_lookup_result *result,
+                                       uint64                    buffer_len,
+                                       char                     *buffer)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   tictoc_disk_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+tictoc_disk_set_isolation_level_virtual(transactional_splinterdb   *txn_kvsb,
+                                        transaction_isolation_level isol_level)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   tictoc_disk_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+tictoc_disk_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_get_db(_txn_kvsb);
+}
+
+static bool
+tictoc_disk_scan_read_virtual(transactional_splinterdb *txn_kvsb,
+                              transaction              *txn,
+                              slice                     key,
+                              slice                     stored)
+{
+   tictoc_disk_splinterdb *_txn_kvsb = (tictoc_disk_splinterdb *)txn_kvsb;
+   return tictoc_disk_scan_read(_txn_kvsb, txn, key, stored);
+}
+
+static const transactional_splinterdb_ops tictoc_disk_ops = {
+   .close               = tictoc_disk_close_virtual,
+   .register_thread     = tictoc_disk_register_thread_virtual,
+   .deregister_thread   = tictoc_disk_deregister_thread_virtual,
+   .begin               = tictoc_disk_begin_virtual,
+   .commit              = tictoc_disk_commit_virtual,
+   .abort               = tictoc_disk_abort_virtual,
+   .insert              = tictoc_disk_insert_virtual,
+   .delete              = tictoc_disk_delete_virtual,
+   .update              = tictoc_disk_update_virtual,
+   .lookup              = tictoc_disk_lookup_virtual,
+   .lookup_result_init  = tictoc_disk_lookup_result_init_virtual,
+   .set_isolation_level = tictoc_disk_set_isolation_level_virtual,
+   .get_db              = tictoc_disk_get_db_virtual,
+   .scan_read           = tictoc_disk_scan_read_virtual,
+};
+
+int
+tictoc_disk_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                           transactional_splinterdb             **txn_kvsb,
+                           bool                                   open_existing)
+{
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   tictoc_disk_splinterdb *_txn_kvsb;
+   _txn_kvsb                          = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops               = &tictoc_disk_ops;
+   _txn_kvsb->super.value_header_size = sizeof(tuple_header);
+   _txn_kvsb->tcfg                    = txn_splinterdb_cfg;
+
+   _txn_kvsb->txn_data_cfg = TYPED_ZALLOC(0, _txn_kvsb->txn_data_cfg);
+   tictoc_disk_data_config_init(txn_kvsb_cfg->kvsb_cfg.data_cfg,
+                                _txn_kvsb->txn_data_cfg);
+   txn_splinterdb_cfg->kvsb_cfg.data_cfg =
+      (data_config *)_txn_kvsb->txn_data_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb->txn_data_cfg);
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+   _txn_kvsb->lock_tbl = lock_table_create(txn_kvsb_cfg->kvsb_cfg.data_cfg);
+   *txn_kvsb           = &_txn_kvsb->super;
+
+   return 0;
+}
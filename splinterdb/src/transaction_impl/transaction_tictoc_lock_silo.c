@@ -0,0 +1,777 @@
+#include "data_internal.h"
+#include "splinterdb/data.h"
+#include "fantasticc_internal.h"
+#include "poison.h"
+
+/*
+ * This function has the following effects:
+ * A. If entry key is not in the cache, it inserts the key in the cache with
+ * refcount=1 and value=0. B. If the key is already in the cache, it just
+ * increases the refcount. C. returns the pointer to the value.
+ */
+static inline bool
+rw_entry_iceberg_insert(silo_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   // Make sure increasing the refcount only once
+   if (entry->tuple_ts) {
+      return FALSE;
+   }
+
+   // ValueType value_ht = {0};
+   // bool is_new_item = iceberg_insert_without_increasing_refcount(
+   //    txn_kvsb->tscache, key_ht, value_ht, platform_get_tid());
+
+   timestamp_set ts = {0};
+   entry->tuple_ts  = &ts;
+   bool is_new_item = iceberg_insert_and_get_without_increasing_refcount(
+      txn_kvsb->tscache,
+      &entry->key,
+      (ValueType **)&entry->tuple_ts,
+      platform_get_tid());
+   platform_assert(entry->tuple_ts != &ts);
+
+   // get the pointer of the value from the iceberg
+   // platform_assert(iceberg_get_value(txn_kvsb->tscache,
+   //                                   key_ht,
+   //                                   (ValueType **)&entry->tuple_ts,
+   //                                   platform_get_tid()));
+
+   /* platform_assert(((uint64)entry->tuple_ts) % sizeof(txn_timestamp) == 0);
+    */
+
+   return is_new_item;
+}
+
+static inline void
+rw_entry_iceberg_remove(silo_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   if (!entry->tuple_ts) {
+      return;
+   }
+
+   entry->tuple_ts = NULL;
+
+   // KeyType   key_ht   = (KeyType)slice_data(entry->key);
+   // ValueType value_ht = {0};
+   // if (iceberg_get_and_remove(
+   //        txn_kvsb->tscache, &key_ht, &value_ht, platform_get_tid()))
+   // {
+   //    // if (entry->is_read)
+   //    //    platform_error_log("remove %s refcount: %d %lu\n",
+   //    //                       key_ht,
+   //    //                       value_ht.refcount,
+   //    //                       platform_get_tid());
+   //    if (slice_data(entry->key) != key_ht) {
+   //       platform_free_from_heap(0, key_ht);
+   //    } else {
+   //       entry->need_to_keep_key = 0;
+   //    }
+   // }
+
+   // if (entry->is_read)
+   //    platform_error_log("%s refcount: %d %lu\n",
+   //                       key_ht,
+   //                       value_ht.refcount,
+   //                       platform_get_tid());
+}
+
+
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   new_entry->tuple_ts = NULL;
+   return new_entry;
+}
+
+/*
+ * The msg is the msg from app.
+ */
+static inline void
+rw_entry_set_msg(rw_entry *e, message msg, transaction_arena *arena)
+{
+   e->msg = transaction_arena_copy_message(arena, msg);
+}
+
+static inline bool
+rw_entry_is_read(const rw_entry *entry)
+{
+   return entry->is_read;
+}
+
+static inline bool
+rw_entry_is_write(const rw_entry *entry)
+{
+   return !message_is_null(entry->msg);
+}
+
+/*
+ * Will Set timestamps in entry later
+ */
+static inline rw_entry *
+rw_entry_get(silo_splinterdb   *txn_kvsb,
+             transaction       *txn,
+             slice              user_key,
+             const data_config *cfg,
+             const bool         is_read)
+{
+   rw_entry *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry = rw_entry_create(txn);
+      // The entry->key will be replaced by the key from the hash table.
+      entry->key = transaction_arena_copy_slice(txn->arena, user_key);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+   }
+
+   entry->is_read = entry->is_read || is_read;
+   return entry;
+}
+
+static int
+rw_entry_key_compare(const void *elem1, const void *elem2, void *args)
+{
+   const data_config *cfg = (const data_config *)args;
+
+   rw_entry *e1 = *((rw_entry **)elem1);
+   rw_entry *e2 = *((rw_entry **)elem2);
+
+   key akey = key_create_from_slice(e1->key);
+   key bkey = key_create_from_slice(e2->key);
+
+   return data_key_compare(cfg, akey, bkey);
+}
+
+/*
+ * Locks the key of entry until txn finishes, for a read of a hot key (see
+ * transaction_hotness.h). Returns FALSE if it stayed locked by others.
+ */
+static bool
+silo_lock_hot(silo_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   uint64 attempt = 0;
+   while (lock_table_try_acquire_entry_lock(
+             txn_kvsb->lock_tbl, entry->key, &entry->is_locked)
+          == LOCK_TABLE_RC_BUSY)
+   {
+      if (!transaction_hotness_backoff(&txn_kvsb->super.contention, attempt++))
+      {
+         return FALSE;
+      }
+   }
+   entry->is_hot = TRUE;
+   return TRUE;
+}
+
+static void
+silo_close(silo_splinterdb *_txn_kvsb)
+{
+   iceberg_print_state(_txn_kvsb->tscache);
+
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   lock_table_destroy(_txn_kvsb->lock_tbl);
+   /* iceberg_print_state(_txn_kvsb->tscache); */
+   platform_free(0, _txn_kvsb->tscache);
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+silo_register_thread(silo_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+silo_deregister_thread(silo_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+silo_begin(silo_splinterdb *txn_kvsb, transaction              *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+   // platform_error_log("[%lu] begin\n", ((unsigned long)txn) % 100);
+
+   return 0;
+}
+
+static inline void
+transaction_deinit(silo_splinterdb *txn_kvsb, transaction *txn)
+{
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *entry = txn->rw_entries[i];
+      // The locks of hot keys that were written are released with the other
+      // writes
+      if (entry->is_hot && entry->is_locked) {
+         lock_table_release_entry_lock(
+            txn_kvsb->lock_tbl, entry->key, &entry->is_locked);
+      }
+      entry->is_hot = FALSE;
+      rw_entry_iceberg_remove(txn_kvsb, entry);
+   }
+}
+
+static int
+silo_commit(silo_splinterdb *txn_kvsb, transaction              *txn)
+{
+   txn_timestamp commit_ts = 0;
+
+   int        num_reads   = 0;
+   int        num_writes  = 0;
+   int        num_updates = 0;
+   rw_entry **read_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, read_set, txn->num_rw_entries);
+   rw_entry **write_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, write_set, txn->num_rw_entries);
+   // Commutative updates, which are applied without locks or timestamps
+   rw_entry **update_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, update_set, txn->num_rw_entries);
+
+   for (int i = 0; i < txn->num_rw_entries; i++) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (transaction_is_commutative_update(
+             &txn_kvsb->super, rw_entry_is_read(entry), entry->msg))
+      {
+         update_set[num_updates++] = entry;
+      } else if (rw_entry_is_write(entry)) {
+         write_set[num_writes++] = entry;
+      }
+
+      if (rw_entry_is_read(entry)) {
+         read_set[num_reads++] = entry;
+
+         commit_ts = MAX(commit_ts, entry->wts + 1);
+      }
+   }
+
+   platform_sort_slow(write_set,
+                      num_writes,
+                      sizeof(rw_entry *),
+                      rw_entry_key_compare,
+                      (void *)txn_kvsb->tcfg->kvsb_cfg.data_cfg,
+                      NULL);
+
+   uint64 lock_attempt = 0;
+RETRY_LOCK_WRITE_SET:
+{
+   for (int lock_num = 0; lock_num < num_writes; ++lock_num) {
+      if (write_set[lock_num]->is_hot) {
+         continue;
+      }
+      lock_table_rc lock_rc =
+         lock_table_try_acquire_entry_lock(txn_kvsb->lock_tbl,
+                                           write_set[lock_num]->key,
+                                           &write_set[lock_num]->is_locked);
+      platform_assert(lock_rc != LOCK_TABLE_RC_DEADLK);
+      if (lock_rc == LOCK_TABLE_RC_BUSY) {
+         for (int i = 0; i < lock_num; ++i) {
+            if (write_set[i]->is_hot) {
+               continue;
+            }
+            lock_table_release_entry_lock(
+               txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+         }
+
+         // The hot keys txn holds may be what the holder waits for
+         if (!transaction_hotness_enabled(&txn_kvsb->super.hotness)) {
+            transaction_contention_backoff(&txn_kvsb->super.contention,
+                                           lock_attempt++);
+         } else if (!transaction_hotness_backoff(&txn_kvsb->super.contention,
+                                                 lock_attempt++))
+         {
+            transaction_abort_profile_note(&txn_kvsb->super.aborts,
+                                           TRANSACTION_ABORT_LOCK_BUSY,
+                                           write_set[lock_num]->key);
+            transaction_deinit(txn_kvsb, txn);
+            return TRANSACTION_ABORTED;
+         }
+
+         goto RETRY_LOCK_WRITE_SET;
+      }
+   }
+}
+
+   for (uint64 i = 0; i < num_writes; ++i) {
+      rw_entry *w = write_set[i];
+      if (!w->tuple_ts) {
+         rw_entry_iceberg_insert(txn_kvsb, w);
+      }
+      commit_ts = MAX(commit_ts, timestamp_set_get_rts(w->tuple_ts) + 1);
+   }
+
+   bool is_abort = !transaction_validate_scans(&txn_kvsb->super, txn);
+   if (is_abort) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_PHANTOM, NULL_SLICE);
+   }
+   for (uint64 i = 0; !is_abort && i < num_reads; ++i) {
+      rw_entry *r = read_set[i];
+      platform_assert(rw_entry_is_read(r));
+
+      // Silo validates every read regardless of the commit timestamp
+      lock_table_rc lock_rc = lock_table_try_acquire_entry_lock(
+         txn_kvsb->lock_tbl, r->key, &r->is_locked);
+
+      // platform_error_log("[%lu] key %s rts %lu commit_ts %lu lock_rc == "
+      //                    "LOCK_TABLE_RC_BUSY %d\n",
+      //                    ((unsigned long)txn) % 100,
+      //                    (char *)slice_data(r->key),
+      //                    rts,
+      //                    commit_ts,
+      //                    (lock_rc == LOCK_TABLE_RC_BUSY));
+
+      if (lock_rc == LOCK_TABLE_RC_BUSY) {
+         if (timestamp_set_get_rts(r->tuple_ts) <= commit_ts) {
+            transaction_abort_profile_note(
+               &txn_kvsb->super.aborts, TRANSACTION_ABORT_READ_LOCKED, r->key);
+            transaction_hotness_note_conflict(&txn_kvsb->super.hotness,
+                                              r->key);
+            is_abort = TRUE;
+            break;
+         }
+      }
+
+      // platform_error_log("[%lu] key %s wts %lu r->wts %lu\n",
+      //                    ((unsigned long)txn) % 100,
+      //                    (char *)slice_data(r->key),
+      //                    wts,
+      //                    r->wts);
+
+      if (r->tuple_ts->wts != r->wts) {
+         if (lock_rc == LOCK_TABLE_RC_OK) {
+            lock_table_release_entry_lock(
+               txn_kvsb->lock_tbl, r->key, &r->is_locked);
+         }
+         transaction_abort_profile_note(
+            &txn_kvsb->super.aborts, TRANSACTION_ABORT_READ_CHANGED, r->key);
+         transaction_hotness_note_conflict(&txn_kvsb->super.hotness, r->key);
+         is_abort = TRUE;
+         break;
+      }
+
+      if (lock_rc == LOCK_TABLE_RC_OK) {
+         lock_table_release_entry_lock(
+            txn_kvsb->lock_tbl, r->key, &r->is_locked);
+      }
+   }
+
+   int rc = 0;
+   if (!is_abort) {
+      transaction_write_batch batch;
+      transaction_write_batch_init(&batch, txn, num_writes + num_updates);
+      for (uint64 i = 0; i < num_writes; ++i) {
+         rw_entry *w = write_set[i];
+         platform_assert(rw_entry_is_write(w));
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 1
+         platform_sleep_ns(100);
+#endif
+         transaction_write_batch_add(&batch, w->key, w->msg);
+      }
+      for (uint64 i = 0; i < num_updates; ++i) {
+         transaction_write_batch_add(
+            &batch, update_set[i]->key, update_set[i]->msg);
+      }
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+      rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+#endif
+
+      for (uint64 i = 0; i < num_writes; ++i) {
+         rw_entry *w = write_set[i];
+         w->tuple_ts->wts   = commit_ts;
+         w->tuple_ts->delta = 0;
+
+         lock_table_release_entry_lock(
+            txn_kvsb->lock_tbl, w->key, &w->is_locked);
+      }
+   } else {
+      // Transaction abort
+      for (int i = 0; i < num_writes; ++i) {
+         lock_table_release_entry_lock(
+            txn_kvsb->lock_tbl, write_set[i]->key, &write_set[i]->is_locked);
+      }
+   }
+
+   transaction_deinit(txn_kvsb, txn);
+
+   return is_abort ? TRANSACTION_ABORTED : rc;
+}
+
+static int
+silo_abort(silo_splinterdb *txn_kvsb, transaction              *txn)
+{
+   transaction_deinit(txn_kvsb, txn);
+
+   return 0;
+}
+
+static int
+local_write(silo_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key,
+            message          msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   const key          ukey  = key_create_from_slice(user_key);
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, FALSE);
+   /* if (message_class(msg) == MESSAGE_TYPE_UPDATE */
+   /*     || message_class(msg) == MESSAGE_TYPE_DELETE) */
+   /* { */
+   /*    rw_entry_iceberg_insert(txn_kvsb, entry); */
+   /*    timestamp_set v = *entry->tuple_ts; */
+   /*    entry->wts      = v.wts; */
+   /*    entry->rts      = timestamp_set_get_rts(&v); */
+   /* } */
+
+   if (message_is_null(entry->msg)) {
+      rw_entry_set_msg(entry, msg, txn->arena);
+   } else {
+      // TODO it needs to be checked later for upsert
+      key wkey = key_create_from_slice(entry->key);
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         if (message_is_definitive(msg)) {
+            rw_entry_set_msg(entry, msg, txn->arena);
+         } else {
+            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
+
+            merge_accumulator new_message;
+            merge_accumulator_init_from_message(&new_message, 0, msg);
+            data_merge_tuples(cfg, ukey, entry->msg, &new_message);
+            entry->msg = transaction_arena_copy_message(
+               txn->arena, merge_accumulator_to_message(&new_message));
+            merge_accumulator_deinit(&new_message);
+         }
+      }
+   }
+   return 0;
+}
+
+static int
+silo_insert(silo_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key,
+            slice            value)
+{
+   if (!txn) {
+      return splinterdb_insert(txn_kvsb->kvsb, user_key, value);
+   }
+
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+silo_delete(silo_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key)
+{
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+silo_update(silo_splinterdb *txn_kvsb,
+            transaction     *txn,
+            slice            user_key,
+            slice            delta)
+{
+   // platform_error_log("[%lu] update %s\n",
+   //                    ((unsigned long)txn) % 100,
+   //                    (char *)slice_data(user_key));
+
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+/*
+ * Reads what txn sees of entry into result: the stored value, with the write
+ * txn has pending on the key, if any, over it.
+ */
+static inline int
+silo_read(silo_splinterdb          *txn_kvsb,
+          rw_entry                 *entry,
+          splinterdb_lookup_result *result)
+{
+   int rc = 0;
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 1
+   platform_sleep_ns(100);
+#else
+   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   // An update of txn applies to the stored value, which is read and
+   // validated like any other
+   if (!rw_entry_is_write(entry) || !message_is_definitive(entry->msg)) {
+      rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+   }
+   if (rc == 0 && rw_entry_is_write(entry)) {
+      // read my write
+      // TODO if it was an insert or a delete, this read should not be
+      // considered for validation. entry->is_read should be false.
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+      transaction_read_own_write(cfg, entry->key, entry->msg, &_result->value);
+   }
+#endif
+   return rc;
+}
+
+static int
+silo_lookup(silo_splinterdb          *txn_kvsb,
+            transaction              *txn,
+            slice                     user_key,
+            splinterdb_lookup_result *result)
+{
+   // platform_error_log("[%lu] lookup %s\n",
+   //                    ((unsigned long)txn) % 100,
+   //                    (char *)slice_data(user_key));
+
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+
+   int rc = 0;
+
+   rw_entry_iceberg_insert(txn_kvsb, entry);
+
+   if (!entry->is_hot
+       && transaction_hotness_is_hot(&txn_kvsb->super.hotness, entry->key)
+       && !silo_lock_hot(txn_kvsb, entry))
+   {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_LOCK_BUSY, entry->key);
+      silo_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+
+   timestamp_set v1, v2;
+   if (entry->is_hot) {
+      // Nobody else writes the key while txn holds its lock
+      timestamp_set_load(entry->tuple_ts, &v1);
+      rc = silo_read(txn_kvsb, entry, result);
+   } else {
+      uint64 locked_attempts = 0;
+      bool   is_locked;
+      do {
+         timestamp_set_load(entry->tuple_ts, &v1);
+         rc = silo_read(txn_kvsb, entry, result);
+         timestamp_set_load(entry->tuple_ts, &v2);
+
+         is_locked =
+            lock_table_get_entry_lock_state(txn_kvsb->lock_tbl, entry->key)
+            == LOCK_TABLE_RC_BUSY;
+         // Hot keys stay locked for whole transactions, which may wait for
+         // txn in turn
+         if (is_locked && transaction_hotness_enabled(&txn_kvsb->super.hotness)
+             && !transaction_hotness_backoff(&txn_kvsb->super.contention,
+                                             locked_attempts++))
+         {
+            transaction_abort_profile_note(&txn_kvsb->super.aborts,
+                                           TRANSACTION_ABORT_READ_LOCKED,
+                                           entry->key);
+            transaction_hotness_note_conflict(&txn_kvsb->super.hotness,
+                                              entry->key);
+            silo_abort(txn_kvsb, txn);
+            return TRANSACTION_ABORTED;
+         }
+      } while (memcmp(&v1, &v2, sizeof(v1)) != 0 || is_locked);
+   }
+
+   entry->wts = v1.wts;
+   entry->rts = timestamp_set_get_rts(&v1);
+
+   return rc;
+}
+
+static void
+silo_lookup_result_init(
+   silo_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+silo_set_isolation_level(silo_splinterdb            *txn_kvsb,
+                         transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+silo_get_db(silo_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+silo_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   silo_close(_txn_kvsb);
+}
+
+static void
+silo_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   silo_register_thread(_txn_kvsb);
+}
+
+static void
+silo_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   silo_deregister_thread(_txn_kvsb);
+}
+
+static int
+silo_begin_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_begin(_txn_kvsb, txn);
+}
+
+static int
+silo_commit_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_commit(_txn_kvsb, txn);
+}
+
+static int
+silo_abort_virtual(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_abort(_txn_kvsb, txn);
+}
+
+static int
+silo_insert_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key,
+                    slice                     value)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+silo_delete_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+silo_update_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key,
+                    slice                     delta)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+silo_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                    transaction              *txn,
+                    slice                     user_key,
+                    splinterdb_lookup_result *result)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+silo_lookup_result_init_virtual(transactional_splinterdb *txn_kvsb,
+                                splinterdb_lookup_result *result,
+                                uint64                    buffer_len,
+                                char                     *buffer)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   silo_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+silo_set_isolation_level_virtual(transactional_splinterdb   *txn_kvsb,
+                                 transaction_isolation_level isol_level)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   silo_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+silo_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   silo_splinterdb *_txn_kvsb = (silo_splinterdb *)txn_kvsb;
+   return silo_get_db(_txn_kvsb);
+}
+
+static const transactional_splinterdb_ops silo_ops = {
+   .close               = silo_close_virtual,
+   .register_thread     = silo_register_thread_virtual,
+   .deregister_thread   = silo_deregister_thread_virtual,
+   .begin               = silo_begin_virtual,
+   .commit              = silo_commit_virtual,
+   .abort               = silo_abort_virtual,
+   .insert              = silo_insert_virtual,
+   .delete              = silo_delete_virtual,
+   .update              = silo_update_virtual,
+   .lookup              = silo_lookup_virtual,
+   .lookup_result_init  = silo_lookup_result_init_virtual,
+   .set_isolation_level = silo_set_isolation_level_virtual,
+   .get_db              = silo_get_db_virtual,
+};
+
+int
+silo_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                    transactional_splinterdb             **txn_kvsb,
+                    bool                                   open_existing)
+{
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   silo_splinterdb *_txn_kvsb;
+   _txn_kvsb            = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops = &silo_ops;
+   _txn_kvsb->tcfg      = txn_splinterdb_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+
+   _txn_kvsb->lock_tbl =
+      lock_table_create(txn_splinterdb_cfg->kvsb_cfg.data_cfg);
+
+   iceberg_table *tscache;
+   tscache = TYPED_ZALLOC(0, tscache);
+   platform_assert(iceberg_init(tscache,
+                                txn_splinterdb_cfg->tscache_log_slots,
+                                txn_splinterdb_cfg->kvsb_cfg.data_cfg)
+                   == 0);
+   _txn_kvsb->tscache = tscache;
+
+   *txn_kvsb = &_txn_kvsb->super;
+
+   return 0;
+}
@@ -0,0 +1,897 @@
+#include "splinterdb/data.h"
+#include "platform.h"
+#include "data_internal.h"
+#include "splinterdb/transaction.h"
+#include "util.h"
+#include "transaction_internal.h"
+#include "experimental_mode.h"
+#include "splinterdb_internal.h"
+#include "isketch/iceberg_table.h"
+#include "poison.h"
+
+typedef struct tictoc_sketch_splinterdb {
+   transactional_splinterdb         super;
+   splinterdb                      *kvsb;
+   transactional_splinterdb_config *tcfg;
+   iceberg_table                   *tscache;
+   sketch_config                    sktch_config;
+} tictoc_sketch_splinterdb;
+
+// TicToc paper used this structure, but it causes a lot of delta overflow
+/* typedef struct { */
+/*    txn_timestamp lock_bit : 1; */
+/*    txn_timestamp delta : 15; */
+/*    txn_timestamp wts : 48; */
+/* } timestamp_set __attribute__((aligned(sizeof(txn_timestamp)))); */
+
+typedef struct {
+   txn_timestamp lock_bit : 1;
+   txn_timestamp wts : 63;
+   txn_timestamp delta : 64;
+} timestamp_set __attribute__((aligned(sizeof(txn_timestamp))));
+
+static inline bool
+timestamp_set_is_equal(const timestamp_set *s1, const timestamp_set *s2)
+{
+   return memcmp((const void *)s1, (const void *)s2, sizeof(timestamp_set))
+          == 0;
+}
+
+static inline txn_timestamp
+timestamp_set_get_rts(timestamp_set *ts)
+{
+   return ts->wts + ts->delta;
+}
+
+static inline bool
+timestamp_set_compare_and_swap(timestamp_set *ts,
+                               timestamp_set *v1,
+                               timestamp_set *v2)
+{
+   return __atomic_compare_exchange((volatile txn_timestamp *)ts,
+                                    (txn_timestamp *)v1,
+                                    (txn_timestamp *)v2,
+                                    TRUE,
+                                    __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED);
+}
+
+static inline void
+timestamp_set_load(timestamp_set *ts, timestamp_set *v)
+{
+   __atomic_load(
+      (volatile txn_timestamp *)ts, (txn_timestamp *)v, __ATOMIC_RELAXED);
+}
+
+static inline void
+timestamp_set_set_timestamps(txn_timestamp  wts,
+                             txn_timestamp  rts,
+                             timestamp_set *ts)
+{
+   ts->wts   = wts;
+   ts->delta = rts - wts;
+}
+
+static inline void
+timestamp_set_check_invariant(timestamp_set *ts)
+{
+   platform_assert(timestamp_set_get_rts(ts) >= ts->wts);
+}
+
+static void
+sketch_insert_timestamp_set(ValueType *current_value, ValueType new_value)
+{
+   timestamp_set *current_ts = (timestamp_set *)current_value;
+   timestamp_set *new_ts     = (timestamp_set *)&new_value;
+
+   txn_timestamp current_rts = timestamp_set_get_rts(current_ts);
+   txn_timestamp new_rts     = timestamp_set_get_rts(new_ts);
+
+   timestamp_set_set_timestamps(
+      MAX(current_ts->wts, new_ts->wts), MAX(current_rts, new_rts), current_ts);
+}
+
+static void
+sketch_get_timestamp_set(ValueType current_value, ValueType *new_value)
+{
+   timestamp_set *current_ts = (timestamp_set *)&current_value;
+   timestamp_set *new_ts     = (timestamp_set *)new_value;
+
+   txn_timestamp current_rts = timestamp_set_get_rts(current_ts);
+   txn_timestamp new_rts     = timestamp_set_get_rts(new_ts);
+
+   timestamp_set_set_timestamps(
+      MIN(current_ts->wts, new_ts->wts), MIN(current_rts, new_rts), new_ts);
+   timestamp_set_check_invariant(new_ts);
+}
+
+typedef struct rw_entry {
+   slice          key;
+   message        msg; // value + op
+   txn_timestamp  wts;
+   txn_timestamp  rts;
+   timestamp_set *tuple_ts;
+   bool           is_read;
+   bool           is_hot; // read under the lock of the tuple, still held
+} rw_entry;
+
+/*
+ * This function has the following effects:
+ * A. If entry key is not in the cache, it inserts the key in the cache with
+ * refcount=1 and value=0. B. If the key is already in the cache, it just
+ * increases the refcount. C. returns the pointer to the value.
+ */
+static inline bool
+rw_entry_iceberg_insert(tictoc_sketch_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   // Make sure increasing the refcount only once
+   if (entry->tuple_ts) {
+      return FALSE;
+   }
+
+   // increase refcount for key
+   timestamp_set ts = {0};
+   entry->tuple_ts  = &ts;
+   // if there is no item in the cache, it inserts a new item, read a
+   // value from the sketch, and set the bigger one between that and
+   // the given value. As a result, it gets the timestamp greater than
+   // or equals to 0.
+   return iceberg_insert_and_get(txn_kvsb->tscache,
+                                 &entry->key,
+                                 (ValueType **)&entry->tuple_ts,
+                                 platform_get_tid());
+}
+
+static inline void
+rw_entry_iceberg_remove(tictoc_sketch_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   if (!entry->tuple_ts) {
+      return;
+   }
+
+   entry->tuple_ts = NULL;
+
+   iceberg_remove(txn_kvsb->tscache, entry->key, platform_get_tid());
+}
+
+static rw_entry *
+rw_entry_create(transaction *txn)
+{
+   rw_entry *new_entry;
+   new_entry = TYPED_ARENA_ZALLOC(txn->arena, new_entry);
+   new_entry->tuple_ts = NULL;
+   return new_entry;
+}
+
+/*
+ * The msg is the msg from app.
+ */
+static inline void
+rw_entry_set_msg(rw_entry *e, message msg, transaction_arena *arena)
+{
+   e->msg = transaction_arena_copy_message(arena, msg);
+}
+
+static inline bool
+rw_entry_is_read(const rw_entry *entry)
+{
+   return entry->is_read;
+}
+
+static inline bool
+rw_entry_is_write(const rw_entry *entry)
+{
+   return !message_is_null(entry->msg);
+}
+
+/*
+ * Will Set timestamps in entry later
+ */
+static inline rw_entry *
+rw_entry_get(tictoc_sketch_splinterdb *txn_kvsb,
+             transaction              *txn,
+             slice                     user_key,
+             const data_config        *cfg,
+             const bool                is_read)
+{
+   rw_entry *entry = transaction_find_rw_entry(txn, cfg, user_key);
+   if (entry == NULL) {
+      entry      = rw_entry_create(txn);
+      entry->key = transaction_arena_copy_slice(txn->arena, user_key);
+      transaction_append_rw_entry(txn, cfg, entry, entry->key);
+   }
+
+   entry->is_read = entry->is_read || is_read;
+   return entry;
+}
+
+static int
+rw_entry_key_compare(const void *elem1, const void *elem2, void *args)
+{
+   const data_config *cfg = (const data_config *)args;
+
+   rw_entry *e1 = *((rw_entry **)elem1);
+   rw_entry *e2 = *((rw_entry **)elem2);
+
+   key akey = key_create_from_slice(e1->key);
+   key bkey = key_create_from_slice(e2->key);
+
+   return data_key_compare(cfg, akey, bkey);
+}
+
+static inline bool
+rw_entry_try_lock(rw_entry *entry)
+{
+   timestamp_set v1, v2;
+   timestamp_set_load(entry->tuple_ts, &v1);
+   v2 = v1;
+   if (v1.lock_bit) {
+      return FALSE;
+   }
+   v2.lock_bit = 1;
+   return timestamp_set_compare_and_swap(entry->tuple_ts, &v1, &v2);
+}
+
+static inline void
+rw_entry_unlock(rw_entry *entry)
+{
+   timestamp_set v1, v2;
+   do {
+      timestamp_set_load(entry->tuple_ts, &v1);
+      v2          = v1;
+      v2.lock_bit = 0;
+   } while (!timestamp_set_compare_and_swap(entry->tuple_ts, &v1, &v2));
+}
+
+/*
+ * Locks the tuple of entry until txn finishes, for a read of a hot key (see
+ * transaction_hotness.h). Returns FALSE if it stayed locked by others.
+ */
+static bool
+tictoc_sketch_lock_hot(tictoc_sketch_splinterdb *txn_kvsb, rw_entry *entry)
+{
+   uint64 attempt = 0;
+   while (!rw_entry_try_lock(entry)) {
+      if (!transaction_hotness_backoff(&txn_kvsb->super.contention, attempt++))
+      {
+         return FALSE;
+      }
+   }
+   entry->is_hot = TRUE;
+   return TRUE;
+}
+
+static void
+tictoc_sketch_close(tictoc_sketch_splinterdb *_txn_kvsb)
+{
+   iceberg_print_state(_txn_kvsb->tscache);
+
+   splinterdb_close(&_txn_kvsb->kvsb);
+
+   platform_free(0, _txn_kvsb->tscache);
+   platform_free(0, _txn_kvsb->tcfg);
+   platform_free(0, _txn_kvsb);
+}
+
+static void
+tictoc_sketch_register_thread(tictoc_sketch_splinterdb *kvs)
+{
+   splinterdb_register_thread(kvs->kvsb);
+}
+
+static void
+tictoc_sketch_deregister_thread(tictoc_sketch_splinterdb *kvs)
+{
+   splinterdb_deregister_thread(kvs->kvsb);
+}
+
+static int
+tictoc_sketch_begin(tictoc_sketch_splinterdb *txn_kvsb,
+                    transaction              *txn)
+{
+   platform_assert(txn);
+   memset(txn, 0, sizeof(*txn));
+   return 0;
+}
+
+static inline void
+transaction_deinit(tictoc_sketch_splinterdb *txn_kvsb, transaction *txn)
+{
+   for (int i = 0; i < txn->num_rw_entries; ++i) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (entry->is_hot) {
+         rw_entry_unlock(entry);
+         entry->is_hot = FALSE;
+      }
+      rw_entry_iceberg_remove(txn_kvsb, entry);
+   }
+}
+
+static int
+tictoc_sketch_commit(tictoc_sketch_splinterdb *txn_kvsb,
+                     transaction              *txn)
+{
+   txn_timestamp commit_ts = 0;
+
+   int        num_reads   = 0;
+   int        num_writes  = 0;
+   int        num_updates = 0;
+   rw_entry **read_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, read_set, txn->num_rw_entries);
+   rw_entry **write_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, write_set, txn->num_rw_entries);
+   // Commutative updates, which are applied without locks or timestamps
+   rw_entry **update_set =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, update_set, txn->num_rw_entries);
+
+   for (int i = 0; i < txn->num_rw_entries; i++) {
+      rw_entry *entry = txn->rw_entries[i];
+      if (transaction_is_commutative_update(
+             &txn_kvsb->super, rw_entry_is_read(entry), entry->msg))
+      {
+         update_set[num_updates++] = entry;
+      } else if (rw_entry_is_write(entry)) {
+         write_set[num_writes++] = entry;
+      }
+
+      if (rw_entry_is_read(entry)) {
+         read_set[num_reads++] = entry;
+
+         txn_timestamp wts = entry->wts;
+         commit_ts         = MAX(commit_ts, wts);
+      }
+   }
+
+   platform_sort_slow(write_set,
+                      num_writes,
+                      sizeof(rw_entry *),
+                      rw_entry_key_compare,
+                      (void *)txn_kvsb->tcfg->kvsb_cfg.data_cfg,
+                      NULL);
+
+   uint64 lock_attempt = 0;
+RETRY_LOCK_WRITE_SET:
+{
+   for (int lock_num = 0; lock_num < num_writes; ++lock_num) {
+      rw_entry *w = write_set[lock_num];
+      if (w->is_hot) {
+         continue;
+      }
+      if (!w->tuple_ts) {
+         rw_entry_iceberg_insert(txn_kvsb, w);
+      }
+
+      if (!rw_entry_try_lock(w)) {
+         // This is "no-wait" optimization in the TicToc paper.
+         for (int i = 0; i < lock_num; ++i) {
+            if (!write_set[i]->is_hot) {
+               rw_entry_unlock(write_set[i]);
+            }
+         }
+
+         // The hot keys txn holds may be what the holder waits for
+         if (!transaction_hotness_enabled(&txn_kvsb->super.hotness)) {
+            transaction_contention_backoff(&txn_kvsb->super.contention,
+                                           lock_attempt++);
+         } else if (!transaction_hotness_backoff(&txn_kvsb->super.contention,
+                                                 lock_attempt++))
+         {
+            transaction_abort_profile_note(
+               &txn_kvsb->super.aborts, TRANSACTION_ABORT_LOCK_BUSY, w->key);
+            transaction_deinit(txn_kvsb, txn);
+            return TRANSACTION_ABORTED;
+         }
+
+         goto RETRY_LOCK_WRITE_SET;
+      }
+   }
+}
+
+   for (uint64 i = 0; i < num_writes; ++i) {
+      commit_ts =
+         MAX(commit_ts, timestamp_set_get_rts(write_set[i]->tuple_ts) + 1);
+   }
+
+   bool is_abort = !transaction_validate_scans(&txn_kvsb->super, txn);
+   if (is_abort) {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_PHANTOM, NULL_SLICE);
+   }
+   for (uint64 i = 0; !is_abort && i < num_reads; ++i) {
+      rw_entry *r = read_set[i];
+      platform_assert(rw_entry_is_read(r));
+
+      if (r->rts < commit_ts) {
+         bool          is_success;
+         timestamp_set v1, v2;
+         do {
+            is_success = TRUE;
+            timestamp_set_load(r->tuple_ts, &v1);
+            v2                                 = v1;
+            bool          is_wts_different     = r->wts != v1.wts;
+            txn_timestamp rts                  = timestamp_set_get_rts(&v1);
+            bool          is_locked_by_another = rts <= commit_ts
+                                        && r->tuple_ts->lock_bit
+                                        && !rw_entry_is_write(r) && !r->is_hot;
+            if (is_wts_different || is_locked_by_another) {
+               transaction_abort_profile_note(
+                  &txn_kvsb->super.aborts,
+                  is_wts_different ? TRANSACTION_ABORT_READ_CHANGED
+                                   : TRANSACTION_ABORT_READ_LOCKED,
+                  r->key);
+               transaction_hotness_note_conflict(&txn_kvsb->super.hotness,
+                                                 r->key);
+               is_abort = TRUE;
+               break;
+            }
+            if (rts <= commit_ts) {
+               txn_timestamp delta = commit_ts - v1.wts;
+               /* txn_timestamp shift = delta - (delta & 0x7fff); */
+               txn_timestamp shift = delta - (delta & UINT64_MAX);
+               platform_assert(shift == 0);
+               v2.wts += shift;
+               v2.delta = delta - shift;
+               is_success =
+                  timestamp_set_compare_and_swap(r->tuple_ts, &v1, &v2);
+            }
+         } while (!is_success);
+      }
+   }
+
+   int rc = 0;
+   if (!is_abort) {
+      transaction_write_batch batch;
+      transaction_write_batch_init(&batch, txn, num_writes + num_updates);
+      for (uint64 i = 0; i < num_writes; ++i) {
+         rw_entry *w = write_set[i];
+         platform_assert(rw_entry_is_write(w));
+         transaction_write_batch_add(&batch, w->key, w->msg);
+      }
+      for (uint64 i = 0; i < num_updates; ++i) {
+         transaction_write_batch_add(
+            &batch, update_set[i]->key, update_set[i]->msg);
+      }
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+      rc = transaction_write_batch_apply(txn_kvsb->kvsb, &batch);
+#endif
+
+      for (uint64 i = 0; i < num_writes; ++i) {
+         rw_entry *w = write_set[i];
+         timestamp_set v1, v2;
+         do {
+            timestamp_set_load(w->tuple_ts, &v1);
+            v2          = v1;
+            v2.wts      = commit_ts;
+            v2.delta    = 0;
+            v2.lock_bit = 0;
+         } while (!timestamp_set_compare_and_swap(w->tuple_ts, &v1, &v2));
+         w->is_hot = FALSE;
+      }
+   } else {
+      for (uint64 i = 0; i < num_writes; ++i) {
+         rw_entry_unlock(write_set[i]);
+         write_set[i]->is_hot = FALSE;
+      }
+   }
+
+   transaction_deinit(txn_kvsb, txn);
+
+   return is_abort ? TRANSACTION_ABORTED : rc;
+}
+
+static int
+tictoc_sketch_abort(tictoc_sketch_splinterdb *txn_kvsb,
+                    transaction              *txn)
+{
+   transaction_deinit(txn_kvsb, txn);
+
+   return 0;
+}
+
+static int
+local_write(tictoc_sketch_splinterdb *txn_kvsb,
+            transaction              *txn,
+            slice                     user_key,
+            message                   msg)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, FALSE);
+
+   if (message_is_null(entry->msg)) {
+      rw_entry_set_msg(entry, msg, txn->arena);
+   } else {
+      // TODO it needs to be checked later for upsert
+      key       wkey = key_create_from_slice(entry->key);
+      const key ukey = key_create_from_slice(user_key);
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         if (message_is_definitive(msg)) {
+            rw_entry_set_msg(entry, msg, txn->arena);
+         } else {
+            platform_assert(message_class(entry->msg) != MESSAGE_TYPE_DELETE);
+
+            merge_accumulator new_message;
+            merge_accumulator_init_from_message(&new_message, 0, msg);
+            data_merge_tuples(cfg, ukey, entry->msg, &new_message);
+            entry->msg = transaction_arena_copy_message(
+               txn->arena, merge_accumulator_to_message(&new_message));
+            merge_accumulator_deinit(&new_message);
+         }
+      }
+   }
+   return 0;
+}
+
+static int
+tictoc_sketch_insert(tictoc_sketch_splinterdb *txn_kvsb,
+                     transaction              *txn,
+                     slice                     user_key,
+                     slice                     value)
+{
+   if (!txn) {
+      return splinterdb_insert(txn_kvsb->kvsb, user_key, value);
+   }
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+static int
+tictoc_sketch_delete(tictoc_sketch_splinterdb *txn_kvsb,
+                     transaction              *txn,
+                     slice                     user_key)
+{
+   return local_write(txn_kvsb, txn, user_key, DELETE_MESSAGE);
+}
+
+static int
+tictoc_sketch_update(tictoc_sketch_splinterdb *txn_kvsb,
+                     transaction              *txn,
+                     slice                     user_key,
+                     slice                     delta)
+{
+   return local_write(
+      txn_kvsb, txn, user_key, message_create(MESSAGE_TYPE_UPDATE, delta));
+}
+
+/*
+ * Reads what txn sees of entry into result: the stored value, with the write
+ * txn has pending on the key, if any, over it.
+ */
+static inline int
+tictoc_sketch_read(tictoc_sketch_splinterdb *txn_kvsb,
+                   rw_entry                 *entry,
+                   splinterdb_lookup_result *result)
+{
+   int rc = 0;
+#if EXPERIMENTAL_MODE_BYPASS_SPLINTERDB == 0
+   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   // An update of txn applies to the stored value, which is read and
+   // validated like any other
+   if (!rw_entry_is_write(entry) || !message_is_definitive(entry->msg)) {
+      rc = splinterdb_lookup(txn_kvsb->kvsb, entry->key, result);
+   }
+   if (rc == 0 && rw_entry_is_write(entry)) {
+      // read my write
+      // TODO if it was an insert or a delete, this read should not be
+      // considered for validation. entry->is_read should be false.
+      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+      transaction_read_own_write(cfg, entry->key, entry->msg, &_result->value);
+   }
+#endif
+   return rc;
+}
+
+static int
+tictoc_sketch_lookup(tictoc_sketch_splinterdb *txn_kvsb,
+                     transaction              *txn,
+                     slice                     user_key,
+                     splinterdb_lookup_result *result)
+{
+   const data_config *cfg   = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   rw_entry          *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+
+   int rc = 0;
+
+   rw_entry_iceberg_insert(txn_kvsb, entry);
+
+   if (!entry->is_hot
+       && transaction_hotness_is_hot(&txn_kvsb->super.hotness, entry->key)
+       && !tictoc_sketch_lock_hot(txn_kvsb, entry))
+   {
+      transaction_abort_profile_note(
+         &txn_kvsb->super.aborts, TRANSACTION_ABORT_LOCK_BUSY, entry->key);
+      tictoc_sketch_abort(txn_kvsb, txn);
+      return TRANSACTION_ABORTED;
+   }
+
+   timestamp_set v1;
+   if (entry->is_hot) {
+      // Nobody else writes the tuple while txn holds its lock
+      timestamp_set_load(entry->tuple_ts, &v1);
+      rc = tictoc_sketch_read(txn_kvsb, entry, result);
+   } else {
+      uint64 locked_attempts = 0;
+      do {
+         timestamp_set_load(entry->tuple_ts, &v1);
+         if (v1.lock_bit) {
+            if (!transaction_hotness_wait_locked_read(
+                   &txn_kvsb->super.hotness,
+                   &txn_kvsb->super.contention,
+                   locked_attempts++))
+            {
+               transaction_abort_profile_note(&txn_kvsb->super.aborts,
+                                              TRANSACTION_ABORT_READ_LOCKED,
+                                              entry->key);
+               transaction_hotness_note_conflict(&txn_kvsb->super.hotness,
+                                                 entry->key);
+               tictoc_sketch_abort(txn_kvsb, txn);
+               return TRANSACTION_ABORTED;
+            }
+            // The loop condition does not let a locked v1 through
+            continue;
+         }
+         rc = tictoc_sketch_read(txn_kvsb, entry, result);
+      } while (v1.lock_bit
+               || !timestamp_set_compare_and_swap(entry->tuple_ts, &v1, &v1));
+      if (locked_attempts) {
+         transaction_contention_end_locked_read(&txn_kvsb->super.contention);
+      }
+   }
+
+   entry->wts = v1.wts;
+   entry->rts = timestamp_set_get_rts(&v1);
+
+   return rc;
+}
+
+/*
+ * Reads the timestamps of a key an iterator of txn returned, see scan_read in
+ * transactional_splinterdb_ops.
+ */
+static bool
+tictoc_sketch_scan_read(tictoc_sketch_splinterdb *txn_kvsb,
+                        transaction              *txn,
+                        slice                     user_key)
+{
+   const data_config *cfg = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   if (transaction_find_rw_entry(txn, cfg, user_key)) {
+      // A write of txn validates itself, and a read keeps its timestamps
+      return TRUE;
+   }
+   rw_entry *entry = rw_entry_get(txn_kvsb, txn, user_key, cfg, TRUE);
+   rw_entry_iceberg_insert(txn_kvsb, entry);
+
+   // Unlike a lookup, do not wait long on a locked key: the iterator may
+   // hold the leaf its writer installs into. That write changes what the
+   // scan saw anyway.
+   timestamp_set v1;
+   uint64        spins = 0;
+   for (timestamp_set_load(entry->tuple_ts, &v1); v1.lock_bit;
+        timestamp_set_load(entry->tuple_ts, &v1))
+   {
+      if (spins++ == txn_kvsb->super.contention.read_wait_spins) {
+         return FALSE;
+      }
+      platform_pause();
+   }
+
+   entry->wts = v1.wts;
+   entry->rts = timestamp_set_get_rts(&v1);
+   return TRUE;
+}
+
+static void
+tictoc_sketch_lookup_result_init(
+   tictoc_sketch_splinterdb *txn_kvsb,   // IN
+   splinterdb_lookup_result *result,     // IN/OUT
+   uint64                    buffer_len, // IN
+   char                     *buffer      // IN
+)
+{
+   return splinterdb_lookup_result_init(
+      txn_kvsb->kvsb, result, buffer_len, buffer);
+}
+
+static void
+tictoc_sketch_set_isolation_level(tictoc_sketch_splinterdb   *txn_kvsb,
+                                  transaction_isolation_level isol_level)
+{
+   platform_assert(isol_level > TRANSACTION_ISOLATION_LEVEL_INVALID);
+   platform_assert(isol_level < TRANSACTION_ISOLATION_LEVEL_MAX_VALID);
+
+   txn_kvsb->tcfg->isol_level = isol_level;
+}
+
+static const splinterdb *
+tictoc_sketch_get_db(tictoc_sketch_splinterdb *txn_kvsb)
+{
+   return txn_kvsb->kvsb;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * Virtual functions
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+tictoc_sketch_close_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   tictoc_sketch_close(_txn_kvsb);
+}
+
+static void
+tictoc_sketch_register_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   tictoc_sketch_register_thread(_txn_kvsb);
+}
+
+static void
+tictoc_sketch_deregister_thread_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   tictoc_sketch_deregister_thread(_txn_kvsb);
+}
+
+static int
+tictoc_sketch_begin_virtual(transactional_splinterdb *txn_kvsb,
+                            transaction              *txn)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_begin(_txn_kvsb, txn);
+}
+
+static int
+tictoc_sketch_commit_virtual(transactional_splinterdb *txn_kvsb,
+                             transaction              *txn)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_commit(_txn_kvsb, txn);
+}
+
+static int
+tictoc_sketch_abort_virtual(transactional_splinterdb *txn_kvsb,
+                            transaction              *txn)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_abort(_txn_kvsb, txn);
+}
+
+static int
+tictoc_sketch_insert_virtual(transactional_splinterdb *txn_kvsb,
+                             transaction              *txn,
+                             slice                     user_key,
+                             slice                     value)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_insert(_txn_kvsb, txn, user_key, value);
+}
+
+static int
+tictoc_sketch_delete_virtual(transactional_splinterdb *txn_kvsb,
+                             transaction              *txn,
+                             slice                     user_key)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_delete(_txn_kvsb, txn, user_key);
+}
+
+static int
+tictoc_sketch_update_virtual(transactional_splinterdb *txn_kvsb,
+                             transaction              *txn,
+                             slice                     user_key,
+                             slice                     delta)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_update(_txn_kvsb, txn, user_key, delta);
+}
+
+static int
+tictoc_sketch_lookup_virtual(transactional_splinterdb *txn_kvsb,
+                             transaction              *txn,
+                             slice                     user_key,
+                             splinterdb_lookup_result *result)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_lookup(_txn_kvsb, txn, user_key, result);
+}
+
+static void
+tictoc_sketch_lookup_result_init_virtual(transactional_splinterdb *txn_kvsb,
+                                         splinterdb_lookup_result *result,
+                                         uint64                    buffer_len,
+                                         char                     *buffer)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   tictoc_sketch_lookup_result_init(_txn_kvsb, result, buffer_len, buffer);
+}
+
+static void
+tictoc_sketch_set_isolation_level_virtual(
+   transactional_splinterdb   *txn_kvsb,
+   transaction_isolation_level isol_level)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   tictoc_sketch_set_isolation_level(_txn_kvsb, isol_level);
+}
+
+static const splinterdb *
+tictoc_sketch_get_db_virtual(transactional_splinterdb *txn_kvsb)
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_get_db(_txn_kvsb);
+}
+
+static bool
+tictoc_sketch_scan_read_virtual(transactional_splinterdb *txn_kvsb,
+                                transaction              *txn,
+                                slice                     key,
+                                slice                     UNUSED_PARAM(stored))
+{
+   tictoc_sketch_splinterdb *_txn_kvsb = (tictoc_sketch_splinterdb *)txn_kvsb;
+   return tictoc_sketch_scan_read(_txn_kvsb, txn, key);
+}
+
+static const transactional_splinterdb_ops tictoc_sketch_ops = {
+   .close               = tictoc_sketch_close_virtual,
+   .register_thread     = tictoc_sketch_register_thread_virtual,
+   .deregister_thread   = tictoc_sketch_deregister_thread_virtual,
+   .begin               = tictoc_sketch_begin_virtual,
+   .commit              = tictoc_sketch_commit_virtual,
+   .abort               = tictoc_sketch_abort_virtual,
+   .insert              = tictoc_sketch_insert_virtual,
+   .delete              = tictoc_sketch_delete_virtual,
+   .update              = tictoc_sketch_update_virtual,
+   .lookup              = tictoc_sketch_lookup_virtual,
+   .lookup_result_init  = tictoc_sketch_lookup_result_init_virtual,
+   .set_isolation_level = tictoc_sketch_set_isolation_level_virtual,
+   .get_db              = tictoc_sketch_get_db_virtual,
+   .scan_read           = tictoc_sketch_scan_read_virtual,
+};
+
+int
+tictoc_sketch_create_or_open(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing)
+{
+   transactional_splinterdb_config *txn_splinterdb_cfg;
+   txn_splinterdb_cfg = TYPED_ZALLOC(0, txn_splinterdb_cfg);
+   memcpy(txn_splinterdb_cfg, txn_kvsb_cfg, sizeof(*txn_splinterdb_cfg));
+
+   tictoc_sketch_splinterdb *_txn_kvsb;
+   _txn_kvsb             = TYPED_ZALLOC(0, _txn_kvsb);
+   _txn_kvsb->super.ops = &tictoc_sketch_ops;
+   _txn_kvsb->tcfg      = txn_splinterdb_cfg;
+
+   int rc = splinterdb_create_or_open(
+      &txn_splinterdb_cfg->kvsb_cfg, &_txn_kvsb->kvsb, open_existing);
+   bool fail_to_create_splinterdb = (rc != 0);
+   if (fail_to_create_splinterdb) {
+      platform_free(0, _txn_kvsb);
+      platform_free(0, txn_splinterdb_cfg);
+      return rc;
+   }
+
+   sketch_config_default_init(&_txn_kvsb->sktch_config);
+
+   _txn_kvsb->sktch_config.insert_value_fn = &sketch_insert_timestamp_set;
+   _txn_kvsb->sktch_config.get_value_fn    = &sketch_get_timestamp_set;
+   _txn_kvsb->sktch_config.rows            = txn_splinterdb_cfg->sketch_rows;
+   _txn_kvsb->sktch_config.cols            = txn_splinterdb_cfg->sketch_cols;
+
+   iceberg_table *tscache;
+   tscache = TYPED_ZALLOC(0, tscache);
+   platform_assert(
+      iceberg_init_with_sketch(tscache,
+                               txn_splinterdb_cfg->tscache_log_slots,
+                               txn_splinterdb_cfg->kvsb_cfg.data_cfg,
+                               &_txn_kvsb->sktch_config)
+      == 0);
+   _txn_kvsb->tscache = tscache;
+
+   *txn_kvsb = &_txn_kvsb->super;
+
+   return 0;
+}
@@ -0,0 +1,358 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_internal.h --
+ *
+ *     The interface every concurrency control protocol in transaction_impl/
+ *     implements. transaction.c chooses the protocol from
+ *     transactional_splinterdb_config at create/open time and forwards the
+ *     public transactional_splinterdb_* calls through the ops table below.
+ */
+
+#pragma once
+
+#include "splinterdb/transaction.h"
+#include "platform.h"
+#include "transaction_abort_profile.h"
+#include "transaction_arena.h"
+#include "transaction_contention.h"
+#include "transaction_histogram.h"
+#include "transaction_hotness.h"
+#include "transaction_timestamp.h"
+
+typedef uint128 txn_timestamp;
+
+// The disk-based protocols store their timestamps next to each tuple, so
+// they keep them small.
+typedef uint32 txn_disk_timestamp;
+
+typedef void (*transactional_splinterdb_close_fn)(
+   transactional_splinterdb *txn_kvsb);
+typedef void (*transactional_splinterdb_thread_fn)(
+   transactional_splinterdb *txn_kvsb);
+typedef int (*transactional_splinterdb_txn_fn)(
+   transactional_splinterdb *txn_kvsb,
+   transaction              *txn);
+typedef int (*transactional_splinterdb_write_fn)(
+   transactional_splinterdb *txn_kvsb,
+   transaction              *txn,
+   slice                     user_key,
+   slice                     value);
+typedef int (*transactional_splinterdb_delete_fn)(
+   transactional_splinterdb *txn_kvsb,
+   transaction              *txn,
+   slice                     user_key);
+typedef int (*transactional_splinterdb_lookup_fn)(
+   transactional_splinterdb *txn_kvsb,
+   transaction              *txn,
+   slice                     user_key,
+   splinterdb_lookup_result *result);
+typedef void (*transactional_splinterdb_lookup_result_init_fn)(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_lookup_result *result,
+   uint64                    buffer_len,
+   char                     *buffer);
+typedef void (*transactional_splinterdb_set_isolation_level_fn)(
+   transactional_splinterdb   *txn_kvsb,
+   transaction_isolation_level isol_level);
+typedef const splinterdb *(*transactional_splinterdb_get_db_fn)(
+   transactional_splinterdb *txn_kvsb);
+typedef bool (*transactional_splinterdb_scan_value_fn)(
+   transactional_splinterdb *txn_kvsb,
+   transaction              *txn,
+   slice                     key,
+   slice                     stored,
+   slice                    *value);
+typedef bool (*transactional_splinterdb_scan_read_fn)(
+   transactional_splinterdb *txn_kvsb,
+   transaction              *txn,
+   slice                     key,
+   slice                     stored);
+
+/*
+ * An operation or commit that aborts its transaction over a conflict returns
+ * TRANSACTION_ABORTED, once the transaction holds nothing anymore. An
+ * operation that fails with any other error leaves the transaction as it
+ * is, and transaction.c aborts it through the abort op.
+ */
+typedef struct transactional_splinterdb_ops {
+   transactional_splinterdb_close_fn               close;
+   transactional_splinterdb_thread_fn              register_thread;
+   transactional_splinterdb_thread_fn              deregister_thread;
+   transactional_splinterdb_txn_fn                 begin;
+   transactional_splinterdb_txn_fn                 commit;
+   transactional_splinterdb_txn_fn                 abort;
+   transactional_splinterdb_write_fn               insert;
+   transactional_splinterdb_delete_fn              delete;
+   transactional_splinterdb_write_fn               update;
+   transactional_splinterdb_lookup_fn              lookup;
+   transactional_splinterdb_lookup_result_init_fn  lookup_result_init;
+   transactional_splinterdb_set_isolation_level_fn set_isolation_level;
+   transactional_splinterdb_get_db_fn              get_db;
+   // Optional. Sets *value to the value txn sees in what the protocol stored
+   // for key, or returns FALSE if key does not exist for txn. Without
+   // it, transactional iterators skip value_header_size bytes instead.
+   transactional_splinterdb_scan_value_fn scan_value;
+   // Optional. Adds a key an iterator of txn returned, with what the
+   // protocol stored for it, to the reads of txn, as a lookup would but
+   // without aborting. Returns FALSE if txn cannot commit after that read,
+   // which fails its commit. Protocols that order transactions as they
+   // commit, like silo, or keep their reads locked, like 2pl, do not need
+   // it.
+   transactional_splinterdb_scan_read_fn scan_read;
+} transactional_splinterdb_ops;
+
+/*
+ * What a thread shows the others of the commit it is in. Managed by
+ * transaction_scan.c.
+ */
+typedef struct transaction_commit_slot {
+   // Odd while the thread is past transaction_validate_scans() in a commit
+   uint64 seq;
+   // The scans of the committing transaction, from before they are walked
+   // again until the commit ends
+   transaction_scan *scans;
+   // Threads reading scans, which stays valid until they are done
+   uint64 readers;
+} PLATFORM_CACHELINE_ALIGNED transaction_commit_slot;
+
+// To implement a protocol, make a transactional_splinterdb your first field
+struct transactional_splinterdb {
+   const transactional_splinterdb_ops *ops;
+
+   // Arenas of finished transactions, kept per thread for reuse. Managed by
+   // transaction.c.
+   transaction_arena *idle_arenas[MAX_THREADS];
+
+   // Bytes the protocol stores in front of every value in splinterdb, which
+   // transactional iterators skip.
+   uint64 value_header_size;
+
+   // The application's, which orders the keys of scans. Set by
+   // transaction.c.
+   const data_config *app_data_cfg;
+
+   // Managed by transaction_scan.c
+   transaction_commit_slot commits[MAX_THREADS];
+   // How many slots of commits have scans
+   cache_aligned_uint64 num_published_scans;
+   // Whether scanning commits run platform_heavy_barrier(), which spares the
+   // other commits a fence. Set by transaction.c.
+   bool heavy_scan_barrier;
+
+   // Whether commits wait for the log to be on disk. Set by transaction.c.
+   bool sync_commits;
+
+   // Whether writes that are only updates skip locking and validation, see
+   // transactional_splinterdb_config. Set by transaction.c.
+   bool commutative_updates;
+
+   // Consulted by the protocols whenever a lock they need is taken. Told
+   // about commits and aborts by transaction.c.
+   transaction_contention contention;
+
+   // Timestamps of begin, for the protocols that need them. Set up by
+   // transaction.c.
+   transaction_timestamp_allocator timestamps;
+
+   // Why transactions abort and on which keys. Protocols note the reason of
+   // every abort they decide on, and transaction.c counts it.
+   transaction_abort_profile aborts;
+
+   // How long the phases of transactions take, if enabled. Recorded by
+   // transaction.c.
+   transaction_phase_stats phases;
+
+   // Which keys the optimistic protocols read under a lock. They note the
+   // conflicts of their reads in it. Set up by transaction.c.
+   transaction_hotness hotness;
+};
+
+#define TRANSACTION_MIN_RW_ENTRIES 16
+
+// Past this many entries the read/write set is looked up through a hash
+// index instead of a linear scan. Define it to UINT64_MAX to turn the index
+// off.
+#ifndef TRANSACTION_RW_INDEX_THRESHOLD
+#   define TRANSACTION_RW_INDEX_THRESHOLD 16
+#endif
+
+// A slot of the open-addressing index over the read/write set
+struct rw_index_slot {
+   uint32 hash;
+   uint32 pos; // 1 + the position in rw_entries, 0 if the slot is empty
+};
+
+/*
+ * Returns the entry of key in the read/write set of txn, or NULL if txn has
+ * not accessed key yet.
+ */
+rw_entry *
+transaction_find_rw_entry(transaction       *txn,
+                          const data_config *cfg,
+                          slice              key);
+
+/*
+ * Appends entry to the read/write set of txn, growing the set if needed. key
+ * must stay valid until the transaction finishes, e.g. by living in the
+ * arena of txn.
+ */
+void
+transaction_append_rw_entry(transaction       *txn,
+                            const data_config *cfg,
+                            rw_entry          *entry,
+                            slice              key);
+
+/*
+ * Removes the entry appended last from the read/write set of txn.
+ */
+void
+transaction_pop_rw_entry(transaction *txn, const data_config *cfg);
+
+/*
+ * Applies the UPDATE in delta to base, which is an INSERT, an UPDATE, or a
+ * DELETE to apply it to nothing. delta is left holding an INSERT, unless
+ * base is an UPDATE too or the application turned it into a DELETE.
+ */
+void
+transaction_apply_delta(const data_config *app_cfg,
+                        slice              user_key,
+                        message            base,
+                        merge_accumulator *delta);
+
+/*
+ * Makes a lookup of user_key see msg, the write its transaction has pending
+ * on the key, on top of *value, what the lookup found in splinterdb (null if
+ * nothing). An INSERT or a DELETE replaces *value, and an UPDATE is applied
+ * to it. msg and *value hold values of the application, without the header
+ * of the protocol.
+ */
+void
+transaction_read_own_write(const data_config *app_cfg,
+                           slice              user_key,
+                           message            msg,
+                           merge_accumulator *value);
+
+/*
+ * Whether a commit applies msg, the write its transaction has pending on a
+ * key, without locking or validating the key: commutative_updates is on,
+ * and the transaction only updated the key, without reading it (is_read).
+ */
+static inline bool
+transaction_is_commutative_update(const transactional_splinterdb *txn_kvsb,
+                                  bool                            is_read,
+                                  message                         msg)
+{
+   return txn_kvsb->commutative_updates && !is_read && !message_is_null(msg)
+          && message_class(msg) == MESSAGE_TYPE_UPDATE;
+}
+
+/*
+ * The writes a commit installs, gathered so that they reach splinterdb in a
+ * single splinterdb_write_batch().
+ */
+typedef struct transaction_write_batch {
+   splinterdb_write *writes;
+   uint64            num_writes;
+} transaction_write_batch;
+
+/*
+ * Makes room for max_writes writes in the arena of txn. Protocols call it
+ * once a commit is validated and about to install its writes, which is where
+ * the write phase of txn starts.
+ */
+void
+transaction_write_batch_init(transaction_write_batch *batch,
+                             transaction             *txn,
+                             uint64                   max_writes);
+
+/*
+ * Adds the write of msg to key. Messages that are not an INSERT, an UPDATE
+ * or a DELETE are skipped. key and msg must stay valid until the batch is
+ * applied.
+ */
+void
+transaction_write_batch_add(transaction_write_batch *batch,
+                            slice                    key,
+                            message                  msg);
+
+/*
+ * Writes the batch to splinterdb. If it fails, some of the writes may be in
+ * already (see splinterdb_write_batch()), so protocols release the locks of
+ * the commit as if it succeeded and return the error.
+ */
+static inline int
+transaction_write_batch_apply(const splinterdb              *kvsb,
+                              const transaction_write_batch *batch)
+{
+   return splinterdb_write_batch(kvsb, batch->num_writes, batch->writes);
+}
+
+/*
+ * Scans the ranges txn read through transactional iterators again, and
+ * returns FALSE if any of them changed since, in which case the protocol must
+ * abort txn as if a read had failed validation.
+ *
+ * Protocols call this from commit once their write set is locked, or right
+ * away if they lock as they go, and before they validate reads or install
+ * writes. It waits for the commits that are installing writes at that point
+ * to finish. It also returns FALSE if txn accessed a key in the range of a
+ * scan another thread is committing, as txn could not be ordered after that
+ * commit. Every commit must call it, even without scans, unless the protocol
+ * does not protect scans at all, like mvcc under snapshot isolation.
+ */
+bool
+transaction_validate_scans(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn);
+
+/*
+ * Ends the commit started by transaction_validate_scans(), if any. Called by
+ * transaction.c once the protocol has committed or aborted.
+ */
+void
+transaction_finish_commit(transactional_splinterdb *txn_kvsb);
+
+/*
+ * Constructors of each protocol. txn_kvsb_cfg has already been filled with
+ * the defaults of its protocol by transactional_splinterdb_config_init().
+ */
+int
+tictoc_disk_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                           transactional_splinterdb             **txn_kvsb,
+                           bool open_existing);
+int
+tictoc_memory_create_or_open(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing);
+int
+tictoc_sketch_create_or_open(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing);
+int
+sto_disk_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                        transactional_splinterdb             **txn_kvsb,
+                        bool                                   open_existing);
+int
+sto_memory_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                          transactional_splinterdb             **txn_kvsb,
+                          bool open_existing);
+int
+sto_sketch_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                          transactional_splinterdb             **txn_kvsb,
+                          bool open_existing);
+int
+two_phase_locking_create_or_open(
+   const transactional_splinterdb_config *txn_kvsb_cfg,
+   transactional_splinterdb             **txn_kvsb,
+   bool                                   open_existing);
+int
+silo_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                    transactional_splinterdb             **txn_kvsb,
+                    bool                                   open_existing);
+int
+mvcc_create_or_open(const transactional_splinterdb_config *txn_kvsb_cfg,
+                    transactional_splinterdb             **txn_kvsb,
+                    bool                                   open_existing);
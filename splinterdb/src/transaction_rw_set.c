@@ -0,0 +1,267 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_rw_set.c --
+ *
+ *     The read/write set of a transaction, shared by all the protocols.
+ *
+ *     Small sets are searched linearly. Once a set has more than
+ *     TRANSACTION_RW_INDEX_THRESHOLD entries, an open-addressing index
+ *     (linear probing, at most half full) is built over the keys in the
+ *     arena of the transaction, so that a lookup costs O(1) key comparisons
+ *     no matter how many keys the transaction touches.
+ *
+ *     Lookups see the pending writes of their own transaction, merged over
+ *     the stored value like splinterdb would merge them once committed. At
+ *     commit, the write set goes into splinterdb as one batch.
+ */
+
+#include "transaction_internal.h"
+#include "data_internal.h"
+#include "poison.h"
+
+static inline uint32
+rw_key_hash(const data_config *cfg, slice key)
+{
+   return cfg->key_hash(slice_data(key), slice_length(key), 0);
+}
+
+static inline bool
+rw_key_equal(const data_config *cfg, slice key1, slice key2)
+{
+   return data_key_compare(
+             cfg, key_create_from_slice(key1), key_create_from_slice(key2))
+          == 0;
+}
+
+static void
+rw_index_insert(transaction *txn, uint32 hash, uint32 pos)
+{
+   uint64 mask = txn->rw_index_size - 1;
+   uint64 i    = hash & mask;
+   while (txn->rw_index[i].pos) {
+      i = (i + 1) & mask;
+   }
+   txn->rw_index[i].hash = hash;
+   txn->rw_index[i].pos  = pos;
+}
+
+/*
+ * Replaces the index of txn with one of the given size. The old index, if
+ * any, is left in the arena.
+ */
+static void
+rw_index_rebuild(transaction *txn, const data_config *cfg, uint64 size)
+{
+   rw_index_slot *old_index = txn->rw_index;
+   uint64         old_size  = txn->rw_index_size;
+
+   txn->rw_index = TYPED_ARENA_ARRAY_MALLOC(txn->arena, txn->rw_index, size);
+   memset(txn->rw_index, 0, size * sizeof(*txn->rw_index));
+   txn->rw_index_size = size;
+
+   if (old_index) {
+      for (uint64 i = 0; i < old_size; i++) {
+         if (old_index[i].pos) {
+            rw_index_insert(txn, old_index[i].hash, old_index[i].pos);
+         }
+      }
+   } else {
+      for (uint64 i = 0; i < txn->num_rw_entries; i++) {
+         rw_index_insert(txn, rw_key_hash(cfg, txn->rw_keys[i]), i + 1);
+      }
+   }
+}
+
+rw_entry *
+transaction_find_rw_entry(transaction       *txn,
+                          const data_config *cfg,
+                          slice              key)
+{
+   if (!txn->rw_index) {
+      for (uint64 i = 0; i < txn->num_rw_entries; i++) {
+         if (rw_key_equal(cfg, key, txn->rw_keys[i])) {
+            return txn->rw_entries[i];
+         }
+      }
+      return NULL;
+   }
+
+   uint32 hash = rw_key_hash(cfg, key);
+   uint64 mask = txn->rw_index_size - 1;
+   for (uint64 i = hash & mask; txn->rw_index[i].pos; i = (i + 1) & mask) {
+      uint64 pos = txn->rw_index[i].pos - 1;
+      if (txn->rw_index[i].hash == hash
+          && rw_key_equal(cfg, key, txn->rw_keys[pos]))
+      {
+         return txn->rw_entries[pos];
+      }
+   }
+   return NULL;
+}
+
+void
+transaction_append_rw_entry(transaction       *txn,
+                            const data_config *cfg,
+                            rw_entry          *entry,
+                            slice              key)
+{
+   if (txn->num_rw_entries == txn->max_rw_entries) {
+      // The set lives in the arena of txn, so the old arrays are simply
+      // abandoned when it grows.
+      uint64 max_rw_entries =
+         MAX(2 * txn->max_rw_entries, TRANSACTION_MIN_RW_ENTRIES);
+      rw_entry **rw_entries =
+         TYPED_ARENA_ARRAY_MALLOC(txn->arena, rw_entries, max_rw_entries);
+      slice *rw_keys =
+         TYPED_ARENA_ARRAY_MALLOC(txn->arena, rw_keys, max_rw_entries);
+      if (txn->num_rw_entries) {
+         memcpy(rw_entries,
+                txn->rw_entries,
+                txn->num_rw_entries * sizeof(*rw_entries));
+         memcpy(rw_keys, txn->rw_keys, txn->num_rw_entries * sizeof(*rw_keys));
+      }
+      txn->rw_entries     = rw_entries;
+      txn->rw_keys        = rw_keys;
+      txn->max_rw_entries = max_rw_entries;
+   }
+
+   if (txn->rw_index && 2 * (txn->num_rw_entries + 1) > txn->rw_index_size) {
+      rw_index_rebuild(txn, cfg, 2 * txn->rw_index_size);
+   }
+
+   txn->rw_entries[txn->num_rw_entries] = entry;
+   txn->rw_keys[txn->num_rw_entries]    = key;
+   txn->num_rw_entries++;
+
+   if (txn->rw_index) {
+      rw_index_insert(txn, rw_key_hash(cfg, key), txn->num_rw_entries);
+   } else if (txn->num_rw_entries > TRANSACTION_RW_INDEX_THRESHOLD) {
+      uint64 size = 1;
+      while (size < 4 * txn->num_rw_entries) {
+         size *= 2;
+      }
+      rw_index_rebuild(txn, cfg, size);
+   }
+}
+
+void
+transaction_pop_rw_entry(transaction *txn, const data_config *cfg)
+{
+   platform_assert(txn->num_rw_entries > 0);
+
+   if (txn->rw_index) {
+      uint32 pos  = txn->num_rw_entries;
+      uint64 mask = txn->rw_index_size - 1;
+      uint64 i    = rw_key_hash(cfg, txn->rw_keys[pos - 1]) & mask;
+      while (txn->rw_index[i].pos != pos) {
+         i = (i + 1) & mask;
+      }
+
+      // Backward-shift deletion: move up the slots after i whose home is
+      // not between i and themselves, so no probe sequence crosses an
+      // empty slot.
+      uint64 j = i;
+      while (TRUE) {
+         j = (j + 1) & mask;
+         if (!txn->rw_index[j].pos) {
+            break;
+         }
+         uint64 home = txn->rw_index[j].hash & mask;
+         if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+            continue;
+         }
+         txn->rw_index[i] = txn->rw_index[j];
+         i                = j;
+      }
+      txn->rw_index[i].pos = 0;
+   }
+
+   txn->num_rw_entries--;
+}
+
+void
+transaction_apply_delta(const data_config *app_cfg,
+                        slice              user_key,
+                        message            base,
+                        merge_accumulator *delta)
+{
+   key tuple_key = key_create_from_slice(user_key);
+   if (message_class(base) == MESSAGE_TYPE_DELETE) {
+      data_merge_tuples_final(app_cfg, tuple_key, delta);
+   } else {
+      data_merge_tuples(app_cfg, tuple_key, base, delta);
+   }
+
+   // Applications do not have to set the class of what they merged
+   if (message_class(base) != MESSAGE_TYPE_UPDATE
+       && merge_accumulator_message_class(delta) == MESSAGE_TYPE_UPDATE)
+   {
+      merge_accumulator_set_class(delta, MESSAGE_TYPE_INSERT);
+   }
+}
+
+void
+transaction_read_own_write(const data_config *app_cfg,
+                           slice              user_key,
+                           message            msg,
+                           merge_accumulator *value)
+{
+   switch (message_class(msg)) {
+      case MESSAGE_TYPE_DELETE:
+         merge_accumulator_set_to_null(value);
+         break;
+      case MESSAGE_TYPE_UPDATE:
+      {
+         message base = merge_accumulator_is_null(value)
+                           ? DELETE_MESSAGE
+                           : merge_accumulator_to_message(value);
+         merge_accumulator merged;
+         merge_accumulator_init_from_message(&merged, 0, msg);
+         transaction_apply_delta(app_cfg, user_key, base, &merged);
+         if (merge_accumulator_message_class(&merged) == MESSAGE_TYPE_DELETE)
+         {
+            merge_accumulator_set_to_null(value);
+         } else {
+            merge_accumulator_copy_message(
+               value, merge_accumulator_to_message(&merged));
+         }
+         merge_accumulator_deinit(&merged);
+         break;
+      }
+      default:
+         merge_accumulator_copy_message(value, msg);
+         break;
+   }
+}
+
+void
+transaction_write_batch_init(transaction_write_batch *batch,
+                             transaction             *txn,
+                             uint64                   max_writes)
+{
+   if (txn->begin_ns) {
+      txn->write_ns = platform_get_timestamp();
+   }
+   batch->writes =
+      TYPED_ARENA_ARRAY_MALLOC(txn->arena, batch->writes, max_writes);
+   batch->num_writes = 0;
+}
+
+void
+transaction_write_batch_add(transaction_write_batch *batch,
+                            slice                    key,
+                            message                  msg)
+{
+   switch (message_class(msg)) {
+      case MESSAGE_TYPE_INSERT:
+      case MESSAGE_TYPE_UPDATE:
+      case MESSAGE_TYPE_DELETE:
+         batch->writes[batch->num_writes++] = (splinterdb_write){
+            .type = message_class(msg), .key = key, .value = message_slice(msg)};
+         break;
+      default:
+         break;
+   }
+}
@@ -0,0 +1,405 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_scan.c --
+ *
+ *     Transactional iterators, shared by all the protocols.
+ *
+ *     An iterator is a plain splinterdb_iterator that folds every key and
+ *     value it returns into a digest. At commit, once the protocol has
+ *     locked its write set, each scanned range is walked again and its
+ *     digest compared, which catches keys inserted into or deleted from the
+ *     range (phantoms) as well as changed values.
+ *
+ *     Every key an iterator returns is also read by its transaction through
+ *     the scan_read op of the protocol, so that the protocol orders the
+ *     transaction after the writes it saw, as it does for lookups. Without
+ *     it, a TicToc transaction could read a key, then scan the write of a
+ *     transaction that overwrote that key, and still commit.
+ *
+ *     A write that is installed after that second walk must not be ordered
+ *     before the scanning transaction. Locks do not ensure it: a transaction
+ *     that read a key the scanning one has locked may still validate, e.g.
+ *     under TicToc when it commits at an earlier timestamp. So a scanning
+ *     commit publishes its ranges in its commit slot, then waits for the
+ *     commits that are past validate_scans at that point. Every commit marks
+ *     its slot once past validate_scans, then fails if it accessed a key in a
+ *     published range. Either the scanning commit waits for another one, or
+ *     that one sees the ranges and aborts.
+ *
+ *     Scanning commits are rare, and they run a heavy barrier across all
+ *     threads once their ranges are published, where the system supports
+ *     it. The other commits then mark their slot with plain stores, and only
+ *     look at the other slots while some scan is published.
+ */
+
+#include "transaction_internal.h"
+#include "data_internal.h"
+#include "poison.h"
+
+struct transaction_scan {
+   transaction_scan *next;
+   slice             start_key; // NULL_SLICE to start before the minimum key
+   slice             end_key;   // The last key recorded, NULL_SLICE if none
+   char             *end_buf;   // Holds end_key
+   uint64            end_buf_size;
+   uint64            num_keys;
+   uint64            digest;
+   bool              to_end;    // The iterator ran past the last key
+   bool              is_failed; // The transaction could not read a key
+};
+
+struct transactional_splinterdb_iterator {
+   transactional_splinterdb *txn_kvsb;
+   transaction              *txn;
+   splinterdb_iterator      *iter;
+   transaction_scan         *scan;
+};
+
+/*
+ * Sets *key and *value to the current item of iter, as txn sees it. Returns
+ * FALSE if the key does not exist for txn.
+ */
+static inline bool
+scan_get_current(transactional_splinterdb *txn_kvsb,
+                 transaction              *txn,
+                 splinterdb_iterator      *iter,
+                 slice                    *key,
+                 slice                    *value)
+{
+   splinterdb_iterator_get_current(iter, key, value);
+   if (txn_kvsb->ops->scan_value) {
+      return txn_kvsb->ops->scan_value(txn_kvsb, txn, *key, *value, value);
+   }
+   platform_assert(slice_length(*value) >= txn_kvsb->value_header_size);
+   *value = slice_create(slice_length(*value) - txn_kvsb->value_header_size,
+                         (const char *)slice_data(*value)
+                            + txn_kvsb->value_header_size);
+   return TRUE;
+}
+
+static inline uint64
+scan_digest(slice key, slice value, uint64 digest)
+{
+   digest = platform_hash64(slice_data(key), slice_length(key), digest);
+   return platform_hash64(slice_data(value), slice_length(value), digest);
+}
+
+// Keeps a copy of key as the end of scan, reusing the previous copy if large
+// enough
+static void
+scan_set_end_key(transaction *txn, transaction_scan *scan, slice key)
+{
+   uint64 length = slice_length(key);
+   if (length > scan->end_buf_size) {
+      scan->end_buf_size = MAX(length, 2 * scan->end_buf_size);
+      scan->end_buf = transaction_arena_alloc(txn->arena, scan->end_buf_size);
+   }
+   memmove(scan->end_buf, slice_data(key), length);
+   scan->end_key = slice_create(length, scan->end_buf);
+}
+
+// Reads the current key of iter in txn, see scan_read in
+// transactional_splinterdb_ops
+static inline bool
+scan_read(transactional_splinterdb *txn_kvsb,
+          transaction              *txn,
+          splinterdb_iterator      *iter)
+{
+   if (!txn_kvsb->ops->scan_read) {
+      return TRUE;
+   }
+   slice key, stored;
+   splinterdb_iterator_get_current(iter, &key, &stored);
+   return txn_kvsb->ops->scan_read(txn_kvsb, txn, key, stored);
+}
+
+/*
+ * Moves the iterator past the keys its transaction does not see, and
+ * records the item it lands on, or that it ran past the end.
+ */
+static void
+scan_record_current(transactional_splinterdb_iterator *it)
+{
+   slice key, value;
+   while (splinterdb_iterator_valid(it->iter)) {
+      if (scan_get_current(it->txn_kvsb, it->txn, it->iter, &key, &value)) {
+         it->scan->digest = scan_digest(key, value, it->scan->digest);
+         it->scan->num_keys++;
+         scan_set_end_key(it->txn, it->scan, key);
+         if (!it->scan->is_failed) {
+            it->scan->is_failed = !scan_read(it->txn_kvsb, it->txn, it->iter);
+         }
+         return;
+      }
+      splinterdb_iterator_next(it->iter);
+   }
+   if (splinterdb_iterator_status(it->iter) == 0) {
+      it->scan->to_end = TRUE;
+   }
+}
+
+int
+transactional_splinterdb_iterator_init(
+   transactional_splinterdb           *txn_kvsb, // IN
+   transaction                        *txn,      // IN
+   transactional_splinterdb_iterator **iter,     // OUT
+   slice                               start_key // IN
+)
+{
+   transactional_splinterdb_iterator *it;
+   it           = TYPED_ARENA_ZALLOC(txn->arena, it);
+   it->txn_kvsb = txn_kvsb;
+   it->txn      = txn;
+
+   int rc = splinterdb_iterator_init(
+      transactional_splinterdb_get_db(txn_kvsb), &it->iter, start_key);
+   if (rc != 0) {
+      return rc;
+   }
+
+   it->scan = TYPED_ARENA_ZALLOC(txn->arena, it->scan);
+   if (!slice_is_null(start_key)) {
+      it->scan->start_key = transaction_arena_copy_slice(txn->arena, start_key);
+   }
+   it->scan->next = txn->scans;
+   txn->scans     = it->scan;
+
+   scan_record_current(it);
+
+   *iter = it;
+   return 0;
+}
+
+void
+transactional_splinterdb_iterator_deinit(
+   transactional_splinterdb_iterator *iter)
+{
+   // The iterator itself lives in the arena of its transaction
+   splinterdb_iterator_deinit(iter->iter);
+   iter->iter = NULL;
+}
+
+bool
+transactional_splinterdb_iterator_valid(
+   transactional_splinterdb_iterator *iter)
+{
+   return splinterdb_iterator_valid(iter->iter);
+}
+
+void
+transactional_splinterdb_iterator_next(
+   transactional_splinterdb_iterator *iter)
+{
+   splinterdb_iterator_next(iter->iter);
+   scan_record_current(iter);
+}
+
+void
+transactional_splinterdb_iterator_get_current(
+   transactional_splinterdb_iterator *iter, // IN
+   slice                             *key,  // OUT
+   slice                             *value // OUT
+)
+{
+   scan_get_current(iter->txn_kvsb, iter->txn, iter->iter, key, value);
+}
+
+int
+transactional_splinterdb_iterator_status(
+   const transactional_splinterdb_iterator *iter)
+{
+   return splinterdb_iterator_status(iter->iter);
+}
+
+/*
+ * Walks the range of scan again and checks that it still holds the same keys
+ * and values.
+ */
+static bool
+scan_is_unchanged(transactional_splinterdb *txn_kvsb,
+                  transaction              *txn,
+                  const transaction_scan   *scan)
+{
+   splinterdb_iterator *iter = NULL;
+   int                  rc   = splinterdb_iterator_init(
+      transactional_splinterdb_get_db(txn_kvsb), &iter, scan->start_key);
+   if (rc != 0) {
+      return FALSE;
+   }
+
+   uint64 num_keys = 0;
+   uint64 digest   = 0;
+   while (num_keys < scan->num_keys && splinterdb_iterator_valid(iter)) {
+      slice key, value;
+      if (scan_get_current(txn_kvsb, txn, iter, &key, &value)) {
+         digest = scan_digest(key, value, digest);
+         num_keys++;
+      }
+      splinterdb_iterator_next(iter);
+   }
+
+   bool is_unchanged = num_keys == scan->num_keys && digest == scan->digest
+                       && splinterdb_iterator_status(iter) == 0;
+   if (is_unchanged && scan->to_end) {
+      is_unchanged = !splinterdb_iterator_valid(iter)
+                     && splinterdb_iterator_status(iter) == 0;
+   }
+
+   splinterdb_iterator_deinit(iter);
+   return is_unchanged;
+}
+
+/*
+ * Waits until every other thread that is past transaction_validate_scans()
+ * has finished that commit.
+ */
+static void
+wait_for_installing_commits(transactional_splinterdb *txn_kvsb)
+{
+   threadid tid = platform_get_tid();
+   uint64   seen[MAX_THREADS];
+   for (threadid i = 0; i < MAX_THREADS; i++) {
+      seen[i] = __atomic_load_n(&txn_kvsb->commits[i].seq, __ATOMIC_SEQ_CST);
+   }
+   for (threadid i = 0; i < MAX_THREADS; i++) {
+      if (i == tid || !(seen[i] & 1)) {
+         continue;
+      }
+      while (__atomic_load_n(&txn_kvsb->commits[i].seq, __ATOMIC_ACQUIRE)
+             == seen[i])
+      {
+         platform_pause();
+      }
+   }
+}
+
+static void
+publish_scans(transactional_splinterdb *txn_kvsb, transaction *txn)
+{
+   transaction_commit_slot *slot = &txn_kvsb->commits[platform_get_tid()];
+   __atomic_fetch_add(&txn_kvsb->num_published_scans.v, 1, __ATOMIC_SEQ_CST);
+   __atomic_store_n(&slot->scans, txn->scans, __ATOMIC_SEQ_CST);
+   if (txn_kvsb->heavy_scan_barrier) {
+      // Orders the stores of the other commits to their slots before their
+      // loads of num_published_scans, see transaction_validate_scans()
+      platform_heavy_barrier();
+   }
+}
+
+// Waits for the threads still reading the scans, which live in the arena of
+// the transaction
+static void
+unpublish_scans(transactional_splinterdb *txn_kvsb)
+{
+   transaction_commit_slot *slot = &txn_kvsb->commits[platform_get_tid()];
+   if (slot->scans == NULL) {
+      return;
+   }
+   __atomic_store_n(&slot->scans, NULL, __ATOMIC_SEQ_CST);
+   while (__atomic_load_n(&slot->readers, __ATOMIC_SEQ_CST)) {
+      platform_pause();
+   }
+   __atomic_fetch_sub(&txn_kvsb->num_published_scans.v, 1, __ATOMIC_RELEASE);
+}
+
+static inline int
+scan_key_compare(const data_config *cfg, slice key1, slice key2)
+{
+   return data_key_compare(
+      cfg, key_create_from_slice(key1), key_create_from_slice(key2));
+}
+
+static bool
+scan_covers(const data_config *cfg, const transaction_scan *scan, slice key)
+{
+   if (!slice_is_null(scan->start_key)
+       && scan_key_compare(cfg, key, scan->start_key) < 0)
+   {
+      return FALSE;
+   }
+   // A scan that failed before recording a key is not bounded above
+   return scan->to_end || slice_is_null(scan->end_key)
+          || scan_key_compare(cfg, key, scan->end_key) <= 0;
+}
+
+/*
+ * Whether txn accessed a key in the ranges of another committing thread's
+ * scans. Reads count too, txn does not know which keys it only read.
+ */
+static bool
+accesses_published_scans(transactional_splinterdb *txn_kvsb,
+                         transaction              *txn)
+{
+   if (__atomic_load_n(&txn_kvsb->num_published_scans.v, __ATOMIC_SEQ_CST)
+       == 0)
+   {
+      return FALSE;
+   }
+
+   threadid tid = platform_get_tid();
+   bool     is_accessed = FALSE;
+   for (threadid i = 0; !is_accessed && i < MAX_THREADS; i++) {
+      transaction_commit_slot *slot = &txn_kvsb->commits[i];
+      if (i == tid || __atomic_load_n(&slot->scans, __ATOMIC_SEQ_CST) == NULL)
+      {
+         continue;
+      }
+      __atomic_fetch_add(&slot->readers, 1, __ATOMIC_SEQ_CST);
+      for (const transaction_scan *scan =
+              __atomic_load_n(&slot->scans, __ATOMIC_SEQ_CST);
+           !is_accessed && scan;
+           scan = scan->next)
+      {
+         for (uint64 j = 0; !is_accessed && j < txn->num_rw_entries; j++) {
+            is_accessed =
+               scan_covers(txn_kvsb->app_data_cfg, scan, txn->rw_keys[j]);
+         }
+      }
+      __atomic_fetch_sub(&slot->readers, 1, __ATOMIC_RELEASE);
+   }
+   return is_accessed;
+}
+
+bool
+transaction_validate_scans(transactional_splinterdb *txn_kvsb,
+                           transaction              *txn)
+{
+   for (transaction_scan *scan = txn->scans; scan; scan = scan->next) {
+      if (scan->is_failed) {
+         return FALSE;
+      }
+   }
+   if (txn->scans) {
+      publish_scans(txn_kvsb, txn);
+      wait_for_installing_commits(txn_kvsb);
+      for (transaction_scan *scan = txn->scans; scan; scan = scan->next) {
+         if (!scan_is_unchanged(txn_kvsb, txn, scan)) {
+            unpublish_scans(txn_kvsb);
+            return FALSE;
+         }
+      }
+   }
+
+   // Only this thread writes its own slot
+   uint64 *seq = &txn_kvsb->commits[platform_get_tid()].seq;
+   platform_assert(!(*seq & 1));
+   if (txn_kvsb->heavy_scan_barrier) {
+      __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+      __atomic_signal_fence(__ATOMIC_SEQ_CST);
+   } else {
+      __atomic_store_n(seq, *seq + 1, __ATOMIC_SEQ_CST);
+   }
+   return !accesses_published_scans(txn_kvsb, txn);
+}
+
+void
+transaction_finish_commit(transactional_splinterdb *txn_kvsb)
+{
+   unpublish_scans(txn_kvsb);
+   uint64 *seq = &txn_kvsb->commits[platform_get_tid()].seq;
+   if (*seq & 1) {
+      __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+   }
+}
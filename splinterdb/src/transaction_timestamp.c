@@ -0,0 +1,94 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "transaction_timestamp.h"
+#if defined(__x86_64__)
+#   include <cpuid.h>
+#   include <x86intrin.h>
+#endif
+#include "poison.h"
+
+// Whether the TSC ticks at the same rate on every core and in every power
+// state, so that it can be compared across cores
+static bool
+transaction_timestamp_has_invariant_tsc(void)
+{
+#if defined(__x86_64__)
+   unsigned int eax, ebx, ecx, edx;
+   if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+      return FALSE;
+   }
+   return (edx & (1 << 8)) != 0;
+#else
+   return FALSE;
+#endif
+}
+
+static inline uint64
+transaction_timestamp_read_raw_clock(bool has_invariant_tsc)
+{
+#if defined(__x86_64__)
+   if (has_invariant_tsc) {
+      return __rdtsc();
+   }
+#endif
+   return platform_get_timestamp();
+}
+
+void
+transaction_timestamp_init(transaction_timestamp_allocator *tsa,
+                           transaction_timestamp_source     source)
+{
+   platform_assert(TRANSACTION_TIMESTAMP_INVALID < source
+                   && source < TRANSACTION_TIMESTAMP_MAX_VALID);
+   ZERO_CONTENTS(tsa);
+   tsa->source = source;
+   if (source == TRANSACTION_TIMESTAMP_TSC) {
+      tsa->has_invariant_tsc = transaction_timestamp_has_invariant_tsc();
+      tsa->tsc_base =
+         transaction_timestamp_read_raw_clock(tsa->has_invariant_tsc);
+   }
+}
+
+/*
+ * Counts from the init of tsa, so that the clock fits in the bits left over
+ * by the thread id for a long time.
+ */
+uint64
+transaction_timestamp_read_clock(const transaction_timestamp_allocator *tsa)
+{
+   return transaction_timestamp_read_raw_clock(tsa->has_invariant_tsc)
+          - tsa->tsc_base;
+}
+
+static const char *transaction_timestamp_source_names[] = {
+   [TRANSACTION_TIMESTAMP_COUNTER] = "counter",
+   [TRANSACTION_TIMESTAMP_BATCHED] = "batched",
+   [TRANSACTION_TIMESTAMP_TAGGED]  = "tagged",
+   [TRANSACTION_TIMESTAMP_TSC]     = "tsc",
+};
+
+const char *
+transaction_timestamp_source_name(transaction_timestamp_source source)
+{
+   if (source <= TRANSACTION_TIMESTAMP_INVALID
+       || TRANSACTION_TIMESTAMP_MAX_VALID <= source)
+   {
+      return "invalid";
+   }
+   return transaction_timestamp_source_names[source];
+}
+
+transaction_timestamp_source
+transaction_timestamp_source_from_name(const char *name)
+{
+   for (transaction_timestamp_source s = TRANSACTION_TIMESTAMP_INVALID + 1;
+        s < TRANSACTION_TIMESTAMP_MAX_VALID;
+        s++)
+   {
+      if (strcmp(name, transaction_timestamp_source_names[s]) == 0) {
+         return s;
+      }
+   }
+   return TRANSACTION_TIMESTAMP_INVALID;
+}
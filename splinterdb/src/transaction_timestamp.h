@@ -0,0 +1,125 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_timestamp.h --
+ *
+ *     Hands out the timestamps that STO and 2PL give transactions when they
+ *     begin, from the source chosen in transactional_splinterdb_config.
+ *
+ *     Timestamps are unique within a database and grow on every thread.
+ *     Apart from COUNTER, the sources keep their state per thread, so that
+ *     threads do not all write the same cache line on every begin:
+ *
+ *     - BATCHED takes TRANSACTION_TIMESTAMP_BATCH timestamps of the shared
+ *       counter at a time.
+ *     - TAGGED and TSC put the thread id in the low bits, under a clock that
+ *       only has to grow on the thread. The TAGGED clocks of the threads are
+ *       kept close by a shared clock that each thread reads on every begin,
+ *       but only moves every TRANSACTION_TIMESTAMP_PUBLISH_INTERVAL ticks.
+ */
+
+#pragma once
+
+#include "platform.h"
+#include "splinterdb/transaction.h"
+
+#define TRANSACTION_TIMESTAMP_BATCH (64)
+
+#define TRANSACTION_TIMESTAMP_PUBLISH_INTERVAL (32)
+
+// Low bits of TAGGED and TSC timestamps, which hold the thread id
+#define TRANSACTION_TIMESTAMP_TID_BITS (6)
+_Static_assert((1ULL << TRANSACTION_TIMESTAMP_TID_BITS) >= MAX_THREADS,
+               "Thread ids do not fit in TRANSACTION_TIMESTAMP_TID_BITS");
+
+typedef struct transaction_timestamp_thread {
+   uint64 next; // BATCHED: next timestamp of the range, else the last clock
+   uint64 end;  // BATCHED: end of the range
+} PLATFORM_CACHELINE_ALIGNED transaction_timestamp_thread;
+
+typedef struct transaction_timestamp_allocator {
+   transaction_timestamp_source source;
+   uint64                       tsc_base; // TSC: the clock at init
+   bool                         has_invariant_tsc;
+   // COUNTER and BATCHED: the last timestamp handed out.
+   // TAGGED: the shared clock.
+   cache_aligned_uint64         shared;
+   transaction_timestamp_thread threads[MAX_THREADS];
+} transaction_timestamp_allocator;
+
+void
+transaction_timestamp_init(transaction_timestamp_allocator *tsa,
+                           transaction_timestamp_source     source);
+
+// TRUE if the timestamps of source count the transactions, so that they
+// stay small
+static inline bool
+transaction_timestamp_is_dense(transaction_timestamp_source source)
+{
+   return source == TRANSACTION_TIMESTAMP_COUNTER
+          || source == TRANSACTION_TIMESTAMP_BATCHED;
+}
+
+uint64
+transaction_timestamp_read_clock(const transaction_timestamp_allocator *tsa);
+
+static inline uint64
+transaction_timestamp_tag(uint64 clock, threadid tid)
+{
+   return (clock << TRANSACTION_TIMESTAMP_TID_BITS) | tid;
+}
+
+// Moves the shared clock up to clock, unless a thread moved it further
+static inline void
+transaction_timestamp_publish(transaction_timestamp_allocator *tsa,
+                              uint64                           clock)
+{
+   uint64 shared = __atomic_load_n(&tsa->shared.v, __ATOMIC_RELAXED);
+   while (shared < clock
+          && !__atomic_compare_exchange_n(&tsa->shared.v,
+                                          &shared,
+                                          clock,
+                                          TRUE,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED))
+   {
+   }
+}
+
+static inline uint64
+transaction_timestamp_next(transaction_timestamp_allocator *tsa)
+{
+   threadid                      tid    = platform_get_tid();
+   transaction_timestamp_thread *thread = &tsa->threads[tid];
+   uint64                        clock;
+
+   switch (tsa->source) {
+      case TRANSACTION_TIMESTAMP_COUNTER:
+         return __atomic_add_fetch(&tsa->shared.v, 1, __ATOMIC_RELAXED);
+      case TRANSACTION_TIMESTAMP_BATCHED:
+         if (thread->next == thread->end) {
+            thread->next = 1
+                           + __atomic_fetch_add(&tsa->shared.v,
+                                                TRANSACTION_TIMESTAMP_BATCH,
+                                                __ATOMIC_RELAXED);
+            thread->end  = thread->next + TRANSACTION_TIMESTAMP_BATCH;
+         }
+         return thread->next++;
+      case TRANSACTION_TIMESTAMP_TAGGED:
+         clock = MAX(thread->next + 1,
+                     __atomic_load_n(&tsa->shared.v, __ATOMIC_RELAXED));
+         if (clock % TRANSACTION_TIMESTAMP_PUBLISH_INTERVAL == 0) {
+            transaction_timestamp_publish(tsa, clock);
+         }
+         thread->next = clock;
+         return transaction_timestamp_tag(clock, tid);
+      case TRANSACTION_TIMESTAMP_TSC:
+         clock = MAX(thread->next + 1, transaction_timestamp_read_clock(tsa));
+         thread->next = clock;
+         return transaction_timestamp_tag(clock, tid);
+      default:
+         platform_assert(FALSE, "Invalid timestamp source %d", tsa->source);
+         return 0;
+   }
+}
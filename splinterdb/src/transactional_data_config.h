@@ -3,18 +3,23 @@
 
 #pragma once
 
-#if EXPERIMENTAL_MODE_TICTOC_DISK || EXPERIMENTAL_MODE_STO_DISK
-
-#   include "splinterdb/data.h"
+#include "splinterdb/data.h"
 
 typedef struct transactional_data_config {
    data_config        super;
    const data_config *application_data_config;
 } transactional_data_config;
 
+/*
+ * The disk-based protocols keep a tuple_header with the timestamps in front
+ * of every value, so each of them needs its own merge functions.
+ */
 void
-transactional_data_config_init(data_config               *in_cfg, // IN
-                               transactional_data_config *out_cfg // OUT
+tictoc_disk_data_config_init(data_config               *in_cfg, // IN
+                             transactional_data_config *out_cfg // OUT
 );
 
-#endif
+void
+sto_disk_data_config_init(data_config               *in_cfg, // IN
+                          transactional_data_config *out_cfg // OUT
+);
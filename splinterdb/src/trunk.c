@@ -99,6 +99,12 @@ static const int64 latency_histo_buckets[LATENCYHISTO_SIZE] = {
 #define TRUNK_EXTRA_PIVOT_KEYS (6)
 
 #define TRUNK_INVALID_PIVOT_NO (UINT16_MAX)
+
+/*
+ * Insert batches of up to this many tuples keep their leaf generations on the
+ * stack.
+ */
+#define TRUNK_INSERT_BATCH_STACK_TUPLES (64)
 /*
  * Trunk logging functions.
  *
@@ -823,7 +829,7 @@ static inline void                 trunk_dec_ref                   (trunk_handle
 static inline void                 trunk_zap_branch_range          (trunk_handle *spl, trunk_branch *branch, key start_key, key end_key, page_type type);
 static inline void                 trunk_inc_intersection          (trunk_handle *spl, trunk_branch *branch, key target, bool is_memtable);
 void                               trunk_memtable_flush_virtual    (void *arg, uint64 generation);
-platform_status                    trunk_memtable_insert           (trunk_handle *spl, key tuple_key, message data);
+platform_status                    trunk_memtable_insert_batch     (trunk_handle *spl, uint64 num_tuples, const key *tuple_keys, const message *msgs, uint64 *leaf_generations);
 void                               trunk_bundle_build_filters      (void *arg, void *scratch);
 static inline void                 trunk_inc_filter                (trunk_handle *spl, routing_filter *filter);
 static inline void                 trunk_dec_filter                (trunk_handle *spl, routing_filter *filter);
@@ -3045,7 +3051,13 @@ trunk_memtable_iterator_deinit(trunk_handle   *spl,
 }
 
 /*
- * Attempts to insert (key, data) into the current memtable.
+ * Attempts to insert the num_tuples tuples (tuple_keys[i], msgs[i]) into the
+ * current memtable, in order and under a single acquisition of its insert
+ * lock, and logs them in one write. leaf_generations must have room for
+ * num_tuples generations.
+ *
+ * The caller checks the tuples with btree_insert_check() first. If one still
+ * fails to insert, the tuples before it stay inserted and logged.
  *
  * Returns:
  *    success if succeeded
@@ -3054,7 +3066,11 @@ trunk_memtable_iterator_deinit(trunk_handle   *spl,
  *       responsible for flushing it.
  */
 platform_status
-trunk_memtable_insert(trunk_handle *spl, key tuple_key, message msg)
+trunk_memtable_insert_batch(trunk_handle  *spl,
+                            uint64         num_tuples,
+                            const key     *tuple_keys,
+                            const message *msgs,
+                            uint64        *leaf_generations)
 {
    page_handle    *lock_page;
    uint64          generation;
@@ -3074,15 +3090,24 @@ trunk_memtable_insert(trunk_handle *spl, key tuple_key, message msg)
 
    // this call is safe because we hold the insert lock
    memtable *mt = trunk_get_memtable(spl, generation);
-   uint64    leaf_generation; // used for ordering the log
-   rc = memtable_insert(
-      spl->mt_ctxt, mt, spl->heap_id, tuple_key, msg, &leaf_generation);
-   if (!SUCCESS(rc)) {
-      goto unlock_insert_lock;
+   uint64    num_inserted = 0; // leaf generations order the log
+   while (num_inserted < num_tuples) {
+      rc = memtable_insert(spl->mt_ctxt,
+                           mt,
+                           spl->heap_id,
+                           tuple_keys[num_inserted],
+                           msgs[num_inserted],
+                           &leaf_generations[num_inserted]);
+      if (!SUCCESS(rc)) {
+         break;
+      }
+      num_inserted++;
    }
 
-   if (spl->cfg.use_log) {
-      int crappy_rc = log_write(spl->log, tuple_key, msg, leaf_generation);
+   // Log what made it into the memtable, even if the rest failed
+   if (spl->cfg.use_log && num_inserted > 0) {
+      int crappy_rc = log_write_batch(
+         spl->log, num_inserted, tuple_keys, msgs, leaf_generations);
       if (crappy_rc != 0) {
          goto unlock_insert_lock;
       }
@@ -6173,8 +6198,41 @@ trunk_maybe_reclaim_space(trunk_handle *spl)
  *-----------------------------------------------------------------------------
  */
 
+static void
+trunk_record_insert_stats(trunk_handle *spl,
+                          threadid      tid,
+                          message_type  class,
+                          timestamp     latency)
+{
+   switch (class) {
+      case MESSAGE_TYPE_INSERT:
+         spl->stats[tid].insertions++;
+         platform_histo_insert(spl->stats[tid].insert_latency_histo, latency);
+         break;
+      case MESSAGE_TYPE_UPDATE:
+         spl->stats[tid].updates++;
+         platform_histo_insert(spl->stats[tid].update_latency_histo, latency);
+         break;
+      case MESSAGE_TYPE_DELETE:
+         spl->stats[tid].deletions++;
+         platform_histo_insert(spl->stats[tid].delete_latency_histo, latency);
+         break;
+      default:
+         platform_assert(0);
+   }
+}
+
 platform_status
 trunk_insert(trunk_handle *spl, key tuple_key, message data)
+{
+   return trunk_insert_batch(spl, 1, &tuple_key, &data);
+}
+
+platform_status
+trunk_insert_batch(trunk_handle *spl,
+                   uint64        num_tuples,
+                   const key    *tuple_keys,
+                   message      *msgs)
 {
    timestamp      ts;
    const threadid tid = platform_get_tid();
@@ -6182,15 +6240,40 @@ trunk_insert(trunk_handle *spl, key tuple_key, message data)
       ts = platform_get_timestamp();
    }
 
-   if (trunk_max_key_size(spl) < key_length(tuple_key)) {
-      return STATUS_BAD_PARAM;
+   // Reject the batch before any of it goes in, so that only running out of
+   // memory or a failing merge can stop it part-way
+   for (uint64 i = 0; i < num_tuples; i++) {
+      if (trunk_max_key_size(spl) < key_length(tuple_keys[i])) {
+         return STATUS_BAD_PARAM;
+      }
+
+      if (message_class(msgs[i]) == MESSAGE_TYPE_DELETE) {
+         msgs[i] = DELETE_MESSAGE;
+      }
+
+      platform_status rc =
+         btree_insert_check(&spl->cfg.btree_cfg, tuple_keys[i], msgs[i]);
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
    }
 
-   if (message_class(data) == MESSAGE_TYPE_DELETE) {
-      data = DELETE_MESSAGE;
+   uint64  stack_generations[TRUNK_INSERT_BATCH_STACK_TUPLES];
+   uint64 *leaf_generations = stack_generations;
+   if (num_tuples > TRUNK_INSERT_BATCH_STACK_TUPLES) {
+      leaf_generations =
+         TYPED_ARRAY_MALLOC(spl->heap_id, leaf_generations, num_tuples);
+      if (leaf_generations == NULL) {
+         return STATUS_NO_MEMORY;
+      }
    }
 
-   platform_status rc = trunk_memtable_insert(spl, tuple_key, data);
+   platform_status rc = trunk_memtable_insert_batch(
+      spl, num_tuples, tuple_keys, msgs, leaf_generations);
+
+   if (leaf_generations != stack_generations) {
+      platform_free(spl->heap_id, leaf_generations);
+   }
    if (!SUCCESS(rc)) {
       goto out;
    }
@@ -6198,24 +6281,10 @@ trunk_insert(trunk_handle *spl, key tuple_key, message data)
    task_perform_one_if_needed(spl->ts, spl->cfg.queue_scale_percent);
 
    if (spl->cfg.use_stats) {
-      switch (message_class(data)) {
-         case MESSAGE_TYPE_INSERT:
-            spl->stats[tid].insertions++;
-            platform_histo_insert(spl->stats[tid].insert_latency_histo,
-                                  platform_timestamp_elapsed(ts));
-            break;
-         case MESSAGE_TYPE_UPDATE:
-            spl->stats[tid].updates++;
-            platform_histo_insert(spl->stats[tid].update_latency_histo,
-                                  platform_timestamp_elapsed(ts));
-            break;
-         case MESSAGE_TYPE_DELETE:
-            spl->stats[tid].deletions++;
-            platform_histo_insert(spl->stats[tid].delete_latency_histo,
-                                  platform_timestamp_elapsed(ts));
-            break;
-         default:
-            platform_assert(0);
+      // Each tuple of a batch is charged its share of the batch
+      timestamp latency = platform_timestamp_elapsed(ts) / num_tuples;
+      for (uint64 i = 0; i < num_tuples; i++) {
+         trunk_record_insert_stats(spl, tid, message_class(msgs[i]), latency);
       }
    }
 
@@ -6394,6 +6463,11 @@ trunk_lookup(trunk_handle *spl, key target, merge_accumulator *result)
 
    merge_accumulator_set_to_null(result);
 
+   // No such key can have been inserted
+   if (trunk_max_key_size(spl) < key_length(target)) {
+      return STATUS_BAD_PARAM;
+   }
+
    bool         found_in_memtable   = FALSE;
    page_handle *mt_lookup_lock_page = memtable_get_lookup_lock(spl->mt_ctxt);
    uint64       mt_gen_start        = memtable_generation(spl->mt_ctxt);
@@ -6509,7 +6583,7 @@ trunk_async_callback(cache_async_ctxt *cache_ctxt)
    ctxt->was_async = TRUE;
    // Move state machine ahead and requeue for dispatch
    if (UNLIKELY(ctxt->state == async_state_get_root_reentrant)) {
-      trunk_async_set_state(ctxt, async_state_trunk_node_lookup);
+      trunk_async_set_state(ctxt, async_state_got_root);
    } else {
       debug_assert((ctxt->state == async_state_get_child_trunk_node_reentrant),
                    "ctxt->state=%d != expected state=%d",
@@ -6628,6 +6702,12 @@ trunk_lookup_async(trunk_handle      *spl,    // IN
                   break;
                }
             }
+            if (ctxt->state == async_state_found_final_answer_early) {
+               // Keeps the memtable lookup lock, there is no trunk node
+               break;
+            }
+            // The callback of a read of the root goes by this state
+            trunk_async_set_state(ctxt, async_state_get_root_reentrant);
             // fallthrough
          }
          case async_state_get_root_reentrant:
@@ -6659,18 +6739,26 @@ trunk_lookup_async(trunk_handle      *spl,    // IN
                   break;
                case async_success:
                   ctxt->was_async = FALSE;
-                  trunk_async_set_state(ctxt, async_state_trunk_node_lookup);
-                  ctxt->trunk_node.page = ctxt->cache_ctxt.page;
-                  ctxt->trunk_node.hdr =
-                     (trunk_hdr *)(ctxt->cache_ctxt.page->data);
-                  memtable_unget_lookup_lock(spl->mt_ctxt, ctxt->mt_lock_page);
-                  ctxt->mt_lock_page = NULL;
+                  trunk_async_set_state(ctxt, async_state_got_root);
                   break;
                default:
                   platform_assert(0);
             }
             break;
          }
+         case async_state_got_root:
+         {
+            // The root is held now, whether it was read from disk or not
+            if (ctxt->was_async) {
+               trunk_node_async_done(spl, ctxt);
+            }
+            ctxt->trunk_node.page = ctxt->cache_ctxt.page;
+            ctxt->trunk_node.hdr  = (trunk_hdr *)(ctxt->cache_ctxt.page->data);
+            memtable_unget_lookup_lock(spl->mt_ctxt, ctxt->mt_lock_page);
+            ctxt->mt_lock_page = NULL;
+            trunk_async_set_state(ctxt, async_state_trunk_node_lookup);
+            break;
+         }
          case async_state_trunk_node_lookup:
          {
             ctxt->height = trunk_height(node);
@@ -248,6 +248,7 @@ typedef enum {
    async_state_start,
    async_state_lookup_memtable,
    async_state_get_root_reentrant,
+   async_state_got_root,
    async_state_trunk_node_lookup,
    async_state_subbundle_lookup,
    async_state_pivot_lookup,
@@ -332,6 +333,19 @@ typedef struct trunk_async_ctxt {
 platform_status
 trunk_insert(trunk_handle *spl, key tuple_key, message data);
 
+/*
+ * Inserts the num_tuples tuples (tuple_keys[i], msgs[i]) in order, taking the
+ * memtable insert lock once and logging them together. The batch is not
+ * atomic: lookups can see part of it, and if it fails the tuples before the
+ * failing one stay inserted. msgs of class DELETE are replaced with
+ * DELETE_MESSAGE.
+ */
+platform_status
+trunk_insert_batch(trunk_handle *spl,
+                   uint64        num_tuples,
+                   const key    *tuple_keys,
+                   message      *msgs);
+
 platform_status
 trunk_lookup(trunk_handle *spl, key target, merge_accumulator *result);
 
@@ -0,0 +1,143 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * iceberg_simd_test.c --
+ *
+ *     Measures the metadata scans of the iceberg table for each set of
+ *     kernels the cpu supports, so the one a table picks at init can be
+ *     checked against the others on a given machine.
+ */
+#include "platform.h"
+
+#include "isketch/iceberg_simd.h"
+#include "test.h"
+
+#include "poison.h"
+
+#define TEST_DEFAULT_NUM_PROBES (10 * 1000 * 1000)
+
+// Blocks of metadata the probes cycle through; small enough to stay in cache
+#define TEST_NUM_MD_BLOCKS (4096)
+
+typedef struct test_simd_result {
+   uint64 checksum;
+   uint64 elapsed_ns[3];
+} test_simd_result;
+
+/*
+ * Probes like a lookup does: scans a block for a fingerprint and selects the
+ * slot of each match. The checksum keeps the compiler from dropping the work
+ * and lets the levels be compared with each other.
+ */
+static void
+test_simd_probe(const iceberg_simd_ops *ops,
+                const uint8            *md,
+                uint64                  num_probes,
+                test_simd_result       *result)
+{
+   uint64 sum   = 0;
+   uint64 start = platform_get_timestamp();
+   for (uint64 i = 0; i < num_probes; i++) {
+      const uint8 *block = md + 64 * (i % TEST_NUM_MD_BLOCKS);
+      sum += ops->slot_mask_64(block, i & 7);
+   }
+   result->elapsed_ns[0] = platform_timestamp_elapsed(start);
+   result->checksum      = sum;
+
+   sum   = 0;
+   start = platform_get_timestamp();
+   for (uint64 i = 0; i < num_probes; i++) {
+      const uint8 *block = md + 64 * (i % TEST_NUM_MD_BLOCKS);
+      sum += ops->slot_mask_32(block, i & 7);
+   }
+   result->elapsed_ns[1] = platform_timestamp_elapsed(start);
+   result->checksum     ^= sum;
+
+   sum   = 0;
+   start = platform_get_timestamp();
+   for (uint64 i = 0; i < num_probes; i++) {
+      const uint8 *block = md + 64 * (i % TEST_NUM_MD_BLOCKS);
+      uint64       word;
+      memmove(&word, block, sizeof(word));
+      sum += ops->word_select(word, i & 31);
+   }
+   result->elapsed_ns[2] = platform_timestamp_elapsed(start);
+   result->checksum     += sum;
+}
+
+static void
+usage(const char *argv0)
+{
+   platform_error_log("Usage:\n"
+                      "\t%s [--num-probes <probes per kernel>]\n",
+                      argv0);
+}
+
+int
+iceberg_simd_test(int argc, char *argv[])
+{
+   uint64 num_probes = TEST_DEFAULT_NUM_PROBES;
+   if (argc == 3 && STRING_EQUALS_LITERAL(argv[1], "--num-probes")) {
+      if (!try_string_to_uint64(argv[2], &num_probes)) {
+         usage(argv[0]);
+         return -1;
+      }
+   } else if (argc != 1) {
+      usage(argv[0]);
+      return -1;
+   }
+
+   platform_heap_handle hh;
+   platform_heap_id     hid;
+   platform_status      rc = platform_heap_create(
+      platform_get_module_id(), 1 * GiB, &hh, &hid);
+   platform_assert_status_ok(rc);
+
+   uint8 *md = TYPED_ARRAY_MALLOC(hid, md, 64 * TEST_NUM_MD_BLOCKS);
+   platform_assert(md);
+   uint64 state = 0x9e3779b97f4a7c15ULL;
+   for (uint64 i = 0; i < 64 * TEST_NUM_MD_BLOCKS; i++) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      md[i] = state % 3 == 0 ? 0 : (state >> 8) % 8;
+   }
+
+   platform_default_log("iceberg tables use %s\n",
+                        iceberg_simd_ops_best()->name);
+   platform_default_log("%-8s %14s %14s %14s  (M probes/second)\n",
+                        "level",
+                        "slot_mask_64",
+                        "slot_mask_32",
+                        "word_select");
+
+   uint64 expected = 0;
+   for (iceberg_simd_level level = ICEBERG_SIMD_SCALAR;
+        level < ICEBERG_SIMD_MAX_VALID;
+        level++)
+   {
+      const iceberg_simd_ops *ops = iceberg_simd_ops_get(level);
+      if (ops == NULL) {
+         continue;
+      }
+      test_simd_result result;
+      test_simd_probe(ops, md, num_probes, &result);
+      if (level == ICEBERG_SIMD_SCALAR) {
+         expected = result.checksum;
+      } else if (result.checksum != expected) {
+         platform_error_log("%s: results differ from scalar\n", ops->name);
+         rc = STATUS_TEST_FAILED;
+      }
+      platform_default_log(
+         "%-8s %14.2f %14.2f %14.2f\n",
+         ops->name,
+         (double)num_probes * THOUSAND / MAX(result.elapsed_ns[0], 1),
+         (double)num_probes * THOUSAND / MAX(result.elapsed_ns[1], 1),
+         (double)num_probes * THOUSAND / MAX(result.elapsed_ns[2], 1));
+   }
+
+   platform_free(hid, md);
+   platform_heap_destroy(&hh);
+   return SUCCESS(rc) ? 0 : -1;
+}
@@ -51,6 +51,12 @@ ycsb_test(int argc, char *argv[]);
 int
 splinter_io_apis_test(int argc, char *argv[]);
 
+int
+transaction_timestamp_test(int argc, char *argv[]);
+
+int
+iceberg_simd_test(int argc, char *argv[]);
+
 /*
  * Initialization for using splinter, need to be called at the start of the test
  * main function. This initializes SplinterDB's task sub-system.
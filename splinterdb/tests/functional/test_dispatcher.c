@@ -18,6 +18,8 @@ usage(void)
    platform_error_log("\tlog_test\n");
    platform_error_log("\tcache_test\n");
    platform_error_log("\tio_apis_test\n");
+   platform_error_log("\ttransaction_timestamp_test\n");
+   platform_error_log("\ticeberg_simd_test\n");
 #ifdef PLATFORM_LINUX
    platform_error_log("\tycsb_test\n");
 #endif
@@ -48,6 +50,12 @@ test_dispatcher(int argc, char *argv[])
          return cache_test(argc - 1, &argv[1]);
       } else if (STRING_EQUALS_LITERAL(test_name, "io_apis_test")) {
          return splinter_io_apis_test(argc - 1, &argv[1]);
+      } else if (STRING_EQUALS_LITERAL(test_name,
+                                       "transaction_timestamp_test"))
+      {
+         return transaction_timestamp_test(argc - 1, &argv[1]);
+      } else if (STRING_EQUALS_LITERAL(test_name, "iceberg_simd_test")) {
+         return iceberg_simd_test(argc - 1, &argv[1]);
 #ifdef PLATFORM_LINUX
       } else if (STRING_EQUALS_LITERAL(test_name, "ycsb_test")) {
          return ycsb_test(argc - 1, &argv[1]);
@@ -0,0 +1,147 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * transaction_timestamp_test.c --
+ *
+ *     Measures how the timestamp sources of transactions scale with the
+ *     number of threads taking timestamps at the same time.
+ */
+#include "platform.h"
+
+#include "transaction_timestamp.h"
+#include "test.h"
+
+#include "poison.h"
+
+#define TEST_DEFAULT_STAMPS_PER_THREAD (1000 * 1000)
+
+// Threads doubling from 1 up to this, or MAX_THREADS if it is less
+#define TEST_MAX_TIMESTAMP_THREADS (128)
+
+typedef struct test_timestamp_thread_params {
+   transaction_timestamp_allocator *tsa;
+   threadid                         tid;
+   uint64                           num_stamps;
+   platform_thread                  thread;
+   bool                             in_order;
+} test_timestamp_thread_params;
+
+static void
+test_timestamp_thread(void *arg)
+{
+   test_timestamp_thread_params *params = (test_timestamp_thread_params *)arg;
+   platform_set_tid(params->tid);
+
+   uint64 last     = 0;
+   params->in_order = TRUE;
+   for (uint64 i = 0; i < params->num_stamps; i++) {
+      uint64 ts         = transaction_timestamp_next(params->tsa);
+      params->in_order &= last < ts;
+      last              = ts;
+   }
+}
+
+static platform_status
+test_timestamp_perf(transaction_timestamp_allocator *tsa,
+                    transaction_timestamp_source     source,
+                    uint64                           num_threads,
+                    uint64                           num_stamps,
+                    platform_heap_id                 hid)
+{
+   test_timestamp_thread_params *params =
+      TYPED_ARRAY_ZALLOC(hid, params, num_threads);
+   platform_assert(params);
+   platform_status ret = STATUS_OK;
+
+   transaction_timestamp_init(tsa, source);
+   for (uint64 i = 0; i < num_threads; i++) {
+      params[i].tsa        = tsa;
+      params[i].tid        = i;
+      params[i].num_stamps = num_stamps;
+   }
+
+   uint64 start_time = platform_get_timestamp();
+   uint64 started    = 0;
+   for (; started < num_threads; started++) {
+      ret = platform_thread_create(&params[started].thread,
+                                   FALSE,
+                                   test_timestamp_thread,
+                                   &params[started],
+                                   hid);
+      if (!SUCCESS(ret)) {
+         break;
+      }
+   }
+   for (uint64 i = 0; i < started; i++) {
+      platform_thread_join(params[i].thread);
+   }
+   uint64 elapsed_ns = platform_timestamp_elapsed(start_time);
+
+   if (SUCCESS(ret)) {
+      for (uint64 i = 0; i < num_threads; i++) {
+         if (!params[i].in_order) {
+            platform_error_log("%s: timestamps of thread %lu went back\n",
+                               transaction_timestamp_source_name(source),
+                               i);
+            ret = STATUS_TEST_FAILED;
+         }
+      }
+      platform_default_log("%-8s %3lu threads: %8.2f M timestamps/second\n",
+                           transaction_timestamp_source_name(source),
+                           num_threads,
+                           (double)(num_threads * num_stamps) * THOUSAND
+                              / MAX(elapsed_ns, 1));
+   }
+
+   platform_free(hid, params);
+   return ret;
+}
+
+static void
+usage(const char *argv0)
+{
+   platform_error_log("Usage:\n"
+                      "\t%s [--num-stamps <timestamps per thread>]\n",
+                      argv0);
+}
+
+int
+transaction_timestamp_test(int argc, char *argv[])
+{
+   uint64 num_stamps = TEST_DEFAULT_STAMPS_PER_THREAD;
+   if (argc == 3 && STRING_EQUALS_LITERAL(argv[1], "--num-stamps")) {
+      if (!try_string_to_uint64(argv[2], &num_stamps)) {
+         usage(argv[0]);
+         return -1;
+      }
+   } else if (argc != 1) {
+      usage(argv[0]);
+      return -1;
+   }
+
+   platform_heap_handle hh;
+   platform_heap_id     hid;
+   platform_status      rc = platform_heap_create(
+      platform_get_module_id(), 1 * GiB, &hh, &hid);
+   platform_assert_status_ok(rc);
+
+   transaction_timestamp_allocator *tsa = TYPED_ZALLOC(hid, tsa);
+   platform_assert(tsa);
+
+   uint64 max_threads = MIN(TEST_MAX_TIMESTAMP_THREADS, MAX_THREADS);
+   for (transaction_timestamp_source source = TRANSACTION_TIMESTAMP_INVALID + 1;
+        SUCCESS(rc) && source < TRANSACTION_TIMESTAMP_MAX_VALID;
+        source++)
+   {
+      for (uint64 num_threads = 1; SUCCESS(rc) && num_threads <= max_threads;
+           num_threads *= 2)
+      {
+         rc = test_timestamp_perf(tsa, source, num_threads, num_stamps, hid);
+      }
+   }
+
+   platform_free(hid, tsa);
+   platform_heap_destroy(&hh);
+   return SUCCESS(rc) ? 0 : -1;
+}
@@ -0,0 +1,179 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * iceberg_inline_key_test.c
+ *
+ *  Exercises the keys the iceberg table copies into its slots: short and
+ *  long keys are found and removed alike, the cells of removed short keys
+ *  are reused by the next inserts of the same thread, and lookups that do
+ *  not lock their blocks see the keys that stay while others come and go.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "isketch/iceberg_table.h"
+
+#define TEST_MAX_KEY_SIZE 64
+
+#define TEST_LOG_SLOTS 16
+
+#define TEST_NUM_KEYS 1000
+
+#define TEST_NUM_ROUNDS 20
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(iceberg_inline_key)
+{
+   data_config   data_cfg;
+   iceberg_table table;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(iceberg_inline_key)
+{
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->data_cfg);
+   ASSERT_EQUAL(0, iceberg_init(&data->table, TEST_LOG_SLOTS, &data->data_cfg));
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(iceberg_inline_key) {}
+
+// Builds key i, padded to length bytes, which must be more than 3
+static slice
+make_key(char *buf, int i, uint64 length)
+{
+   memset(buf, 'k', length);
+   snprintf(buf, length, "%d", i);
+   return slice_create(length, buf);
+}
+
+/*
+ * Keys that fit in the slots and keys that do not are inserted, found and
+ * removed the same way, even when they share a prefix.
+ */
+CTEST2(iceberg_inline_key, test_short_and_long_keys)
+{
+   uint64 lengths[] = {4,
+                       8,
+                       ICEBERG_INLINE_KEY_SIZE,
+                       ICEBERG_INLINE_KEY_SIZE + 1,
+                       TEST_MAX_KEY_SIZE};
+   char buf[TEST_MAX_KEY_SIZE];
+
+   for (uint64 l = 0; l < ARRAY_SIZE(lengths); l++) {
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         slice key = make_key(buf, i, lengths[l]);
+         ASSERT_TRUE(iceberg_insert(&data->table, &key, i, 0));
+      }
+   }
+
+   for (uint64 l = 0; l < ARRAY_SIZE(lengths); l++) {
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         ValueType *value;
+         slice      key = make_key(buf, i, lengths[l]);
+         ASSERT_TRUE(iceberg_get_value(&data->table, key, &value, 0));
+         ASSERT_TRUE(*value == (ValueType)i);
+      }
+   }
+
+   for (uint64 l = 0; l < ARRAY_SIZE(lengths); l++) {
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         slice key = make_key(buf, i, lengths[l]);
+         ASSERT_TRUE(iceberg_remove(&data->table, key, 0));
+         ValueType *value;
+         ASSERT_FALSE(iceberg_get_value(&data->table, key, &value, 0));
+      }
+   }
+}
+
+/*
+ * A short key inserted after another one was removed takes its cell, while a
+ * long key gets a cell of its own.
+ */
+CTEST2(iceberg_inline_key, test_cell_reuse)
+{
+   char buf[TEST_MAX_KEY_SIZE];
+
+   ValueType  value = 1;
+   ValueType *first = &value;
+   slice      key   = make_key(buf, 1, ICEBERG_INLINE_KEY_SIZE);
+   ASSERT_TRUE(iceberg_insert_and_get(&data->table, &key, &first, 0));
+   ASSERT_FALSE(iceberg_remove(&data->table, make_key(buf, 1, 8), 0));
+   ASSERT_TRUE(iceberg_remove(
+      &data->table, make_key(buf, 1, ICEBERG_INLINE_KEY_SIZE), 0));
+
+   value             = 2;
+   ValueType *second = &value;
+   key               = make_key(buf, 2, 8);
+   ASSERT_TRUE(iceberg_insert_and_get(&data->table, &key, &second, 0));
+   if (ICEBERG_INLINE_KEY_SIZE) {
+      ASSERT_TRUE(first == second);
+   }
+   ASSERT_TRUE(*second == 2);
+   ASSERT_EQUAL(8, slice_length(key));
+   ASSERT_STREQN("2", slice_data(key), 1);
+}
+
+typedef struct churn_args {
+   iceberg_table *table;
+   int            done;
+} churn_args;
+
+// Inserts and removes keys other than the ones the lookups look for
+static void *
+churn(void *arg)
+{
+   churn_args *args = (churn_args *)arg;
+   char        buf[TEST_MAX_KEY_SIZE];
+   for (int r = 0; r < TEST_NUM_ROUNDS; r++) {
+      for (int i = TEST_NUM_KEYS; i < 2 * TEST_NUM_KEYS; i++) {
+         slice key = make_key(buf, i, 8);
+         platform_assert(iceberg_insert(args->table, &key, i, 1));
+      }
+      for (int i = TEST_NUM_KEYS; i < 2 * TEST_NUM_KEYS; i++) {
+         platform_assert(iceberg_remove(args->table, make_key(buf, i, 8), 1));
+      }
+   }
+   __atomic_store_n(&args->done, 1, __ATOMIC_RELEASE);
+   return NULL;
+}
+
+/*
+ * Lookups race with a thread that keeps changing the blocks of the keys they
+ * look for, and always find them with their value.
+ */
+CTEST2(iceberg_inline_key, test_lookups_during_writes)
+{
+   char       buf[TEST_MAX_KEY_SIZE];
+   ValueType *values[TEST_NUM_KEYS];
+   for (int i = 0; i < TEST_NUM_KEYS; i++) {
+      ValueType value = i;
+      values[i]       = &value;
+      slice key       = make_key(buf, i, 8);
+      ASSERT_TRUE(iceberg_insert_and_get(&data->table, &key, &values[i], 0));
+   }
+
+   churn_args args = {.table = &data->table};
+   pthread_t  thread;
+   int        rc = pthread_create(&thread, NULL, churn, &args);
+   ASSERT_EQUAL(0, rc);
+
+   while (!__atomic_load_n(&args.done, __ATOMIC_ACQUIRE)) {
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         ValueType *value;
+         slice      key = make_key(buf, i, 8);
+         ASSERT_TRUE(iceberg_get_value(&data->table, key, &value, 0));
+         ASSERT_TRUE(value == values[i]);
+         ASSERT_TRUE(*value == (ValueType)i);
+      }
+   }
+   pthread_join(thread, NULL);
+}
@@ -0,0 +1,120 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * iceberg_lv3_test.c
+ *
+ *  Exercises the overflow lists of the iceberg table: keys that fill their
+ *  lv1 and lv2 blocks go to lv3 and are found there, the counters report
+ *  them, and the nodes of removed keys are reused instead of allocated again.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "isketch/iceberg_table.h"
+
+#define TEST_MAX_KEY_SIZE 32
+
+// Small enough that keys sharing all their blocks are quick to find
+#define TEST_LOG_SLOTS 10
+
+// All of them in block 0: they fill lv1 and lv2 and the rest go to lv3
+#define TEST_NUM_KEYS 200
+
+#define TEST_NUM_ROUNDS 3
+
+// The seeds of the table's hashes
+extern uint64_t seed[5];
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(iceberg_lv3)
+{
+   data_config   data_cfg;
+   iceberg_table table;
+   char          keys[TEST_NUM_KEYS][TEST_MAX_KEY_SIZE];
+};
+
+static slice
+str_key(char *key)
+{
+   return slice_create(strlen(key), key);
+}
+
+// The block a hash of the table maps key to
+static uint64
+block_of(iceberg_table *table, slice key, uint64 hash_seed)
+{
+   uint64 hash = platform_hash64(slice_data(key), slice_length(key), hash_seed);
+   return (hash >> FPRINT_BITS) & ((1ULL << table->metadata.block_bits) - 1);
+}
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(iceberg_lv3)
+{
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->data_cfg);
+   ASSERT_EQUAL(0, iceberg_init(&data->table, TEST_LOG_SLOTS, &data->data_cfg));
+
+   // Keys whose lv1 block and both lv2 blocks are block 0
+   int found = 0;
+   for (uint64 i = 0; found < TEST_NUM_KEYS; i++) {
+      char *key = data->keys[found];
+      snprintf(key, TEST_MAX_KEY_SIZE, "key-%08lu", i);
+      if (block_of(&data->table, str_key(key), seed[0]) == 0
+          && block_of(&data->table, str_key(key), seed[1]) == 0
+          && block_of(&data->table, str_key(key), seed[2]) == 0)
+      {
+         found++;
+      }
+   }
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(iceberg_lv3) {}
+
+/*
+ * Keys that overflow to lv3 are found there and counted in its one list. Once
+ * they are removed, their nodes are all free, and inserting them again takes
+ * no new slabs.
+ */
+CTEST2(iceberg_lv3, test_overflow_reuses_nodes)
+{
+   uint64 slab_nodes = 0;
+   for (int r = 0; r < TEST_NUM_ROUNDS; r++) {
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         slice key = str_key(data->keys[i]);
+         ASSERT_TRUE(iceberg_insert(&data->table, &key, i, 0));
+      }
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         ValueType *value;
+         ASSERT_TRUE(iceberg_get_value(
+            &data->table, str_key(data->keys[i]), &value, 0));
+         ASSERT_TRUE(*value == (ValueType)i);
+      }
+
+      iceberg_lv3_stats stats;
+      iceberg_lv3_get_stats(&data->table, &stats);
+      ASSERT_TRUE(stats.items > 0);
+      ASSERT_EQUAL(lv3_balls(&data->table), stats.items);
+      ASSERT_EQUAL(1, stats.lists);
+      ASSERT_EQUAL(stats.items, stats.longest_list);
+      ASSERT_EQUAL(stats.items, stats.slab_nodes - stats.free_nodes);
+      if (r == 0) {
+         slab_nodes = stats.slab_nodes;
+      }
+      ASSERT_EQUAL(slab_nodes, stats.slab_nodes);
+
+      for (int i = 0; i < TEST_NUM_KEYS; i++) {
+         ASSERT_TRUE(
+            iceberg_remove(&data->table, str_key(data->keys[i]), 0));
+      }
+      iceberg_lv3_get_stats(&data->table, &stats);
+      ASSERT_EQUAL(0, stats.items);
+      ASSERT_EQUAL(0, stats.lists);
+      ASSERT_EQUAL(slab_nodes, stats.free_nodes);
+   }
+}
@@ -0,0 +1,152 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * iceberg_resize_test.c
+ *
+ *  Exercises the online resizing of the iceberg table that backs the
+ *  timestamp cache: a table that starts small grows as keys are added, every
+ *  key is still found, and the value pointers handed out stay valid.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "isketch/iceberg_table.h"
+
+#define TEST_MAX_KEY_SIZE 32
+
+// Smallest table the resize supports, a few times over
+#define TEST_LOG_SLOTS 10
+
+#define TEST_NUM_KEYS    20000
+#define TEST_NUM_THREADS 4
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(iceberg_resize)
+{
+   data_config   data_cfg;
+   iceberg_table table;
+   char        (*keys)[TEST_MAX_KEY_SIZE];
+   ValueType   **values;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(iceberg_resize)
+{
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->data_cfg);
+   ASSERT_EQUAL(0, iceberg_init(&data->table, TEST_LOG_SLOTS, &data->data_cfg));
+
+   data->keys = TYPED_ARRAY_ZALLOC(0, data->keys, TEST_NUM_KEYS);
+   ASSERT_TRUE(data->keys != NULL);
+   data->values = TYPED_ARRAY_ZALLOC(0, data->values, TEST_NUM_KEYS);
+   ASSERT_TRUE(data->values != NULL);
+   for (int i = 0; i < TEST_NUM_KEYS; i++) {
+      snprintf(data->keys[i], TEST_MAX_KEY_SIZE, "key-%08d", i);
+   }
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(iceberg_resize)
+{
+   platform_free(0, data->values);
+   platform_free(0, data->keys);
+}
+
+static slice
+str_key(char *key)
+{
+   return slice_create(strlen(key), key);
+}
+
+// Every key is found, with the value pointer it was inserted with
+static void
+check_keys(iceberg_table *table,
+           char (*keys)[TEST_MAX_KEY_SIZE],
+           ValueType    **values)
+{
+   for (int i = 0; i < TEST_NUM_KEYS; i++) {
+      ValueType *value = NULL;
+      ASSERT_TRUE(iceberg_get_value(table, str_key(keys[i]), &value, 0));
+      ASSERT_TRUE(value == values[i]);
+      ASSERT_TRUE(*value == (ValueType)i);
+   }
+}
+
+/*
+ * Inserting far more keys than the table starts with grows it, without
+ * losing a key or moving a value.
+ */
+CTEST2(iceberg_resize, test_grow)
+{
+   uint64_t init_nblocks = data->table.metadata.nblocks;
+   for (int i = 0; i < TEST_NUM_KEYS; i++) {
+      slice     key   = str_key(data->keys[i]);
+      ValueType value = i;
+      data->values[i] = &value;
+      ASSERT_TRUE(
+         iceberg_insert_and_get(&data->table, &key, &data->values[i], 0));
+   }
+   ASSERT_TRUE(data->table.metadata.nblocks > init_nblocks);
+
+   check_keys(&data->table, data->keys, data->values);
+
+   // Finishing the last resize leaves everything where it was found
+   iceberg_end(&data->table);
+   check_keys(&data->table, data->keys, data->values);
+}
+
+typedef struct inserter_args {
+   iceberg_table *table;
+   char (*keys)[TEST_MAX_KEY_SIZE];
+   ValueType **values;
+   int         from;
+   int         to;
+   threadid    tid;
+} inserter_args;
+
+static void *
+inserter(void *arg)
+{
+   inserter_args *args = (inserter_args *)arg;
+   for (int i = args->from; i < args->to; i++) {
+      slice     key   = str_key(args->keys[i]);
+      ValueType value = i;
+      args->values[i] = &value;
+      platform_assert(iceberg_insert_and_get(
+         args->table, &key, &args->values[i], args->tid));
+   }
+   return NULL;
+}
+
+/*
+ * Threads that insert while the table grows, each splitting the blocks it
+ * needs, still leave every key in place.
+ */
+CTEST2(iceberg_resize, test_grow_concurrently)
+{
+   inserter_args args[TEST_NUM_THREADS];
+   pthread_t     threads[TEST_NUM_THREADS];
+   int           per_thread = TEST_NUM_KEYS / TEST_NUM_THREADS;
+   for (int t = 0; t < TEST_NUM_THREADS; t++) {
+      args[t] = (inserter_args){.table  = &data->table,
+                                .keys   = data->keys,
+                                .values = data->values,
+                                .from   = t * per_thread,
+                                .to     = (t + 1) * per_thread,
+                                .tid    = t};
+      int rc  = pthread_create(&threads[t], NULL, inserter, &args[t]);
+      ASSERT_EQUAL(0, rc);
+   }
+   for (int t = 0; t < TEST_NUM_THREADS; t++) {
+      pthread_join(threads[t], NULL);
+   }
+
+   check_keys(&data->table, data->keys, data->values);
+}
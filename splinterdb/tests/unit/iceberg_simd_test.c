@@ -0,0 +1,169 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * iceberg_simd_test.c
+ *
+ *  Exercises the metadata scans of the iceberg table: every set of kernels
+ *  the cpu supports gives the same masks and selects the same bits as a
+ *  byte-by-byte reference.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "platform.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "isketch/iceberg_simd.h"
+
+#define TEST_NUM_BLOCKS 10000
+
+// The byte of lv1 metadata whose lowest bit is the lock bit
+#define TEST_LOCK_BYTE 56
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(iceberg_simd)
+{
+   uint64 rand_state;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(iceberg_simd)
+{
+   data->rand_state = 0x9e3779b97f4a7c15ULL;
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(iceberg_simd) {}
+
+static uint64
+next_rand(uint64 *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return *state;
+}
+
+/*
+ * Fills md with fingerprints from a small range, so that scans find a few
+ * matches, and with empty slots.
+ */
+static void
+fill_metadata(uint64 *state, uint8 md[64])
+{
+   for (int i = 0; i < 64; i++) {
+      uint64 r = next_rand(state);
+      md[i]    = r % 3 == 0 ? 0 : (r >> 8) % 8;
+   }
+}
+
+static uint64
+reference_mask(const uint8 *md, uint8 fprint, int bytes)
+{
+   uint64 mask = 0;
+   for (int i = 0; i < bytes; i++) {
+      uint8 b  = md[i];
+      uint8 fp = fprint;
+      if (bytes == 64 && i == TEST_LOCK_BYTE) {
+         b |= 1;
+         fp |= 1;
+      }
+      if (b == fp) {
+         mask |= 1ULL << i;
+      }
+   }
+   return mask;
+}
+
+static uint8
+reference_select(uint64 val, int rank)
+{
+   for (int i = 0; i < 64; i++) {
+      if (val & (1ULL << i)) {
+         if (rank-- == 0) {
+            return i;
+         }
+      }
+   }
+   return 64;
+}
+
+/*
+ * The portable kernels are always there and the best ones are at least as
+ * good as them.
+ */
+CTEST2(iceberg_simd, test_levels)
+{
+   ASSERT_TRUE(iceberg_simd_ops_get(ICEBERG_SIMD_SCALAR) != NULL);
+   ASSERT_TRUE(iceberg_simd_ops_get(ICEBERG_SIMD_MAX_VALID) == NULL);
+
+   const iceberg_simd_ops *best = iceberg_simd_ops_best();
+   ASSERT_TRUE(best != NULL);
+   for (int level = ICEBERG_SIMD_MAX_VALID - 1; level >= 0; level--) {
+      const iceberg_simd_ops *ops = iceberg_simd_ops_get(level);
+      if (ops != NULL) {
+         ASSERT_TRUE(ops == best);
+         break;
+      }
+   }
+}
+
+/*
+ * Scans of random metadata, including the byte with the lock bit, match the
+ * reference for every supported level.
+ */
+CTEST2(iceberg_simd, test_slot_masks)
+{
+   uint8 md[64];
+   for (int level = 0; level < ICEBERG_SIMD_MAX_VALID; level++) {
+      const iceberg_simd_ops *ops = iceberg_simd_ops_get(level);
+      if (ops == NULL) {
+         continue;
+      }
+      for (int b = 0; b < TEST_NUM_BLOCKS; b++) {
+         fill_metadata(&data->rand_state, md);
+         uint8 fprint = next_rand(&data->rand_state) % 8;
+         ASSERT_EQUAL(reference_mask(md, fprint, 64),
+                      ops->slot_mask_64(md, fprint),
+                      "level %s, block %d\n",
+                      ops->name,
+                      b);
+         ASSERT_EQUAL(reference_mask(md, fprint, 32),
+                      ops->slot_mask_32(md, fprint),
+                      "level %s, block %d\n",
+                      ops->name,
+                      b);
+      }
+   }
+}
+
+/*
+ * Every rank of random words, and ranks past their last set bit, select the
+ * same bit as the reference.
+ */
+CTEST2(iceberg_simd, test_word_select)
+{
+   for (int level = 0; level < ICEBERG_SIMD_MAX_VALID; level++) {
+      const iceberg_simd_ops *ops = iceberg_simd_ops_get(level);
+      if (ops == NULL) {
+         continue;
+      }
+      ASSERT_EQUAL(64, ops->word_select(0, 0));
+      ASSERT_EQUAL(63, ops->word_select(~0ULL, 63));
+      ASSERT_EQUAL(64, ops->word_select(~0ULL, 64));
+      for (int w = 0; w < TEST_NUM_BLOCKS; w++) {
+         uint64 val = next_rand(&data->rand_state);
+         for (int rank = 0; rank <= __builtin_popcountll(val); rank++) {
+            ASSERT_EQUAL(reference_select(val, rank),
+                         ops->word_select(val, rank),
+                         "level %s, word 0x%lx, rank %d\n",
+                         ops->name,
+                         val,
+                         rank);
+         }
+      }
+   }
+}
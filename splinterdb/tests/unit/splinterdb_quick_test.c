@@ -252,6 +252,9 @@ CTEST2(splinterdb_quick, test_key_size_gt_max_key_size)
    splinterdb_lookup_result result;
    splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
 
+   rc = splinterdb_lookup(data->kvsb, too_large_key, &result);
+   ASSERT_EQUAL(EINVAL, rc);
+
    rc = splinterdb_delete(data->kvsb, too_large_key);
    ASSERT_EQUAL(EINVAL, rc);
 
@@ -698,6 +701,132 @@ CTEST2(splinterdb_quick, test_repeated_insert_close_reopen)
    }
 }
 
+/*
+ * Test splinterdb_prefetch(): after reopening, so that the cache is cold,
+ * more keys than it looks up at once are prefetched, some of them missing,
+ * and lookups then find what was inserted.
+ */
+CTEST2(splinterdb_quick, test_prefetch)
+{
+   // More keys than splinterdb_prefetch() looks up at once
+   enum { num_inserts = 40, num_keys = 50 };
+
+   int rc = insert_some_keys(num_inserts, data->kvsb);
+   ASSERT_EQUAL(0, rc);
+   splinterdb_close(&data->kvsb);
+   rc = splinterdb_open(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   char  keys[num_keys][TEST_INSERT_KEY_LENGTH] = {{0}};
+   slice key_slices[num_keys];
+   for (int i = 0; i < num_keys; i++) {
+      snprintf(keys[i], sizeof(keys[i]), key_fmt, i);
+      key_slices[i] = slice_create(sizeof(keys[i]), keys[i]);
+   }
+   splinterdb_prefetch(data->kvsb, num_keys, key_slices);
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+   for (int i = 0; i < num_keys; i++) {
+      rc = splinterdb_lookup(data->kvsb, key_slices[i], &result);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(i < num_inserts, splinterdb_lookup_found(&result));
+      if (i < num_inserts) {
+         char val[TEST_INSERT_VAL_LENGTH] = {0};
+         snprintf(val, sizeof(val), val_fmt, i);
+         slice value;
+         rc = splinterdb_lookup_result_value(&result, &value);
+         ASSERT_EQUAL(0, rc);
+         ASSERT_EQUAL(sizeof(val), slice_length(value));
+         ASSERT_STREQN(val, slice_data(value), slice_length(value));
+      }
+   }
+   splinterdb_lookup_result_deinit(&result);
+
+   // Nothing to prefetch
+   splinterdb_prefetch(data->kvsb, 0, NULL);
+}
+
+/*
+ * Test splinterdb_write_batch(): the writes of a batch are applied in
+ * order, including batches too large to be converted on the stack, and a
+ * batch with an invalid write fails.
+ */
+CTEST2(splinterdb_quick, test_write_batch)
+{
+   // More writes than splinterdb_write_batch() converts on the stack
+   enum { num_writes = 100 };
+
+   char             keys[num_writes][TEST_INSERT_KEY_LENGTH];
+   char             vals[num_writes][TEST_INSERT_VAL_LENGTH];
+   splinterdb_write writes[num_writes + 1];
+   for (int i = 0; i < num_writes; i++) {
+      snprintf(keys[i], sizeof(keys[i]), key_fmt, i);
+      snprintf(vals[i], sizeof(vals[i]), val_fmt, i);
+      writes[i] = (splinterdb_write){
+         .type  = MESSAGE_TYPE_INSERT,
+         .key   = slice_create(sizeof(keys[i]), keys[i]),
+         .value = slice_create(sizeof(vals[i]), vals[i]),
+      };
+   }
+   // Deleting the first key again must win over its insert
+   writes[num_writes] = (splinterdb_write){
+      .type = MESSAGE_TYPE_DELETE,
+      .key  = writes[0].key,
+   };
+
+   int rc = splinterdb_write_batch(data->kvsb, num_writes + 1, writes);
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+
+   rc = splinterdb_lookup(data->kvsb, writes[0].key, &result);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_FALSE(splinterdb_lookup_found(&result));
+
+   for (int i = 1; i < num_writes; i++) {
+      rc = splinterdb_lookup(data->kvsb, writes[i].key, &result);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_TRUE(splinterdb_lookup_found(&result));
+
+      slice value;
+      rc = splinterdb_lookup_result_value(&result, &value);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(0, slice_lex_cmp(writes[i].value, value));
+   }
+
+   splinterdb_write invalid = {.type = MESSAGE_TYPE_INVALID,
+                               .key  = writes[0].key};
+   rc = splinterdb_write_batch(data->kvsb, 1, &invalid);
+   ASSERT_NOT_EQUAL(0, rc);
+
+   // A value that is too large fails the batch before any of it is applied
+   size_t too_large_value_len =
+      MAX_INLINE_MESSAGE_SIZE(LAIO_DEFAULT_PAGE_SIZE) + 1;
+   char *too_large_value_data;
+   too_large_value_data = TYPED_ARRAY_MALLOC(
+      data->cfg.heap_id, too_large_value_data, too_large_value_len);
+   memset(too_large_value_data, 'z', too_large_value_len);
+   splinterdb_write too_large[] = {
+      {.type  = MESSAGE_TYPE_INSERT,
+       .key   = writes[0].key,
+       .value = writes[1].value},
+      {.type  = MESSAGE_TYPE_INSERT,
+       .key   = writes[1].key,
+       .value = slice_create(too_large_value_len, too_large_value_data)},
+   };
+   rc = splinterdb_write_batch(data->kvsb, ARRAY_SIZE(too_large), too_large);
+   ASSERT_NOT_EQUAL(0, rc);
+   platform_free(data->cfg.heap_id, too_large_value_data);
+
+   rc = splinterdb_lookup(data->kvsb, writes[0].key, &result);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_FALSE(splinterdb_lookup_found(&result));
+
+   splinterdb_lookup_result_deinit(&result);
+}
+
 // Check that the value-oriented functions work sensibly with a custom
 // data_config
 CTEST2(splinterdb_quick, test_custom_data_config)
@@ -0,0 +1,203 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_abort_profile_test.c
+ *
+ *  Exercises the abort profile of transactions: every abort is counted under
+ *  the reason the protocol gave, and the keys that abort the most
+ *  transactions come out first.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_abort_profile)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_abort_profile)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   data->txn_kvsb = NULL;
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_abort_profile)
+{
+   transaction_test_close_db(&data->txn_kvsb);
+}
+
+/*
+ * Under MVCC, the first of two transactions that wrote key to commit wins,
+ * and the other one aborts on key.
+ */
+static void
+lose_write_conflict(transactional_splinterdb *txn_kvsb, const char *key)
+{
+   transaction loser, winner;
+   transactional_splinterdb_begin(txn_kvsb, &loser);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &loser, key, "value"));
+   transactional_splinterdb_begin(txn_kvsb, &winner);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &winner, key, "value"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &winner));
+   ASSERT_NOT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &loser));
+}
+
+static void
+assert_hot_key(const transaction_hot_key *hot,
+               const char                *key,
+               uint64                     conflicts)
+{
+   ASSERT_EQUAL(strlen(key), hot->length);
+   ASSERT_STREQN(key, hot->key, strlen(key));
+   ASSERT_EQUAL(conflicts, hot->conflicts);
+   ASSERT_EQUAL(0, hot->error);
+}
+
+/*
+ * A 2PL_NO_WAIT write to a key another transaction has locked aborts as
+ * LOCK_BUSY on that key, and the abort of the other one is counted as USER.
+ */
+CTEST2(transaction_abort_profile, test_lock_busy)
+{
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_2PL_NO_WAIT);
+
+   transaction holder, waiter;
+   transactional_splinterdb_begin(data->txn_kvsb, &holder);
+   ASSERT_EQUAL(0, write_key(data->txn_kvsb, &holder, "locked", "value"));
+   transactional_splinterdb_begin(data->txn_kvsb, &waiter);
+   ASSERT_NOT_EQUAL(0, write_key(data->txn_kvsb, &waiter, "locked", "value"));
+   ASSERT_EQUAL(0, transactional_splinterdb_abort(data->txn_kvsb, &holder));
+
+   transaction_abort_stats stats;
+   transactional_splinterdb_thread_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(1, stats.aborts[TRANSACTION_ABORT_LOCK_BUSY]);
+   ASSERT_EQUAL(1, stats.aborts[TRANSACTION_ABORT_USER]);
+   ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_UNKNOWN]);
+
+   transaction_hot_key keys[4];
+   ASSERT_EQUAL(1, transactional_splinterdb_hot_keys(data->txn_kvsb, keys, 4));
+   assert_hot_key(&keys[0], "locked", 1);
+}
+
+/*
+ * Keys come out most conflicts first, and reset forgets them.
+ */
+CTEST2(transaction_abort_profile, test_hot_keys_ranked)
+{
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+
+   lose_write_conflict(data->txn_kvsb, "warm");
+   for (int i = 0; i < 3; i++) {
+      lose_write_conflict(data->txn_kvsb, "hot");
+   }
+   lose_write_conflict(data->txn_kvsb, "cold");
+   lose_write_conflict(data->txn_kvsb, "warm");
+
+   transaction_abort_stats stats;
+   transactional_splinterdb_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(6, stats.aborts[TRANSACTION_ABORT_WRITE_CONFLICT]);
+
+   transaction_hot_key keys[4];
+   ASSERT_EQUAL(3, transactional_splinterdb_hot_keys(data->txn_kvsb, keys, 4));
+   assert_hot_key(&keys[0], "hot", 3);
+   assert_hot_key(&keys[1], "warm", 2);
+   assert_hot_key(&keys[2], "cold", 1);
+
+   // Only as many as asked for
+   ASSERT_EQUAL(1, transactional_splinterdb_hot_keys(data->txn_kvsb, keys, 1));
+   assert_hot_key(&keys[0], "hot", 3);
+
+   transactional_splinterdb_print_abort_stats(data->txn_kvsb);
+
+   transactional_splinterdb_reset_abort_stats(data->txn_kvsb);
+   transactional_splinterdb_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_WRITE_CONFLICT]);
+   ASSERT_EQUAL(0, transactional_splinterdb_hot_keys(data->txn_kvsb, keys, 4));
+}
+
+/*
+ * Keys longer than TRANSACTION_HOT_KEY_MAX_LENGTH keep their length, and
+ * as much of them as fits.
+ */
+CTEST2(transaction_abort_profile, test_long_key)
+{
+   data->data_cfg.max_key_size = TRANSACTION_HOT_KEY_MAX_LENGTH + 16;
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+
+   char key[TRANSACTION_HOT_KEY_MAX_LENGTH + 11];
+   memset(key, 'k', sizeof(key) - 1);
+   key[sizeof(key) - 1] = '\0';
+   lose_write_conflict(data->txn_kvsb, key);
+
+   transaction_hot_key keys[1];
+   ASSERT_EQUAL(1, transactional_splinterdb_hot_keys(data->txn_kvsb, keys, 1));
+   ASSERT_EQUAL(strlen(key), keys[0].length);
+   ASSERT_STREQN(key, keys[0].key, TRANSACTION_HOT_KEY_MAX_LENGTH);
+}
+
+/*
+ * Only one in hot_key_sample_interval keys is counted, while every abort
+ * is.
+ */
+CTEST2(transaction_abort_profile, test_sampling)
+{
+   transactional_splinterdb_config txn_cfg;
+   transactional_splinterdb_config_init(
+      &txn_cfg, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+   txn_cfg.hot_key_sample_interval = 4;
+   ASSERT_EQUAL(0,
+                transactional_splinterdb_create_with_config(&txn_cfg,
+                                                            &data->txn_kvsb));
+
+   for (int i = 0; i < 8; i++) {
+      lose_write_conflict(data->txn_kvsb, "hot");
+   }
+
+   transaction_abort_stats stats;
+   transactional_splinterdb_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(8, stats.aborts[TRANSACTION_ABORT_WRITE_CONFLICT]);
+
+   transaction_hot_key keys[1];
+   ASSERT_EQUAL(1, transactional_splinterdb_hot_keys(data->txn_kvsb, keys, 1));
+   assert_hot_key(&keys[0], "hot", 2);
+}
+
+/*
+ * Every reason has a name of its own.
+ */
+CTEST2(transaction_abort_profile, test_reason_names)
+{
+   for (transaction_abort_reason r = TRANSACTION_ABORT_UNKNOWN;
+        r < TRANSACTION_ABORT_MAX_VALID;
+        r++)
+   {
+      const char *name = transaction_abort_reason_name(r);
+      ASSERT_NOT_EQUAL(0, strcmp("invalid", name));
+      for (transaction_abort_reason s = TRANSACTION_ABORT_UNKNOWN; s < r; s++)
+      {
+         ASSERT_NOT_EQUAL(0, strcmp(transaction_abort_reason_name(s), name));
+      }
+   }
+   ASSERT_STREQ("invalid",
+                transaction_abort_reason_name(TRANSACTION_ABORT_MAX_VALID));
+}
@@ -0,0 +1,121 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_arena_test.c
+ *
+ *  Exercises the arena that backs the read/write set of a transaction.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "platform.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_arena.h"
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_arena)
+{
+   // Declare head handles for memory allocation.
+   platform_heap_handle hh;
+   platform_heap_id     hid;
+
+   transaction_arena *arena;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_arena)
+{
+   platform_status rc = platform_heap_create(
+      platform_get_module_id(), (1 * GiB), &data->hh, &data->hid);
+   platform_assert_status_ok(rc);
+
+   data->arena = transaction_arena_create(data->hid);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_arena)
+{
+   transaction_arena_destroy(data->arena);
+   platform_heap_destroy(&data->hh);
+}
+
+/*
+ * Every allocation is aligned, and consecutive allocations do not overlap.
+ */
+CTEST2(transaction_arena, test_alloc_alignment)
+{
+   char  *prev    = NULL;
+   uint64 prev_sz = 0;
+   for (uint64 size = 1; size < 100; size++) {
+      char *ptr = transaction_arena_alloc(data->arena, size);
+      ASSERT_EQUAL(0, (uint64)ptr % TRANSACTION_ARENA_ALIGNMENT);
+      if (prev) {
+         ASSERT_TRUE(prev + prev_sz <= ptr);
+      }
+      memset(ptr, 0xab, size);
+      prev    = ptr;
+      prev_sz = size;
+   }
+}
+
+/*
+ * Allocating past the end of a chunk, and allocating more than a chunk at
+ * once, both return usable memory.
+ */
+CTEST2(transaction_arena, test_alloc_past_chunk)
+{
+   uint64 size = TRANSACTION_ARENA_CHUNK_SIZE / 4 + 1;
+   for (int i = 0; i < 16; i++) {
+      char *ptr = transaction_arena_alloc(data->arena, size);
+      ASSERT_NOT_NULL(ptr);
+      memset(ptr, i, size);
+   }
+
+   size      = 3 * TRANSACTION_ARENA_CHUNK_SIZE;
+   char *ptr = transaction_arena_alloc(data->arena, size);
+   ASSERT_NOT_NULL(ptr);
+   memset(ptr, 0xcd, size);
+}
+
+/*
+ * After a reset the arena hands out the same memory again.
+ */
+CTEST2(transaction_arena, test_reset_reuses_memory)
+{
+   char *first = transaction_arena_alloc(data->arena, 64);
+   for (int i = 0; i < 1000; i++) {
+      transaction_arena_alloc(data->arena, 1024);
+   }
+   uint64 big_size = TRANSACTION_ARENA_CHUNK_SIZE;
+   char  *big      = transaction_arena_alloc(data->arena, big_size);
+
+   transaction_arena_reset(data->arena);
+   ASSERT_TRUE(first == transaction_arena_alloc(data->arena, 64));
+   for (int i = 0; i < 1000; i++) {
+      transaction_arena_alloc(data->arena, 1024);
+   }
+   ASSERT_TRUE(big == transaction_arena_alloc(data->arena, big_size));
+}
+
+/*
+ * Zeroed allocations and slice copies.
+ */
+CTEST2(transaction_arena, test_zalloc_and_copy)
+{
+   char *ptr = transaction_arena_alloc(data->arena, 32);
+   memset(ptr, 0xff, 32);
+   transaction_arena_reset(data->arena);
+
+   uint64 *zero = TYPED_ARENA_ZALLOC(data->arena, zero);
+   ASSERT_EQUAL(0, *zero);
+
+   const char *str  = "transaction arena";
+   slice       src  = slice_create(strlen(str), str);
+   slice       copy = transaction_arena_copy_slice(data->arena, src);
+   ASSERT_TRUE(slice_data(src) != slice_data(copy));
+   ASSERT_EQUAL(0, slice_lex_cmp(src, copy));
+}
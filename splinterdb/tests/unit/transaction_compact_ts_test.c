@@ -0,0 +1,195 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_compact_ts_test.c
+ *
+ *  Exercises the compact timestamps of TicToc, which keep the timestamps of
+ *  a tuple in one word: transactions run as with the wide ones, and a read
+ *  timestamp extended past what the delta holds moves the write timestamp
+ *  up instead, by no more than the delta cannot hold.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "transaction_impl/tictoc_memory_internal.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+// Writes that take the write timestamp of a key past the 15 bits of delta
+#define TEST_NUM_BUMPS ((1 << 15) + 100)
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_compact_ts)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_compact_ts)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   data->txn_kvsb = NULL;
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_compact_ts)
+{
+   transaction_test_close_db(&data->txn_kvsb);
+}
+
+static void
+create_db(transactional_splinterdb **txn_kvsb,
+          const splinterdb_config   *cfg,
+          bool                       compact_timestamps)
+{
+   transactional_splinterdb_config txn_cfg;
+   transaction_test_init_txn_config(
+      &txn_cfg, cfg, TRANSACTION_PROTOCOL_TICTOC_MEMORY);
+   txn_cfg.compact_timestamps = compact_timestamps;
+   int rc = transactional_splinterdb_create_with_config(&txn_cfg, txn_kvsb);
+   ASSERT_EQUAL(0, rc);
+}
+
+// Reads key, which must be there, and checks that its value is value
+static int
+read_key(transactional_splinterdb *txn_kvsb,
+         transaction              *txn,
+         const char               *key,
+         const char               *value)
+{
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb, txn, str_slice(key), &result);
+   if (rc == 0) {
+      ASSERT_TRUE(splinterdb_lookup_found(&result));
+      slice found;
+      ASSERT_EQUAL(0, splinterdb_lookup_result_value(&result, &found));
+      ASSERT_EQUAL(strlen(value), slice_length(found));
+      ASSERT_STREQN(value, slice_data(found), slice_length(found));
+   }
+   splinterdb_lookup_result_deinit(&result);
+   return rc;
+}
+
+static void
+commit_write(transactional_splinterdb *txn_kvsb,
+             const char               *key,
+             const char               *value)
+{
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &txn, key, value));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+}
+
+/*
+ * Reads see what was committed, and a reader that writes the key over a read
+ * another writer made stale fails validation, as with wide timestamps.
+ */
+CTEST2(transaction_compact_ts, test_read_write)
+{
+   create_db(&data->txn_kvsb, &data->cfg, TRUE);
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   commit_write(txn_kvsb, "key", "0");
+
+   transaction reader, writer;
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+   ASSERT_EQUAL(0, read_key(txn_kvsb, &reader, "key", "0"));
+   transactional_splinterdb_begin(txn_kvsb, &writer);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "key", "1"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &writer));
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &reader, "key", "2"));
+   ASSERT_NOT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+   ASSERT_EQUAL(0, read_key(txn_kvsb, &reader, "key", "1"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+}
+
+/*
+ * "cold" is read by a transaction that commits far past its write
+ * timestamp. The wide timestamps extend its read timestamp; the compact ones
+ * move its write timestamp up, so a transaction that read "cold" before then
+ * fails validation.
+ */
+CTEST2(transaction_compact_ts, test_delta_overflow)
+{
+   for (int compact = 0; compact < 2; compact++) {
+      create_db(&data->txn_kvsb, &data->cfg, compact);
+      transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+      commit_write(txn_kvsb, "cold", "c");
+      for (int i = 0; i < TEST_NUM_BUMPS; i++) {
+         commit_write(txn_kvsb, "hot", "h");
+      }
+
+      transaction early, late;
+      transactional_splinterdb_begin(txn_kvsb, &early);
+      ASSERT_EQUAL(0, read_key(txn_kvsb, &early, "cold", "c"));
+
+      transactional_splinterdb_begin(txn_kvsb, &late);
+      ASSERT_EQUAL(0, read_key(txn_kvsb, &late, "cold", "c"));
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &late, "hot", "h"));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &late));
+
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &early, "hot", "h"));
+      int rc = transactional_splinterdb_commit(txn_kvsb, &early);
+      transaction_abort_stats stats;
+      transactional_splinterdb_abort_stats(txn_kvsb, &stats);
+      if (compact) {
+         ASSERT_NOT_EQUAL(0, rc);
+         ASSERT_EQUAL(1, stats.aborts[TRANSACTION_ABORT_READ_CHANGED]);
+      } else {
+         ASSERT_EQUAL(0, rc);
+         ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_READ_CHANGED]);
+      }
+
+      // The value is unchanged, only its timestamps moved
+      transaction txn;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, read_key(txn_kvsb, &txn, "cold", "c"));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * An rts extended just past what the delta holds moves wts up by the excess
+ * only, leaving the delta full. The wide layout keeps wts.
+ */
+CTEST2(transaction_compact_ts, test_extend_past_max_delta)
+{
+   for (txn_timestamp excess = 1; excess <= 3; excess++) {
+      txn_timestamp rts = 100 + COMPACT_TIMESTAMP_MAX_DELTA + excess;
+
+      timestamp_set ts = {.wts = 100};
+      timestamp_set_extend(&ts, rts, TRUE);
+      ASSERT_EQUAL(100 + excess, (uint64)ts.wts);
+      ASSERT_EQUAL(COMPACT_TIMESTAMP_MAX_DELTA, (uint64)ts.delta);
+      ASSERT_EQUAL(rts, timestamp_set_get_rts(&ts));
+
+      ts = (timestamp_set){.wts = 100};
+      timestamp_set_extend(&ts, rts, FALSE);
+      ASSERT_EQUAL(100, (uint64)ts.wts);
+      ASSERT_EQUAL(rts - 100, (uint64)ts.delta);
+   }
+
+   // Within the delta, wts stays
+   timestamp_set ts = {.wts = 100};
+   timestamp_set_extend(&ts, 100 + COMPACT_TIMESTAMP_MAX_DELTA, TRUE);
+   ASSERT_EQUAL(100, (uint64)ts.wts);
+   ASSERT_EQUAL(COMPACT_TIMESTAMP_MAX_DELTA, (uint64)ts.delta);
+}
@@ -0,0 +1,275 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_contention_test.c
+ *
+ *  Exercises the contention manager that tells the protocols how long to
+ *  wait before retrying a lock, and what reads do when their tuple is locked.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "platform.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_contention.h"
+#include "transaction_internal.h"
+#include "transaction_test_common.h"
+
+#define TEST_MIN_WAIT_NS (1000)
+#define TEST_MAX_WAIT_NS (64 * 1000)
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_contention)
+{
+   transaction_contention *cm;
+   threadid                saved_tid;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_contention)
+{
+   data->cm = TYPED_ZALLOC(0, data->cm);
+   platform_assert(data->cm != NULL);
+
+   // The manager keeps its state per thread, so this one needs an id
+   data->saved_tid = platform_get_tid();
+   platform_set_tid(0);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_contention)
+{
+   platform_set_tid(data->saved_tid);
+   platform_free(0, data->cm);
+}
+
+static void
+init_policy(transaction_contention *cm, transaction_contention_policy policy)
+{
+   transaction_contention_init(cm, policy, TEST_MIN_WAIT_NS, TEST_MAX_WAIT_NS);
+}
+
+/*
+ * FIXED always waits the shortest wait.
+ */
+CTEST2(transaction_contention, test_fixed)
+{
+   init_policy(data->cm, TRANSACTION_CONTENTION_FIXED);
+   for (uint64 attempt = 0; attempt < 20; attempt++) {
+      transaction_contention_on_abort(data->cm);
+      ASSERT_EQUAL(TEST_MIN_WAIT_NS,
+                   transaction_contention_wait_ns(data->cm, attempt));
+   }
+}
+
+/*
+ * BACKOFF doubles the wait with every attempt, up to the longest wait, and
+ * jitters it by at most half.
+ */
+CTEST2(transaction_contention, test_backoff)
+{
+   init_policy(data->cm, TRANSACTION_CONTENTION_BACKOFF);
+   for (uint64 attempt = 0; attempt < 20; attempt++) {
+      uint64 expected = MIN(TEST_MIN_WAIT_NS << attempt, TEST_MAX_WAIT_NS);
+      uint64 wait     = transaction_contention_wait_ns(data->cm, attempt);
+      ASSERT_TRUE(expected / 2 <= wait && wait <= expected,
+                  "attempt %lu waited %lu\n",
+                  attempt,
+                  wait);
+   }
+}
+
+/*
+ * ABORT_RATE waits longer on a thread whose transactions abort, and less
+ * again once they commit.
+ */
+CTEST2(transaction_contention, test_abort_rate)
+{
+   init_policy(data->cm, TRANSACTION_CONTENTION_ABORT_RATE);
+   uint64 wait = transaction_contention_wait_ns(data->cm, 0);
+   ASSERT_TRUE(wait <= TEST_MIN_WAIT_NS, "waited %lu\n", wait);
+
+   for (int i = 0; i < 100; i++) {
+      transaction_contention_on_abort(data->cm);
+   }
+   wait = transaction_contention_wait_ns(data->cm, 0);
+   ASSERT_TRUE(TEST_MAX_WAIT_NS / 4 < wait, "waited %lu\n", wait);
+
+   for (int i = 0; i < 100; i++) {
+      transaction_contention_on_commit(data->cm);
+   }
+   wait = transaction_contention_wait_ns(data->cm, 0);
+   ASSERT_TRUE(wait < 2 * TEST_MIN_WAIT_NS, "waited %lu\n", wait);
+}
+
+/*
+ * AGE lets a transaction that was retried many times wait less than a new
+ * one, so that it gets its locks first.
+ */
+CTEST2(transaction_contention, test_age)
+{
+   init_policy(data->cm, TRANSACTION_CONTENTION_AGE);
+   const uint64 attempt = 10;
+   uint64       young   = transaction_contention_wait_ns(data->cm, attempt);
+   ASSERT_TRUE(TEST_MAX_WAIT_NS / 2 <= young, "waited %lu\n", young);
+
+   for (int i = 0; i < 10; i++) {
+      transaction_contention_on_abort(data->cm);
+   }
+   uint64 old = transaction_contention_wait_ns(data->cm, attempt);
+   ASSERT_TRUE(old <= TEST_MIN_WAIT_NS, "waited %lu\n", old);
+
+   // A commit makes the next transaction young again
+   transaction_contention_on_commit(data->cm);
+   young = transaction_contention_wait_ns(data->cm, attempt);
+   ASSERT_TRUE(TEST_MAX_WAIT_NS / 2 <= young, "waited %lu\n", young);
+}
+
+/*
+ * Commits, aborts and waits are counted per thread until reset.
+ */
+CTEST2(transaction_contention, test_stats)
+{
+   init_policy(data->cm, TRANSACTION_CONTENTION_FIXED);
+   transaction_contention_on_commit(data->cm);
+   transaction_contention_on_abort(data->cm);
+   transaction_contention_on_abort(data->cm);
+   transaction_contention_wait_ns(data->cm, 0);
+   transaction_contention_wait_ns(data->cm, 1);
+   transaction_contention_wait_ns(data->cm, 2);
+
+   transaction_contention_stats stats;
+   transaction_contention_get_stats(data->cm, platform_get_tid(), &stats);
+   ASSERT_EQUAL(1, stats.commits);
+   ASSERT_EQUAL(2, stats.aborts);
+   ASSERT_EQUAL(3, stats.lock_waits);
+   ASSERT_EQUAL(3 * TEST_MIN_WAIT_NS, stats.wait_ns);
+
+   transaction_contention_reset_stats(data->cm);
+   transaction_contention_get_stats(data->cm, platform_get_tid(), &stats);
+   ASSERT_EQUAL(0, stats.commits);
+   ASSERT_EQUAL(0, stats.aborts);
+   ASSERT_EQUAL(0, stats.lock_waits);
+   ASSERT_EQUAL(0, stats.wait_ns);
+}
+
+/*
+ * SPIN and YIELD keep a read waiting for as long as its tuple is locked, and
+ * ABORT gives up after read_wait_spins attempts.
+ */
+CTEST2(transaction_contention, test_read_wait)
+{
+   const uint64 spins = 8;
+   init_policy(data->cm, TRANSACTION_CONTENTION_FIXED);
+   ASSERT_EQUAL(TRANSACTION_READ_WAIT_DEFAULT, data->cm->read_wait_policy);
+
+   transaction_read_wait_policy waiting[] = {TRANSACTION_READ_WAIT_SPIN,
+                                             TRANSACTION_READ_WAIT_YIELD};
+   for (int i = 0; i < ARRAY_SIZE(waiting); i++) {
+      transaction_contention_set_read_wait(data->cm, waiting[i], spins);
+      for (uint64 attempt = 0; attempt < 4 * spins; attempt++) {
+         ASSERT_TRUE(
+            transaction_contention_wait_locked_read(data->cm, attempt));
+      }
+      transaction_contention_end_locked_read(data->cm);
+   }
+
+   transaction_contention_set_read_wait(
+      data->cm, TRANSACTION_READ_WAIT_ABORT, spins);
+   for (uint64 attempt = 0; attempt < spins; attempt++) {
+      ASSERT_TRUE(transaction_contention_wait_locked_read(data->cm, attempt));
+   }
+   ASSERT_FALSE(transaction_contention_wait_locked_read(data->cm, spins));
+
+   // Without spins, ABORT gives up on the first attempt
+   transaction_contention_set_read_wait(
+      data->cm, TRANSACTION_READ_WAIT_ABORT, 0);
+   ASSERT_FALSE(transaction_contention_wait_locked_read(data->cm, 0));
+
+   // Each read counts as one wait, however many attempts it took
+   transaction_contention_stats stats;
+   transaction_contention_get_stats(data->cm, platform_get_tid(), &stats);
+   ASSERT_EQUAL(4, stats.read_waits);
+   ASSERT_TRUE(0 < stats.read_wait_ns);
+   ASSERT_EQUAL(0, stats.lock_waits);
+
+   transaction_contention_reset_stats(data->cm);
+   transaction_contention_get_stats(data->cm, platform_get_tid(), &stats);
+   ASSERT_EQUAL(0, stats.read_waits);
+   ASSERT_EQUAL(0, stats.read_wait_ns);
+}
+
+/*
+ * Every policy can be found by its name.
+ */
+CTEST2(transaction_contention, test_policy_names)
+{
+   for (transaction_contention_policy p = TRANSACTION_CONTENTION_INVALID + 1;
+        p < TRANSACTION_CONTENTION_MAX_VALID;
+        p++)
+   {
+      const char *name = transaction_contention_policy_name(p);
+      ASSERT_EQUAL(p, transaction_contention_policy_from_name(name));
+   }
+   ASSERT_EQUAL(TRANSACTION_CONTENTION_INVALID,
+                transaction_contention_policy_from_name("no-such-policy"));
+}
+
+/*
+ * Every read wait policy can be found by its name.
+ */
+CTEST2(transaction_contention, test_read_wait_policy_names)
+{
+   for (transaction_read_wait_policy p = TRANSACTION_READ_WAIT_INVALID + 1;
+        p < TRANSACTION_READ_WAIT_MAX_VALID;
+        p++)
+   {
+      const char *name = transaction_read_wait_policy_name(p);
+      ASSERT_EQUAL(p, transaction_read_wait_policy_from_name(name));
+   }
+   ASSERT_EQUAL(TRANSACTION_READ_WAIT_INVALID,
+                transaction_read_wait_policy_from_name("no-such-policy"));
+}
+
+/*
+ * A database waits read_wait_spins attempts on locked reads as configured,
+ * TRANSACTION_READ_WAIT_SPINS if it is left zeroed, or none at all with
+ * read_wait_no_spin.
+ */
+CTEST2(transaction_contention, test_read_wait_spins_config)
+{
+   // The database registers this thread itself
+   platform_set_tid(data->saved_tid);
+
+   data_config       data_cfg;
+   splinterdb_config cfg;
+   transaction_test_init_config(&data_cfg, &cfg);
+
+   uint64 spins[]    = {0, 8, 8};
+   bool   no_spin[]  = {FALSE, FALSE, TRUE};
+   uint64 expected[] = {TRANSACTION_READ_WAIT_SPINS, 8, 0};
+   for (int i = 0; i < ARRAY_SIZE(spins); i++) {
+      transactional_splinterdb_config txn_cfg;
+      transactional_splinterdb_config_init(
+         &txn_cfg, &cfg, TRANSACTION_PROTOCOL_TICTOC_MEMORY);
+      ASSERT_EQUAL(TRANSACTION_READ_WAIT_SPINS, txn_cfg.read_wait_spins);
+      txn_cfg.read_wait_policy  = TRANSACTION_READ_WAIT_ABORT;
+      txn_cfg.read_wait_spins   = spins[i];
+      txn_cfg.read_wait_no_spin = no_spin[i];
+
+      transactional_splinterdb *txn_kvsb;
+      ASSERT_EQUAL(
+         0, transactional_splinterdb_create_with_config(&txn_cfg, &txn_kvsb));
+      transaction_contention *cm = &txn_kvsb->contention;
+      ASSERT_EQUAL(expected[i], cm->read_wait_spins);
+      for (uint64 attempt = 0; attempt < expected[i]; attempt++) {
+         ASSERT_TRUE(transaction_contention_wait_locked_read(cm, attempt));
+      }
+      ASSERT_FALSE(transaction_contention_wait_locked_read(cm, expected[i]));
+      transactional_splinterdb_close(&txn_kvsb);
+   }
+}
@@ -0,0 +1,212 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_deadlock_test.c
+ *
+ *  Exercises 2PL with deadlock detection: transactions wait for the locks
+ *  they need, and only one transaction of a cycle of waits aborts, the one
+ *  that accessed the fewest keys.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_deadlock)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_deadlock)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_2PL_DETECT);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_deadlock)
+{
+   transaction_test_close_db(&data->txn_kvsb);
+}
+
+/*
+ * A transaction that needs a lock held by another transaction of its own
+ * thread would wait forever, so it aborts at once.
+ */
+CTEST2(transaction_deadlock, test_wait_for_own_thread)
+{
+   transaction holder, waiter;
+   transactional_splinterdb_begin(data->txn_kvsb, &holder);
+   ASSERT_EQUAL(0, write_key(data->txn_kvsb, &holder, "key", "value"));
+   transactional_splinterdb_begin(data->txn_kvsb, &waiter);
+   ASSERT_NOT_EQUAL(0, write_key(data->txn_kvsb, &waiter, "key", "value"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(data->txn_kvsb, &holder));
+
+   transaction_abort_stats stats;
+   transactional_splinterdb_thread_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(1, stats.aborts[TRANSACTION_ABORT_DEADLOCK]);
+   ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_LOCK_BUSY]);
+}
+
+/*
+ * A lookup that fails with an error, rather than a conflict, aborts its
+ * transaction all the same, and the locks it held are released.
+ */
+CTEST2(transaction_deadlock, test_lookup_error_releases_locks)
+{
+   char too_large_key[TEST_MAX_KEY_SIZE + 1];
+   memset(too_large_key, 'k', sizeof(too_large_key));
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(
+      data->txn_kvsb, &result, 0, NULL);
+
+   transaction failed;
+   transactional_splinterdb_begin(data->txn_kvsb, &failed);
+   ASSERT_EQUAL(0, write_key(data->txn_kvsb, &failed, "key", "value"));
+   int rc = transactional_splinterdb_lookup(
+      data->txn_kvsb,
+      &failed,
+      slice_create(sizeof(too_large_key), too_large_key),
+      &result);
+   ASSERT_EQUAL(EINVAL, rc);
+   splinterdb_lookup_result_deinit(&result);
+
+   // Would wait for itself, and so abort, if the lock were still held
+   transaction txn;
+   transactional_splinterdb_begin(data->txn_kvsb, &txn);
+   ASSERT_EQUAL(0, write_key(data->txn_kvsb, &txn, "key", "value"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(data->txn_kvsb, &txn));
+}
+
+typedef struct locker_args {
+   transactional_splinterdb *txn_kvsb;
+   // Keys it locks before the one the other thread locks
+   const char **keys;
+   int          num_keys;
+   const char  *other_key;
+   int         *ready;
+   int          rc;
+} locker_args;
+
+static void *
+locker(void *arg)
+{
+   locker_args *args = (locker_args *)arg;
+   transactional_splinterdb_register_thread(args->txn_kvsb);
+
+   transaction txn;
+   transactional_splinterdb_begin(args->txn_kvsb, &txn);
+   for (int i = 0; i < args->num_keys; i++) {
+      args->rc = write_key(args->txn_kvsb, &txn, args->keys[i], "value");
+      if (args->rc != 0) {
+         break;
+      }
+   }
+
+   // Both threads hold their keys before either asks for the other's
+   __atomic_fetch_add(args->ready, 1, __ATOMIC_SEQ_CST);
+   while (__atomic_load_n(args->ready, __ATOMIC_SEQ_CST) < 2) {
+      platform_yield();
+   }
+
+   if (args->rc == 0) {
+      args->rc = write_key(args->txn_kvsb, &txn, args->other_key, "value");
+   }
+   if (args->rc == 0) {
+      args->rc = transactional_splinterdb_commit(args->txn_kvsb, &txn);
+   }
+   transactional_splinterdb_deregister_thread(args->txn_kvsb);
+   return NULL;
+}
+
+/*
+ * Two transactions that wait for each other's key: the one that accessed
+ * fewer keys aborts, and the other one gets the lock and commits.
+ */
+CTEST2(transaction_deadlock, test_cycle_aborts_cheapest)
+{
+   const char *big_keys[]   = {"a", "b", "c"};
+   const char *small_keys[] = {"x"};
+   int         ready        = 0;
+
+   locker_args args[2] = {
+      {.txn_kvsb  = data->txn_kvsb,
+       .keys      = big_keys,
+       .num_keys  = ARRAY_SIZE(big_keys),
+       .other_key = "x",
+       .ready     = &ready},
+      {.txn_kvsb  = data->txn_kvsb,
+       .keys      = small_keys,
+       .num_keys  = ARRAY_SIZE(small_keys),
+       .other_key = "a",
+       .ready     = &ready},
+   };
+   pthread_t threads[2];
+   for (int i = 0; i < 2; i++) {
+      int rc = pthread_create(&threads[i], NULL, locker, &args[i]);
+      ASSERT_EQUAL(0, rc);
+   }
+   for (int i = 0; i < 2; i++) {
+      pthread_join(threads[i], NULL);
+   }
+
+   ASSERT_EQUAL(0, args[0].rc);
+   ASSERT_NOT_EQUAL(0, args[1].rc);
+
+   transaction_abort_stats stats;
+   transactional_splinterdb_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(1, stats.aborts[TRANSACTION_ABORT_DEADLOCK]);
+   ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_LOCK_BUSY]);
+   ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_WOUNDED]);
+}
+
+/*
+ * A transaction that waits without a cycle gets its lock once the owner
+ * commits, rather than aborting.
+ */
+CTEST2(transaction_deadlock, test_waits_without_cycle)
+{
+   const char *keys[] = {"a"};
+   int         ready  = 1;
+
+   transaction holder;
+   transactional_splinterdb_begin(data->txn_kvsb, &holder);
+   ASSERT_EQUAL(0, write_key(data->txn_kvsb, &holder, "key", "value"));
+
+   locker_args args = {.txn_kvsb  = data->txn_kvsb,
+                       .keys      = keys,
+                       .num_keys  = ARRAY_SIZE(keys),
+                       .other_key = "key",
+                       .ready     = &ready};
+   pthread_t   thread;
+   int         rc = pthread_create(&thread, NULL, locker, &args);
+   ASSERT_EQUAL(0, rc);
+
+   // Let the locker wait for a while, long enough to look for cycles
+   platform_sleep_ns(20 * MILLION);
+   ASSERT_EQUAL(0, write_key(data->txn_kvsb, &holder, "b", "value"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(data->txn_kvsb, &holder));
+   pthread_join(thread, NULL);
+   ASSERT_EQUAL(0, args.rc);
+
+   transaction_abort_stats stats;
+   transactional_splinterdb_abort_stats(data->txn_kvsb, &stats);
+   ASSERT_EQUAL(0, stats.aborts[TRANSACTION_ABORT_DEADLOCK]);
+}
@@ -0,0 +1,257 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_durability_test.c
+ *
+ *  Exercises group commit: commits can wait for their writes to reach the
+ *  log on disk, or hand out tickets that are polled, and concurrent commits
+ *  share the log writes.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+#define TEST_NUM_THREADS        4
+#define TEST_COMMITS_PER_THREAD 200
+#define TEST_ASYNC_COMMITS      10
+
+// Threads that commit at the same time, in a few rounds
+#define TEST_NUM_BURST_THREADS 8
+#define TEST_NUM_BURST_ROUNDS  3
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_durability)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_durability)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   data->cfg.use_log = TRUE;
+   data->txn_kvsb    = NULL;
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_durability)
+{
+   transaction_test_close_db(&data->txn_kvsb);
+}
+
+static int
+create_db(transactional_splinterdb **txn_kvsb,
+          const splinterdb_config   *cfg,
+          bool                       sync_commits)
+{
+   transactional_splinterdb_config txn_cfg;
+   // Transactions only write keys of their own, so no protocol aborts them
+   transaction_test_init_txn_config(
+      &txn_cfg, cfg, TRANSACTION_PROTOCOL_2PL_NO_WAIT);
+   txn_cfg.sync_commits = sync_commits;
+   return transactional_splinterdb_create_with_config(&txn_cfg, txn_kvsb);
+}
+
+// Inserts the key numbered i in its own transaction
+static int
+insert_key(transactional_splinterdb *txn_kvsb, int i, uint64 *ticket)
+{
+   char  key[TEST_MAX_KEY_SIZE];
+   slice key_slice =
+      slice_create(snprintf(key, sizeof(key), "key-%06d", i), key);
+
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   int rc =
+      transactional_splinterdb_insert(txn_kvsb, &txn, key_slice, key_slice);
+   if (rc != 0) {
+      return rc;
+   }
+   if (ticket) {
+      return transactional_splinterdb_commit_async(txn_kvsb, &txn, ticket);
+   }
+   return transactional_splinterdb_commit(txn_kvsb, &txn);
+}
+
+/*
+ * Waiting for commits to be durable needs the log.
+ */
+CTEST2(transaction_durability, test_sync_commits_need_log)
+{
+   data->cfg.use_log = FALSE;
+   int rc            = create_db(&data->txn_kvsb, &data->cfg, TRUE);
+   ASSERT_EQUAL(EINVAL, rc);
+   data->txn_kvsb = NULL;
+}
+
+/*
+ * Once a synchronous commit returns, its writes are on disk.
+ */
+CTEST2(transaction_durability, test_sync_commits)
+{
+   int rc = create_db(&data->txn_kvsb, &data->cfg, TRUE);
+   ASSERT_EQUAL(0, rc);
+
+   for (int i = 0; i < TEST_ASYNC_COMMITS; i++) {
+      rc = insert_key(data->txn_kvsb, i, NULL);
+      ASSERT_EQUAL(0, rc);
+
+      const splinterdb *kvsb = transactional_splinterdb_get_db(data->txn_kvsb);
+      ASSERT_TRUE(transactional_splinterdb_is_durable(
+         data->txn_kvsb, splinterdb_log_lsn(kvsb)));
+   }
+}
+
+/*
+ * Tickets of asynchronous commits become durable once a sync is due under
+ * the group commit settings, or once someone waits for them.
+ */
+CTEST2(transaction_durability, test_async_commit_tickets)
+{
+   // Long enough that the polls below do not sync, waits do after it
+   data->cfg.log_sync_delay_ns = 200 * MILLION;
+   data->cfg.log_sync_batch    = 2 * TEST_ASYNC_COMMITS;
+   int rc                      = create_db(&data->txn_kvsb, &data->cfg, FALSE);
+   ASSERT_EQUAL(0, rc);
+
+   uint64 tickets[TEST_ASYNC_COMMITS];
+   for (int i = 0; i < TEST_ASYNC_COMMITS; i++) {
+      rc = insert_key(data->txn_kvsb, i, &tickets[i]);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_FALSE(
+         transactional_splinterdb_is_durable(data->txn_kvsb, tickets[i]));
+      if (i > 0) {
+         ASSERT_TRUE(tickets[i - 1] < tickets[i]);
+      }
+   }
+
+   // Waiting for one ticket makes the earlier ones durable too
+   uint64 last_ticket = tickets[TEST_ASYNC_COMMITS - 1];
+   rc = transactional_splinterdb_wait_durable(data->txn_kvsb, last_ticket);
+   ASSERT_EQUAL(0, rc);
+   for (int i = 0; i < TEST_ASYNC_COMMITS; i++) {
+      ASSERT_TRUE(
+         transactional_splinterdb_is_durable(data->txn_kvsb, tickets[i]));
+   }
+
+   // Once enough commits are waiting, polling syncs them
+   data->cfg.log_sync_batch = 1;
+   transactional_splinterdb_close(&data->txn_kvsb);
+   rc = create_db(&data->txn_kvsb, &data->cfg, FALSE);
+   ASSERT_EQUAL(0, rc);
+   rc = insert_key(data->txn_kvsb, 0, &tickets[0]);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_TRUE(transactional_splinterdb_is_durable(data->txn_kvsb, tickets[0]));
+}
+
+typedef struct committer_args {
+   transactional_splinterdb *txn_kvsb;
+   int                       thread_num;
+   int                       num_commits;
+   pthread_barrier_t        *start; // Waited on before committing, if set
+   int                       rc;
+} committer_args;
+
+static void *
+committer(void *arg)
+{
+   committer_args *args = (committer_args *)arg;
+   transactional_splinterdb_register_thread(args->txn_kvsb);
+   if (args->start) {
+      pthread_barrier_wait(args->start);
+   }
+   for (int i = 0; i < args->num_commits && args->rc == 0; i++) {
+      int key_num = args->thread_num * args->num_commits + i;
+      args->rc    = insert_key(args->txn_kvsb, key_num, NULL);
+   }
+   transactional_splinterdb_deregister_thread(args->txn_kvsb);
+   return NULL;
+}
+
+/*
+ * Concurrent synchronous commits that wait for each other to share a sync.
+ */
+CTEST2(transaction_durability, test_group_commit)
+{
+   data->cfg.log_sync_delay_ns = 50 * THOUSAND;
+   data->cfg.log_sync_batch    = TEST_NUM_THREADS;
+   int rc                      = create_db(&data->txn_kvsb, &data->cfg, TRUE);
+   ASSERT_EQUAL(0, rc);
+
+   pthread_t      threads[TEST_NUM_THREADS];
+   committer_args args[TEST_NUM_THREADS];
+   for (int i = 0; i < TEST_NUM_THREADS; i++) {
+      args[i] = (committer_args){.txn_kvsb    = data->txn_kvsb,
+                                 .thread_num  = i,
+                                 .num_commits = TEST_COMMITS_PER_THREAD};
+      rc      = pthread_create(&threads[i], NULL, committer, &args[i]);
+      ASSERT_EQUAL(0, rc);
+   }
+   for (int i = 0; i < TEST_NUM_THREADS; i++) {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUAL(0, args[i].rc);
+   }
+
+   const splinterdb *kvsb = transactional_splinterdb_get_db(data->txn_kvsb);
+   ASSERT_TRUE(transactional_splinterdb_is_durable(data->txn_kvsb,
+                                                   splinterdb_log_lsn(kvsb)));
+}
+
+/*
+ * Synchronous commits made at the same time wait out the delay of the first
+ * one and share its sync, rather than each syncing on its own. The commits
+ * of later rounds, made right after a sync, wait out a delay of their own.
+ */
+CTEST2(transaction_durability, test_group_commit_batches_syncs)
+{
+   // Long enough for every thread to commit before the first sync is due
+   data->cfg.log_sync_delay_ns = 100 * MILLION;
+   data->cfg.log_sync_batch    = 2 * TEST_NUM_BURST_THREADS;
+   int rc                      = create_db(&data->txn_kvsb, &data->cfg, TRUE);
+   ASSERT_EQUAL(0, rc);
+
+   const splinterdb *kvsb      = transactional_splinterdb_get_db(data->txn_kvsb);
+   uint64            num_syncs = splinterdb_log_num_syncs(kvsb);
+
+   pthread_barrier_t start;
+   pthread_barrier_init(&start, NULL, TEST_NUM_BURST_THREADS);
+   pthread_t      threads[TEST_NUM_BURST_THREADS];
+   committer_args args[TEST_NUM_BURST_THREADS];
+   for (int i = 0; i < TEST_NUM_BURST_THREADS; i++) {
+      args[i] = (committer_args){.txn_kvsb    = data->txn_kvsb,
+                                 .thread_num  = i,
+                                 .num_commits = TEST_NUM_BURST_ROUNDS,
+                                 .start       = &start};
+      rc      = pthread_create(&threads[i], NULL, committer, &args[i]);
+      ASSERT_EQUAL(0, rc);
+   }
+   for (int i = 0; i < TEST_NUM_BURST_THREADS; i++) {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUAL(0, args[i].rc);
+   }
+   pthread_barrier_destroy(&start);
+
+   ASSERT_TRUE(transactional_splinterdb_is_durable(data->txn_kvsb,
+                                                   splinterdb_log_lsn(kvsb)));
+   num_syncs = splinterdb_log_num_syncs(kvsb) - num_syncs;
+   ASSERT_TRUE(0 < num_syncs);
+   ASSERT_TRUE(num_syncs < TEST_NUM_BURST_THREADS,
+               "%lu syncs for %d commits\n",
+               num_syncs,
+               TEST_NUM_BURST_THREADS * TEST_NUM_BURST_ROUNDS);
+}
@@ -0,0 +1,159 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_histogram_test.c
+ *
+ *  Exercises the phase histograms of transactions: durations land in buckets
+ *  that hold them, percentiles come out within a bucket of the truth, and
+ *  transactions are timed only while the statistics are enabled.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_histogram.h"
+#include "transaction_test_common.h"
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_histogram)
+{
+   transaction_histogram *hist;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_histogram)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   data->hist = TYPED_ZALLOC(0, data->hist);
+   platform_assert(data->hist != NULL);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_histogram)
+{
+   platform_free(0, data->hist);
+}
+
+/*
+ * Every duration goes into a bucket that holds it, no wider than
+ * 1/2^TRANSACTION_HISTOGRAM_SUB_BITS of it, and buckets grow with durations.
+ */
+CTEST2(transaction_histogram, test_buckets)
+{
+   uint64 last = 0;
+   for (uint64 ns = 0; ns < (1ULL << TRANSACTION_HISTOGRAM_MAX_BITS);
+        ns     = ns < 4096 ? ns + 1 : ns + ns / 7)
+   {
+      uint64 bucket = transaction_histogram_bucket(ns);
+      ASSERT_TRUE(bucket < TRANSACTION_HISTOGRAM_BUCKETS);
+      ASSERT_TRUE(last <= bucket);
+      uint64 min = transaction_histogram_bucket_min(bucket);
+      uint64 end = transaction_histogram_bucket_min(bucket + 1);
+      ASSERT_TRUE(
+         min <= ns && ns < end, "%lu not in [%lu, %lu)\n", ns, min, end);
+      ASSERT_TRUE((end - min) << TRANSACTION_HISTOGRAM_SUB_BITS <= MAX(ns, 8));
+      last = bucket;
+   }
+   ASSERT_EQUAL(TRANSACTION_HISTOGRAM_BUCKETS - 1,
+                transaction_histogram_bucket(UINT64_MAX));
+}
+
+/*
+ * Percentiles of 1..1000 ns are within a bucket of the truth.
+ */
+CTEST2(transaction_histogram, test_percentiles)
+{
+   ASSERT_EQUAL(0, transaction_histogram_percentile(data->hist, 50));
+
+   for (uint64 ns = 1; ns <= 1000; ns++) {
+      transaction_histogram_record(data->hist, ns);
+   }
+   ASSERT_EQUAL(1000, data->hist->count);
+   ASSERT_EQUAL(500500, data->hist->sum_ns);
+   ASSERT_EQUAL(1000, data->hist->max_ns);
+
+   double percentiles[] = {1, 50, 90, 99, 99.9};
+   for (int i = 0; i < ARRAY_SIZE(percentiles); i++) {
+      uint64 truth = (uint64)(percentiles[i] * 10);
+      uint64 p =
+         transaction_histogram_percentile(data->hist, percentiles[i]);
+      ASSERT_TRUE(truth <= p && p - truth <= truth >> 2,
+                  "p%.1f is %lu\n",
+                  percentiles[i],
+                  p);
+   }
+   ASSERT_EQUAL(1000, transaction_histogram_percentile(data->hist, 100));
+}
+
+/*
+ * Merging adds up the buckets, and keeps the largest max.
+ */
+CTEST2(transaction_histogram, test_merge)
+{
+   transaction_histogram other;
+   ZERO_STRUCT(other);
+   transaction_histogram_record(data->hist, 10);
+   transaction_histogram_record(&other, 10);
+   transaction_histogram_record(&other, 5000);
+
+   transaction_histogram_merge(data->hist, &other);
+   ASSERT_EQUAL(3, data->hist->count);
+   ASSERT_EQUAL(5020, data->hist->sum_ns);
+   ASSERT_EQUAL(5000, data->hist->max_ns);
+   ASSERT_EQUAL(2, data->hist->buckets[transaction_histogram_bucket(10)]);
+}
+
+/*
+ * Transactions are timed while the statistics are enabled, and not before.
+ */
+CTEST2(transaction_histogram, test_phases)
+{
+   data_config       data_cfg;
+   splinterdb_config cfg;
+   transaction_test_init_config(&data_cfg, &cfg);
+   transactional_splinterdb *txn_kvsb;
+   transaction_test_create_db(&txn_kvsb, &cfg, TRANSACTION_PROTOCOL_MVCC);
+
+   slice       key = slice_create(3, "key");
+   transaction txn;
+   for (int enabled = 0; enabled < 2; enabled++) {
+      transactional_splinterdb_enable_phase_stats(txn_kvsb, enabled);
+
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_insert(txn_kvsb, &txn, key, key));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, transactional_splinterdb_abort(txn_kvsb, &txn));
+   }
+
+   for (transaction_phase phase = 0; phase < TRANSACTION_PHASE_MAX_VALID;
+        phase++)
+   {
+      transaction_histogram hist;
+      transactional_splinterdb_phase_histogram(txn_kvsb, phase, &hist);
+      ASSERT_EQUAL(1,
+                   hist.count,
+                   "%s has %lu\n",
+                   transaction_phase_name(phase),
+                   hist.count);
+   }
+   transactional_splinterdb_print_phase_stats(txn_kvsb);
+
+   transactional_splinterdb_reset_phase_stats(txn_kvsb);
+   transaction_histogram hist;
+   transactional_splinterdb_phase_histogram(
+      txn_kvsb, TRANSACTION_PHASE_EXECUTION, &hist);
+   ASSERT_EQUAL(0, hist.count);
+
+   transactional_splinterdb_close(&txn_kvsb);
+}
@@ -0,0 +1,222 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_hotness_test.c
+ *
+ *  Exercises adaptive locking in the optimistic protocols: the conflicts of
+ *  each key are counted and decay over time, and once a key is hot, its
+ *  reads lock it, so that writers wait for them instead of making them
+ *  abort.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+#include "transaction_internal.h"
+
+// The protocols that lock hot keys
+static const transaction_protocol hot_lock_protocols[] = {
+   TRANSACTION_PROTOCOL_TICTOC_MEMORY,
+   TRANSACTION_PROTOCOL_TICTOC_COUNTER,
+   TRANSACTION_PROTOCOL_TICTOC_SKETCH,
+   TRANSACTION_PROTOCOL_SILO_MEMORY,
+};
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_hotness)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+   transaction_hotness       hotness;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_hotness)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   data->txn_kvsb = NULL;
+   ZERO_CONTENTS(&data->hotness);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_hotness)
+{
+   transaction_test_close_db(&data->txn_kvsb);
+   transaction_hotness_deinit(&data->hotness);
+}
+
+static void
+create_db(transactional_splinterdb **txn_kvsb,
+          const splinterdb_config   *cfg,
+          transaction_protocol       protocol,
+          uint64                     hot_lock_threshold)
+{
+   transactional_splinterdb_config txn_cfg;
+   transaction_test_init_txn_config(&txn_cfg, cfg, protocol);
+   txn_cfg.hot_lock_threshold = hot_lock_threshold;
+   int rc = transactional_splinterdb_create_with_config(&txn_cfg, txn_kvsb);
+   ASSERT_EQUAL(0, rc);
+}
+
+// Returns what transactional_splinterdb_lookup() does
+static int
+read_key(transactional_splinterdb *txn_kvsb,
+         transaction              *txn,
+         const char               *key)
+{
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb, txn, str_slice(key), &result);
+   splinterdb_lookup_result_deinit(&result);
+   return rc;
+}
+
+/*
+ * A key is hot once it has as many conflicts as the threshold, and its count
+ * halves every epoch. Other keys are not counted.
+ */
+CTEST2(transaction_hotness, test_conflicts_decay)
+{
+   transaction_hotness *h = &data->hotness;
+   transaction_hotness_init(h, 3);
+   ASSERT_TRUE(transaction_hotness_enabled(h));
+
+   slice hot  = str_slice("hot");
+   slice cold = str_slice("cold");
+   transaction_hotness_note_conflict(h, hot);
+   transaction_hotness_note_conflict(h, hot);
+   ASSERT_FALSE(transaction_hotness_is_hot(h, hot));
+   transaction_hotness_note_conflict(h, hot);
+   ASSERT_TRUE(transaction_hotness_is_hot(h, hot));
+   ASSERT_FALSE(transaction_hotness_is_hot(h, cold));
+   ASSERT_EQUAL(0, transaction_hotness_conflicts(h, cold));
+
+   // Two epochs later, 8 conflicts are down to 2 at most
+   h->epoch_ns = 1000 * 1000;
+   for (int i = 0; i < 8; i++) {
+      transaction_hotness_note_conflict(h, cold);
+   }
+   ASSERT_TRUE(transaction_hotness_is_hot(h, cold));
+   platform_sleep_ns(3 * h->epoch_ns);
+   ASSERT_TRUE(transaction_hotness_conflicts(h, cold) <= 2);
+   ASSERT_FALSE(transaction_hotness_is_hot(h, cold));
+}
+
+/*
+ * A threshold of 0 counts nothing.
+ */
+CTEST2(transaction_hotness, test_disabled)
+{
+   transaction_hotness *h = &data->hotness;
+   transaction_hotness_init(h, 0);
+   ASSERT_FALSE(transaction_hotness_enabled(h));
+
+   transaction_hotness_note_conflict(h, str_slice("hot"));
+   ASSERT_EQUAL(0, transaction_hotness_conflicts(h, str_slice("hot")));
+   ASSERT_FALSE(transaction_hotness_is_hot(h, str_slice("hot")));
+}
+
+/*
+ * A read that fails validation makes its key hot: the reader wrote the key
+ * over a read another writer made stale. The next reader of the key locks
+ * it: a writer gives up on its commit rather than wait for the reader
+ * forever, and the reader commits its own write of the key.
+ */
+CTEST2(transaction_hotness, test_hot_key_is_locked)
+{
+   for (int i = 0; i < ARRAY_SIZE(hot_lock_protocols); i++) {
+      transaction_protocol p = hot_lock_protocols[i];
+      create_db(&data->txn_kvsb, &data->cfg, p, 1);
+      transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+      slice                     key      = str_slice("key");
+
+      transaction txn;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &txn, "key", "0"));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+      ASSERT_FALSE(transaction_hotness_is_hot(&txn_kvsb->hotness, key));
+
+      transaction reader, writer;
+      transactional_splinterdb_begin(txn_kvsb, &reader);
+      ASSERT_EQUAL(0, read_key(txn_kvsb, &reader, "key"));
+      transactional_splinterdb_begin(txn_kvsb, &writer);
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "key", "1"));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &writer));
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &reader, "key", "2"));
+      ASSERT_NOT_EQUAL(0,
+                       transactional_splinterdb_commit(txn_kvsb, &reader),
+                       "%s\n",
+                       transaction_protocol_name(p));
+      ASSERT_TRUE(transaction_hotness_is_hot(&txn_kvsb->hotness, key),
+                  "%s\n",
+                  transaction_protocol_name(p));
+
+      transactional_splinterdb_begin(txn_kvsb, &reader);
+      ASSERT_EQUAL(0, read_key(txn_kvsb, &reader, "key"));
+      transactional_splinterdb_begin(txn_kvsb, &writer);
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "key", "2"));
+      ASSERT_NOT_EQUAL(0,
+                       transactional_splinterdb_commit(txn_kvsb, &writer),
+                       "%s\n",
+                       transaction_protocol_name(p));
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &reader, "key", "3"));
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_commit(txn_kvsb, &reader),
+                   "%s\n",
+                   transaction_protocol_name(p));
+
+      // The reader let go of the key
+      transactional_splinterdb_begin(txn_kvsb, &writer);
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "key", "4"));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &writer));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * Without a threshold, reads stay optimistic: the writer commits, and the
+ * reader, which wrote the key over what it read, aborts, time after time.
+ */
+CTEST2(transaction_hotness, test_optimistic_by_default)
+{
+   for (int i = 0; i < ARRAY_SIZE(hot_lock_protocols); i++) {
+      transaction_protocol p = hot_lock_protocols[i];
+      create_db(&data->txn_kvsb, &data->cfg, p, 0);
+      transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+      transaction txn;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, write_key(txn_kvsb, &txn, "key", "0"));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      for (int round = 0; round < 2; round++) {
+         transaction reader, writer;
+         transactional_splinterdb_begin(txn_kvsb, &reader);
+         ASSERT_EQUAL(0, read_key(txn_kvsb, &reader, "key"));
+         transactional_splinterdb_begin(txn_kvsb, &writer);
+         ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "key", "1"));
+         ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &writer));
+         ASSERT_EQUAL(0, write_key(txn_kvsb, &reader, "key", "2"));
+         ASSERT_NOT_EQUAL(0,
+                          transactional_splinterdb_commit(txn_kvsb, &reader),
+                          "%s\n",
+                          transaction_protocol_name(p));
+      }
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
@@ -0,0 +1,411 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_mvcc_test.c
+ *
+ *  Exercises snapshot isolation: transactions read the snapshot they began
+ *  at, only write-write conflicts abort, and old versions go away once no
+ *  snapshot needs them.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+// Enough commits for the gc horizon to move, while the versions of a key
+// still fit in a message
+#define TEST_NUM_OVERWRITES 80
+
+// Far more versions of a key than fit in a message
+#define TEST_NUM_TRUNCATING_OVERWRITES 1000
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_mvcc)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_mvcc)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_mvcc)
+{
+   transactional_splinterdb_close(&data->txn_kvsb);
+}
+
+static int
+commit_value(transactional_splinterdb *txn_kvsb,
+             const char               *key,
+             const char               *value)
+{
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   int rc = write_key(txn_kvsb, &txn, key, value);
+   if (rc != 0) {
+      return rc;
+   }
+   return transactional_splinterdb_commit(txn_kvsb, &txn);
+}
+
+// Returns whether txn sees key, and checks that it sees it with value
+static bool
+read_value(transactional_splinterdb *txn_kvsb,
+           transaction              *txn,
+           const char               *key,
+           const char               *value)
+{
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb, txn, str_slice(key), &result);
+   ASSERT_EQUAL(0, rc);
+
+   bool found = splinterdb_lookup_found(&result);
+   if (found && value) {
+      slice found_value;
+      ASSERT_EQUAL(0, splinterdb_lookup_result_value(&result, &found_value));
+      ASSERT_EQUAL(0, slice_lex_cmp(str_slice(value), found_value));
+   }
+   splinterdb_lookup_result_deinit(&result);
+   return found;
+}
+
+/*
+ * A transaction keeps reading what was committed when it began, through
+ * lookups and iterators, and still commits.
+ */
+CTEST2(transaction_mvcc, test_snapshot_reads)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "old"));
+
+   transaction reader;
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+
+   transaction writer;
+   transactional_splinterdb_begin(txn_kvsb, &writer);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "a", "new"));
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &writer, "b", "new"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &writer));
+
+   ASSERT_TRUE(read_value(txn_kvsb, &reader, "a", "old"));
+   ASSERT_FALSE(read_value(txn_kvsb, &reader, "b", NULL));
+
+   transactional_splinterdb_iterator *it;
+   ASSERT_EQUAL(0,
+                transactional_splinterdb_iterator_init(
+                   txn_kvsb, &reader, &it, NULL_SLICE));
+   int num_keys = 0;
+   for (; transactional_splinterdb_iterator_valid(it);
+        transactional_splinterdb_iterator_next(it))
+   {
+      slice key, value;
+      transactional_splinterdb_iterator_get_current(it, &key, &value);
+      ASSERT_EQUAL(0, slice_lex_cmp(str_slice("a"), key));
+      ASSERT_EQUAL(0, slice_lex_cmp(str_slice("old"), value));
+      num_keys++;
+   }
+   ASSERT_EQUAL(0, transactional_splinterdb_iterator_status(it));
+   transactional_splinterdb_iterator_deinit(it);
+   ASSERT_EQUAL(1, num_keys);
+
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_TRUE(read_value(txn_kvsb, &txn, "a", "new"));
+   ASSERT_TRUE(read_value(txn_kvsb, &txn, "b", "new"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+}
+
+/*
+ * A transaction sees its own writes on top of its snapshot.
+ */
+CTEST2(transaction_mvcc, test_read_own_writes)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "old"));
+
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &txn, "a", "new"));
+   ASSERT_TRUE(read_value(txn_kvsb, &txn, "a", "new"));
+   ASSERT_EQUAL(0,
+                transactional_splinterdb_delete(
+                   txn_kvsb, &txn, str_slice("a")));
+   ASSERT_FALSE(read_value(txn_kvsb, &txn, "a", NULL));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_FALSE(read_value(txn_kvsb, &txn, "a", NULL));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+}
+
+/*
+ * Of two transactions writing the same key, the one that commits second
+ * aborts. Transactions that only read what the other writes do not.
+ */
+CTEST2(transaction_mvcc, test_write_conflicts)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "0"));
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "b", "0"));
+
+   transaction t1, t2;
+   transactional_splinterdb_begin(txn_kvsb, &t1);
+   transactional_splinterdb_begin(txn_kvsb, &t2);
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &t1, "a", "1"));
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &t2, "a", "2"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &t1));
+   ASSERT_NOT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &t2));
+
+   // Write skew is allowed under snapshot isolation
+   transactional_splinterdb_begin(txn_kvsb, &t1);
+   transactional_splinterdb_begin(txn_kvsb, &t2);
+   ASSERT_TRUE(read_value(txn_kvsb, &t1, "a", "1"));
+   ASSERT_TRUE(read_value(txn_kvsb, &t2, "b", "0"));
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &t1, "b", "1"));
+   ASSERT_EQUAL(0, write_key(txn_kvsb, &t2, "a", "2"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &t1));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &t2));
+}
+
+// Returns the size of all the versions of key
+static uint64
+chain_size(transactional_splinterdb *txn_kvsb, const char *key)
+{
+   const splinterdb        *kvsb = transactional_splinterdb_get_db(txn_kvsb);
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(kvsb, &result, 0, NULL);
+   ASSERT_EQUAL(0, splinterdb_lookup(kvsb, str_slice(key), &result));
+   slice chain;
+   ASSERT_EQUAL(0, splinterdb_lookup_result_value(&result, &chain));
+   uint64 size = slice_length(chain);
+   splinterdb_lookup_result_deinit(&result);
+   return size;
+}
+
+/*
+ * Versions stay as long as a snapshot can see them, and are dropped after.
+ */
+CTEST2(transaction_mvcc, test_gc)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "old"));
+
+   transaction reader;
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+   for (int i = 0; i < TEST_NUM_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   }
+   ASSERT_TRUE(read_value(txn_kvsb, &reader, "a", "old"));
+   uint64 pinned_size = chain_size(txn_kvsb, "a");
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+
+   for (int i = 0; i < TEST_NUM_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   }
+   ASSERT_TRUE(chain_size(txn_kvsb, "a") < pinned_size);
+}
+
+/*
+ * The versions of a key that is no longer written are dropped too, once the
+ * snapshots that see them end and other keys are written.
+ */
+CTEST2(transaction_mvcc, test_gc_cold_keys)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "old"));
+
+   transaction reader;
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+   for (int i = 0; i < TEST_NUM_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   }
+   ASSERT_TRUE(read_value(txn_kvsb, &reader, "a", "old"));
+   uint64 pinned_size = chain_size(txn_kvsb, "a");
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+
+   for (int i = 0; i < 2 * TEST_NUM_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "b", "new"));
+   }
+   ASSERT_TRUE(chain_size(txn_kvsb, "a") < pinned_size);
+}
+
+/*
+ * A lookup that fails in splinterdb aborts its transaction, which gives up
+ * its snapshot: versions go once the other snapshots that see them end.
+ */
+CTEST2(transaction_mvcc, test_lookup_error_ends_snapshot)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "old"));
+
+   transaction failed, reader;
+   transactional_splinterdb_begin(txn_kvsb, &failed);
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+
+   char too_large_key[TEST_MAX_KEY_SIZE + 1];
+   memset(too_large_key, 'k', sizeof(too_large_key));
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb,
+      &failed,
+      slice_create(sizeof(too_large_key), too_large_key),
+      &result);
+   ASSERT_EQUAL(EINVAL, rc);
+   splinterdb_lookup_result_deinit(&result);
+
+   for (int i = 0; i < TEST_NUM_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   }
+   ASSERT_TRUE(read_value(txn_kvsb, &reader, "a", "old"));
+   uint64 pinned_size = chain_size(txn_kvsb, "a");
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+
+   for (int i = 0; i < TEST_NUM_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   }
+   ASSERT_TRUE(chain_size(txn_kvsb, "a") < pinned_size);
+}
+
+/*
+ * Chains that grow too long lose their oldest versions, and the
+ * transactions that needed them abort.
+ */
+CTEST2(transaction_mvcc, test_snapshot_too_old)
+{
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "old"));
+
+   transaction reader, scanner;
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+   transactional_splinterdb_begin(txn_kvsb, &scanner);
+   for (int i = 0; i < TEST_NUM_TRUNCATING_OVERWRITES; i++) {
+      ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   }
+
+   // The lookup fails and aborts the reader
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb, &reader, str_slice("a"), &result);
+   ASSERT_NOT_EQUAL(0, rc);
+   splinterdb_lookup_result_deinit(&result);
+
+   // The scan skips the key, and the scanner fails to commit
+   transactional_splinterdb_iterator *it;
+   ASSERT_EQUAL(0,
+                transactional_splinterdb_iterator_init(
+                   txn_kvsb, &scanner, &it, NULL_SLICE));
+   ASSERT_FALSE(transactional_splinterdb_iterator_valid(it));
+   transactional_splinterdb_iterator_deinit(it);
+   ASSERT_NOT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &scanner));
+
+   // New transactions still see the newest version
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_TRUE(read_value(txn_kvsb, &txn, "a", "new"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+}
+
+/*
+ * Asking for snapshot isolation without a protocol gets mvcc, with any other
+ * protocol fails, and mvcc provides nothing else.
+ */
+CTEST2(transaction_mvcc, test_isolation_level)
+{
+   transactional_splinterdb_close(&data->txn_kvsb);
+
+   transactional_splinterdb_config txn_cfg;
+   transactional_splinterdb_config_init(
+      &txn_cfg, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+   ASSERT_EQUAL(TRANSACTION_ISOLATION_LEVEL_SNAPSHOT, txn_cfg.isol_level);
+   txn_cfg.isol_level = TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE;
+   int rc = transactional_splinterdb_create_with_config(&txn_cfg,
+                                                        &data->txn_kvsb);
+   ASSERT_NOT_EQUAL(0, rc);
+
+   transaction_test_init_txn_config(
+      &txn_cfg, &data->cfg, TRANSACTION_PROTOCOL_TICTOC_MEMORY);
+   txn_cfg.isol_level = TRANSACTION_ISOLATION_LEVEL_SNAPSHOT;
+   rc = transactional_splinterdb_create_with_config(&txn_cfg, &data->txn_kvsb);
+   ASSERT_NOT_EQUAL(0, rc);
+
+   ZERO_CONTENTS(&txn_cfg);
+   txn_cfg.kvsb_cfg   = data->cfg;
+   txn_cfg.isol_level = TRANSACTION_ISOLATION_LEVEL_SNAPSHOT;
+   rc = transactional_splinterdb_create_with_config(&txn_cfg, &data->txn_kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   ASSERT_EQUAL(0, commit_value(data->txn_kvsb, "a", "old"));
+   transaction reader;
+   transactional_splinterdb_begin(data->txn_kvsb, &reader);
+   ASSERT_EQUAL(0, commit_value(data->txn_kvsb, "a", "new"));
+   ASSERT_TRUE(read_value(data->txn_kvsb, &reader, "a", "old"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(data->txn_kvsb, &reader));
+}
+
+/*
+ * A database opened again resumes after the timestamps it used, so its
+ * versions are seen by the snapshots that follow them, and no others. The
+ * key that keeps those timestamps is out of reach of applications.
+ */
+CTEST2(transaction_mvcc, test_reopen)
+{
+   ASSERT_EQUAL(0, commit_value(data->txn_kvsb, "a", "old"));
+   transactional_splinterdb_close(&data->txn_kvsb);
+
+   transactional_splinterdb_config txn_cfg;
+   transaction_test_init_txn_config(
+      &txn_cfg, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+   int rc =
+      transactional_splinterdb_open_with_config(&txn_cfg, &data->txn_kvsb);
+   ASSERT_EQUAL(0, rc);
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+   transaction reader;
+   transactional_splinterdb_begin(txn_kvsb, &reader);
+   transactional_splinterdb_iterator *it;
+   ASSERT_EQUAL(0,
+                transactional_splinterdb_iterator_init(
+                   txn_kvsb, &reader, &it, NULL_SLICE));
+   int num_keys = 0;
+   for (; transactional_splinterdb_iterator_valid(it);
+        transactional_splinterdb_iterator_next(it))
+   {
+      num_keys++;
+   }
+   transactional_splinterdb_iterator_deinit(it);
+   ASSERT_EQUAL(1, num_keys);
+
+   ASSERT_EQUAL(0, commit_value(txn_kvsb, "a", "new"));
+   ASSERT_TRUE(read_value(txn_kvsb, &reader, "a", "old"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &reader));
+
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_TRUE(read_value(txn_kvsb, &txn, "a", "new"));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+   ASSERT_EQUAL(EINVAL, commit_value(txn_kvsb, "", "value"));
+}
@@ -0,0 +1,249 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_run_test.c
+ *
+ *  Exercises transactional_splinterdb_run(): transactions that abort are run
+ *  again until they commit or run out of attempts, and bodies can give up.
+ *  Errors other than aborts are returned at once.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+#define TEST_KEY "counter"
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_run)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_run)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+
+   // First committer wins, so a conflicting commit aborts the commit of the
+   // body
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_run)
+{
+   transactional_splinterdb_close(&data->txn_kvsb);
+}
+
+static int
+write_counter(transactional_splinterdb *txn_kvsb, transaction *txn, uint64 n)
+{
+   char value[32];
+   snprintf(value, sizeof(value), "%lu", n);
+   return write_key(txn_kvsb, txn, TEST_KEY, value);
+}
+
+// Reads the counter into *n, which is 0 if there is none yet
+static int
+read_counter(transactional_splinterdb *txn_kvsb, transaction *txn, uint64 *n)
+{
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb, txn, str_slice(TEST_KEY), &result);
+   *n = 0;
+   if (rc == 0 && splinterdb_lookup_found(&result)) {
+      slice value;
+      rc = splinterdb_lookup_result_value(&result, &value);
+      platform_assert(rc == 0);
+      char buf[32] = {0};
+      memcpy(buf, slice_data(value), MIN(slice_length(value), 31));
+      *n = strtoul(buf, NULL, 10);
+   }
+   splinterdb_lookup_result_deinit(&result);
+   return rc;
+}
+
+static uint64
+committed_counter(transactional_splinterdb *txn_kvsb)
+{
+   transaction txn;
+   uint64      n;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_EQUAL(0, read_counter(txn_kvsb, &txn, &n));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+   return n;
+}
+
+typedef struct increment_args {
+   int    conflicts; // Attempts that are made to abort
+   int    give_up;   // Error to give up with, 0 to commit
+   uint64 runs;
+} increment_args;
+
+/*
+ * Increments the counter. While args->conflicts lasts, another transaction
+ * sets the counter to 100 after it was read, so the commit aborts.
+ */
+static int
+increment(transactional_splinterdb *txn_kvsb, transaction *txn, void *ctx)
+{
+   increment_args *args = (increment_args *)ctx;
+   args->runs++;
+
+   uint64 n;
+   int    rc = read_counter(txn_kvsb, txn, &n);
+   if (rc != 0) {
+      return rc;
+   }
+   rc = write_counter(txn_kvsb, txn, n + 1);
+   if (rc != 0) {
+      return rc;
+   }
+
+   if (args->conflicts > 0) {
+      args->conflicts--;
+      transaction other;
+      transactional_splinterdb_begin(txn_kvsb, &other);
+      ASSERT_EQUAL(0, write_counter(txn_kvsb, &other, 100));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &other));
+   }
+   return args->give_up;
+}
+
+/*
+ * A transaction that commits at once is run once.
+ */
+CTEST2(transaction_run, test_run_once)
+{
+   increment_args                     args = {0};
+   transactional_splinterdb_run_stats stats;
+   int                                rc   = transactional_splinterdb_run(
+      data->txn_kvsb, increment, &args, NULL, &stats);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(1, args.runs);
+   ASSERT_EQUAL(1, stats.attempts);
+   ASSERT_EQUAL(0, stats.wasted_ns);
+   ASSERT_EQUAL(1, committed_counter(data->txn_kvsb));
+}
+
+/*
+ * Aborted attempts are run again, and the one that commits sees what the
+ * others committed in between.
+ */
+CTEST2(transaction_run, test_retries_conflicts)
+{
+   increment_args                     args = {.conflicts = 2};
+   transactional_splinterdb_run_stats stats;
+   int                                rc   = transactional_splinterdb_run(
+      data->txn_kvsb, increment, &args, NULL, &stats);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(3, args.runs);
+   ASSERT_EQUAL(3, stats.attempts);
+   ASSERT_TRUE(0 < stats.wasted_ns);
+   ASSERT_EQUAL(101, committed_counter(data->txn_kvsb));
+
+   transaction_contention_stats contention;
+   transactional_splinterdb_thread_contention_stats(data->txn_kvsb,
+                                                    &contention);
+   ASSERT_TRUE(2 <= contention.aborts);
+}
+
+/*
+ * A transaction that keeps aborting fails once it runs out of attempts.
+ */
+CTEST2(transaction_run, test_max_attempts)
+{
+   increment_args                       args = {.conflicts = 10};
+   transactional_splinterdb_run_options opts = {.max_attempts = 3};
+   transactional_splinterdb_run_stats   stats;
+   int                                  rc   = transactional_splinterdb_run(
+      data->txn_kvsb, increment, &args, &opts, &stats);
+   ASSERT_NOT_EQUAL(0, rc);
+   ASSERT_EQUAL(3, args.runs);
+   ASSERT_EQUAL(3, stats.attempts);
+   ASSERT_EQUAL(100, committed_counter(data->txn_kvsb));
+}
+
+/*
+ * A body that gives up is not run again, and its writes are dropped.
+ */
+CTEST2(transaction_run, test_give_up)
+{
+   increment_args args = {.give_up = EINVAL};
+   int            rc   = transactional_splinterdb_run(
+      data->txn_kvsb, increment, &args, NULL, NULL);
+   ASSERT_EQUAL(EINVAL, rc);
+   ASSERT_EQUAL(1, args.runs);
+   ASSERT_EQUAL(0, committed_counter(data->txn_kvsb));
+}
+
+// Looks up a key longer than splinterdb allows, which fails with EINVAL
+static int
+lookup_too_large_key(transactional_splinterdb *txn_kvsb,
+                     transaction              *txn,
+                     void                     *ctx)
+{
+   uint64 *runs = (uint64 *)ctx;
+   (*runs)++;
+
+   char too_large_key[TEST_MAX_KEY_SIZE + 1];
+   memset(too_large_key, 'k', sizeof(too_large_key));
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb,
+      txn,
+      slice_create(sizeof(too_large_key), too_large_key),
+      &result);
+   splinterdb_lookup_result_deinit(&result);
+   return rc;
+}
+
+/*
+ * An operation that fails with an error rather than an abort is not run
+ * again, and its error is returned.
+ */
+CTEST2(transaction_run, test_error_not_retried)
+{
+   uint64                             runs = 0;
+   transactional_splinterdb_run_stats stats;
+   int                                rc   = transactional_splinterdb_run(
+      data->txn_kvsb, lookup_too_large_key, &runs, NULL, &stats);
+   ASSERT_EQUAL(EINVAL, rc);
+   ASSERT_EQUAL(1, runs);
+   ASSERT_EQUAL(1, stats.attempts);
+}
+
+/*
+ * The declared footprint is prefetched, and keys of it that are missing, or
+ * that the body never looks up, change nothing.
+ */
+CTEST2(transaction_run, test_footprint)
+{
+   slice footprint[] = {str_slice(TEST_KEY), str_slice("missing")};
+   transactional_splinterdb_run_options opts = {
+      .footprint = footprint, .footprint_size = ARRAY_SIZE(footprint)};
+   for (int i = 0; i < 2; i++) {
+      increment_args args = {0};
+      int            rc   = transactional_splinterdb_run(
+         data->txn_kvsb, increment, &args, &opts, NULL);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(1, args.runs);
+   }
+   ASSERT_EQUAL(2, committed_counter(data->txn_kvsb));
+}
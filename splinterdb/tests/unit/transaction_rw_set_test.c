@@ -0,0 +1,134 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_rw_set_test.c
+ *
+ *  Exercises the read/write set shared by the transaction protocols, both
+ *  below and above the size at which it gets a hash index.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "platform.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_internal.h"
+
+#define TEST_MAX_KEY_SIZE 32
+
+// Enough keys for the index to be built and grown a few times
+#define TEST_NUM_KEYS (64 * TRANSACTION_MIN_RW_ENTRIES)
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_rw_set)
+{
+   // Declare head handles for memory allocation.
+   platform_heap_handle hh;
+   platform_heap_id     hid;
+
+   data_config data_cfg;
+   transaction txn;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_rw_set)
+{
+   platform_status rc = platform_heap_create(
+      platform_get_module_id(), (1 * GiB), &data->hh, &data->hid);
+   platform_assert_status_ok(rc);
+
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->data_cfg);
+   memset(&data->txn, 0, sizeof(data->txn));
+   data->txn.arena = transaction_arena_create(data->hid);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_rw_set)
+{
+   transaction_arena_destroy(data->txn.arena);
+   platform_heap_destroy(&data->hh);
+}
+
+static slice
+make_key(transaction *txn, uint64 i)
+{
+   char buf[TEST_MAX_KEY_SIZE];
+   int  len = snprintf(buf, sizeof(buf), "key-%lu", i);
+   return transaction_arena_copy_slice(txn->arena, slice_create(len, buf));
+}
+
+// The set only stores the entries, so any distinct pointers will do.
+static rw_entry *
+make_entry(transaction *txn)
+{
+   return transaction_arena_alloc(txn->arena, 1);
+}
+
+static void
+append_keys(transaction       *txn,
+            const data_config *cfg,
+            rw_entry         **entries,
+            uint64             num_keys)
+{
+   for (uint64 i = 0; i < num_keys; i++) {
+      entries[i] = make_entry(txn);
+      transaction_append_rw_entry(txn, cfg, entries[i], make_key(txn, i));
+   }
+}
+
+/*
+ * Every key appended is found again, whether or not the set is indexed, and
+ * keys that were never appended are not.
+ */
+CTEST2(transaction_rw_set, test_find)
+{
+   transaction       *txn = &data->txn;
+   const data_config *cfg = &data->data_cfg;
+   rw_entry          *entries[TEST_NUM_KEYS];
+
+   for (uint64 i = 0; i < TEST_NUM_KEYS; i++) {
+      entries[i] = make_entry(txn);
+      transaction_append_rw_entry(txn, cfg, entries[i], make_key(txn, i));
+      ASSERT_EQUAL(i + 1, txn->num_rw_entries);
+      ASSERT_EQUAL(i >= TRANSACTION_RW_INDEX_THRESHOLD, txn->rw_index != NULL);
+
+      for (uint64 j = 0; j <= i; j += 1 + i / 8) {
+         ASSERT_TRUE(entries[j]
+                     == transaction_find_rw_entry(txn, cfg, make_key(txn, j)));
+      }
+      ASSERT_NULL(transaction_find_rw_entry(txn, cfg, make_key(txn, i + 1)));
+   }
+}
+
+/*
+ * Popping removes exactly the last entry from the set and its index.
+ */
+CTEST2(transaction_rw_set, test_pop)
+{
+   transaction       *txn = &data->txn;
+   const data_config *cfg = &data->data_cfg;
+   rw_entry          *entries[TEST_NUM_KEYS];
+
+   append_keys(txn, cfg, entries, TEST_NUM_KEYS);
+
+   for (uint64 n = TEST_NUM_KEYS; n > TEST_NUM_KEYS / 2; n--) {
+      transaction_pop_rw_entry(txn, cfg);
+      ASSERT_EQUAL(n - 1, txn->num_rw_entries);
+      ASSERT_NULL(transaction_find_rw_entry(txn, cfg, make_key(txn, n - 1)));
+   }
+
+   for (uint64 i = 0; i < TEST_NUM_KEYS / 2; i++) {
+      ASSERT_TRUE(entries[i]
+                  == transaction_find_rw_entry(txn, cfg, make_key(txn, i)));
+   }
+
+   // Popped keys can be appended again
+   rw_entry *entry = make_entry(txn);
+   slice     key   = make_key(txn, TEST_NUM_KEYS - 1);
+   transaction_append_rw_entry(txn, cfg, entry, key);
+   ASSERT_TRUE(entry == transaction_find_rw_entry(txn, cfg, key));
+}
@@ -0,0 +1,368 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_scan_test.c
+ *
+ *  Exercises transactional iterators under every transaction protocol: they
+ *  return what was committed, and a transaction fails to commit if a range
+ *  it scanned changed in the meantime.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "transaction_internal.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+#define TEST_NUM_KEYS 100
+
+static const char key_fmt[] = "key-%04d";
+static const char val_fmt[] = "val-%04d";
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_scan)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_scan)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_scan) {}
+
+static slice
+make_slice(char *buf, size_t size, const char *fmt, int i)
+{
+   return slice_create(snprintf(buf, size, fmt, i), buf);
+}
+
+// Commits TEST_NUM_KEYS keys, at even numbers so there are gaps to insert in
+static void
+load_keys(transactional_splinterdb *txn_kvsb)
+{
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   for (int i = 0; i < TEST_NUM_KEYS; i++) {
+      char key[TEST_MAX_KEY_SIZE];
+      char val[TEST_MAX_KEY_SIZE];
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_insert(
+                      txn_kvsb,
+                      &txn,
+                      make_slice(key, sizeof(key), key_fmt, 2 * i),
+                      make_slice(val, sizeof(val), val_fmt, 2 * i)));
+   }
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+}
+
+// Scans up to num_keys keys of txn starting at the key numbered start
+static int
+scan_keys(transactional_splinterdb *txn_kvsb,
+          transaction              *txn,
+          int                       start,
+          int                       num_keys)
+{
+   char  start_key[TEST_MAX_KEY_SIZE];
+   slice start_slice = make_slice(start_key, sizeof(start_key), key_fmt, start);
+
+   transactional_splinterdb_iterator *it;
+   ASSERT_EQUAL(0,
+                transactional_splinterdb_iterator_init(
+                   txn_kvsb, txn, &it, start_slice));
+
+   int n = 0;
+   for (; n < num_keys && transactional_splinterdb_iterator_valid(it); n++) {
+      transactional_splinterdb_iterator_next(it);
+   }
+   ASSERT_EQUAL(0, transactional_splinterdb_iterator_status(it));
+   transactional_splinterdb_iterator_deinit(it);
+   return n;
+}
+
+/*
+ * Scans [start, start + num_keys) in one transaction, commits a write of the
+ * key numbered written in another, and returns the result of committing the
+ * scanning transaction.
+ */
+static int
+scan_then_commit_write(transactional_splinterdb *txn_kvsb,
+                       int                       start,
+                       int                       num_keys,
+                       int                       written,
+                       bool                      is_delete)
+{
+   transaction scanner, writer;
+   transactional_splinterdb_begin(txn_kvsb, &scanner);
+   scan_keys(txn_kvsb, &scanner, start, num_keys);
+
+   char  key[TEST_MAX_KEY_SIZE];
+   slice key_slice = make_slice(key, sizeof(key), key_fmt, written);
+   transactional_splinterdb_begin(txn_kvsb, &writer);
+   if (is_delete) {
+      ASSERT_EQUAL(
+         0, transactional_splinterdb_delete(txn_kvsb, &writer, key_slice));
+   } else {
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_insert(
+                      txn_kvsb, &writer, key_slice, slice_create(3, "new")));
+   }
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &writer));
+
+   return transactional_splinterdb_commit(txn_kvsb, &scanner);
+}
+
+/*
+ * A scan returns the committed keys in order, with the values the
+ * application stored, whatever the protocol keeps next to them.
+ */
+CTEST2(transaction_scan, test_scan_committed)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      transaction_test_create_db(&data->txn_kvsb, &data->cfg, p);
+      load_keys(data->txn_kvsb);
+
+      transaction txn;
+      transactional_splinterdb_begin(data->txn_kvsb, &txn);
+
+      transactional_splinterdb_iterator *it;
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_iterator_init(
+                      data->txn_kvsb, &txn, &it, NULL_SLICE));
+      int i = 0;
+      for (; transactional_splinterdb_iterator_valid(it); i++) {
+         char  key[TEST_MAX_KEY_SIZE];
+         char  val[TEST_MAX_KEY_SIZE];
+         slice expected_key = make_slice(key, sizeof(key), key_fmt, 2 * i);
+         slice expected_val = make_slice(val, sizeof(val), val_fmt, 2 * i);
+
+         slice found_key, found_val;
+         transactional_splinterdb_iterator_get_current(
+            it, &found_key, &found_val);
+         ASSERT_EQUAL(0, slice_lex_cmp(expected_key, found_key));
+         ASSERT_EQUAL(0, slice_lex_cmp(expected_val, found_val));
+
+         transactional_splinterdb_iterator_next(it);
+      }
+      ASSERT_EQUAL(0, transactional_splinterdb_iterator_status(it));
+      ASSERT_EQUAL(TEST_NUM_KEYS, i);
+      transactional_splinterdb_iterator_deinit(it);
+
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(data->txn_kvsb, &txn));
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * Inserting into, deleting from, or updating a scanned range fails the
+ * commit of the scanning transaction. Writes elsewhere do not.
+ */
+CTEST2(transaction_scan, test_phantoms)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      if (p == TRANSACTION_PROTOCOL_MVCC) {
+         // Snapshot isolation allows phantoms
+         continue;
+      }
+      transaction_test_create_db(&data->txn_kvsb, &data->cfg, p);
+      load_keys(data->txn_kvsb);
+
+      // Ten keys from 20 leave the iterator on 40, so each of these scans
+      // covers [20, 40]
+      ASSERT_NOT_EQUAL(
+         0, scan_then_commit_write(data->txn_kvsb, 20, 10, 25, FALSE));
+      ASSERT_NOT_EQUAL(
+         0, scan_then_commit_write(data->txn_kvsb, 20, 10, 24, TRUE));
+      ASSERT_NOT_EQUAL(
+         0, scan_then_commit_write(data->txn_kvsb, 20, 10, 30, FALSE));
+      ASSERT_EQUAL(
+         0, scan_then_commit_write(data->txn_kvsb, 20, 10, 41, FALSE));
+      ASSERT_EQUAL(
+         0, scan_then_commit_write(data->txn_kvsb, 20, 10, 19, FALSE));
+
+      // A scan that reaches the end of the database covers what comes after
+      int last = 2 * (TEST_NUM_KEYS - 1);
+      ASSERT_NOT_EQUAL(
+         0, scan_then_commit_write(data->txn_kvsb, last, 10, last + 1, FALSE));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * A transaction that read a key, then scanned the write of a transaction that
+ * overwrote that key, cannot commit: it would have to come both before and
+ * after the writer. Under 2PL the writer would wait on the read lock, and
+ * snapshot isolation allows the skew.
+ */
+CTEST2(transaction_scan, test_read_skew)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      if (p == TRANSACTION_PROTOCOL_MVCC
+          || (TRANSACTION_PROTOCOL_2PL_NO_WAIT <= p
+              && p <= TRANSACTION_PROTOCOL_2PL_DETECT))
+      {
+         continue;
+      }
+      transaction_test_create_db(&data->txn_kvsb, &data->cfg, p);
+      load_keys(data->txn_kvsb);
+
+      transaction scanner, writer;
+      transactional_splinterdb_begin(data->txn_kvsb, &scanner);
+
+      char                     key[TEST_MAX_KEY_SIZE];
+      splinterdb_lookup_result result;
+      transactional_splinterdb_lookup_result_init(
+         data->txn_kvsb, &result, 0, NULL);
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_lookup(
+                      data->txn_kvsb,
+                      &scanner,
+                      make_slice(key, sizeof(key), key_fmt, 10),
+                      &result));
+      splinterdb_lookup_result_deinit(&result);
+
+      transactional_splinterdb_begin(data->txn_kvsb, &writer);
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_insert(
+                      data->txn_kvsb,
+                      &writer,
+                      make_slice(key, sizeof(key), key_fmt, 10),
+                      slice_create(3, "new")));
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_insert(
+                      data->txn_kvsb,
+                      &writer,
+                      make_slice(key, sizeof(key), key_fmt, 30),
+                      slice_create(3, "new")));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(data->txn_kvsb, &writer));
+
+      // The scan sees the new 30, and nothing changes in its range after
+      scan_keys(data->txn_kvsb, &scanner, 30, 1);
+      ASSERT_EQUAL(TRANSACTION_ABORTED,
+                   transactional_splinterdb_commit(data->txn_kvsb, &scanner));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+typedef struct writer_args {
+   transactional_splinterdb *txn_kvsb;
+   int                       read;    // The key it reads
+   int                       written; // The key it inserts
+   int                       rc;
+} writer_args;
+
+// Reads a key and inserts another in a transaction on a thread of its own
+static void *
+read_then_insert(void *arg)
+{
+   writer_args *args = (writer_args *)arg;
+   transactional_splinterdb_register_thread(args->txn_kvsb);
+
+   transaction txn;
+   transactional_splinterdb_begin(args->txn_kvsb, &txn);
+
+   char                     key[TEST_MAX_KEY_SIZE];
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(
+      args->txn_kvsb, &result, 0, NULL);
+   args->rc = transactional_splinterdb_lookup(
+      args->txn_kvsb,
+      &txn,
+      make_slice(key, sizeof(key), key_fmt, args->read),
+      &result);
+   splinterdb_lookup_result_deinit(&result);
+
+   if (args->rc == 0) {
+      args->rc = transactional_splinterdb_insert(
+         args->txn_kvsb,
+         &txn,
+         make_slice(key, sizeof(key), key_fmt, args->written),
+         slice_create(3, "new"));
+   }
+   if (args->rc == 0) {
+      args->rc = transactional_splinterdb_commit(args->txn_kvsb, &txn);
+   }
+   transactional_splinterdb_deregister_thread(args->txn_kvsb);
+   return NULL;
+}
+
+static int
+run_writer(transactional_splinterdb *txn_kvsb, int read, int written)
+{
+   writer_args args = {.txn_kvsb = txn_kvsb, .read = read, .written = written};
+   pthread_t   thread;
+   ASSERT_EQUAL(0, pthread_create(&thread, NULL, read_then_insert, &args));
+   pthread_join(thread, NULL);
+   return args.rc;
+}
+
+/*
+ * A transaction that commits while a scanning one is past validating its
+ * scans, and before it installed its writes, fails if it inserts into a
+ * scanned range. Whether it read a key the scanning transaction wrote does
+ * not matter, e.g. TicToc would let it commit at an earlier timestamp.
+ */
+CTEST2(transaction_scan, test_insert_while_scanner_installs)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      if (p == TRANSACTION_PROTOCOL_MVCC) {
+         // Snapshot isolation allows phantoms
+         continue;
+      }
+      transaction_test_create_db(&data->txn_kvsb, &data->cfg, p);
+      load_keys(data->txn_kvsb);
+
+      // Stop the scanner where its protocol would lock and install, with
+      // its scan covering [20, 40]
+      transaction scanner;
+      transactional_splinterdb_begin(data->txn_kvsb, &scanner);
+      scan_keys(data->txn_kvsb, &scanner, 20, 10);
+      ASSERT_TRUE(transaction_validate_scans(data->txn_kvsb, &scanner));
+
+      ASSERT_EQUAL(TRANSACTION_ABORTED, run_writer(data->txn_kvsb, 30, 25));
+      ASSERT_EQUAL(TRANSACTION_ABORTED, run_writer(data->txn_kvsb, 50, 33));
+      ASSERT_EQUAL(0, run_writer(data->txn_kvsb, 50, 41));
+
+      transaction_finish_commit(data->txn_kvsb);
+      ASSERT_EQUAL(0, transactional_splinterdb_abort(data->txn_kvsb, &scanner));
+
+      transaction_abort_stats stats;
+      transactional_splinterdb_abort_stats(data->txn_kvsb, &stats);
+      ASSERT_EQUAL(2, stats.aborts[TRANSACTION_ABORT_PHANTOM]);
+
+      // Once the scanner is done, the range is free again
+      ASSERT_EQUAL(0, run_writer(data->txn_kvsb, 30, 25));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
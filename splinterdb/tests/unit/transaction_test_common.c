@@ -0,0 +1,58 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * transaction_test_common.c:
+ *  Shared methods used by the transactional unit-test modules.
+ */
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "ctest.h"
+#include "transaction_test_common.h"
+
+void
+transaction_test_init_config(data_config *data_cfg, splinterdb_config *cfg)
+{
+   default_data_config_init(TEST_MAX_KEY_SIZE, data_cfg);
+   *cfg = (splinterdb_config){.filename   = TEST_DB_NAME,
+                              .cache_size = 64 * Mega,
+                              .disk_size  = 127 * Mega,
+                              .data_cfg   = data_cfg};
+}
+
+void
+transaction_test_init_txn_config(transactional_splinterdb_config *txn_cfg,
+                                 const splinterdb_config         *cfg,
+                                 transaction_protocol             protocol)
+{
+   transactional_splinterdb_config_init(txn_cfg, cfg, protocol);
+   txn_cfg->tscache_log_slots = TEST_TSCACHE_LOG_SLOTS;
+}
+
+void
+transaction_test_create_db(transactional_splinterdb **txn_kvsb,
+                           const splinterdb_config   *cfg,
+                           transaction_protocol       protocol)
+{
+   transactional_splinterdb_config txn_cfg;
+   transaction_test_init_txn_config(&txn_cfg, cfg, protocol);
+   int rc = transactional_splinterdb_create_with_config(&txn_cfg, txn_kvsb);
+   ASSERT_EQUAL(0, rc);
+}
+
+void
+transaction_test_close_db(transactional_splinterdb **txn_kvsb)
+{
+   if (*txn_kvsb) {
+      transactional_splinterdb_close(txn_kvsb);
+   }
+}
+
+int
+write_key(transactional_splinterdb *txn_kvsb,
+          transaction              *txn,
+          const char               *key,
+          const char               *value)
+{
+   return transactional_splinterdb_insert(
+      txn_kvsb, txn, str_slice(key), str_slice(value));
+}
@@ -0,0 +1,52 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * transaction_test_common.h: Shared fixture of the transactional unit-test
+ * modules, which run over a small database of default_data_config keys.
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include "splinterdb/default_data_config.h"
+#include "splinterdb/transaction.h"
+
+#define TEST_MAX_KEY_SIZE 32
+
+// Keep the timestamp caches small, the tests do not need many slots
+#define TEST_TSCACHE_LOG_SLOTS 16
+
+// Sets up data_cfg for keys of up to TEST_MAX_KEY_SIZE bytes, and cfg for a
+// database of TEST_DB_NAME over it
+void
+transaction_test_init_config(data_config *data_cfg, splinterdb_config *cfg);
+
+// transactional_splinterdb_config_init(), with small timestamp caches
+void
+transaction_test_init_txn_config(transactional_splinterdb_config *txn_cfg,
+                                 const splinterdb_config         *cfg,
+                                 transaction_protocol             protocol);
+
+// Creates a database of protocol over cfg, which must succeed
+void
+transaction_test_create_db(transactional_splinterdb **txn_kvsb,
+                           const splinterdb_config   *cfg,
+                           transaction_protocol       protocol);
+
+// Closes *txn_kvsb, if a test left it open
+void
+transaction_test_close_db(transactional_splinterdb **txn_kvsb);
+
+static inline slice
+str_slice(const char *s)
+{
+   return slice_create(strlen(s), s);
+}
+
+// Inserts value at key in txn
+int
+write_key(transactional_splinterdb *txn_kvsb,
+          transaction              *txn,
+          const char               *key,
+          const char               *value);
@@ -0,0 +1,190 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_timestamp_test.c
+ *
+ *  Exercises the timestamp sources of transactions: timestamps are unique
+ *  across threads and grow on each thread.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "platform.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_timestamp.h"
+
+#define TEST_NUM_THREADS 8
+#define TEST_NUM_STAMPS  10000
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_timestamp)
+{
+   transaction_timestamp_allocator *tsa;
+   threadid                         saved_tid;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_timestamp)
+{
+   data->tsa = TYPED_ZALLOC(0, data->tsa);
+   platform_assert(data->tsa != NULL);
+
+   // The sources keep their state per thread, so this one needs an id
+   data->saved_tid = platform_get_tid();
+   platform_set_tid(0);
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_timestamp)
+{
+   platform_set_tid(data->saved_tid);
+   platform_free(0, data->tsa);
+}
+
+typedef struct stamper_args {
+   transaction_timestamp_allocator *tsa;
+   threadid                         tid;
+   uint64                          *stamps;
+} stamper_args;
+
+static void *
+stamper(void *arg)
+{
+   stamper_args *args = (stamper_args *)arg;
+   platform_set_tid(args->tid);
+   for (int i = 0; i < TEST_NUM_STAMPS; i++) {
+      args->stamps[i] = transaction_timestamp_next(args->tsa);
+   }
+   return NULL;
+}
+
+static int
+compare_stamps(const void *a, const void *b)
+{
+   uint64 x = *(const uint64 *)a;
+   uint64 y = *(const uint64 *)b;
+   return x < y ? -1 : x > y;
+}
+
+// Takes timestamps from several threads at once, and checks them
+static void
+check_source(transaction_timestamp_allocator *tsa,
+             transaction_timestamp_source     source)
+{
+   transaction_timestamp_init(tsa, source);
+
+   uint64 *stamps =
+      TYPED_ARRAY_MALLOC(0, stamps, TEST_NUM_THREADS * TEST_NUM_STAMPS);
+   platform_assert(stamps != NULL);
+   pthread_t    threads[TEST_NUM_THREADS];
+   stamper_args args[TEST_NUM_THREADS];
+   for (int t = 0; t < TEST_NUM_THREADS; t++) {
+      args[t] = (stamper_args){
+         .tsa = tsa, .tid = t + 1, .stamps = &stamps[t * TEST_NUM_STAMPS]};
+      ASSERT_EQUAL(0, pthread_create(&threads[t], NULL, stamper, &args[t]));
+   }
+   for (int t = 0; t < TEST_NUM_THREADS; t++) {
+      pthread_join(threads[t], NULL);
+   }
+
+   for (int t = 0; t < TEST_NUM_THREADS; t++) {
+      for (int i = 1; i < TEST_NUM_STAMPS; i++) {
+         ASSERT_TRUE(args[t].stamps[i - 1] < args[t].stamps[i],
+                     "%s: thread %d went back at %d\n",
+                     transaction_timestamp_source_name(source),
+                     t,
+                     i);
+      }
+   }
+
+   qsort(stamps,
+         TEST_NUM_THREADS * TEST_NUM_STAMPS,
+         sizeof(*stamps),
+         compare_stamps);
+   ASSERT_NOT_EQUAL(0, stamps[0]);
+   for (int i = 1; i < TEST_NUM_THREADS * TEST_NUM_STAMPS; i++) {
+      ASSERT_NOT_EQUAL(stamps[i - 1],
+                       stamps[i],
+                       "%s: %lu handed out twice\n",
+                       transaction_timestamp_source_name(source),
+                       stamps[i]);
+   }
+   // Dense sources only skip what is left of the ranges of the threads
+   if (transaction_timestamp_is_dense(source)) {
+      uint64 span = stamps[TEST_NUM_THREADS * TEST_NUM_STAMPS - 1];
+      ASSERT_TRUE(span <= TEST_NUM_THREADS
+                             * (TEST_NUM_STAMPS + TRANSACTION_TIMESTAMP_BATCH),
+                  "%s: last timestamp is %lu\n",
+                  transaction_timestamp_source_name(source),
+                  span);
+   }
+
+   platform_free(0, stamps);
+}
+
+CTEST2(transaction_timestamp, test_counter)
+{
+   check_source(data->tsa, TRANSACTION_TIMESTAMP_COUNTER);
+}
+
+CTEST2(transaction_timestamp, test_batched)
+{
+   check_source(data->tsa, TRANSACTION_TIMESTAMP_BATCHED);
+}
+
+CTEST2(transaction_timestamp, test_tagged)
+{
+   check_source(data->tsa, TRANSACTION_TIMESTAMP_TAGGED);
+}
+
+CTEST2(transaction_timestamp, test_tsc)
+{
+   check_source(data->tsa, TRANSACTION_TIMESTAMP_TSC);
+}
+
+/*
+ * A thread that took no TAGGED timestamps for a while catches up with the
+ * others on its next one.
+ */
+CTEST2(transaction_timestamp, test_tagged_catch_up)
+{
+   transaction_timestamp_init(data->tsa, TRANSACTION_TIMESTAMP_TAGGED);
+   uint64 first = transaction_timestamp_next(data->tsa);
+
+   platform_set_tid(1);
+   uint64 other = 0;
+   for (int i = 0; i < 10 * TRANSACTION_TIMESTAMP_PUBLISH_INTERVAL; i++) {
+      other = transaction_timestamp_next(data->tsa);
+   }
+
+   platform_set_tid(0);
+   uint64 next = transaction_timestamp_next(data->tsa);
+   ASSERT_TRUE(first < next);
+   uint64 lag = (other >> TRANSACTION_TIMESTAMP_TID_BITS)
+                - (next >> TRANSACTION_TIMESTAMP_TID_BITS);
+   ASSERT_TRUE(next > other || lag < TRANSACTION_TIMESTAMP_PUBLISH_INTERVAL,
+               "lagging by %lu\n",
+               lag);
+}
+
+/*
+ * Every source can be found by its name.
+ */
+CTEST2(transaction_timestamp, test_source_names)
+{
+   for (transaction_timestamp_source s = TRANSACTION_TIMESTAMP_INVALID + 1;
+        s < TRANSACTION_TIMESTAMP_MAX_VALID;
+        s++)
+   {
+      const char *name = transaction_timestamp_source_name(s);
+      ASSERT_EQUAL(s, transaction_timestamp_source_from_name(name));
+   }
+   ASSERT_EQUAL(TRANSACTION_TIMESTAMP_INVALID,
+                transaction_timestamp_source_from_name("no-such-source"));
+}
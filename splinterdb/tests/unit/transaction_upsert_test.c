@@ -0,0 +1,341 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_upsert_test.c
+ *
+ *  Exercises upserts (UPDATE messages) in transactions under every
+ *  transaction protocol, with values that are counters the updates add to:
+ *  a transaction reads its own pending updates merged over what was
+ *  committed, and commits them as if it had written the sum. With
+ *  commutative updates, transactions that only update a counter do not
+ *  conflict on it.
+ * -----------------------------------------------------------------------------
+ */
+#include "splinterdb/public_platform.h"
+#include "unit_tests.h"
+#include "util.h"
+#include "ctest.h" // This is required for all test-case files.
+#include "transaction_test_common.h"
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction_upsert)
+{
+   data_config               data_cfg;
+   splinterdb_config         cfg;
+   transactional_splinterdb *txn_kvsb;
+};
+
+// Adds the delta in new_message to the counter in old_message
+static int
+counter_merge_tuples(const data_config *cfg,
+                     slice              key,
+                     message            old_message,
+                     merge_accumulator *new_message)
+{
+   uint64 old_count, delta;
+   platform_assert(message_length(old_message) == sizeof(old_count));
+   platform_assert(merge_accumulator_length(new_message) == sizeof(delta));
+   memcpy(&old_count, message_data(old_message), sizeof(old_count));
+   memcpy(&delta, merge_accumulator_data(new_message), sizeof(delta));
+   uint64 count = old_count + delta;
+   memcpy(merge_accumulator_data(new_message), &count, sizeof(count));
+   merge_accumulator_set_class(new_message, message_class(old_message));
+   return 0;
+}
+
+// A delta to nothing is a counter that starts from 0
+static int
+counter_merge_tuples_final(const data_config *cfg,
+                           slice              key,
+                           merge_accumulator *oldest_message)
+{
+   merge_accumulator_set_class(oldest_message, MESSAGE_TYPE_INSERT);
+   return 0;
+}
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction_upsert)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   transaction_test_init_config(&data->data_cfg, &data->cfg);
+   data->data_cfg.merge_tuples       = counter_merge_tuples;
+   data->data_cfg.merge_tuples_final = counter_merge_tuples_final;
+   data->txn_kvsb = NULL;
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction_upsert)
+{
+   transaction_test_close_db(&data->txn_kvsb);
+}
+
+static void
+create_db_with(transactional_splinterdb **txn_kvsb,
+               const splinterdb_config   *cfg,
+               transaction_protocol       protocol,
+               bool                       commutative_updates)
+{
+   transactional_splinterdb_config txn_cfg;
+   transaction_test_init_txn_config(&txn_cfg, cfg, protocol);
+   txn_cfg.commutative_updates = commutative_updates;
+   int rc = transactional_splinterdb_create_with_config(&txn_cfg, txn_kvsb);
+   ASSERT_EQUAL(0, rc);
+}
+
+static int
+set_counter(transactional_splinterdb *txn_kvsb,
+            transaction              *txn,
+            const char               *key,
+            uint64                    count)
+{
+   return transactional_splinterdb_insert(
+      txn_kvsb, txn, str_slice(key), slice_create(sizeof(count), &count));
+}
+
+static int
+add_counter(transactional_splinterdb *txn_kvsb,
+            transaction              *txn,
+            const char               *key,
+            uint64                    delta)
+{
+   return transactional_splinterdb_update(
+      txn_kvsb, txn, str_slice(key), slice_create(sizeof(delta), &delta));
+}
+
+// Returns whether txn sees key, and checks that it sees it with count
+static bool
+read_counter(transactional_splinterdb *txn_kvsb,
+             transaction              *txn,
+             const char               *key,
+             uint64                    count)
+{
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(txn_kvsb, &result, 0, NULL);
+   int rc = transactional_splinterdb_lookup(
+      txn_kvsb, txn, str_slice(key), &result);
+   ASSERT_EQUAL(0, rc);
+
+   bool found = splinterdb_lookup_found(&result);
+   if (found) {
+      slice  value;
+      uint64 found_count;
+      ASSERT_EQUAL(0, splinterdb_lookup_result_value(&result, &value));
+      ASSERT_EQUAL(sizeof(found_count), slice_length(value));
+      memcpy(&found_count, slice_data(value), sizeof(found_count));
+      ASSERT_EQUAL(count, found_count);
+   }
+   splinterdb_lookup_result_deinit(&result);
+   return found;
+}
+
+/*
+ * A transaction reads its updates of a committed counter, and of a counter
+ * that does not exist yet, and commits them.
+ */
+CTEST2(transaction_upsert, test_read_own_updates)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      transaction_test_create_db(&data->txn_kvsb, &data->cfg, p);
+      transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+      transaction txn;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, set_counter(txn_kvsb, &txn, "counted", 10));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &txn, "counted", 1));
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "counted", 11),
+                  "%s\n",
+                  transaction_protocol_name(p));
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &txn, "new", 5));
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "new", 5),
+                  "%s\n",
+                  transaction_protocol_name(p));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "counted", 11));
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "new", 5));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * An insert or a delete after an update replaces it, and an update after an
+ * insert applies to the value inserted.
+ */
+CTEST2(transaction_upsert, test_read_own_writes)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      transaction_test_create_db(&data->txn_kvsb, &data->cfg, p);
+      transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+      transaction txn;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &txn, "a", 1));
+      ASSERT_EQUAL(0, set_counter(txn_kvsb, &txn, "a", 100));
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "a", 100),
+                  "%s\n",
+                  transaction_protocol_name(p));
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_delete(
+                      txn_kvsb, &txn, str_slice("a")));
+      ASSERT_FALSE(read_counter(txn_kvsb, &txn, "a", 0),
+                   "%s\n",
+                   transaction_protocol_name(p));
+
+      ASSERT_EQUAL(0, set_counter(txn_kvsb, &txn, "b", 100));
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &txn, "b", 1));
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "b", 101),
+                  "%s\n",
+                  transaction_protocol_name(p));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * Transactions that only update a counter do not conflict on it, in either
+ * commit order, and a transaction that reads the counter too still commits
+ * its update on top of theirs.
+ */
+CTEST2(transaction_upsert, test_commutative_updates)
+{
+   for (transaction_protocol p = TRANSACTION_PROTOCOL_INVALID + 1;
+        p < TRANSACTION_PROTOCOL_MAX_VALID;
+        p++)
+   {
+      create_db_with(&data->txn_kvsb, &data->cfg, p, TRUE);
+      transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+      transaction txn;
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, set_counter(txn_kvsb, &txn, "hot", 10));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transaction first, second;
+      transactional_splinterdb_begin(txn_kvsb, &first);
+      transactional_splinterdb_begin(txn_kvsb, &second);
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &first, "hot", 1));
+      ASSERT_EQUAL(0,
+                   add_counter(txn_kvsb, &second, "hot", 2),
+                   "%s\n",
+                   transaction_protocol_name(p));
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &first, "hot", 4));
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_commit(txn_kvsb, &second),
+                   "%s\n",
+                   transaction_protocol_name(p));
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_commit(txn_kvsb, &first),
+                   "%s\n",
+                   transaction_protocol_name(p));
+
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "hot", 17),
+                  "%s\n",
+                  transaction_protocol_name(p));
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &txn, "hot", 8));
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "hot", 25));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_TRUE(read_counter(txn_kvsb, &txn, "hot", 25),
+                  "%s\n",
+                  transaction_protocol_name(p));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+      transactional_splinterdb_close(&data->txn_kvsb);
+   }
+}
+
+/*
+ * Without commutative updates, the blind updates of two transactions to the
+ * same counter still conflict.
+ */
+CTEST2(transaction_upsert, test_updates_conflict_by_default)
+{
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+   transaction first, second;
+   transactional_splinterdb_begin(txn_kvsb, &first);
+   transactional_splinterdb_begin(txn_kvsb, &second);
+   ASSERT_EQUAL(0, add_counter(txn_kvsb, &first, "hot", 1));
+   ASSERT_EQUAL(0, add_counter(txn_kvsb, &second, "hot", 2));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &second));
+   ASSERT_NOT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &first));
+}
+
+// A memtable small enough for TEST_NUM_FILLER_KEYS to fill it a few times
+#define TEST_MEMTABLE_CAPACITY (1 * Mega)
+#define TEST_NUM_FILLER_KEYS   16384
+#define TEST_FILLER_SIZE       256
+#define TEST_NUM_UPDATES       2000
+
+/*
+ * Committed updates of a counter that was flushed out of the memtable all
+ * add up, however many there are.
+ */
+CTEST2(transaction_upsert, test_many_updates_after_flush)
+{
+   data->cfg.memtable_capacity = TEST_MEMTABLE_CAPACITY;
+   transaction_test_create_db(
+      &data->txn_kvsb, &data->cfg, TRANSACTION_PROTOCOL_MVCC);
+   transactional_splinterdb *txn_kvsb = data->txn_kvsb;
+
+   transaction txn;
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_EQUAL(0, set_counter(txn_kvsb, &txn, "counted", 0));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+   char filler[TEST_FILLER_SIZE];
+   memset(filler, 'f', sizeof(filler));
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   for (int i = 0; i < TEST_NUM_FILLER_KEYS; i++) {
+      char key[TEST_MAX_KEY_SIZE];
+      snprintf(key, sizeof(key), "filler-%06d", i);
+      ASSERT_EQUAL(0,
+                   transactional_splinterdb_insert(
+                      txn_kvsb,
+                      &txn,
+                      str_slice(key),
+                      slice_create(sizeof(filler), filler)));
+      if (i % 1024 == 1023) {
+         ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+         transactional_splinterdb_begin(txn_kvsb, &txn);
+      }
+   }
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+   for (int i = 0; i < TEST_NUM_UPDATES; i++) {
+      transactional_splinterdb_begin(txn_kvsb, &txn);
+      ASSERT_EQUAL(0, add_counter(txn_kvsb, &txn, "counted", 1));
+      ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+   }
+
+   transactional_splinterdb_begin(txn_kvsb, &txn);
+   ASSERT_TRUE(read_counter(txn_kvsb, &txn, "counted", TEST_NUM_UPDATES));
+   ASSERT_EQUAL(0, transactional_splinterdb_commit(txn_kvsb, &txn));
+
+   // Closing flushes the memtable, which must still fit every chain
+   transactional_splinterdb_close(&data->txn_kvsb);
+}